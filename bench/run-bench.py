@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+#
+# The AEGeAn Toolkit is distributed under the ISC License. See
+# the 'LICENSE' file in the AEGeAn source code distribution or
+# online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+#
+# Run the AEGeAn programs on a synthetic data set (see synth-genome.py) and
+# record the wall time, CPU time, peak memory, and throughput of each run as
+# JSON. The data set is generated on the first run and reused as long as the
+# generator parameters do not change.
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import time
+
+BENCHDIR = os.path.dirname(os.path.abspath(__file__))
+
+
+def benchmarks(bindir, data, outdir):
+    """Name, command, input file(s), and stdin/stdout redirection of each."""
+    refr = data + '-refr.gff3'
+    pred = data + '-pred.gff3'
+    aligns = data + '-aligns.gff3'
+    fasta = data + '.fa'
+    out = os.path.join(outdir, 'out')
+    bin = lambda name: os.path.join(bindir, name)
+    return [
+        ('parseval', [bin('parseval'), '-w', '-s', '-o', out, refr, pred],
+         [refr, pred], None, None),
+        ('locuspocus', [bin('locuspocus'), '-o', out, refr],
+         [refr], None, None),
+        ('locuspocus-refine', [bin('locuspocus'), '--refine', '-o', out, refr],
+         [refr], None, None),
+        ('xtractore', [bin('xtractore'), '-t', 'mRNA', '-o', out, refr, fasta],
+         [refr], None, None),
+        ('gaeval', [bin('gaeval'), aligns, refr],
+         [aligns, refr], None, out),
+        ('canon-gff3', [bin('canon-gff3'), '-o', out, refr],
+         [refr], None, None),
+        ('canon-gff3-threads', [bin('canon-gff3'), '--threads', '4', '-o', out,
+                                refr],
+         [refr], None, None),
+        ('pmrna', [bin('pmrna')],
+         [refr], refr, out),
+    ]
+
+
+def count_features(filename):
+    count = 0
+    with open(filename, 'r') as infile:
+        for line in infile:
+            if line and line[0] != '#' and line != '\n':
+                count += 1
+    return count
+
+
+def run(command, infile, outfile):
+    """Run a command; return wall time, rusage of the child, exit status."""
+    stdin = open(infile, 'r') if infile else subprocess.DEVNULL
+    stdout = open(outfile, 'w') if outfile else subprocess.DEVNULL
+    start = time.time()
+    proc = subprocess.Popen(command, stdin=stdin, stdout=stdout,
+                            stderr=subprocess.DEVNULL)
+    pid, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    proc.returncode = os.WEXITSTATUS(status)
+    for stream in (stdin, stdout):
+        if hasattr(stream, 'close'):
+            stream.close()
+    return wall, usage, proc.returncode
+
+
+def prepare_data(args):
+    """Generate the data set, unless it exists with the same parameters."""
+    os.makedirs(args.workdir, exist_ok=True)
+    prefix = os.path.join(args.workdir, 'synth')
+    params = ['--seed', str(args.seed), '--size', args.size]
+    params.extend(args.genopts)
+    stampfile = prefix + '.params'
+    if os.path.exists(stampfile):
+        with open(stampfile, 'r') as stamp:
+            if stamp.read().split() == params:
+                return prefix, params
+    command = [sys.executable, os.path.join(BENCHDIR, 'synth-genome.py')]
+    subprocess.check_call(command + params + [prefix])
+    with open(stampfile, 'w') as stamp:
+        print(' '.join(params), file=stamp)
+    return prefix, params
+
+
+def main(args):
+    prefix, params = prepare_data(args)
+    features = {}
+    results = []
+    # ru_maxrss is reported in bytes on Mac OS X and in kilobytes elsewhere
+    rssunit = 1024 if platform.system() == 'Darwin' else 1
+    for name, command, inputs, infile, outfile in benchmarks(args.bindir,
+                                                             prefix,
+                                                             args.workdir):
+        if args.programs and name not in args.programs:
+            continue
+        for filename in inputs:
+            if filename not in features:
+                features[filename] = count_features(filename)
+        numfeatures = sum(features[filename] for filename in inputs)
+        numbytes = sum(os.path.getsize(filename) for filename in inputs)
+
+        for i in range(args.repeat):
+            wall, usage, status = run(command, infile, outfile)
+            cpu = usage.ru_utime + usage.ru_stime
+            result = {
+                'benchmark': name,
+                'run': i + 1,
+                'status': status,
+                'wall_sec': round(wall, 3),
+                'cpu_sec': round(cpu, 3),
+                'peak_rss_kb': usage.ru_maxrss // rssunit,
+                'input_features': numfeatures,
+                'input_bytes': numbytes,
+                'features_per_sec': round(numfeatures / wall, 1),
+                'mb_per_sec': round(numbytes / wall / 1000000.0, 2),
+            }
+            results.append(result)
+            print('[run-bench] %-18s %8.2fs %10d KB %s' % (
+                  name, wall, result['peak_rss_kb'],
+                  'ok' if status == 0 else 'exit status %d' % status),
+                  file=sys.stderr)
+
+    report = {
+        'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'host': platform.node(),
+        'generator': params,
+        'results': results,
+    }
+    outstream = open(args.outfile, 'w') if args.outfile else sys.stdout
+    json.dump(report, outstream, indent=2, sort_keys=True)
+    print(file=outstream)
+    if args.outfile:
+        outstream.close()
+    return 0 if all(r['status'] == 0 for r in results) else 1
+
+
+def get_parser():
+    parser = argparse.ArgumentParser(description='Benchmark the AEGeAn '
+                                     'programs on a synthetic data set')
+    parser.add_argument('-b', '--bindir', default='bin',
+                        help='directory containing the AEGeAn programs; '
+                        'default is "bin"')
+    parser.add_argument('-w', '--workdir', default='bench/scratch',
+                        help='directory for data and program output; default '
+                        'is "bench/scratch"')
+    parser.add_argument('-s', '--seed', type=int, default=42,
+                        help='random seed for the data set; default is 42')
+    parser.add_argument('-z', '--size', default='10M',
+                        help='genome size of the data set; default is 10M')
+    parser.add_argument('-g', '--genopt', dest='genopts', action='append',
+                        default=[], metavar='OPT',
+                        help='additional option for synth-genome.py, such '
+                        'as "--density=80"; can be specified multiple times')
+    parser.add_argument('-p', '--program', dest='programs', action='append',
+                        metavar='NAME', help='only run the named benchmark; '
+                        'can be specified multiple times')
+    parser.add_argument('-r', '--repeat', type=int, default=1,
+                        help='number of runs of each benchmark; default is 1')
+    parser.add_argument('-o', '--outfile', metavar='FILE',
+                        help='write JSON results to FILE; default is the '
+                        'terminal (stdout)')
+    return parser
+
+
+if __name__ == '__main__':
+    sys.exit(main(get_parser().parse_args()))
@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+#
+# The AEGeAn Toolkit is distributed under the ISC License. See
+# the 'LICENSE' file in the AEGeAn source code distribution or
+# online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+#
+# Generate a synthetic genome and annotation for benchmarking. The output is
+# fully determined by the seed and the other parameters, so that benchmark
+# results from different commits are comparable.
+#
+# Files written (with the given prefix):
+#   PREFIX.fa            genome sequence
+#   PREFIX-refr.gff3     reference gene models
+#   PREFIX-pred.gff3     prediction: reference models with perturbed exon
+#                        boundaries, some genes missing
+#   PREFIX-aligns.gff3   transcript alignments (cDNA_match) for GAEVAL
+
+import argparse
+import random
+import sys
+
+MAX_GENOME_SIZE = 3 * 1000 ** 3
+
+
+def parse_size(sizestr):
+    """Parse a size such as 500k, 20M, or 3G."""
+    multipliers = {'k': 1000, 'm': 1000 ** 2, 'g': 1000 ** 3}
+    suffix = sizestr[-1].lower()
+    if suffix in multipliers:
+        size = int(float(sizestr[:-1]) * multipliers[suffix])
+    else:
+        size = int(sizestr)
+    if size < 10000 or size > MAX_GENOME_SIZE:
+        raise argparse.ArgumentTypeError('genome size must be between 10k '
+                                         'and 3G')
+    return size
+
+
+def rate(value):
+    value = float(value)
+    if value < 0.0 or value > 1.0:
+        raise argparse.ArgumentTypeError('rate must be between 0 and 1')
+    return value
+
+
+def exon_structure(rng, start, numexons, maxlength=None):
+    """Lay out exons from `start`; return a list of (start, end) tuples."""
+    exons = []
+    pos = start
+    for i in range(numexons):
+        length = rng.randint(60, 400)
+        exons.append((pos, pos + length - 1))
+        pos += length + rng.randint(80, 2000)
+        if maxlength and exons[-1][1] - start + 1 > maxlength:
+            exons.pop()
+            break
+    return exons
+
+
+class Gene(object):
+    """A gene with one or more isoforms, each a list of exons."""
+
+    def __init__(self, rng, args, geneid, seqid, start, strand,
+                 maxlength=None):
+        self.id = geneid
+        self.seqid = seqid
+        self.strand = strand
+        numexons = max(1, int(round(rng.expovariate(1.0 / args.exons))))
+        exons = exon_structure(rng, start, numexons, maxlength)
+        if not exons:
+            exons = [(start, start + 59)]
+        self.isoforms = [exons]
+        numisoforms = max(1, int(round(rng.expovariate(1.0 / args.isoforms))))
+        for i in range(1, numisoforms):
+            self.isoforms.append(self.alternative(rng, exons))
+        self.start = exons[0][0]
+        self.end = exons[-1][1]
+
+    @staticmethod
+    def alternative(rng, exons):
+        """Skip an internal exon, or shift a terminal exon boundary."""
+        if len(exons) > 2 and rng.random() < 0.5:
+            skip = rng.randint(1, len(exons) - 2)
+            return exons[:skip] + exons[skip + 1:]
+        isoform = list(exons)
+        first = isoform[0]
+        newstart = min(first[0] + rng.randint(0, 40), first[1] - 20)
+        isoform[0] = (newstart, first[1])
+        return isoform
+
+    def introns(self):
+        exons = self.isoforms[0]
+        return [(exons[i][1] + 1, exons[i + 1][0] - 1)
+                for i in range(len(exons) - 1)]
+
+    def gff3(self, outstream, source, isoforms=None):
+        if isoforms is None:
+            isoforms = self.isoforms
+        start = min(iso[0][0] for iso in isoforms)
+        end = max(iso[-1][1] for iso in isoforms)
+        fields = [self.seqid, source, 'gene', start, end, '.', self.strand,
+                  '.', 'ID=%s' % self.id]
+        print(*fields, sep='\t', file=outstream)
+        for i, exons in enumerate(isoforms):
+            mrnaid = '%s.%d' % (self.id, i + 1)
+            fields = [self.seqid, source, 'mRNA', exons[0][0], exons[-1][1],
+                      '.', self.strand, '.',
+                      'ID=%s;Parent=%s' % (mrnaid, self.id)]
+            print(*fields, sep='\t', file=outstream)
+            for exon in exons:
+                fields = [self.seqid, source, 'exon', exon[0], exon[1], '.',
+                          self.strand, '.', 'Parent=%s' % mrnaid]
+                print(*fields, sep='\t', file=outstream)
+            for cds, phase in self.coding(exons):
+                fields = [self.seqid, source, 'CDS', cds[0], cds[1], '.',
+                          self.strand, phase,
+                          'ID=%s.cds;Parent=%s' % (mrnaid, mrnaid)]
+                print(*fields, sep='\t', file=outstream)
+
+    def coding(self, exons):
+        """Place the CDS inside the UTRs; return segments with phases."""
+        total = sum(e[1] - e[0] + 1 for e in exons)
+        utr5 = min(total // 5, 150)
+        utr3 = min(total // 5, 200)
+        if self.strand == '-':
+            utr5, utr3 = utr3, utr5
+        cdsstart = self.offset(exons, utr5)
+        cdsend = self.offset(exons, total - utr3 - 1)
+        segments = [(max(e[0], cdsstart), min(e[1], cdsend)) for e in exons
+                    if e[1] >= cdsstart and e[0] <= cdsend]
+        ordered = segments if self.strand == '+' else segments[::-1]
+        phased = []
+        length = 0
+        for segment in ordered:
+            phased.append((segment, (3 - length % 3) % 3))
+            length += segment[1] - segment[0] + 1
+        return sorted(phased)
+
+    @staticmethod
+    def offset(exons, position):
+        """Genomic coordinate of the given position in the spliced exons."""
+        for exon in exons:
+            length = exon[1] - exon[0] + 1
+            if position < length:
+                return exon[0] + position
+            position -= length
+        return exons[-1][1]
+
+
+def perturbed(rng, gene):
+    """Prediction of a gene: most exon boundaries are kept as is."""
+    isoforms = []
+    for exons in gene.isoforms[:2]:
+        newexons = []
+        for i, exon in enumerate(exons):
+            start, end = exon
+            if rng.random() < 0.15:
+                start += rng.randint(-15, 15)
+            if rng.random() < 0.15:
+                end += rng.randint(-15, 15)
+            if i > 0:
+                start = max(start, newexons[-1][1] + 20)
+            end = max(end, start + 20)
+            newexons.append((start, end))
+        isoforms.append(newexons)
+    return isoforms
+
+
+def alignments(rng, gene, count):
+    """Partial transcript alignments, one list of segments per alignment."""
+    exons = gene.isoforms[0]
+    aligns = []
+    for i in range(count):
+        first = rng.randint(0, len(exons) - 1)
+        last = rng.randint(first, len(exons) - 1)
+        segments = list(exons[first:last + 1])
+        segments[0] = (segments[0][0] - rng.randint(-20, 60), segments[0][1])
+        segments[-1] = (segments[-1][0], segments[-1][1] + rng.randint(-20, 60))
+        segments = [(max(1, s), max(max(1, s) + 9, e)) for s, e in segments]
+        aligns.append(segments)
+    return aligns
+
+
+def write_sequence(rng, outstream, seqid, length):
+    """Write a random sequence in lines of 80, without holding it in memory."""
+    table = bytes(b'ACGT' * 64)
+    print('>%s' % seqid, file=outstream)
+    chunk = 80 * 12500
+    remaining = length
+    while remaining > 0:
+        size = min(chunk, remaining)
+        raw = rng.getrandbits(8 * size).to_bytes(size, 'little')
+        seq = raw.translate(table).decode('ascii')
+        lines = [seq[i:i + 80] for i in range(0, size, 80)]
+        outstream.write('\n'.join(lines) + '\n')
+        remaining -= size
+
+
+def generate(args):
+    rng = random.Random(args.seed)
+    seqrng = random.Random(args.seed + 1)
+    numseqs = args.seqs or max(1, args.size // 100000000)
+    seqlength = args.size // numseqs
+    genespacing = 1000000.0 / args.density
+
+    fasta = open(args.prefix + '.fa', 'w')
+    refr = open(args.prefix + '-refr.gff3', 'w')
+    pred = open(args.prefix + '-pred.gff3', 'w')
+    aligns = open(args.prefix + '-aligns.gff3', 'w')
+    for outstream in (refr, pred, aligns):
+        print('##gff-version   3', file=outstream)
+        for i in range(numseqs):
+            print('##sequence-region   seq%d 1 %d' % (i + 1, seqlength),
+                  file=outstream)
+
+    genecount = 0
+    aligncount = 0
+    for i in range(numseqs):
+        seqid = 'seq%d' % (i + 1)
+        write_sequence(seqrng, fasta, seqid, seqlength)
+        seqaligns = []
+        prev = None
+        pos = 1 + int(rng.expovariate(1.0 / genespacing))
+        while True:
+            strand = rng.choice('+-')
+            maxlength = None
+            start = pos
+            nested = prev is not None and rng.random() < args.nesting
+            if nested:
+                introns = prev.introns()
+                if introns:
+                    intron = max(introns, key=lambda r: r[1] - r[0])
+                    maxlength = intron[1] - intron[0] - 200
+                if maxlength is None or maxlength < 200:
+                    nested = False
+                else:
+                    start = intron[0] + 100
+            if not nested and prev is not None and \
+                    rng.random() < args.overlap:
+                start = rng.randint(prev.start, prev.end)
+                strand = '-' if prev.strand == '+' else '+'
+            if start + 10000 >= seqlength:
+                break
+
+            genecount += 1
+            gene = Gene(rng, args, 'gene%06d' % genecount, seqid, start,
+                        strand, maxlength)
+            if gene.end >= seqlength:
+                break
+            gene.gff3(refr, 'synth')
+            if rng.random() >= args.missing:
+                gene.gff3(pred, 'synthpred', perturbed(rng, gene))
+            for segments in alignments(rng, gene, args.aligns):
+                aligncount += 1
+                seqaligns.append((segments[0][0], aligncount, segments,
+                                  gene.strand))
+
+            if not nested:
+                prev = gene
+            spacing = int(rng.expovariate(1.0 / genespacing))
+            pos = max(pos, gene.end) + 1 + spacing
+
+        # Alignments are written in order of start position
+        for start, alignid, segments, strand in sorted(seqaligns):
+            for segment in segments:
+                fields = [seqid, 'synth', 'cDNA_match', segment[0],
+                          segment[1], '.', strand, '.',
+                          'ID=aln%07d' % alignid]
+                print(*fields, sep='\t', file=aligns)
+
+    for outstream in (fasta, refr, pred, aligns):
+        outstream.close()
+    print('[synth-genome] %d sequences, %d genes, %d alignments'
+          % (numseqs, genecount, aligncount), file=sys.stderr)
+
+
+def get_parser():
+    parser = argparse.ArgumentParser(description='Generate a synthetic '
+                                     'genome and annotation for benchmarking')
+    parser.add_argument('-s', '--seed', type=int, default=42,
+                        help='random seed; default is 42')
+    parser.add_argument('-z', '--size', type=parse_size, default='10M',
+                        help='genome size, such as 500k, 20M, or 3G; default '
+                        'is 10M')
+    parser.add_argument('-n', '--seqs', type=int, default=0,
+                        help='number of sequences; default is one per 100 '
+                        'Mb, at least 1')
+    parser.add_argument('-d', '--density', type=float, default=40.0,
+                        help='genes per Mb; default is 40')
+    parser.add_argument('-i', '--isoforms', type=float, default=1.5,
+                        help='mean isoforms per gene; default is 1.5')
+    parser.add_argument('-e', '--exons', type=float, default=5.0,
+                        help='mean exons per transcript; default is 5')
+    parser.add_argument('-o', '--overlap', type=rate, default=0.05,
+                        help='rate of genes overlapping the previous gene on '
+                        'the opposite strand; default is 0.05')
+    parser.add_argument('-t', '--nesting', type=rate, default=0.02,
+                        help='rate of genes nested in an intron of the '
+                        'previous gene; default is 0.02')
+    parser.add_argument('-m', '--missing', type=rate, default=0.05,
+                        help='rate of reference genes missing from the '
+                        'prediction; default is 0.05')
+    parser.add_argument('-a', '--aligns', type=int, default=2,
+                        help='transcript alignments per gene; default is 2')
+    parser.add_argument('prefix', help='prefix for output files')
+    return parser
+
+
+if __name__ == '__main__':
+    generate(get_parser().parse_args())
@@ -0,0 +1,131 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_ALIGNMENT_INDEX
+#define AEGEAN_ALIGNMENT_INDEX
+
+#include "extended/feature_node_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnAlignmentIndex
+ *
+ * Compact in-memory store of transcript alignments, used by GAEVAL in place of
+ * a ``GtFeatureIndex``. Each alignment is reduced to its strand, range, aligned
+ * segments, and gaps; the feature nodes themselves are not retained. For each
+ * sequence, alignments are kept in an array sorted by start coordinate, so
+ * that queries made in coordinate order are resolved by a single sweep.
+ */
+typedef struct AgnAlignmentIndex AgnAlignmentIndex;
+
+/**
+ * @type Read-only view of a single alignment stored in an
+ * ``AgnAlignmentIndex``. The segment and gap arrays belong to the index and are
+ * only valid until more alignments are added to it.
+ * @member [GtRange] range the range spanned by the alignment
+ * @member [GtStrand] strand the strand of the alignment
+ * @member [const GtRange *] segments aligned segments, sorted by coordinate
+ * @member [GtUword] num_segments number of aligned segments
+ * @member [const GtRange *] gaps gaps between aligned segments
+ * @member [GtUword] num_gaps number of gaps
+ */
+struct AgnAlignment
+{
+  GtRange range;
+  GtStrand strand;
+  const GtRange *segments;
+  GtUword num_segments;
+  const GtRange *gaps;
+  GtUword num_gaps;
+};
+typedef struct AgnAlignment AgnAlignment;
+
+/**
+ * @function Add an alignment to the index. The segments of the alignment are
+ * any features in the given feature graph that are not of type ``match_gap``.
+ * The gaps are its ``match_gap`` features or, if it has none, are inferred
+ * between consecutive segments. The index does not take ownership of the
+ * feature.
+ */
+void agn_alignment_index_add(AgnAlignmentIndex *idx, GtFeatureNode *alignment);
+
+/**
+ * @function Class destructor.
+ */
+void agn_alignment_index_delete(AgnAlignmentIndex *idx);
+
+/**
+ * @function Pull all feature nodes from the given stream and add them to the
+ * index. The nodes are deleted once added. Returns 0 on success and -1 on
+ * error.
+ */
+int agn_alignment_index_load(AgnAlignmentIndex *idx, GtNodeStream *stream,
+                             GtError *error);
+
+/**
+ * @function Get the number of alignments on sequence ``seqid`` containing a gap
+ * with exactly the given coordinates. Gap support counts are tallied as
+ * alignments are added, so this is a constant-time lookup.
+ */
+GtUword agn_alignment_index_gap_support(AgnAlignmentIndex *idx,
+                                        const char *seqid, GtRange *gap);
+
+/**
+ * @function Same as ``agn_alignment_index_query``, except that the index is
+ * never modified: no sweep position is retained between calls, so each lookup
+ * is a binary search. The index must first be sorted with
+ * ``agn_alignment_index_prepare``; after that, lookups can safely be issued
+ * from multiple threads at once, provided no alignments are added or pruned in
+ * the meantime.
+ */
+GtUword agn_alignment_index_lookup(AgnAlignmentIndex *idx, const char *seqid,
+                                   GtRange *range, GtArray *hits);
+
+/**
+ * @function Class constructor.
+ */
+AgnAlignmentIndex *agn_alignment_index_new();
+
+/**
+ * @function Sort the alignments for every sequence in the index, in
+ * preparation for calls to ``agn_alignment_index_lookup``.
+ */
+void agn_alignment_index_prepare(AgnAlignmentIndex *idx);
+
+/**
+ * @function Discard alignments that cannot overlap with any feature at or
+ * beyond position ``pos`` of sequence ``seqid``: all alignments from other
+ * sequences, and alignments on ``seqid`` that end before ``pos``. Intended for
+ * processing coordinate-sorted data with a sliding window of alignments; the
+ * actual compaction is deferred until enough alignments have accumulated to
+ * make it worthwhile.
+ */
+void agn_alignment_index_prune(AgnAlignmentIndex *idx, const char *seqid,
+                               GtUword pos);
+
+/**
+ * @function Find all alignments on sequence ``seqid`` that overlap with
+ * ``range`` and add them to ``hits`` (an array of ``AgnAlignment`` objects).
+ * Returns the number of alignments found.
+ */
+GtUword agn_alignment_index_query(AgnAlignmentIndex *idx, const char *seqid,
+                                  GtRange *range, GtArray *hits);
+
+/**
+ * @function Get the number of alignments stored in the index.
+ */
+GtUword agn_alignment_index_size(AgnAlignmentIndex *idx);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_alignment_index_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_BINARY_IN_STREAM
+#define AEGEAN_BINARY_IN_STREAM
+
+#include "core/hashmap_api.h"
+#include "core/range_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnBinaryInStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Reads sequence regions
+ * and feature trees from annotation files in the compact binary format written
+ * by the ``AgnBinaryOutStream`` class (conventionally with a ``.agb``
+ * extension). Each file is mapped into memory and decoded directly, without
+ * any text parsing; strings are stored once per file and shared by all nodes
+ * that use them. Comments, pragmas, and sequences are not stored; every node
+ * is given the name of the file and a line number of 0.
+ *
+ * File layout: the 8-byte magic string ``AGNTREES``; a version byte, a byte
+ * giving the size of a ``GtUword`` in bytes, two zero bytes, and the 32-bit
+ * value ``AGN_BINARY_BYTE_ORDER`` in native byte order; then one record per
+ * node; then the string table (the number of strings, the offset of
+ * each string in the heap, the heap size, and the heap of NUL-terminated
+ * strings); then the sequence index (the number of sequences and one
+ * ``AgnBinarySeqIndex`` entry per sequence); and finally a trailer of four
+ * values: flags, the number of records, and the file offsets of the string
+ * table and the sequence index. All other fixed-size integers are ``GtUword``
+ * values in native byte order, so files written on a machine with a different
+ * byte order or word size are rejected.
+ *
+ * Within records, numbers are stored as variable-length integers (7 bits per
+ * byte), strings as indices into the string table, and coordinates as offsets
+ * from the start of the previous record on the same sequence (for top-level
+ * nodes) or from the start of the parent (for subfeatures). A record begins
+ * with its length in bytes, its kind (``AGN_BINARY_REGION`` or
+ * ``AGN_BINARY_FEATURE``), its sequence ID, and its start offset and length;
+ * a feature record then lists every node of the feature graph, each with its
+ * type, source, relative coordinates, flags, score, attributes, and the
+ * indices of its children, so that nodes with several parents are stored once.
+ */
+typedef struct AgnBinaryInStream AgnBinaryInStream;
+
+#define AGN_BINARY_MAGIC "AGNTREES"
+#define AGN_BINARY_VERSION 2
+#define AGN_BINARY_BYTE_ORDER 0x01020304
+#define AGN_BINARY_SORTED 1
+#define AGN_BINARY_REGION 1
+#define AGN_BINARY_FEATURE 2
+
+/**
+ * @type Sequence index entry. Records for a sequence all lie between
+ * ``offset`` and ``endoffset``; if the file is sorted, no records for other
+ * sequences lie between them.
+ * @member [GtUword] seqid index of the sequence ID in the string table
+ * @member [GtRange] range range spanned by all records of the sequence
+ * @member [GtUword] offset file offset of the sequence's first record
+ * @member [GtUword] endoffset file offset following the sequence's last record
+ * @member [GtUword] numrecords number of records for the sequence
+ */
+struct AgnBinarySeqIndex
+{
+  GtUword seqid;
+  GtRange range;
+  GtUword offset;
+  GtUword endoffset;
+  GtUword numrecords;
+};
+typedef struct AgnBinarySeqIndex AgnBinarySeqIndex;
+
+/**
+ * @function Class constructor. The files are read in order, each when the
+ * previous one has been exhausted. If ``keepattrs`` is not NULL, attributes
+ * whose keys are not in the hashmap are discarded; ``ID``, ``Parent``,
+ * ``Name``, and ``accession`` attributes are always kept, since feature labels
+ * are taken from them.
+ */
+GtNodeStream *agn_binary_in_stream_new(int numfiles, const char **filenames,
+                                       GtHashmap *keepattrs);
+
+/**
+ * @function Determine whether the given file is in the binary format, and if
+ * so, whether it was written in sorted order.
+ */
+bool agn_binary_in_stream_probe(const char *filename, bool *sorted);
+
+/**
+ * @function Only deliver nodes for the given sequence. For sorted files, the
+ * sequence index is used to read that sequence's records directly.
+ */
+void agn_binary_in_stream_select(AgnBinaryInStream *stream, const char *seqid);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_binary_in_stream_unit_test(AgnUnitTest *test);
+
+#endif
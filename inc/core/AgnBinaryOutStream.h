@@ -0,0 +1,36 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_BINARY_OUT_STREAM
+#define AEGEAN_BINARY_OUT_STREAM
+
+#include <stdio.h>
+#include "extended/node_stream_api.h"
+
+/**
+ * @class AgnBinaryOutStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Writes sequence
+ * regions and feature trees to a file in the compact binary format described
+ * in the ``AgnBinaryInStream`` class, and passes all nodes through unchanged.
+ * Comments, sequences, and pragmas are not written, except that an
+ * ``##aegean-sorted`` pragma in the stream marks the file as sorted. The
+ * string table and sequence index are written once the input stream is
+ * exhausted, so the output need not be seekable.
+ */
+typedef struct AgnBinaryOutStream AgnBinaryOutStream;
+
+/**
+ * @function Class constructor. The stream does not take ownership of
+ * ``outstream``.
+ */
+GtNodeStream *agn_binary_out_stream_new(GtNodeStream *in_stream,
+                                        FILE *outstream);
+
+#endif
@@ -0,0 +1,56 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_CANON_STREAM
+#define AEGEAN_CANON_STREAM
+
+#include "core/logger_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnCanonStream
+ *
+ * Implements the ``GtNodeStream`` interface. Produces the same output as an
+ * ``AgnGeneStream``: CDS, start and stop codons, and UTRs are inferred for each
+ * mRNA, then exons and introns for each gene, and finally each gene is
+ * validated and delivered to the output stream if it has one or more valid
+ * mRNA subfeatures. Rather than applying each of these steps in a separate
+ * stream and selecting the subfeatures of interest anew for each step, the
+ * subfeatures of each gene and mRNA are collected in a single traversal of the
+ * feature graph and updated as new features are inferred.
+ */
+typedef struct AgnCanonStream AgnCanonStream;
+
+/**
+ * @function Class constructor.
+ */
+GtNodeStream* agn_canon_stream_new(GtNodeStream *in_stream, GtLogger *logger);
+
+/**
+ * @function Specify a source (GFF3 column 2) to be applied to newly inferred
+ * features (default is '.').
+ */
+void agn_canon_stream_set_source(AgnCanonStream *stream, GtStr *source);
+
+/**
+ * @function By default, multi-segment CDS features lacking an ID are assigned
+ * IDs of the form 'CDS<n>' as they are encountered. Leave them without an ID
+ * instead, so that an ``AgnCdsIdVisitor`` further downstream can assign IDs in
+ * output order. This is needed when several streams process disjoint sets of
+ * genes in parallel.
+ */
+void agn_canon_stream_defer_cds_ids(AgnCanonStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_canon_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,43 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_CDS_ID_VISITOR
+#define AEGEAN_CDS_ID_VISITOR
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnCdsIdVisitor
+ *
+ * Implements the GenomeTools ``GtNodeVisitor`` interface. This is a node
+ * visitor that assigns IDs of the form 'CDS<n>' to multi-segment CDS features
+ * lacking an ID, numbering them from 0 in the order in which they are
+ * visited. It is used downstream of ``AgnCanonStream`` instances whose CDS
+ * numbering has been deferred (see ``agn_canon_stream_defer_cds_ids``), so
+ * that the IDs do not depend on how the genes were divided among threads.
+ */
+typedef struct AgnCdsIdVisitor AgnCdsIdVisitor;
+
+/**
+ * @function Constructor for a node stream based on this node visitor.
+ */
+GtNodeStream* agn_cds_id_stream_new(GtNodeStream *in);
+
+/**
+ * @function Constructor for the node visitor.
+ */
+GtNodeVisitor *agn_cds_id_visitor_new();
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_cds_id_visitor_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_CACHE_STREAM
+#define AEGEAN_COMPARE_CACHE_STREAM
+
+#include "core/logger_api.h"
+#include "extended/node_stream_api.h"
+
+/**
+ * @class AgnCompareCacheStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that performs the comparative analysis of each ``AgnLocus`` in the stream,
+ * reusing the results of a previous run wherever possible. The cache file
+ * records a content hash for each locus (see ``agn_locus_content_hash``) along
+ * with the clique pairs selected for that locus. When a locus' hash is found
+ * in the cache, the stored selection is restored with
+ * ``agn_locus_comparative_analysis_restore``; otherwise the comparative
+ * analysis is performed in full. Downstream report visitors then find the
+ * analysis already done. Cache keys also record the locus delta and the
+ * maximum number of transcripts per locus, so that entries are only reused by
+ * runs with the same settings.
+ */
+typedef struct AgnCompareCacheStream AgnCompareCacheStream;
+
+/**
+ * @function Class constructor. If ``cachefile`` exists, its contents are
+ * loaded; it is then replaced with an updated cache, covering every locus in
+ * the stream, once the stream has been processed completely. Returns NULL and
+ * sets ``error`` if the cache file exists but is not a valid cache.
+ */
+GtNodeStream *agn_compare_cache_stream_new(GtNodeStream *in_stream,
+                                           const char *cachefile,
+                                           GtUword delta, int maxtrans,
+                                           GtLogger *logger, GtError *error);
+
+#endif
@@ -0,0 +1,47 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_REPORT_CSV
+#define AEGEAN_COMPARE_REPORT_CSV
+
+#include "core/logger_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnCompareReportCSV
+ *
+ * The ``AgnCompareReportCSV`` class is an alternative to the
+ * ``AgnCompareReportText`` class for when comparison results are intended for
+ * downstream analysis rather than for reading. For each ``AgnLocus`` in the
+ * stream, one row of delimited text is written for each clique pair reported,
+ * containing the locus coordinates, the IDs of the reference and prediction
+ * transcripts (separated by semicolons), the comparison classification, and
+ * the raw counts from the ``AgnComparison`` object. Sequence IDs and
+ * transcript IDs are quoted as described in RFC 4180 when they contain the
+ * delimiter, quotes, or line breaks. Output is accumulated in a large buffer
+ * and written in chunks.
+ */
+typedef struct AgnCompareReportCSV AgnCompareReportCSV;
+
+/**
+ * @function Write any buffered output to the output stream. Must be called
+ * after the node stream has been processed and before the output stream is
+ * closed.
+ */
+void agn_compare_report_csv_flush(AgnCompareReportCSV *rpt);
+
+/**
+ * @function Class constructor. Rows are written to ``outstream``, with values
+ * separated by ``delim`` (usually a comma or a tab). A header row is written
+ * immediately.
+ */
+GtNodeVisitor *agn_compare_report_csv_new(FILE *outstream, char delim,
+                                          GtLogger *logger);
+
+#endif
@@ -64,4 +64,30 @@ void agn_compare_report_html_set_overview_func(AgnCompareReportHTML *rpt,
                                          AgnCompareReportHTMLOverviewFunc func,
                                          void *funcdata);
 
+/**
+ * @function Render locus graphics on ``numthreads`` threads. When more than one
+ * thread is requested, each locus graphic is laid out as the locus is
+ * processed and queued, and the queued graphics are drawn in parallel batches;
+ * any graphics remaining in the queue are rendered by
+ * ``agn_compare_report_html_create_summary``. The locus reports
+ * themselves are unaffected, since each graphic's filename is determined by
+ * the locus coordinates. Default is 1 (render each graphic immediately).
+ */
+void agn_compare_report_html_set_png_threads(AgnCompareReportHTML *rpt,
+                                             GtUword numthreads);
+
+/**
+ * @function Write locus reports to a handful of large shard files rather than
+ * to one file per locus. Reports are appended to ``loci-0000.html``,
+ * ``loci-0001.html``, and so on in the output directory, moving on to the next
+ * shard once the current one reaches ``shardsize`` bytes. The seqid,
+ * coordinates, shard, byte offset, and length of each report are recorded in
+ * ``loci.tsv``, and links from the summary pages go through the ``locus.html``
+ * page included in the shared data, which retrieves individual reports on
+ * demand. Set to 0 (the default) for one file per locus. Must be called before
+ * any loci are processed.
+ */
+void agn_compare_report_html_set_shard_size(AgnCompareReportHTML *rpt,
+                                            GtUword shardsize);
+
 #endif
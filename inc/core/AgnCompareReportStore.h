@@ -0,0 +1,41 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_REPORT_STORE
+#define AEGEAN_COMPARE_REPORT_STORE
+
+#include "core/logger_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnCompareReportStore
+ *
+ * The ``AgnCompareReportStore`` class persists the same information as the
+ * ``AgnCompareReportCSV`` class (locus coordinates, transcript IDs,
+ * classification, and raw comparison counts for each reported clique pair) in
+ * a compact binary file that can be filtered by region without being read in
+ * its entirety. See the ``AgnCompareStore`` class for a description of the
+ * file format and for reading the file.
+ */
+typedef struct AgnCompareReportStore AgnCompareReportStore;
+
+/**
+ * @function Write the final block of rows and the block index to the output
+ * stream. Must be called after the node stream has been processed and before
+ * the output stream is closed.
+ */
+void agn_compare_report_store_finish(AgnCompareReportStore *rpt);
+
+/**
+ * @function Class constructor. The store is written to ``outstream``, which
+ * must be opened in binary mode.
+ */
+GtNodeVisitor *agn_compare_report_store_new(FILE *outstream, GtLogger *logger);
+
+#endif
@@ -0,0 +1,143 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_STORE
+#define AEGEAN_COMPARE_STORE
+
+#include "core/error_api.h"
+#include "core/range_api.h"
+#include "AgnComparison.h"
+
+/**
+ * @class AgnCompareStore
+ *
+ * Read-only access to a file of comparison results written by the
+ * ``AgnCompareReportStore`` class. The file is organized in blocks of up to
+ * ``AGN_COMPARE_STORE_BLOCK_SIZE`` rows, each belonging to a single sequence.
+ * Within a block, the values of each column are stored contiguously, and an
+ * index at the end of the file records the sequence and range spanned by each
+ * block, so that the rows for a particular region can be loaded without
+ * reading the entire file.
+ *
+ * File layout (all integers are ``GtUword`` values in native byte order):
+ * the 8-byte magic string ``AGNSTORE`` and a version number; then the blocks,
+ * each consisting of the number of rows, one array per column (see
+ * ``AgnCompareStoreColumn``), and a heap of NUL-terminated transcript ID
+ * strings referenced by offset from the ID columns; then the sequence ID table
+ * and the block index (see ``AgnCompareStoreBlock``); and finally the file
+ * offset at which the sequence ID table begins.
+ */
+typedef struct AgnCompareStore AgnCompareStore;
+
+#define AGN_COMPARE_STORE_MAGIC "AGNSTORE"
+#define AGN_COMPARE_STORE_VERSION 1
+#define AGN_COMPARE_STORE_BLOCK_SIZE 4096
+
+/**
+ * @type Columns of a comparison results store. ``AGN_COMPARE_STORE_SEQID``
+ * holds an index into the sequence ID table, and ``AGN_COMPARE_STORE_REFRIDS``
+ * and ``AGN_COMPARE_STORE_PREDIDS`` hold offsets into the block's ID heap.
+ */
+enum AgnCompareStoreColumn
+{
+  AGN_COMPARE_STORE_SEQID,
+  AGN_COMPARE_STORE_START,
+  AGN_COMPARE_STORE_END,
+  AGN_COMPARE_STORE_REFRIDS,
+  AGN_COMPARE_STORE_PREDIDS,
+  AGN_COMPARE_STORE_CLASS,
+  AGN_COMPARE_STORE_CDS_NUC_TP,
+  AGN_COMPARE_STORE_CDS_NUC_FN,
+  AGN_COMPARE_STORE_CDS_NUC_FP,
+  AGN_COMPARE_STORE_CDS_NUC_TN,
+  AGN_COMPARE_STORE_UTR_NUC_TP,
+  AGN_COMPARE_STORE_UTR_NUC_FN,
+  AGN_COMPARE_STORE_UTR_NUC_FP,
+  AGN_COMPARE_STORE_UTR_NUC_TN,
+  AGN_COMPARE_STORE_CDS_STRUC_CORRECT,
+  AGN_COMPARE_STORE_CDS_STRUC_MISSING,
+  AGN_COMPARE_STORE_CDS_STRUC_WRONG,
+  AGN_COMPARE_STORE_EXON_STRUC_CORRECT,
+  AGN_COMPARE_STORE_EXON_STRUC_MISSING,
+  AGN_COMPARE_STORE_EXON_STRUC_WRONG,
+  AGN_COMPARE_STORE_UTR_STRUC_CORRECT,
+  AGN_COMPARE_STORE_UTR_STRUC_MISSING,
+  AGN_COMPARE_STORE_UTR_STRUC_WRONG,
+  AGN_COMPARE_STORE_OVERALL_MATCHES,
+  AGN_COMPARE_STORE_OVERALL_LENGTH,
+  AGN_COMPARE_STORE_NUM_COLUMNS
+};
+typedef enum AgnCompareStoreColumn AgnCompareStoreColumn;
+
+/**
+ * @type Block index entry.
+ * @member [GtUword] offset file offset at which the block begins
+ * @member [GtUword] numrows number of rows in the block
+ * @member [GtUword] seqid index of the block's sequence in the sequence table
+ * @member [GtRange] range range spanned by all rows in the block
+ */
+struct AgnCompareStoreBlock
+{
+  GtUword offset;
+  GtUword numrows;
+  GtUword seqid;
+  GtRange range;
+};
+typedef struct AgnCompareStoreBlock AgnCompareStoreBlock;
+
+/**
+ * @type A single row of the store: one reported clique pair. The strings
+ * belong to the store. The statistics in ``stats`` are computed from the
+ * stored counts.
+ * @member [const char *] seqid sequence ID of the locus
+ * @member [GtRange] range coordinates of the locus
+ * @member [const char *] refrids reference transcript IDs, separated by ``;``
+ * @member [const char *] predids prediction transcript IDs, separated by ``;``
+ * @member [AgnCompClassification] classification comparison outcome
+ * @member [AgnComparison] stats comparison counts and statistics
+ */
+struct AgnCompareRecord
+{
+  const char *seqid;
+  GtRange range;
+  const char *refrids;
+  const char *predids;
+  AgnCompClassification classification;
+  AgnComparison stats;
+};
+typedef struct AgnCompareRecord AgnCompareRecord;
+
+/**
+ * @function Class destructor.
+ */
+void agn_compare_store_delete(AgnCompareStore *store);
+
+/**
+ * @function Retrieve the given row of the store.
+ */
+void agn_compare_store_get(AgnCompareStore *store, GtUword row,
+                           AgnCompareRecord *record);
+
+/**
+ * @function Class constructor. Loads the rows of the store in ``filename``. If
+ * ``seqid`` is not NULL, only rows from that sequence are loaded, and if
+ * ``range`` is also not NULL, only rows whose locus overlaps with that range.
+ * Blocks outside the region of interest are not read. Returns NULL and sets
+ * ``error`` if the file cannot be read.
+ */
+AgnCompareStore *agn_compare_store_open(const char *filename,
+                                        const char *seqid, GtRange *range,
+                                        GtError *error);
+
+/**
+ * @function Get the number of rows loaded.
+ */
+GtUword agn_compare_store_size(AgnCompareStore *store);
+
+#endif
@@ -226,6 +226,19 @@ void agn_comp_class_summary_aggregate(AgnCompClassSummary *agg_summ,
  */
 void agn_comp_class_summary_init(AgnCompClassSummary *summ);
 
+/**
+ * @function Get a short label for the given comparison classification, such as
+ * ``perfect_match`` or ``non_match``.
+ */
+const char *agn_comp_classification_label(AgnCompClassification cls);
+
+/**
+ * @function Get the comparison classification corresponding to the given label
+ * (see ``agn_comp_classification_label``). Returns
+ * ``AGN_COMP_CLASS_UNCLASSIFIED`` if the label is not recognized.
+ */
+AgnCompClassification agn_comp_classification_parse(const char *label);
+
 /**
  * @function Add values from ``info`` to ``agg_info``.
  */
@@ -0,0 +1,47 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_EXTERNAL_SORT_STREAM
+#define AEGEAN_EXTERNAL_SORT_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnExternalSortStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Delivers nodes in the
+ * same order as a ``GtSortStream``, but without holding every feature in
+ * memory. Top-level features are collected until their estimated size
+ * (including attributes) reaches a memory budget, at which point they are
+ * sorted and written as GFF3 to a temporary file (a "run"). Once the input is
+ * exhausted, the runs are read back one feature at a time and merged with the
+ * features remaining in memory. Sequence regions, comments, and other
+ * non-feature nodes are few and are always kept in memory. If the input fits
+ * within the budget, nothing is written and the stream behaves exactly like a
+ * ``GtSortStream``. Each feature is written with an attribute recording its
+ * original file name and line number, which are restored (and the attribute
+ * removed) when the feature is read back from the run. Parent features without
+ * an ID are written with a temporary one, which is likewise removed.
+ */
+typedef struct AgnExternalSortStream AgnExternalSortStream;
+
+/**
+ * @function Class constructor. ``budget`` is the approximate number of bytes of
+ * features to hold in memory before writing a run to disk.
+ */
+GtNodeStream *agn_external_sort_stream_new(GtNodeStream *in_stream,
+                                           GtUword budget);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_external_sort_stream_unit_test(AgnUnitTest *test);
+
+#endif
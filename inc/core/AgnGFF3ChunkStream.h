@@ -0,0 +1,57 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_GFF3_CHUNK_STREAM
+#define AEGEAN_GFF3_CHUNK_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnGFF3ChunkStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Parses GFF3 files on
+ * multiple threads. Each file is mapped into memory and split into chunks at
+ * ``###`` lines, after which no feature may refer to an earlier one, and each
+ * worker parses one chunk with its own GenomeTools GFF3 parser (with ID
+ * attribute checks and tidy mode enabled). Chunks are parsed a round at a
+ * time, one per worker, and their nodes are delivered in file order, so the
+ * output matches that of a single parser.
+ *
+ * Every chunk is parsed with a header declaring all of the file's sequence
+ * regions, including regions implied by the features of sequences that are
+ * not declared; region nodes are only delivered from the first chunk. Each
+ * chunk is copied to a temporary file for parsing. The nodes, and parser
+ * error messages, are given the name of the input file and line numbers in
+ * it. IDs are checked across chunks as the nodes of each round are collected,
+ * so that duplicate IDs in different chunks are rejected as by a single
+ * parser.
+ *
+ * Standard input, compressed files, files without ``###`` lines, and files
+ * declaring sequence regions after the first feature are parsed by a single
+ * parser as usual.
+ */
+typedef struct AgnGFF3ChunkStream AgnGFF3ChunkStream;
+
+/**
+ * @function Class constructor. The files are read in order; a filename of
+ * ``-`` refers to standard input, as does an empty list of files. If
+ * ``sorted`` is true, each chunk is read with a sorted GFF3 parser. If
+ * GenomeTools was compiled without thread support, the chunks of each round
+ * are parsed serially.
+ */
+GtNodeStream *agn_gff3_chunk_stream_new(int numfiles, const char **filenames,
+                                        bool sorted, GtUword numthreads);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_gff3_chunk_stream_unit_test(AgnUnitTest *test);
+
+#endif
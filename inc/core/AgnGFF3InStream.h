@@ -0,0 +1,79 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_GFF3_IN_STREAM
+#define AEGEAN_GFF3_IN_STREAM
+
+#include "extended/node_stream_api.h"
+#include "core/hashmap_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnGFF3InStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Reads features from
+ * GFF3 files with the GenomeTools GFF3 parser (unsorted, with ID attribute
+ * checks and tidy mode enabled), optionally discarding all but a few
+ * attributes before they are parsed. In that case, column 9 of each feature
+ * line is scanned as raw text and only the key/value pairs with keys of
+ * interest are copied verbatim to a temporary file, which the parser then
+ * reads; the values of the discarded attributes are never decoded or stored.
+ * The parsed nodes are given the name of the original file (``stdin`` for
+ * standard input) and their original line numbers, but file names in parser
+ * messages refer to the temporary files. Trimming thus costs one extra write
+ * and read of the trimmed input, and disk space for trimmed copies of all
+ * input files until the stream is deleted.
+ *
+ * If every input file carries the ``##aegean-sorted`` pragma in its header,
+ * each file is instead read with a sorted GFF3 parser, checked by an
+ * ``AgnSortCheckStream``, and merged with the other files, so that the nodes
+ * are delivered in sorted order without holding the entire input in memory.
+ *
+ * Input files in the binary format written by ``AgnBinaryOutStream`` are
+ * recognized by their content and read with an ``AgnBinaryInStream`` instead
+ * (discarding unwanted attributes as they are decoded). Binary files written
+ * in sorted order count as marked; otherwise, binary and GFF3 files cannot be
+ * mixed in the same stream.
+ *
+ * GFF3 files can also be parsed on multiple threads with an
+ * ``AgnGFF3ChunkStream``, which splits each file into chunks at ``###`` lines.
+ */
+typedef struct AgnGFF3InStream AgnGFF3InStream;
+
+/**
+ * @function Class constructor. A filename of ``-`` refers to standard input,
+ * as does an empty list of files. If ``keepattrs`` is not NULL, attributes
+ * whose keys are not in the hashmap are discarded; ``ID``, ``Parent``,
+ * ``Name``, and ``accession`` attributes are always kept, since feature labels
+ * are taken from them. The input files are read when the first node is
+ * requested from the stream.
+ */
+GtNodeStream *agn_gff3_in_stream_new(int numfiles, const char **filenames,
+                                     GtHashmap *keepattrs);
+
+/**
+ * @function Determine whether every input file is marked as sorted, in which
+ * case the stream delivers features in sorted order and no ``GtSortStream`` is
+ * needed downstream. Standard input is never considered sorted.
+ */
+bool agn_gff3_in_stream_is_sorted(AgnGFF3InStream *stream);
+
+/**
+ * @function Parse GFF3 input on the given number of threads. Must be called
+ * before the first node is requested from the stream.
+ */
+void agn_gff3_in_stream_set_threads(AgnGFF3InStream *stream,
+                                    GtUword numthreads);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_gff3_in_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -11,6 +11,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #ifndef AEGEAN_GAEVAL_VISITOR
 #define AEGEAN_GAEVAL_VISITOR
 
+#include "core/array_api.h"
 #include "extended/node_stream_api.h"
 #include "AgnUnitTest.h"
 
@@ -51,11 +52,42 @@ GtNodeStream* agn_gaeval_stream_new(GtNodeStream *in, GtNodeStream *astream,
 GtNodeVisitor*
 agn_gaeval_visitor_new(GtNodeStream *astream, AgnGaevalParams gparams);
 
+/**
+ * @function Alternative constructor for when both the gene models and the
+ * alignments are sorted by sequence ID and start coordinate. Rather than
+ * loading all alignments up front, the visitor pulls alignments from
+ * ``astream`` as it visits each gene and discards those that end before the
+ * current gene, so only a sliding window of alignments is held in memory.
+ * Processing fails with an error if either input is found to be out of order.
+ */
+GtNodeVisitor*
+agn_gaeval_visitor_new_streaming(GtNodeStream *astream, AgnGaevalParams gparams);
+
+/**
+ * @function Constructor for a node stream that scores gene models using
+ * ``numthreads`` threads. Features are read from ``in`` in batches, the mRNAs
+ * of each batch are scored concurrently, and the features are then passed
+ * along in the order in which they were read. The stream takes ownership of
+ * the ``nv`` visitor, which must be an ``AgnGaevalVisitor``.
+ */
+GtNodeStream *agn_gaeval_threaded_stream_new(GtNodeStream *in,
+                                             GtNodeVisitor *nv,
+                                             GtUword numthreads);
+
 /**
 * @function Indicate a file to be used for printing TSV output.
 */
 void agn_gaeval_visitor_tsv_out(AgnGaevalVisitor *v, GtStr *tsvfilename);
 
+/**
+ * @function Score every mRNA in the given array of top-level features, dividing
+ * the work among ``numthreads`` threads. Attributes and TSV output are written
+ * in the order of the features, so the result is the same as visiting each
+ * feature in turn. Returns 0 on success and -1 on error.
+ */
+int agn_gaeval_visitor_visit_batch(AgnGaevalVisitor *v, GtArray *features,
+                                   GtUword numthreads, GtError *error);
+
 /**
  * @function Run unit tests for this class.
  */
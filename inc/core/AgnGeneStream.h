@@ -21,7 +21,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  * graph of each feature node in the input for canonical protein-coding gene
  * features. Some basic sanity checks are performed on the mRNA(s) associated
  * with each gene, and genes are only delivered to the output stream if they
- * include one or more valid mRNA subfeatures.
+ * include one or more valid mRNA subfeatures. Each of these steps is applied by
+ * a separate node stream; ``AgnCanonStream`` produces the same output in a
+ * single traversal of each gene and should be preferred.
  */
 typedef struct AgnGeneStream AgnGeneStream;
 
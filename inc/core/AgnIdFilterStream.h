@@ -11,7 +11,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define AEGEAN_ID_FILTER_STREAM
 
 #include "extended/node_stream_api.h"
-#include "core/hashmap_api.h"
+#include "AgnIdSet.h"
 #include "AgnUnitTest.h"
 
 /**
@@ -19,16 +19,21 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  *
  * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
  * used to select features from a node stream using a pre-specified list of IDs.
+ * A top-level feature is kept if the ID of the feature or of any of its
+ * subfeatures is in the list, so that (for example) genes can be selected by
+ * the IDs of their mRNAs. A feature whose own ID is in the list is kept with
+ * all of its subfeatures. Otherwise, only the subfeatures leading to a listed
+ * ID are kept, so a gene selected by the ID of one mRNA loses its other mRNAs.
  */
 typedef struct AgnIdFilterStream AgnIdFilterStream;
 
 /**
- * @function Class constructor. The keys of the ``ids2keep`` hashmap should
- * be strings of the IDs of features to be kept from the node stream. Any
- * non-NULL value can be associated with those keys.
+ * @function Class constructor. Features are kept if they or any of their
+ * subfeatures have an ID in ``ids2keep``, which must not be deleted before the
+ * stream; subfeatures not leading to a listed ID are discarded.
  */
 GtNodeStream* agn_id_filter_stream_new(GtNodeStream *in_stream,
-                                       GtHashmap *ids2keep);
+                                       AgnIdSet *ids2keep);
 
 /**
  * @function Run unit tests for this class. Returns true if all tests passed.
@@ -0,0 +1,64 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_ID_SET
+#define AEGEAN_ID_SET
+
+#include <stdio.h>
+#include "core/error_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnIdSet
+ *
+ * Compact, read-only set of feature IDs. The IDs are read into a single
+ * buffer, one per line (only the first whitespace-delimited token of each line
+ * is used), and are looked up by binary search in a sorted table of pointers
+ * into that buffer. An ID ending in ``*`` is a prefix: any ID beginning with
+ * the preceding characters is a member of the set. Prefixes are kept in a
+ * separate table from which any prefix extending another prefix is discarded,
+ * so a single binary search finds the only prefix that can match a given ID.
+ */
+typedef struct AgnIdSet AgnIdSet;
+
+/**
+ * @function Determine whether the given ID is in the set, either explicitly or
+ * by virtue of one of the prefixes.
+ */
+bool agn_id_set_contains(AgnIdSet *set, const char *id);
+
+/**
+ * @function Class destructor.
+ */
+void agn_id_set_delete(AgnIdSet *set);
+
+/**
+ * @function Class constructor. Parses IDs from the first ``length`` characters
+ * of ``data``, which is copied.
+ */
+AgnIdSet *agn_id_set_new(const char *data, GtUword length);
+
+/**
+ * @function Class constructor. Reads IDs from ``instream`` until the end of
+ * the stream is reached. Returns NULL and sets ``error`` if the stream cannot
+ * be read.
+ */
+AgnIdSet *agn_id_set_read(FILE *instream, GtError *error);
+
+/**
+ * @function Get the number of distinct IDs and prefixes in the set.
+ */
+GtUword agn_id_set_size(AgnIdSet *set);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_id_set_unit_test(AgnUnitTest *test);
+
+#endif
@@ -55,6 +55,13 @@ struct AgnLocusPngMetadata
 };
 typedef struct AgnLocusPngMetadata AgnLocusPngMetadata;
 
+#ifndef WITHOUT_CAIRO
+/**
+ * @type A PNG graphic of a locus, laid out and ready to be rendered.
+ */
+typedef struct AgnLocusPng AgnLocusPng;
+#endif
+
 /**
  * @type Comparison operators to use when filtering loci.
  */
@@ -126,6 +133,13 @@ GtUword agn_locus_cds_length(AgnLocus *locus, AgnComparisonSource src);
 #define agn_locus_get_cds_length(LC)\
         agn_locus_cds_length(LC, DEFAULTSOURCE)
 
+/**
+ * @function Compute a hash of the locus' contents: its coordinates, and the
+ * type, coordinates, and strand of every reference and prediction feature. Two
+ * loci with the same hash can be expected to yield the same comparison.
+ */
+GtUint64 agn_locus_content_hash(AgnLocus *locus);
+
 /**
  * @function Compare every reference transcript clique with every prediction
  * transcript clique. For gene loci with multiple transcript cliques, each
@@ -136,6 +150,28 @@ GtUword agn_locus_cds_length(AgnLocus *locus, AgnComparisonSource src);
  */
 void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger);
 
+/**
+ * @function Same as ``agn_locus_comparative_analysis``, but using reference
+ * transcript cliques enumerated in advance (see
+ * ``agn_locus_refr_cliques``) rather than enumerating them again. This allows
+ * a single set of reference cliques to be compared against several alternative
+ * predictions for the same locus. The cliques remain the caller's property.
+ */
+void agn_locus_comparative_analysis_shared(AgnLocus *locus,
+                                           GtArray *refrcliques,
+                                           GtLogger *logger);
+
+/**
+ * @function Rather than computing it from scratch, restore the outcome of a
+ * previous comparative analysis (see ``agn_locus_comparative_analysis``) from
+ * the encoding produced by ``agn_locus_selection_encode``. Only the selected
+ * clique pairs are compared; clique enumeration and the comparison of every
+ * possible pairing are skipped. Returns false (leaving the locus unchanged) if
+ * the encoding does not fit the locus.
+ */
+bool agn_locus_comparative_analysis_restore(AgnLocus *locus,
+                                            const char *selection);
+
 /**
  * @function Analog of ``strcmp`` for sorting AgnLocus objects. Loci are first
  * sorted lexicographically by sequence ID, and then spatially by genomic
@@ -188,6 +224,52 @@ void agn_locus_filter_parse(FILE *filterfile, GtArray *filters);
  */
 bool agn_locus_filter_test(AgnLocus *locus, AgnLocusFilter *filter);
 
+/**
+ * @function Get the filter operator corresponding to ``opstr`` (one of ``=``,
+ * ``!=``, ``>``, ``>=``, ``<``, ``<=``, or ``<>`` for no-op). Returns false if
+ * the operator is not recognized.
+ */
+bool agn_locus_filter_op_parse(const char *opstr, AgnLocusFilterOp *op);
+
+/**
+ * @function Returns true if ``value`` satisfies the criterion specified by
+ * ``op`` and ``testvalue``. Shared by locus filters and by any other code that
+ * filters on computed values, such as comparison statistics.
+ */
+bool agn_locus_filter_op_test(AgnLocusFilterOp op, double value,
+                              double testvalue);
+
+/**
+ * @type A set of locus filters compiled for repeated evaluation. The gene,
+ * transcript, exon, and CDS values required by the filters are collected in a
+ * single traversal of the locus, filters that need no traversal at all are
+ * tested first, and evaluation stops at the first filter the locus fails.
+ */
+typedef struct AgnLocusFilterSet AgnLocusFilterSet;
+
+/**
+ * @function Class destructor.
+ */
+void agn_locus_filter_set_delete(AgnLocusFilterSet *set);
+
+/**
+ * @function Class constructor. Compiles the ``AgnLocusFilter`` objects in
+ * ``filters``. If ``countsonly`` is true, only gene and transcript count
+ * filters are included, since these can be tested as soon as a locus' genes
+ * are known.
+ */
+AgnLocusFilterSet *agn_locus_filter_set_new(GtArray *filters, bool countsonly);
+
+/**
+ * @function Get the number of filters in the set.
+ */
+GtUword agn_locus_filter_set_size(AgnLocusFilterSet *set);
+
+/**
+ * @function Return true if ``locus`` satisfies every filter in the set.
+ */
+bool agn_locus_filter_set_test(AgnLocusFilterSet *set, AgnLocus *locus);
+
 
 /**
  * @function Return an array of the locus' top-level children, regardless of
@@ -330,6 +412,27 @@ void agn_locus_png_track_selector(GtBlock *block, GtStr *track,void *data);
 #endif
 
 #ifndef WITHOUT_CAIRO
+/**
+ * @function Delete a graphic prepared with ``agn_locus_png_new``. This releases
+ * references to the locus features, so it must be called by the thread that
+ * owns the locus.
+ */
+void agn_locus_png_delete(AgnLocusPng *png);
+
+/**
+ * @function Prepare a PNG graphic for this locus: index its transcripts and
+ * lay out the diagram. This takes references to the locus features, so it
+ * must be called by the thread that owns the locus.
+ */
+AgnLocusPng *agn_locus_png_new(AgnLocus *locus, AgnLocusPngMetadata *metadata);
+
+/**
+ * @function Draw a prepared graphic and write it to its PNG file. The locus
+ * features are only read, so several graphics can be rendered at once on
+ * different threads.
+ */
+void agn_locus_png_render(AgnLocusPng *png);
+
 /**
  * @function Print a PNG graphic for this locus.
  */
@@ -342,6 +445,32 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata);
  */
 void agn_locus_print_transcript_mapping(AgnLocus *locus, FILE *outstream);
 
+/**
+ * @function Encode the outcome of this locus' comparative analysis (the
+ * reported clique pairs and the unmatched cliques) as a compact string, in
+ * terms of the positions of reference and prediction mRNAs in the locus. For
+ * use with ``agn_locus_comparative_analysis_restore``. Returns false if no
+ * comparative analysis has been done.
+ */
+bool agn_locus_selection_encode(AgnLocus *locus, GtStr *selection);
+
+/**
+ * @function Create a new locus with the same coordinates as ``locus``,
+ * containing all of its reference features but only those prediction features
+ * that were loaded from ``predfile``. Features are shared with the original
+ * locus, as in ``agn_locus_clone``. For loci created with
+ * ``agn_locus_stream_label_multiway``.
+ */
+AgnLocus *agn_locus_select_prediction(AgnLocus *locus, const char *predfile);
+
+/**
+ * @function Enumerate the maximal cliques of reference transcripts in this
+ * locus, for use with ``agn_locus_comparative_analysis_shared``. Returns NULL
+ * if the locus has no reference transcripts. The caller is responsible for
+ * deleting each clique and the array.
+ */
+GtArray *agn_locus_refr_cliques(AgnLocus *locus);
+
 /**
  * @function Set the start and end coordinates for this locus.
  */
@@ -35,6 +35,17 @@ typedef struct AgnLocusStream AgnLocusStream;
 void agn_locus_stream_label_pairwise(AgnLocusStream *stream,
                                      const char *refrfile,const char *predfile);
 
+/**
+ * @function Like ``agn_locus_stream_label_pairwise``, but features from any of
+ * the ``numpreds`` files in ``predfiles`` are labeled as 'prediction' features.
+ * Each locus then spans overlapping genes from the reference and from all of
+ * the predictions; see ``agn_locus_select_prediction`` for restricting a locus
+ * to the reference and a single prediction.
+ */
+void agn_locus_stream_label_multiway(AgnLocusStream *stream,
+                                     const char *refrfile, int numpreds,
+                                     const char **predfiles);
+
 /**
  * @function Calculate iLoci from a node stream which may or may not include
  * data from multiple sources. Extend each iLocus boundary as far as possible
@@ -51,6 +62,17 @@ GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta);
  */
 void agn_locus_stream_set_endmode(AgnLocusStream *stream, int endmode);
 
+/**
+ * @function Discard loci failing any of the gene or transcript count criteria
+ * in `filters` as soon as their genes are known, before they are named or
+ * annotated. Other criteria (which depend on a locus' final coordinates or
+ * structure) are ignored and should be applied downstream, for example with an
+ * `AgnLocusFilterStream`. Loci are only rejected early when `delta` is 0; when
+ * loci are extended, a discarded locus would still affect the boundaries of
+ * its neighbors.
+ */
+void agn_locus_stream_set_filters(AgnLocusStream *stream, GtArray *filters);
+
 /**
  * @function Assign a `Name` attribute with a serial number to each iLocus
  * using the specified printf-style format.
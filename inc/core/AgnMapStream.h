@@ -0,0 +1,67 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_MAP_STREAM
+#define AEGEAN_MAP_STREAM
+
+#include "core/logger_api.h"
+#include "core/queue_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnMapStream
+ *
+ * Implements the ``GtNodeStream`` interface. Applies a chain of per-feature
+ * processing streams to each top-level feature using a pool of worker threads.
+ * Features are read from the input in batches, the features of each batch are
+ * divided among the workers, and the output of each feature is delivered in
+ * the order in which the features were read. Nodes other than features are
+ * passed along unchanged.
+ *
+ * Each worker has a private copy of the chain, so the chain may keep state,
+ * but it must deliver everything it produces for one feature before pulling
+ * the next feature from its input. The sequence ID, source, and file name
+ * strings shared between features are replaced by private copies before a
+ * feature is handed to a worker. Each worker also logs to a private logger.
+ * Once a batch has been processed, the messages are forwarded to the map
+ * stream's logger in the order in which the features were read.
+ */
+typedef struct AgnMapStream AgnMapStream;
+
+/**
+ * @functype Callback that builds one worker's copy of the processing chain on
+ * top of the ``in`` stream, adds every stream it creates to ``streams`` (they
+ * are deleted along with the map stream), and returns the last stream of the
+ * chain. Workers are numbered 0 through ``numworkers - 1``. Streams in the
+ * chain must log to the worker's ``logger`` rather than a shared one; it is
+ * NULL if the map stream was given no logger.
+ */
+typedef GtNodeStream *(*AgnMapStreamChainFunc)(GtNodeStream *in,
+                                               GtUword worker,
+                                               GtUword numworkers,
+                                               GtLogger *logger,
+                                               GtQueue *streams, void *data);
+
+/**
+ * @function Class constructor. The ``chainfunc`` callback is invoked with
+ * ``data`` once for each of the ``numthreads`` workers. Messages logged by the
+ * workers are forwarded to ``logger``, which may be NULL. If GenomeTools was
+ * compiled without thread support, the workers' shares are processed serially.
+ */
+GtNodeStream *agn_map_stream_new(GtNodeStream *in,
+                                 AgnMapStreamChainFunc chainfunc, void *data,
+                                 GtUword numthreads, GtLogger *logger);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_map_stream_unit_test(AgnUnitTest *test);
+
+#endif
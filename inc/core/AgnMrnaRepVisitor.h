@@ -17,11 +17,30 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  * @class AgnMrnaRepVisitor
  *
  * Implements the GenomeTools ``GtNodeVisitor`` interface. This is a node
- * visitor used for filtering out all but the longest mRNA (as measured by CDS
- * length) from alternatively spliced genes.
+ * visitor used for filtering out all but one representative mRNA from
+ * alternatively spliced genes. By default the representative is the mRNA with
+ * the longest CDS; see ``AgnMrnaRepPolicy`` for alternatives. The CDS length,
+ * transcript length, and exon count of every mRNA are tallied in a single
+ * traversal of each feature, and the other mRNAs are removed before the
+ * feature is passed along.
  */
 typedef struct AgnMrnaRepVisitor AgnMrnaRepVisitor;
 
+/**
+ * @type Criteria for selecting the representative mRNA: longest CDS, longest
+ * transcript (combined length of exons), most exons, or highest numeric value
+ * of a specified attribute. Ties are broken by choosing the mRNA whose label
+ * sorts first.
+ */
+enum AgnMrnaRepPolicy
+{
+  AGN_MRNA_REP_CDS_LENGTH,
+  AGN_MRNA_REP_TRANSCRIPT_LENGTH,
+  AGN_MRNA_REP_EXON_COUNT,
+  AGN_MRNA_REP_ATTRIBUTE,
+};
+typedef enum AgnMrnaRepPolicy AgnMrnaRepPolicy;
+
 /**
  * @function Constructor for a node stream based on this node visitor.
  */
@@ -41,6 +60,16 @@ GtNodeVisitor *agn_mrna_rep_visitor_new(FILE *mapstream);
 void agn_mrna_rep_visitor_set_parent_type(AgnMrnaRepVisitor *v,
                                           const char *type);
 
+/**
+ * @function Set the criterion for selecting the representative mRNA. For
+ * ``AGN_MRNA_REP_ATTRIBUTE``, ``attribute`` is the key of the attribute holding
+ * each mRNA's score; mRNAs lacking a numeric value for the attribute are only
+ * selected if no mRNA has one. Otherwise ``attribute`` is ignored.
+ */
+void agn_mrna_rep_visitor_set_policy(AgnMrnaRepVisitor *v,
+                                     AgnMrnaRepPolicy policy,
+                                     const char *attribute);
+
 /**
  * @function Run unit tests for this class. Returns true if all tests passed.
  */
@@ -0,0 +1,60 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_MULTI_COMPARE_STREAM
+#define AEGEAN_MULTI_COMPARE_STREAM
+
+#include <stdio.h>
+#include "core/logger_api.h"
+#include "extended/node_stream_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnMultiCompareStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * for comparing a single reference annotation against several alternative
+ * predictions in one pass. The input is a stream of ``AgnLocus`` objects
+ * spanning the reference and all of the predictions, as produced by an
+ * ``AgnLocusStream`` labeled with ``agn_locus_stream_label_multiway``. For
+ * each locus, the reference transcript cliques are enumerated once, and then
+ * for each prediction a locus restricted to the reference and that prediction
+ * (see ``agn_locus_select_prediction``) is compared and passed to that
+ * prediction's report visitor. The combined loci are passed on unchanged.
+ */
+typedef struct AgnMultiCompareStream AgnMultiCompareStream;
+
+/**
+ * @function Register a prediction to be compared against the reference. Loci
+ * restricted to the reference and ``predfile`` are passed to ``report``, which
+ * may be NULL if only the summary matrix is needed. The stream takes ownership
+ * of ``report``, which is deleted along with the stream.
+ */
+void agn_multi_compare_stream_add_prediction(AgnMultiCompareStream *stream,
+                                             const char *predfile,
+                                             GtNodeVisitor *report);
+
+/**
+ * @function Class constructor. Each ``AgnLocusFilter`` in ``filters`` (which
+ * may be NULL) is applied to the locus of each prediction separately, so that
+ * the filters select the same loci as they would in a pairwise comparison.
+ */
+GtNodeStream *agn_multi_compare_stream_new(GtNodeStream *in_stream,
+                                           GtArray *filters, GtLogger *logger);
+
+/**
+ * @function Print a tab-delimited table with one row for each prediction,
+ * giving the number of loci and comparisons, the number of comparisons in
+ * each classification, and the aggregate similarity statistics. Call after the
+ * stream has been processed.
+ */
+void agn_multi_compare_stream_print_matrix(AgnMultiCompareStream *stream,
+                                           FILE *outstream);
+
+#endif
@@ -0,0 +1,78 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_PROFILE_STREAM
+#define AEGEAN_PROFILE_STREAM
+
+#include <stdio.h>
+#include "core/queue_api.h"
+#include "extended/node_stream_api.h"
+
+/**
+ * @class AgnProfileStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a transparent
+ * node stream that passes along every node from the stream it wraps, recording
+ * how many nodes the wrapped stage produced, the wall time and CPU time it took
+ * to produce them, and how much the process' peak resident set size grew in
+ * the meantime. Statistics for all stages of a pipeline are collected in an
+ * ``AgnProfile`` object.
+ *
+ * Since a call to a stage's ``next`` function pulls nodes from all upstream
+ * stages, each stage is charged only for what is spent outside of its calls to
+ * the profiling stream immediately upstream of it. For this to work, a
+ * profiling stream should be placed after every stage of the pipeline, which is
+ * easiest with ``agn_profile_stream_wrap``.
+ *
+ * The depth reported for a stage is the largest number of nodes it consumed
+ * from the upstream stage in order to produce a single node, indicating how
+ * many nodes it holds at once.
+ */
+typedef struct AgnProfileStream AgnProfileStream;
+
+/**
+ * @type Statistics for all stages of a node processing pipeline.
+ */
+typedef struct AgnProfile AgnProfile;
+
+/**
+ * @function Class destructor.
+ */
+void agn_profile_delete(AgnProfile *profile);
+
+/**
+ * @function Class constructor.
+ */
+AgnProfile *agn_profile_new();
+
+/**
+ * @function Print the statistics for each stage, in pipeline order. If
+ * ``json`` is true the statistics are printed as a JSON array of objects,
+ * otherwise as a table.
+ */
+void agn_profile_print(AgnProfile *profile, FILE *outstream, bool json);
+
+/**
+ * @function Class constructor. Statistics for ``in_stream`` are recorded in
+ * ``profile`` under the given label.
+ */
+GtNodeStream *agn_profile_stream_new(GtNodeStream *in_stream,
+                                     AgnProfile *profile, const char *label);
+
+/**
+ * @function Convenience function for building pipelines. If ``profile`` is
+ * NULL, ``stream`` is returned unchanged. Otherwise it is wrapped in a new
+ * profiling stream, which is added to ``streams`` (so that it will be deleted
+ * along with the rest of the pipeline) and returned.
+ */
+GtNodeStream *agn_profile_stream_wrap(AgnProfile *profile,
+                                      GtNodeStream *stream, const char *label,
+                                      GtQueue *streams);
+
+#endif
@@ -0,0 +1,45 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_SORT_CHECK_STREAM
+#define AEGEAN_SORT_CHECK_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnSortCheckStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Passes nodes through
+ * unchanged while checking that the features are sorted by sequence ID and
+ * start coordinate, as they would be after a ``GtSortStream``. Unlike a sort
+ * stream, it holds no nodes, so it can replace a sort stream for input that is
+ * known to be sorted. The first feature out of order is reported as an error.
+ * The ``##aegean-sorted`` pragma, which marks GFF3 files written in sorted
+ * order, is removed from the stream.
+ */
+typedef struct AgnSortCheckStream AgnSortCheckStream;
+
+/**
+ * @function Class constructor.
+ */
+GtNodeStream *agn_sort_check_stream_new(GtNodeStream *in_stream);
+
+/**
+ * @function Deliver a ``##aegean-sorted`` pragma before the first node, so
+ * that GFF3 output from the stream is marked as sorted.
+ */
+void agn_sort_check_stream_mark_output(AgnSortCheckStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_sort_check_stream_unit_test(AgnUnitTest *test);
+
+#endif
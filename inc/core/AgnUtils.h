@@ -159,6 +159,13 @@ GtRange agn_multi_child_range(GtFeatureNode *top, GtFeatureNode *rep);
 bool agn_overlap_ilocus(GtGenomeNode *f1, GtGenomeNode *f2,
                         GtUword minoverlap, bool by_cds);
 
+/**
+ * @function CLI function: parse a numeric option value consisting only of
+ * decimal digits. Returns false, leaving ``value`` unchanged, if the string is
+ * empty, contains any other character, or is too large for a ``GtUword``.
+ */
+bool agn_parse_uword(const char *str, GtUword *value);
+
 /**
  * @function CLI function: provide the name of the program, and this function
  * prints out the AEGeAn version number to the specified outstream.
@@ -8,14 +8,27 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include "AgnAlignmentIndex.h"
 #include "AgnAttributeFilterStream.h"
+#include "AgnBinaryInStream.h"
+#include "AgnBinaryOutStream.h"
+#include "AgnCanonStream.h"
+#include "AgnCdsIdVisitor.h"
 #include "AgnCliquePair.h"
+#include "AgnCompareCacheStream.h"
+#include "AgnCompareReportCSV.h"
 #include "AgnCompareReportHTML.h"
+#include "AgnCompareReportStore.h"
 #include "AgnCompareReportText.h"
+#include "AgnCompareStore.h"
 #include "AgnComparison.h"
+#include "AgnExternalSortStream.h"
 #include "AgnFilterStream.h"
+#include "AgnGFF3ChunkStream.h"
+#include "AgnGFF3InStream.h"
 #include "AgnGeneStream.h"
 #include "AgnIdFilterStream.h"
+#include "AgnIdSet.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
@@ -24,9 +37,13 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnLocusMapVisitor.h"
 #include "AgnLocusRefineStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMapStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnMultiCompareStream.h"
+#include "AgnProfileStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSortCheckStream.h"
 #include "AgnTranscriptClique.h"
 #include "AgnTypecheck.h"
 #include "AgnUnitTest.h"
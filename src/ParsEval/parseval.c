@@ -16,7 +16,10 @@ int main(int argc, char **argv)
   GtLogger *logger;
   GtQueue *streams;
   GtNodeStream *current_stream, *last_stream;
-  GtNodeVisitor *rpt;
+  GtNodeVisitor *rpt = NULL, *store = NULL;
+  GtNodeStream *multi_stream = NULL;
+  GtArray *reports, *reportfiles;
+  AgnProfile *profile = NULL;
   PeHtmlOverviewData odata;
   char *start_time;
 
@@ -34,82 +37,195 @@ int main(int argc, char **argv)
     return 1;
   }
   int numfiles = argc - optind;
-  if(numfiles != 2)
+  if(numfiles < 2)
   {
-    fprintf(stderr, "[ParsEval] error: must provide two GFF3 files as input");
+    fprintf(stderr, "[ParsEval] error: must provide at least two GFF3 files "
+            "as input");
     pe_print_usage(stderr);
     return 1;
   }
 
   logger = gt_logger_new(true, "", stderr);
   streams = gt_queue_new();
+  reports = gt_array_new( sizeof(GtNodeVisitor *) );
+  reportfiles = gt_array_new( sizeof(FILE *) );
+  if(options.profile)
+    profile = agn_profile_new();
 
 
   //----- Set up the node processing stream -----//
   //---------------------------------------------//
 
-  const char * infiles[] = { options.refrfile, options.predfile };
-  current_stream = gt_gff3_in_stream_new_unsorted(2, infiles);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  const char **infiles = gt_malloc( sizeof(const char *) * numfiles );
+  infiles[0] = options.refrfile;
+  int i;
+  for(i = 0; i < options.numpreds; i++)
+    infiles[i + 1] = options.predfiles[i];
+  current_stream = agn_gff3_in_stream_new(numfiles, infiles, NULL);
+  gt_free(infiles);
+  agn_gff3_in_stream_set_threads((AgnGFF3InStream *)current_stream,
+                                 options.numthreads);
+  bool sorted = agn_gff3_in_stream_is_sorted((AgnGFF3InStream *)
+                                             current_stream);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "gff3-in",
+                                        streams);
 
-  current_stream = gt_sort_stream_new(last_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  // Input marked as sorted is merged and checked as it is read
+  if(!sorted)
+  {
+    if(options.sortmem > 0)
+    {
+      current_stream = agn_external_sort_stream_new(last_stream,
+                                                    options.sortmem * 1048576);
+    }
+    else
+      current_stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream, "sort",
+                                          streams);
+  }
 
-  current_stream = agn_gene_stream_new(last_stream, logger);
+  current_stream = agn_canon_stream_new(last_stream, logger);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "canon",
+                                        streams);
 
   current_stream = agn_locus_stream_new(last_stream, options.delta);
   agn_locus_stream_skip_iiLoci((AgnLocusStream *)current_stream);
-  agn_locus_stream_label_pairwise((AgnLocusStream *)current_stream,
-                                  options.refrfile, options.predfile);
+  agn_locus_stream_label_multiway((AgnLocusStream *)current_stream,
+                                  options.refrfile, options.numpreds,
+                                  options.predfiles);
+  if(options.numpreds == 1)
+  {
+    // Loci failing the gene and transcript count filters are dropped before
+    // they are named; the filter stream below handles the remaining criteria
+    agn_locus_stream_set_filters((AgnLocusStream *)current_stream,
+                                 options.filters);
+  }
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "locus",
+                                        streams);
 
-  if(gt_array_size(options.filters) > 0)
+  if(options.numpreds > 1)
   {
-    current_stream = agn_locus_filter_stream_new(last_stream, options.filters);
+    // Filters are applied to each prediction's view of a locus separately
+    current_stream = agn_multi_compare_stream_new(last_stream, options.filters,
+                                                  logger);
     gt_queue_add(streams, current_stream);
-    last_stream = current_stream;
-  }
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "multi-compare", streams);
+    multi_stream = current_stream;
 
-  switch(options.outfmt)
-  {
-    case TEXTMODE:
-      if(options.summary_only)
-        rpt = agn_compare_report_text_new(NULL, false, logger);
-      else
-        rpt = agn_compare_report_text_new(options.outfile,options.gff3,logger);
-      break;
-    case HTMLMODE:
-      if(options.graphics)
+    const char *exts[] = { "txt", "html", "csv", "tsv" };
+    for(i = 0; i < options.numpreds; i++)
+    {
+      char outname[1024];
+      sprintf(outname, "%s/prediction-%d.%s", options.outfilename, i + 1,
+              exts[options.outfmt]);
+      FILE *reportfile = fopen(outname, "w");
+      if(reportfile == NULL)
       {
-        rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
-                                          &options.pngdata, logger);
+        fprintf(stderr, "[ParsEval] error: could not open output file '%s'\n",
+                outname);
+        return 1;
       }
+      gt_array_add(reportfiles, reportfile);
+
+      if(options.outfmt == TEXTMODE && options.summary_only)
+        rpt = agn_compare_report_text_new(NULL, false, logger);
+      else if(options.outfmt == TEXTMODE)
+        rpt = agn_compare_report_text_new(reportfile, options.gff3, logger);
       else
       {
-        rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
-                                          NULL, logger);
+        char delim = options.outfmt == CSVMODE ? ',' : '\t';
+        rpt = agn_compare_report_csv_new(reportfile, delim, logger);
       }
-      break;
-    case CSVMODE:
-      fprintf(stderr, "error: CSV output mode support temporarily "
-              "unavailable\n");
-      return 1;
-      break;
-    default:
-      fprintf(stderr, "error: unknown output format\n");
+      gt_array_add(reports, rpt);
+      agn_multi_compare_stream_add_prediction(
+          (AgnMultiCompareStream *)multi_stream, options.predfiles[i], rpt);
+    }
+  }
+
+  if(multi_stream == NULL && gt_array_size(options.filters) > 0)
+  {
+    current_stream = agn_locus_filter_stream_new(last_stream, options.filters);
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "locus-filter", streams);
+  }
+
+  if(options.cachefile != NULL)
+  {
+    current_stream = agn_compare_cache_stream_new(last_stream,
+                                                  options.cachefile,
+                                                  options.delta,
+                                                  options.max_transcripts,
+                                                  logger, error);
+    if(current_stream == NULL)
+    {
+      fprintf(stderr, "[ParsEval] error: %s\n", gt_error_get(error));
       return 1;
-      break;
+    }
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream, "cache",
+                                          streams);
+  }
+
+  if(options.storefile != NULL)
+  {
+    store = agn_compare_report_store_new(options.storefile, logger);
+    current_stream = gt_visitor_stream_new(last_stream, store);
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream, "store",
+                                          streams);
+  }
+
+  if(multi_stream == NULL)
+  {
+    switch(options.outfmt)
+    {
+      case TEXTMODE:
+        if(options.summary_only)
+          rpt = agn_compare_report_text_new(NULL, false, logger);
+        else
+        {
+          rpt = agn_compare_report_text_new(options.outfile, options.gff3,
+                                            logger);
+        }
+        break;
+      case HTMLMODE:
+        if(options.graphics)
+        {
+          rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
+                                            &options.pngdata, logger);
+          agn_compare_report_html_set_png_threads((AgnCompareReportHTML *)rpt,
+                                                  options.numthreads);
+        }
+        else
+        {
+          rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
+                                            NULL, logger);
+        }
+        agn_compare_report_html_set_shard_size((AgnCompareReportHTML *)rpt,
+                                               options.shardsize);
+        break;
+      case CSVMODE:
+        rpt = agn_compare_report_csv_new(options.outfile, ',', logger);
+        break;
+      case TSVMODE:
+        rpt = agn_compare_report_csv_new(options.outfile, '\t', logger);
+        break;
+      default:
+        fprintf(stderr, "error: unknown output format\n");
+        return 1;
+        break;
+    }
+    current_stream = gt_visitor_stream_new(last_stream, rpt);
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream, "report",
+                                          streams);
   }
-  current_stream = gt_visitor_stream_new(last_stream, rpt);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
 
 
   //----- Execute the node processing stream -----//
@@ -118,13 +234,43 @@ int main(int argc, char **argv)
   int result = gt_node_stream_pull(last_stream, error);
   if(result == -1)
     fprintf(stderr, "[ParsEval] error: %s", gt_error_get(error));
+  if(profile != NULL)
+  {
+    agn_profile_print(profile, stderr, options.profilejson);
+    agn_profile_delete(profile);
+  }
 
-  if(options.outfmt == TEXTMODE)
+  if(store != NULL)
+    agn_compare_report_store_finish((AgnCompareReportStore *)store);
+  if(multi_stream != NULL)
+  {
+    for(i = 0; i < options.numpreds; i++)
+    {
+      rpt = *(GtNodeVisitor **)gt_array_get(reports, i);
+      FILE *reportfile = *(FILE **)gt_array_get(reportfiles, i);
+      if(options.outfmt == TEXTMODE)
+      {
+        options.predfile = options.predfiles[i];
+        pe_summary_header(&options, reportfile, start_time, argc, argv);
+        agn_compare_report_text_create_summary((AgnCompareReportText *)rpt,
+                                               reportfile);
+      }
+      else
+        agn_compare_report_csv_flush((AgnCompareReportCSV *)rpt);
+    }
+    agn_multi_compare_stream_print_matrix(
+        (AgnMultiCompareStream *)multi_stream, options.outfile);
+  }
+  else if(options.outfmt == TEXTMODE)
   {
     pe_summary_header(&options, options.outfile, start_time, argc, argv);
     agn_compare_report_text_create_summary((AgnCompareReportText *)rpt,
                                            options.outfile);
   }
+  else if(options.outfmt == CSVMODE || options.outfmt == TSVMODE)
+  {
+    agn_compare_report_csv_flush((AgnCompareReportCSV *)rpt);
+  }
   else if(options.outfmt == HTMLMODE)
   {
     odata.refrlabel = options.refrfile;
@@ -152,6 +298,10 @@ int main(int argc, char **argv)
     gt_node_stream_delete(current_stream);
   }
   gt_queue_delete(streams);
+  while(gt_array_size(reportfiles) > 0)
+    fclose(*(FILE **)gt_array_pop(reportfiles));
+  gt_array_delete(reportfiles);
+  gt_array_delete(reports);
   gt_logger_delete(logger);
   gt_error_delete(error);
   gt_lib_clean();
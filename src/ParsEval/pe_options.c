@@ -8,11 +8,16 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
 #include "pe_options.h"
 
 void pe_free_option_memory(ParsEvalOptions *options)
 {
   fclose(options->outfile);
+  if(options->storefile != NULL)
+    fclose(options->storefile);
   gt_array_delete(options->filters);
 }
 
@@ -21,21 +26,27 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "a:df:ghkl:o:pr:st:Vvwx:y:";
+  const char *optstr = "a:b:c:df:ghj:kl:M:o:P::pr:S:st:Vvwx:y:";
   const struct option parseval_options[] =
   {
     { "datashare",  required_argument, NULL, 'a' },
+    { "store",      required_argument, NULL, 'b' },
+    { "cache",      required_argument, NULL, 'c' },
     { "debug",      no_argument,       NULL, 'd' },
     { "outformat",  required_argument, NULL, 'f' },
     { "printgff3",  no_argument,       NULL, 'g' },
     { "help",       no_argument,       NULL, 'h' },
     { "makefilter", no_argument,       NULL, 'k' },
     { "delta",      required_argument, NULL, 'l' },
+    { "sortmem",    required_argument, NULL, 'M' },
     { "outfile",    required_argument, NULL, 'o' },
     { "nopng",      no_argument,       NULL, 'p' },
+    { "profile",    optional_argument, NULL, 'P' },
     { "filterfile", required_argument, NULL, 'r' },
+    { "shards",     required_argument, NULL, 'S' },
     { "summary",    no_argument,       NULL, 's' },
     { "maxtrans",   required_argument, NULL, 't' },
+    { "threads",    required_argument, NULL, 'j' },
     { "verbose",    no_argument,       NULL, 'V' },
     { "version",    no_argument,       NULL, 'v' },
     { "overwrite",  no_argument,       NULL, 'w' },
@@ -52,6 +63,14 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     {
       options->data_path = optarg;
     }
+    else if(opt == 'b')
+    {
+      options->storefilename = optarg;
+    }
+    else if(opt == 'c')
+    {
+      options->cachefile = optarg;
+    }
     else if(opt == 'd')
     {
       options->debug = true;
@@ -59,6 +78,7 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     else if(opt == 'f')
     {
       if      (strcmp(optarg, "csv")  == 0) options->outfmt = CSVMODE;
+      else if (strcmp(optarg, "tsv")  == 0) options->outfmt = TSVMODE;
       else if (strcmp(optarg, "text") == 0) options->outfmt = TEXTMODE;
       else if (strcmp(optarg, "html") == 0) options->outfmt = HTMLMODE;
       else
@@ -91,10 +111,27 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
         exit(1);
       }
     }
+    else if(opt == 'M')
+    {
+      if(!agn_parse_uword(optarg, &options->sortmem) ||
+         options->sortmem == 0 || options->sortmem > GT_UWORD_MAX / 1048576)
+      {
+        fprintf(stderr, "error: invalid sort memory '%s'\n", optarg);
+        exit(1);
+      }
+    }
     else if(opt == 'o')
     {
       options->outfilename = optarg;
     }
+    else if(opt == 'P')
+    {
+      options->profile = true;
+      if(optarg != NULL && strcmp(optarg, "json") == 0)
+        options->profilejson = true;
+      else if(optarg != NULL && strcmp(optarg, "table") != 0)
+        gt_error_set(error, "unknown profile format '%s'", optarg);
+    }
     else if(opt == 'p')
     {
       options->graphics = false;
@@ -110,6 +147,20 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
       agn_locus_filter_parse(filterfile, options->filters);
       fclose(filterfile);
     }
+    else if(opt == 'S')
+    {
+      char *end;
+      errno = 0;
+      options->shardsize = strtoul(optarg, &end, 10);
+      if(!isdigit((unsigned char)optarg[0]) || *end != '\0' || errno != 0 ||
+         options->shardsize == 0 ||
+         options->shardsize > GT_UWORD_MAX / (1024 * 1024))
+      {
+        fprintf(stderr, "error: invalid shard size '%s'\n", optarg);
+        exit(1);
+      }
+      options->shardsize *= 1024 * 1024;
+    }
     else if(opt == 's')
     {
       options->summary_only = true;
@@ -123,6 +174,18 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
         exit(1);
       }
     }
+    else if(opt == 'j')
+    {
+      char *end;
+      errno = 0;
+      options->numthreads = strtoul(optarg, &end, 10);
+      if(!isdigit((unsigned char)optarg[0]) || *end != '\0' || errno != 0 ||
+         options->numthreads == 0)
+      {
+        fprintf(stderr, "error: invalid number of threads '%s'\n", optarg);
+        exit(1);
+      }
+    }
     else if(opt == 'V')
     {
       options->verbose = true;
@@ -180,13 +243,51 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     gt_array_add(options->filters, filter);
   }
 
-  if(argc - optind != 2)
+  if(argc - optind < 2)
   {
     pe_print_usage(stderr);
-    fprintf(stderr, "error: must provide 2 (and only 2) input files, you "
+    fprintf(stderr, "error: must provide at least 2 input files, you "
             "provided %d\n\n", argc - optind);
     exit(1);
   }
+  options->numpreds = argc - optind - 1;
+  options->predfiles = (const char **)argv + optind + 1;
+
+  if(options->numpreds > 1)
+  {
+    if(options->outfmt == HTMLMODE)
+    {
+      fputs("error: HTML output is not supported when comparing more than "
+            "one prediction\n", stderr);
+      exit(1);
+    }
+    if(options->cachefile != NULL || options->storefilename != NULL)
+    {
+      fputs("error: the cache and store options are not supported when "
+            "comparing more than one prediction\n", stderr);
+      exit(1);
+    }
+    if(options->outfilename == NULL)
+    {
+      fputs("error: must provide an output directory with '-o' when comparing "
+            "more than one prediction\n", stderr);
+      exit(1);
+    }
+    if(options->predlabel != NULL)
+    {
+      fprintf(stderr, "warning: prediction label is ignored when comparing "
+              "more than one prediction\n");
+      options->predlabel = NULL;
+    }
+  }
+
+  if((options->outfmt == CSVMODE || options->outfmt == TSVMODE) &&
+     options->summary_only)
+  {
+    fprintf(stderr, "warning: summary-only mode requires text output format; "
+            "ignoring\n");
+    options->summary_only = false;
+  }
 
   if(options->outfmt == HTMLMODE && options->summary_only)
   {
@@ -197,7 +298,7 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
 
   if(options->outfilename)
   {
-    if(options->outfmt == HTMLMODE)
+    if(options->outfmt == HTMLMODE || options->numpreds > 1)
     {
       char dircmd[1024];
       sprintf(dircmd, "test -d %s", options->outfilename);
@@ -278,6 +379,25 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
       options->graphics = false;
     }
   }
+  else if(options->numpreds > 1)
+  {
+    char dircmd[1024];
+    sprintf(dircmd, "mkdir %s", options->outfilename);
+    if(system(dircmd) != 0)
+    {
+      fprintf(stderr, "error: cannot open output directory '%s'\n",
+              options->outfilename);
+      exit(1);
+    }
+    char outname[1024];
+    sprintf(outname, "%s/summary.tsv", options->outfilename);
+    options->outfile = fopen(outname, "w");
+    if(!options->outfile)
+    {
+      fprintf(stderr, "error: could not open output file '%s'\n", outname);
+      exit(1);
+    }
+  }
   else
   {
     if(options->outfilename)
@@ -292,6 +412,17 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     }
   }
 
+  if(options->storefilename)
+  {
+    options->storefile = fopen(options->storefilename, "wb");
+    if(options->storefile == NULL)
+    {
+      fprintf(stderr, "error: cannot open store file '%s'\n",
+              options->storefilename);
+      exit(1);
+    }
+  }
+
   options->refrfile = argv[optind];
   options->predfile = argv[optind + 1];
   if(options->outfmt != HTMLMODE && options->graphics)
@@ -315,30 +446,55 @@ void pe_print_usage(FILE *outstream)
   fprintf(outstream,
 "\nParsEval: comparative analysis of two alternative sources of annotation\n"
 "Usage: parseval [options] reference.gff3 prediction.gff3\n"
+"       parseval [options] -o outdir reference.gff3 pred1.gff3 pred2.gff3 ...\n"
 "  Basic options:\n"
 "    -d|--debug:                 Print debugging messages\n"
 "    -h|--help:                  Print help message and exit\n"
+"    -c|--cache: FILE            Reuse comparisons from a previous run for\n"
+"                                loci whose features have not changed, and\n"
+"                                update the cache file for the next run\n"
 "    -l|--delta: INT             Extend gene loci by this many nucleotides;\n"
 "                                default is 0\n"
+"    -M|--sortmem: INT           When sorting the input, hold at most INT MB\n"
+"                                of features in memory, writing sorted runs\n"
+"                                to temporary files as needed; by default,\n"
+"                                the entire input is sorted in memory\n"
+"    -P|--profile[=json]:        Report the number of nodes processed and the\n"
+"                                time and memory used by each processing\n"
+"                                stage to the terminal (STDERR) as a table or\n"
+"                                as JSON\n"
 "    -V|--verbose:               Print verbose warning messages\n"
 "    -v|--version:               Print version number and exit\n\n"
 "  Output options:\n"
 "    -a|--datashare: STRING      Location from which to copy shared data for\n"
 "                                HTML output (if `make install' has not yet\n"
 "                                been run)\n"
+"    -b|--store: FILE            Also write the comparison results to FILE\n"
+"                                in a compact binary format that can be\n"
+"                                queried with 'parseval-query'\n"
 "    -f|--outformat: STRING      Indicate desired output format; possible\n"
-"                                options: 'csv', 'text', or 'html'\n"
-"                                (default='text'); in 'text' or 'csv' mode,\n"
-"                                will create a single file; in 'html' mode,\n"
-"                                will create a directory\n"
+"                                options: 'csv', 'tsv', 'text', or 'html'\n"
+"                                (default='text'); in 'text', 'csv', or\n"
+"                                'tsv' mode, will create a single file; in\n"
+"                                'html' mode, will create a directory\n"
 "    -g|--nogff3:                Do no print GFF3 output corresponding to each\n"
 "                                comparison\n"
 "    -o|--outfile: FILENAME      File/directory to which output will be\n"
-"                                written; default is the terminal (STDOUT)\n"
+"                                written; default is the terminal (STDOUT);\n"
+"                                when more than one prediction is given, a\n"
+"                                directory with one report per prediction\n"
+"                                and a combined 'summary.tsv' is created\n"
 "    -p|--nopng:                 In HTML output mode, skip generation of PNG\n"
 "                                graphics for each gene locus\n"
+"    -S|--shards: INT            In HTML output mode, write locus reports to\n"
+"                                shard files of approximately INT MB each,\n"
+"                                viewed with 'locus.html', instead of one file\n"
+"                                per locus\n"
 "    -s|--summary:               Only print summary statistics, do not print\n"
 "                                individual comparisons\n"
+"    -j|--threads: INT           Number of threads to use for parsing input and,\n"
+"                                in HTML output mode, for generating PNG\n"
+"                                graphics; default is 1\n"
 "    -w|--overwrite:             Force overwrite of any existing output files\n"
 "    -x|--refrlabel: STRING      Optional label for reference annotations\n"
 "    -y|--predlabel: STRING      Optional label for prediction annotations\n\n"
@@ -365,6 +521,8 @@ void pe_set_option_defaults(ParsEvalOptions *options)
 #endif
   options->refrfile = NULL;
   options->predfile = NULL;
+  options->predfiles = NULL;
+  options->numpreds = 0;
   options->refrlabel = NULL;
   options->predlabel = NULL;
   options->outfmt = TEXTMODE;
@@ -375,4 +533,12 @@ void pe_set_option_defaults(ParsEvalOptions *options)
   options->verbose = false;
   options->max_transcripts = 32;
   options->delta = 0;
+  options->sortmem = 0;
+  options->numthreads = 1;
+  options->shardsize = 0;
+  options->cachefile = NULL;
+  options->storefilename = NULL;
+  options->storefile = NULL;
+  options->profile = false;
+  options->profilejson = false;
 }
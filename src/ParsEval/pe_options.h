@@ -22,7 +22,8 @@ enum PeOutFormat
 {
   TEXTMODE,
   HTMLMODE,
-  CSVMODE
+  CSVMODE,
+  TSVMODE
 };
 typedef enum PeOutFormat PeOutFormat;
 
@@ -40,6 +41,8 @@ struct ParsEvalOptions
   AgnLocusPngMetadata pngdata;
   const char *refrfile;
   const char *predfile;
+  const char **predfiles;
+  int numpreds;
   const char *refrlabel;
   const char *predlabel;
   PeOutFormat outfmt;
@@ -50,6 +53,14 @@ struct ParsEvalOptions
   bool verbose;
   int max_transcripts;
   GtUword delta;
+  GtUword sortmem;
+  GtUword numthreads;
+  GtUword shardsize;
+  const char *cachefile;
+  const char *storefilename;
+  FILE *storefile;
+  bool profile;
+  bool profilejson;
 };
 typedef struct ParsEvalOptions ParsEvalOptions;
 
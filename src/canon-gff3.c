@@ -9,28 +9,68 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 
 #include <getopt.h>
+#include <limits.h>
+#include <string.h>
 #include "genometools.h"
 #include "aegean.h"
 
 typedef struct
 {
   GtFile *outstream;
+  FILE *binstream;
   GtStr *source;
   bool infer;
+  bool profile;
+  bool profilejson;
+  int numthreads;
+  GtHashmap *keepattrs;
+  bool sort;
+  GtUword sortmem;
 } CanonGFF3Options;
 
+typedef struct
+{
+  CanonGFF3Options *options;
+  AgnProfile *profile;
+  GtArray *sources;
+} CanonGFF3Chain;
+
 static void print_usage(FILE *outstream)
 {
   fputs("\nUsage: canon-gff3 [options] gff3file1 [gff3file2 ...]\n"
 "  Options:\n"
+"     -b|--binary-out: FILE   write the output to FILE in AEGeAn's compact\n"
+"                             binary format (.agb), which all AEGeAn programs\n"
+"                             can read much faster than GFF3, instead of\n"
+"                             writing GFF3\n"
 "     -h|--help               print this help message and exit\n"
 "     -i|--infer              for transcript features lacking an explicitly\n"
 "                             declared gene feature as a parent, create this\n"
 "                             feature on-they-fly\n"
+"     -j|--threads: INT       number of threads to use for parsing input and\n"
+"                             processing genes; default is 1\n"
+"     -k|--keep: STRING       comma-separated list of attribute keys; all other\n"
+"                             attributes except ID, Parent, Name, and\n"
+"                             accession are discarded before the input is\n"
+"                             parsed; the trimmed input is written to a\n"
+"                             temporary file in $TMPDIR (default /tmp) and\n"
+"                             read back, which costs an extra pass over the\n"
+"                             data and disk space for trimmed copies of the\n"
+"                             input files\n"
+"     -M|--sortmem: INT       when sorting, hold at most INT megabytes of\n"
+"                             features in memory, writing sorted runs to\n"
+"                             temporary files as needed; implies --sort\n"
 "     -o|--outfile: STRING    name of file to which GFF3 data will be\n"
 "                             written; default is terminal (stdout)\n"
+"     -P|--profile[=json]     report the number of nodes processed and the\n"
+"                             time and memory used by each processing stage\n"
+"                             to the terminal (stderr) as a table or as JSON\n"
 "     -s|--source: STRING     reset the source of each feature to the given\n"
 "                             value\n"
+"     -S|--sort               sort the output by sequence and coordinate, and\n"
+"                             mark it with the ##aegean-sorted pragma so that\n"
+"                             ParsEval and LocusPocus need not sort it again;\n"
+"                             output is marked whenever the input is\n"
 "     -v|--version            print version number and exit\n\n",
         outstream);
 }
@@ -40,40 +80,112 @@ static void canon_gff3_parse_options(int argc, char * const *argv,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hio:s:v";
+  const char *optstr = "b:hij:k:M:o:P::s:Sv";
   const struct option init_options[] =
   {
-    { "help",    no_argument,       NULL, 'h' },
-    { "infer",   no_argument,       NULL, 'i' },
-    { "outfile", required_argument, NULL, 'o' },
-    { "source",  required_argument, NULL, 's' },
-    { "version", no_argument,       NULL, 'v' },
-    { NULL,      no_argument,       NULL, 0 },
+    { "binary-out", required_argument, NULL, 'b' },
+    { "help",       no_argument,       NULL, 'h' },
+    { "infer",      no_argument,       NULL, 'i' },
+    { "keep",       required_argument, NULL, 'k' },
+    { "sortmem",    required_argument, NULL, 'M' },
+    { "outfile",    required_argument, NULL, 'o' },
+    { "threads",    required_argument, NULL, 'j' },
+    { "profile",    optional_argument, NULL, 'P' },
+    { "source",     required_argument, NULL, 's' },
+    { "sort",       no_argument,       NULL, 'S' },
+    { "version",    no_argument,       NULL, 'v' },
+    { NULL,         no_argument,       NULL, 0 },
   };
 
   for(opt = getopt_long(argc, argv, optstr, init_options, &optindex);
       opt != -1;
       opt = getopt_long(argc, argv, optstr, init_options, &optindex))
   {
-    if(opt == 'h')
+    if(opt == 'b')
+    {
+      if(options->binstream != NULL)
+        fclose(options->binstream);
+      options->binstream = fopen(optarg, "wb");
+      if(options->binstream == NULL)
+      {
+        fprintf(stderr, "[CanonGFF3] error: unable to open binary output file "
+                "'%s'\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'h')
     {
       print_usage(stdout);
       exit(0);
     }
     else if(opt == 'i')
       options->infer = true;
+    else if(opt == 'j')
+    {
+      GtUword numthreads;
+      if(!agn_parse_uword(optarg, &numthreads) || numthreads == 0 ||
+         numthreads > INT_MAX)
+      {
+        fprintf(stderr, "[CanonGFF3] error: number of threads must be a "
+                "positive integer\n");
+        exit(1);
+      }
+      options->numthreads = numthreads;
+    }
+    else if(opt == 'k')
+    {
+      if(options->keepattrs == NULL)
+      {
+        options->keepattrs = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                            NULL);
+      }
+      char *key;
+      for(key = strtok(optarg, ","); key != NULL; key = strtok(NULL, ","))
+      {
+        if(gt_hashmap_get(options->keepattrs, key) == NULL)
+        {
+          char *keycopy = gt_cstr_dup(key);
+          gt_hashmap_add(options->keepattrs, keycopy, keycopy);
+        }
+      }
+    }
+    else if(opt == 'M')
+    {
+      if(!agn_parse_uword(optarg, &options->sortmem) ||
+         options->sortmem == 0 || options->sortmem > GT_UWORD_MAX / 1048576)
+      {
+        fprintf(stderr, "[CanonGFF3] error: sort memory must be a positive "
+                "number of megabytes\n");
+        exit(1);
+      }
+      options->sort = true;
+    }
     else if(opt == 'o')
     {
       if(options->outstream != NULL)
         gt_file_delete(options->outstream);
       options->outstream = gt_file_new(optarg, "w", error);
     }
+    else if(opt == 'P')
+    {
+      options->profile = true;
+      if(optarg != NULL && strcmp(optarg, "json") == 0)
+        options->profilejson = true;
+      else if(optarg != NULL && strcmp(optarg, "table") != 0)
+      {
+        fprintf(stderr, "[CanonGFF3] error: unknown profile format '%s'\n",
+                optarg);
+        exit(1);
+      }
+    }
     else if(opt == 's')
     {
       if(options->source != NULL)
         gt_str_delete(options->source);
       options->source = gt_str_new_cstr(optarg);
     }
+    else if(opt == 'S')
+      options->sort = true;
     else if(opt == 'v')
     {
       agn_print_version("CanonGFF3", stdout);
@@ -82,6 +194,48 @@ static void canon_gff3_parse_options(int argc, char * const *argv,
   }
 }
 
+// Per-gene processing stages; with multiple threads, each worker of the map
+// stream gets its own copy
+static GtNodeStream *canon_gff3_chain(GtNodeStream *in, GtUword worker,
+                                      GtUword numworkers, GtLogger *logger,
+                                      GtQueue *streams, void *data)
+{
+  CanonGFF3Chain *chain = data;
+  GtNodeStream *stream, *last_stream = in;
+  if(chain->options->infer)
+  {
+    GtHashmap *type_parents = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                             gt_free_func);
+    gt_hashmap_add(type_parents, gt_cstr_dup("mRNA"), gt_cstr_dup("gene"));
+    gt_hashmap_add(type_parents, gt_cstr_dup("tRNA"), gt_cstr_dup("gene"));
+    stream = agn_infer_parent_stream_new(last_stream, type_parents);
+    gt_hashmap_delete(type_parents);
+    gt_queue_add(streams, stream);
+    last_stream = agn_profile_stream_wrap(chain->profile, stream,
+                                          "infer-parent", streams);
+  }
+
+  // CDS IDs are assigned after the chain, in output order, so that they do
+  // not depend on the number of workers
+  stream = agn_canon_stream_new(last_stream, logger);
+  agn_canon_stream_defer_cds_ids((AgnCanonStream *)stream);
+  gt_queue_add(streams, stream);
+  last_stream = agn_profile_stream_wrap(chain->profile, stream, "canon",
+                                        streams);
+
+  if(chain->options->source != NULL)
+  {
+    GtStr *source = gt_str_clone(chain->options->source);
+    gt_array_add(chain->sources, source);
+    GtNodeVisitor *ssv = gt_set_source_visitor_new(source);
+    stream = gt_visitor_stream_new(last_stream, ssv);
+    gt_queue_add(streams, stream);
+    last_stream = agn_profile_stream_wrap(chain->profile, stream,
+                                          "set-source", streams);
+  }
+  return last_stream;
+}
+
 // Main method
 int main(int argc, char * const *argv)
 {
@@ -89,7 +243,9 @@ int main(int argc, char * const *argv)
   GtLogger *logger;
   GtQueue *streams;
   GtNodeStream *stream, *last_stream;
-  CanonGFF3Options options = { NULL, NULL, false };
+  AgnProfile *profile = NULL;
+  CanonGFF3Options options = { NULL, NULL, NULL, false, false, false, 1,
+                               NULL, false, 0 };
 
   gt_lib_init();
   error = gt_error_new();
@@ -97,50 +253,89 @@ int main(int argc, char * const *argv)
 
   streams = gt_queue_new();
   logger = gt_logger_new(true, "", stderr);
+  if(options.profile)
+    profile = agn_profile_new();
 
-  stream = gt_gff3_in_stream_new_unsorted(argc - optind, (const char **)
-                                                          argv+optind);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  stream = agn_gff3_in_stream_new(argc - optind, (const char **)argv + optind,
+                                  options.keepattrs);
+  agn_gff3_in_stream_set_threads((AgnGFF3InStream *)stream,
+                                 options.numthreads);
+  bool sorted = agn_gff3_in_stream_is_sorted((AgnGFF3InStream *)stream);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "gff3-in", streams);
 
-  if(options.infer)
+  if(options.sort && !sorted)
   {
-    GtHashmap *type_parents = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
-                                             gt_free_func);
-    gt_hashmap_add(type_parents, gt_cstr_dup("mRNA"), gt_cstr_dup("gene"));
-    gt_hashmap_add(type_parents, gt_cstr_dup("tRNA"), gt_cstr_dup("gene"));
-    stream = agn_infer_parent_stream_new(last_stream,
-                                                 type_parents);
-    gt_hashmap_delete(type_parents);
+    if(options.sortmem > 0)
+    {
+      stream = agn_external_sort_stream_new(last_stream,
+                                            options.sortmem * 1048576);
+    }
+    else
+      stream = gt_sort_stream_new(last_stream);
     gt_queue_add(streams, stream);
-    last_stream = stream;
+    last_stream = agn_profile_stream_wrap(profile, stream, "sort", streams);
+  }
+
+  CanonGFF3Chain chain = { &options, NULL, NULL };
+  chain.sources = gt_array_new( sizeof(GtStr *) );
+  if(options.numthreads > 1)
+  {
+    stream = agn_map_stream_new(last_stream, canon_gff3_chain, &chain,
+                                options.numthreads, logger);
+    gt_queue_add(streams, stream);
+    last_stream = agn_profile_stream_wrap(profile, stream, "map", streams);
+  }
+  else
+  {
+    chain.profile = profile;
+    last_stream = canon_gff3_chain(last_stream, 0, 1, logger, streams,
+                                   &chain);
   }
 
-  stream = agn_gene_stream_new(last_stream, logger);
+  stream = agn_cds_id_stream_new(last_stream);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
-  if(options.source != NULL)
+  // Genes are only dropped or given parents of the same extent, so sorted
+  // input gives sorted output
+  if(options.sort || sorted)
   {
-    GtNodeVisitor *ssv = gt_set_source_visitor_new(options.source);
-    stream = gt_visitor_stream_new(last_stream, ssv);
+    stream = agn_sort_check_stream_new(last_stream);
+    agn_sort_check_stream_mark_output((AgnSortCheckStream *)stream);
     gt_queue_add(streams, stream);
-    last_stream = stream;
+    last_stream = agn_profile_stream_wrap(profile, stream, "sort-check",
+                                          streams);
   }
 
-  stream = gt_gff3_out_stream_new(last_stream, options.outstream);
-  if(!options.infer)
-    gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
+  if(options.binstream != NULL)
+  {
+    stream = agn_binary_out_stream_new(last_stream, options.binstream);
+    gt_queue_add(streams, stream);
+    last_stream = agn_profile_stream_wrap(profile, stream, "binary-out",
+                                          streams);
+  }
+  else
+  {
+    stream = gt_gff3_out_stream_new(last_stream, options.outstream);
+    if(!options.infer)
+      gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
+    gt_queue_add(streams, stream);
+    last_stream = agn_profile_stream_wrap(profile, stream, "gff3-out",
+                                          streams);
+  }
 
-  if(gt_node_stream_pull(last_stream, error) == -1)
+  int had_err = gt_node_stream_pull(last_stream, error);
+  if(had_err)
   {
-    fprintf(stderr, "[CanonGFF3] error processing node stream: %s",
+    fprintf(stderr, "[CanonGFF3] error processing node stream: %s\n",
             gt_error_get(error));
   }
+  if(profile != NULL)
+  {
+    agn_profile_print(profile, stderr, options.profilejson);
+    agn_profile_delete(profile);
+  }
 
   while(gt_queue_size(streams) > 0)
   {
@@ -148,13 +343,23 @@ int main(int argc, char * const *argv)
     gt_node_stream_delete(stream);
   }
   gt_queue_delete(streams);
+  while(gt_array_size(chain.sources) > 0)
+  {
+    GtStr **source = gt_array_pop(chain.sources);
+    gt_str_delete(*source);
+  }
+  gt_array_delete(chain.sources);
   if(options.source != NULL)
     gt_str_delete(options.source);
+  if(options.keepattrs != NULL)
+    gt_hashmap_delete(options.keepattrs);
   if(options.outstream != NULL)
     gt_file_delete(options.outstream);
+  if(options.binstream != NULL)
+    fclose(options.binstream);
   gt_error_delete(error);
   gt_logger_delete(logger);
   gt_lib_clean();
 
-  return 0;
+  return had_err ? 1 : 0;
 }
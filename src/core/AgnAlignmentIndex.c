@@ -0,0 +1,734 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include "core/array_api.h"
+#include "core/hashmap_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnAlignmentIndex.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnAlignmentIndex
+{
+  GtHashmap *seqs;
+  GtArray *gaps;
+  GtUword count;
+  GtUword numseqs;
+};
+
+/**
+ * @type Compact representation of an alignment. The segments and gaps of the
+ * alignment are stored contiguously (segments first, then gaps) in the
+ * sequence's ``parts`` array, starting at ``offset``. ``maxend`` is the largest
+ * end coordinate of this and all preceding records, which makes the records
+ * searchable by start coordinate.
+ */
+typedef struct
+{
+  GtUword start;
+  GtUword end;
+  GtUword maxend;
+  GtUword offset;
+  unsigned int num_segments;
+  unsigned int num_gaps;
+  GtStrand strand;
+} AlignmentRecord;
+
+/**
+ * @type All alignments for a single sequence. ``cursor`` and ``laststart``
+ * record the position of the previous query, so that queries issued in
+ * coordinate order sweep through the records rather than searching anew.
+ * ``prunesize`` is the number of records that must accumulate before the next
+ * compaction is done by ``agn_alignment_index_prune``. ``gapcounts`` maps the
+ * exact coordinates of each gap (formatted as ``start,end``) to the number of
+ * alignments containing that gap.
+ */
+typedef struct
+{
+  GtArray *records;
+  GtArray *parts;
+  GtHashmap *gapcounts;
+  bool sorted;
+  GtUword cursor;
+  GtUword laststart;
+  GtUword prunesize;
+} AlignmentSequence;
+
+#define ALIGNMENT_INDEX_MIN_PRUNE_SIZE 256
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Retrieve the alignment records for the given sequence, creating
+ * them if necessary.
+ */
+static AlignmentSequence*
+alignment_index_get_sequence(AgnAlignmentIndex *idx, const char *seqid);
+
+/**
+ * @function Hashmap traversal function for sorting each sequence's alignments.
+ */
+static int alignment_index_sort_sequence(void *key, void *value, void *data,
+                                         GtError *error);
+
+/**
+ * @function Hashmap traversal function for collecting sequence IDs.
+ */
+static int alignment_index_collect_seqids(void *key, void *value, void *data,
+                                          GtError *error);
+
+/**
+ * @function Increment the support count for each of the given gaps.
+ */
+static void alignment_sequence_count_gaps(AlignmentSequence *seq,
+                                          const GtRange *gaps,
+                                          GtUword numgaps);
+
+/**
+ * @function Compare alignment records by start and then end coordinate.
+ */
+static int alignment_record_compare(const void *p1, const void *p2);
+
+/**
+ * @function Starting at the ``start``th record, add each alignment overlapping
+ * with ``range`` to the ``hits`` array. Returns the number of alignments added.
+ */
+static GtUword alignment_sequence_collect(AlignmentSequence *seq, GtUword start,
+                                          GtRange *range, GtArray *hits);
+
+/**
+ * @function Destructor for per-sequence alignment records.
+ */
+static void alignment_sequence_delete(AlignmentSequence *seq);
+
+/**
+ * @function Find the first record whose ``maxend`` is not less than ``pos``.
+ */
+static GtUword alignment_sequence_lower_bound(AlignmentSequence *seq,
+                                              GtUword pos);
+
+/**
+ * @function Constructor for per-sequence alignment records.
+ */
+static AlignmentSequence *alignment_sequence_new();
+
+/**
+ * @function Remove all records that end before ``pos``, rebuild the segment
+ * and gap array for the remaining records, and recompute ``maxend`` values.
+ * Returns the number of records removed.
+ */
+static GtUword alignment_sequence_prune(AlignmentSequence *seq, GtUword pos);
+
+/**
+ * @function Sort records by start coordinate and compute ``maxend`` values.
+ */
+static void alignment_sequence_sort(AlignmentSequence *seq);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_alignment_index_add(AgnAlignmentIndex *idx, GtFeatureNode *alignment)
+{
+  agn_assert(idx && alignment);
+  GtGenomeNode *gn = (GtGenomeNode *)alignment;
+  GtStr *seqid = gt_genome_node_get_seqid(gn);
+  AlignmentSequence *seq = alignment_index_get_sequence(idx, gt_str_get(seqid));
+
+  GtRange range = gt_genome_node_get_range(gn);
+  AlignmentRecord record;
+  record.start = range.start;
+  record.end = range.end;
+  record.maxend = range.end;
+  record.offset = gt_array_size(seq->parts);
+  record.num_segments = 0;
+  record.num_gaps = 0;
+  record.strand = gt_feature_node_get_strand(alignment);
+
+  // A parent feature (such as ``match`` over ``match_part`` features) spans
+  // its parts and their gaps, so it only counts as a segment on its own
+  gt_array_reset(idx->gaps);
+  GtFeatureNode *fn;
+  bool skiproot = false;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(alignment);
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL && !skiproot;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    if(!gt_feature_node_has_type(fn, "match_gap"))
+      skiproot = true;
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  iter = gt_feature_node_iterator_new(alignment);
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    if(fn == alignment && skiproot)
+      continue;
+    GtRange fnrange = gt_genome_node_get_range((GtGenomeNode *)fn);
+    if(gt_feature_node_has_type(fn, "match_gap"))
+      gt_array_add(idx->gaps, fnrange);
+    else
+    {
+      gt_array_add(seq->parts, fnrange);
+      record.num_segments++;
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  GtRange *segments = (GtRange *)gt_array_get_space(seq->parts) + record.offset;
+  if(record.num_segments > 1)
+  {
+    qsort(segments, record.num_segments, sizeof (GtRange),
+          (GtCompare)gt_range_compare);
+  }
+
+  // Explicit gaps take the place of inferred ones, so that no gap is counted
+  // twice
+  GtUword i;
+  bool explicitgaps = gt_array_size(idx->gaps) > 0;
+  if(gt_array_size(idx->gaps) > 1)
+  {
+    qsort(gt_array_get_space(idx->gaps), gt_array_size(idx->gaps),
+          sizeof (GtRange), (GtCompare)gt_range_compare);
+  }
+  for(i = 1; !explicitgaps && i < record.num_segments; i++)
+  {
+    if(segments[i].start > segments[i-1].end + 1)
+    {
+      GtRange gap = { segments[i-1].end + 1, segments[i].start - 1 };
+      gt_array_add(idx->gaps, gap);
+    }
+  }
+  record.num_gaps = gt_array_size(idx->gaps);
+  gt_array_add_array(seq->parts, idx->gaps);
+  alignment_sequence_count_gaps(seq, gt_array_get_space(idx->gaps),
+                                record.num_gaps);
+
+  if(seq->sorted && gt_array_size(seq->records) > 0)
+  {
+    AlignmentRecord *last = gt_array_get_last(seq->records);
+    if(alignment_record_compare(&record, last) < 0)
+      seq->sorted = false;
+    else if(last->maxend > record.maxend)
+      record.maxend = last->maxend;
+  }
+  gt_array_add(seq->records, record);
+  idx->count++;
+}
+
+void agn_alignment_index_delete(AgnAlignmentIndex *idx)
+{
+  gt_hashmap_delete(idx->seqs);
+  gt_array_delete(idx->gaps);
+  gt_free(idx);
+}
+
+int agn_alignment_index_load(AgnAlignmentIndex *idx, GtNodeStream *stream,
+                             GtError *error)
+{
+  agn_assert(idx && stream);
+  GtGenomeNode *gn;
+  int had_err;
+  gt_error_check(error);
+
+  while(1)
+  {
+    had_err = gt_node_stream_next(stream, &gn, error);
+    if(had_err)
+      return had_err;
+    if(!gn)
+      break;
+
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn)
+      agn_alignment_index_add(idx, fn);
+    gt_genome_node_delete(gn);
+  }
+
+  return 0;
+}
+
+AgnAlignmentIndex *agn_alignment_index_new()
+{
+  AgnAlignmentIndex *idx = gt_malloc( sizeof(AgnAlignmentIndex) );
+  idx->seqs = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                             (GtFree)alignment_sequence_delete);
+  idx->gaps = gt_array_new( sizeof(GtRange) );
+  idx->count = 0;
+  idx->numseqs = 0;
+  return idx;
+}
+
+void agn_alignment_index_prune(AgnAlignmentIndex *idx, const char *seqid,
+                               GtUword pos)
+{
+  agn_assert(idx && seqid);
+  AlignmentSequence *seq = gt_hashmap_get(idx->seqs, seqid);
+  if(idx->numseqs > 1 || (idx->numseqs == 1 && seq == NULL))
+  {
+    GtArray *seqids = gt_array_new( sizeof(char *) );
+    gt_hashmap_foreach(idx->seqs, alignment_index_collect_seqids, seqids, NULL);
+    while(gt_array_size(seqids) > 0)
+    {
+      char *otherid = *(char **)gt_array_pop(seqids);
+      if(strcmp(otherid, seqid) == 0)
+        continue;
+      AlignmentSequence *other = gt_hashmap_get(idx->seqs, otherid);
+      idx->count -= gt_array_size(other->records);
+      gt_hashmap_remove(idx->seqs, otherid);
+      idx->numseqs--;
+    }
+    gt_array_delete(seqids);
+  }
+
+  if(seq == NULL || gt_array_size(seq->records) < seq->prunesize)
+    return;
+
+  if(!seq->sorted)
+    alignment_sequence_sort(seq);
+  idx->count -= alignment_sequence_prune(seq, pos);
+  seq->prunesize = 2 * gt_array_size(seq->records);
+  if(seq->prunesize < ALIGNMENT_INDEX_MIN_PRUNE_SIZE)
+    seq->prunesize = ALIGNMENT_INDEX_MIN_PRUNE_SIZE;
+}
+
+GtUword agn_alignment_index_gap_support(AgnAlignmentIndex *idx,
+                                        const char *seqid, GtRange *gap)
+{
+  agn_assert(idx && seqid && gap);
+  AlignmentSequence *seq = gt_hashmap_get(idx->seqs, seqid);
+  if(seq == NULL)
+    return 0;
+
+  char key[64];
+  sprintf(key, "%lu,%lu", gap->start, gap->end);
+  GtUword *count = gt_hashmap_get(seq->gapcounts, key);
+  if(count == NULL)
+    return 0;
+  return *count;
+}
+
+GtUword agn_alignment_index_lookup(AgnAlignmentIndex *idx, const char *seqid,
+                                   GtRange *range, GtArray *hits)
+{
+  agn_assert(idx && seqid && range && hits);
+  AlignmentSequence *seq = gt_hashmap_get(idx->seqs, seqid);
+  if(seq == NULL)
+    return 0;
+  agn_assert(seq->sorted);
+  GtUword i = alignment_sequence_lower_bound(seq, range->start);
+  return alignment_sequence_collect(seq, i, range, hits);
+}
+
+void agn_alignment_index_prepare(AgnAlignmentIndex *idx)
+{
+  agn_assert(idx);
+  gt_hashmap_foreach(idx->seqs, alignment_index_sort_sequence, NULL, NULL);
+}
+
+GtUword agn_alignment_index_query(AgnAlignmentIndex *idx, const char *seqid,
+                                  GtRange *range, GtArray *hits)
+{
+  agn_assert(idx && seqid && range && hits);
+  AlignmentSequence *seq = gt_hashmap_get(idx->seqs, seqid);
+  if(seq == NULL)
+    return 0;
+  if(!seq->sorted)
+    alignment_sequence_sort(seq);
+
+  GtUword numrecords = gt_array_size(seq->records);
+  AlignmentRecord *records = gt_array_get_space(seq->records);
+
+  // Queries issued in coordinate order pick up where the previous query left
+  // off; anything else falls back on a binary search.
+  GtUword i;
+  if(range->start >= seq->laststart)
+  {
+    for(i = seq->cursor; i < numrecords; i++)
+    {
+      if(records[i].maxend >= range->start)
+        break;
+    }
+  }
+  else
+    i = alignment_sequence_lower_bound(seq, range->start);
+  seq->cursor = i;
+  seq->laststart = range->start;
+
+  return alignment_sequence_collect(seq, i, range, hits);
+}
+
+GtUword agn_alignment_index_size(AgnAlignmentIndex *idx)
+{
+  return idx->count;
+}
+
+bool agn_alignment_index_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr");
+  GtGenomeNode *aln1 = gt_feature_node_new(seqid, "cDNA_match", 100, 200,
+                                           GT_STRAND_FORWARD);
+  GtGenomeNode *aln2 = gt_feature_node_new_pseudo(seqid, 150, 500,
+                                                  GT_STRAND_FORWARD);
+  GtGenomeNode *seg = gt_feature_node_new(seqid, "cDNA_match", 400, 500,
+                                          GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln2, (GtFeatureNode *)seg);
+  seg = gt_feature_node_new(seqid, "cDNA_match", 150, 250, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln2, (GtFeatureNode *)seg);
+  GtGenomeNode *aln3 = gt_feature_node_new(seqid, "EST_match", 600, 700,
+                                           GT_STRAND_REVERSE);
+
+  AgnAlignmentIndex *idx = agn_alignment_index_new();
+  agn_alignment_index_add(idx, (GtFeatureNode *)aln3);
+  agn_alignment_index_add(idx, (GtFeatureNode *)aln1);
+  agn_alignment_index_add(idx, (GtFeatureNode *)aln2);
+  gt_genome_node_delete(aln1);
+  gt_genome_node_delete(aln2);
+  gt_genome_node_delete(aln3);
+  agn_unit_test_result(test, "size", agn_alignment_index_size(idx) == 3);
+
+  GtArray *hits = gt_array_new( sizeof(AgnAlignment) );
+  GtRange qrange = { 180, 190 };
+  GtUword numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  bool test1 = numhits == 2 && gt_array_size(hits) == 2;
+  if(test1)
+  {
+    AgnAlignment *a1 = gt_array_get(hits, 0);
+    AgnAlignment *a2 = gt_array_get(hits, 1);
+    GtRange seg1 = { 150, 250 };
+    GtRange seg2 = { 400, 500 };
+    GtRange gap = { 251, 399 };
+    test1 = a1->range.start == 100 && a1->range.end == 200 &&
+            a1->num_segments == 1 && a1->num_gaps == 0 &&
+            a2->range.start == 150 && a2->range.end == 500 &&
+            a2->num_segments == 2 && a2->num_gaps == 1 &&
+            gt_range_compare(&a2->segments[0], &seg1) == 0 &&
+            gt_range_compare(&a2->segments[1], &seg2) == 0 &&
+            gt_range_compare(&a2->gaps[0], &gap) == 0;
+  }
+  agn_unit_test_result(test, "query (1)", test1);
+
+  gt_array_reset(hits);
+  qrange.start = 450;
+  qrange.end = 650;
+  numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  bool test2 = numhits == 2;
+  if(test2)
+  {
+    AgnAlignment *a1 = gt_array_get(hits, 0);
+    AgnAlignment *a2 = gt_array_get(hits, 1);
+    test2 = a1->range.start == 150 && a1->strand == GT_STRAND_FORWARD &&
+            a2->range.start == 600 && a2->strand == GT_STRAND_REVERSE;
+  }
+  agn_unit_test_result(test, "query (2)", test2);
+
+  gt_array_reset(hits);
+  qrange.start = 50;
+  qrange.end = 120;
+  numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  bool test3 = numhits == 1;
+  if(test3)
+  {
+    AgnAlignment *a1 = gt_array_get(hits, 0);
+    test3 = a1->range.start == 100 && a1->range.end == 200;
+  }
+  agn_unit_test_result(test, "query (out of order)", test3);
+
+  GtArray *lhits = gt_array_new( sizeof(AgnAlignment) );
+  agn_alignment_index_prepare(idx);
+  qrange.start = 450;
+  qrange.end = 650;
+  numhits = agn_alignment_index_lookup(idx, "chr", &qrange, lhits);
+  bool test3b = numhits == 2;
+  if(test3b)
+  {
+    AgnAlignment *a1 = gt_array_get(lhits, 0);
+    AgnAlignment *a2 = gt_array_get(lhits, 1);
+    test3b = a1->range.start == 150 && a2->range.start == 600;
+  }
+  agn_unit_test_result(test, "lookup", test3b);
+
+  GtRange gap = { 251, 399 };
+  GtRange nogap = { 250, 399 };
+  bool test3c = agn_alignment_index_gap_support(idx, "chr", &gap) == 1 &&
+                agn_alignment_index_gap_support(idx, "chr", &nogap) == 0 &&
+                agn_alignment_index_gap_support(idx, "chrX", &gap) == 0;
+  agn_unit_test_result(test, "gap support", test3c);
+  gt_array_delete(lhits);
+
+  gt_array_reset(hits);
+  numhits = agn_alignment_index_query(idx, "chrX", &qrange, hits);
+  qrange.start = 800;
+  qrange.end = 900;
+  numhits += agn_alignment_index_query(idx, "chr", &qrange, hits);
+  agn_unit_test_result(test, "query (no hits)",
+                       numhits == 0 && gt_array_size(hits) == 0);
+
+  GtGenomeNode *aln4 = gt_feature_node_new(seqid, "match", 1000, 1500,
+                                           GT_STRAND_FORWARD);
+  seg = gt_feature_node_new(seqid, "match_part", 1400, 1500, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln4, (GtFeatureNode *)seg);
+  seg = gt_feature_node_new(seqid, "match_part", 1000, 1100, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln4, (GtFeatureNode *)seg);
+  seg = gt_feature_node_new(seqid, "match_part", 1200, 1300, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln4, (GtFeatureNode *)seg);
+  agn_alignment_index_add(idx, (GtFeatureNode *)aln4);
+  gt_genome_node_delete(aln4);
+  gt_array_reset(hits);
+  qrange.start = 1250;
+  qrange.end = 1260;
+  numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  bool test3d = numhits == 1;
+  if(test3d)
+  {
+    AgnAlignment *a1 = gt_array_get(hits, 0);
+    GtRange seg1 = { 1000, 1100 };
+    GtRange gap1 = { 1101, 1199 };
+    GtRange gap2 = { 1301, 1399 };
+    test3d = a1->range.start == 1000 && a1->range.end == 1500 &&
+             a1->num_segments == 3 && a1->num_gaps == 2 &&
+             gt_range_compare(&a1->segments[0], &seg1) == 0 &&
+             gt_range_compare(&a1->gaps[0], &gap1) == 0 &&
+             gt_range_compare(&a1->gaps[1], &gap2) == 0;
+  }
+  agn_unit_test_result(test, "match/match_part", test3d);
+
+  GtGenomeNode *aln5 = gt_feature_node_new(seqid, "match", 2000, 2500,
+                                           GT_STRAND_FORWARD);
+  seg = gt_feature_node_new(seqid, "match_part", 2000, 2100, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln5, (GtFeatureNode *)seg);
+  seg = gt_feature_node_new(seqid, "match_gap", 2101, 2399, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln5, (GtFeatureNode *)seg);
+  seg = gt_feature_node_new(seqid, "match_part", 2400, 2500, GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)aln5, (GtFeatureNode *)seg);
+  agn_alignment_index_add(idx, (GtFeatureNode *)aln5);
+  gt_genome_node_delete(aln5);
+  gt_array_reset(hits);
+  qrange.start = 2050;
+  qrange.end = 2060;
+  numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  GtRange gap3 = { 2101, 2399 };
+  bool test3e = numhits == 1 &&
+                agn_alignment_index_gap_support(idx, "chr", &gap3) == 1;
+  if(test3e)
+  {
+    AgnAlignment *a1 = gt_array_get(hits, 0);
+    test3e = a1->num_segments == 2 && a1->num_gaps == 1 &&
+             gt_range_compare(&a1->gaps[0], &gap3) == 0;
+  }
+  agn_unit_test_result(test, "match_part/match_gap", test3e);
+
+  agn_alignment_index_prune(idx, "chr", 650);
+  bool test4 = agn_alignment_index_size(idx) == 5;
+  agn_alignment_index_prune(idx, "chrX", 1);
+  gt_array_reset(hits);
+  qrange.start = 1;
+  qrange.end = 1000;
+  numhits = agn_alignment_index_query(idx, "chr", &qrange, hits);
+  test4 = test4 && agn_alignment_index_size(idx) == 0 && numhits == 0;
+  agn_unit_test_result(test, "prune", test4);
+
+  gt_array_delete(hits);
+  agn_alignment_index_delete(idx);
+  gt_str_delete(seqid);
+  return agn_unit_test_success(test);
+}
+
+static AlignmentSequence*
+alignment_index_get_sequence(AgnAlignmentIndex *idx, const char *seqid)
+{
+  AlignmentSequence *seq = gt_hashmap_get(idx->seqs, seqid);
+  if(seq == NULL)
+  {
+    seq = alignment_sequence_new();
+    gt_hashmap_add(idx->seqs, gt_cstr_dup(seqid), seq);
+    idx->numseqs++;
+  }
+  return seq;
+}
+
+static int alignment_index_sort_sequence(void *key, void *value, void *data,
+                                         GtError *error)
+{
+  AlignmentSequence *seq = value;
+  if(!seq->sorted)
+    alignment_sequence_sort(seq);
+  return 0;
+}
+
+static int alignment_index_collect_seqids(void *key, void *value, void *data,
+                                          GtError *error)
+{
+  GtArray *seqids = data;
+  char *seqid = key;
+  gt_array_add(seqids, seqid);
+  return 0;
+}
+
+static int alignment_record_compare(const void *p1, const void *p2)
+{
+  const AlignmentRecord *r1 = p1;
+  const AlignmentRecord *r2 = p2;
+  if(r1->start != r2->start)
+    return r1->start < r2->start ? -1 : 1;
+  if(r1->end != r2->end)
+    return r1->end < r2->end ? -1 : 1;
+  return 0;
+}
+
+static GtUword alignment_sequence_collect(AlignmentSequence *seq, GtUword start,
+                                          GtRange *range, GtArray *hits)
+{
+  GtUword numrecords = gt_array_size(seq->records);
+  AlignmentRecord *records = gt_array_get_space(seq->records);
+  GtRange *parts = gt_array_get_space(seq->parts);
+  GtUword i, numhits = 0;
+  for(i = start; i < numrecords && records[i].start <= range->end; i++)
+  {
+    AlignmentRecord *record = records + i;
+    if(record->end < range->start)
+      continue;
+
+    AgnAlignment alignment;
+    alignment.range.start = record->start;
+    alignment.range.end = record->end;
+    alignment.strand = record->strand;
+    alignment.segments = parts + record->offset;
+    alignment.num_segments = record->num_segments;
+    alignment.gaps = parts + record->offset + record->num_segments;
+    alignment.num_gaps = record->num_gaps;
+    gt_array_add(hits, alignment);
+    numhits++;
+  }
+  return numhits;
+}
+
+static void alignment_sequence_count_gaps(AlignmentSequence *seq,
+                                          const GtRange *gaps,
+                                          GtUword numgaps)
+{
+  GtUword i;
+  for(i = 0; i < numgaps; i++)
+  {
+    char key[64];
+    sprintf(key, "%lu,%lu", gaps[i].start, gaps[i].end);
+    GtUword *count = gt_hashmap_get(seq->gapcounts, key);
+    if(count == NULL)
+    {
+      count = gt_malloc( sizeof(GtUword) );
+      *count = 0;
+      gt_hashmap_add(seq->gapcounts, gt_cstr_dup(key), count);
+    }
+    (*count)++;
+  }
+}
+
+static void alignment_sequence_delete(AlignmentSequence *seq)
+{
+  gt_array_delete(seq->records);
+  gt_array_delete(seq->parts);
+  gt_hashmap_delete(seq->gapcounts);
+  gt_free(seq);
+}
+
+static GtUword alignment_sequence_lower_bound(AlignmentSequence *seq,
+                                              GtUword pos)
+{
+  AlignmentRecord *records = gt_array_get_space(seq->records);
+  GtUword low = 0;
+  GtUword high = gt_array_size(seq->records);
+  while(low < high)
+  {
+    GtUword mid = low + (high - low) / 2;
+    if(records[mid].maxend < pos)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+static AlignmentSequence *alignment_sequence_new()
+{
+  AlignmentSequence *seq = gt_malloc( sizeof(AlignmentSequence) );
+  seq->records = gt_array_new( sizeof(AlignmentRecord) );
+  seq->parts = gt_array_new( sizeof(GtRange) );
+  seq->gapcounts = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  seq->sorted = true;
+  seq->cursor = 0;
+  seq->laststart = 0;
+  seq->prunesize = ALIGNMENT_INDEX_MIN_PRUNE_SIZE;
+  return seq;
+}
+
+static GtUword alignment_sequence_prune(AlignmentSequence *seq, GtUword pos)
+{
+  GtArray *records = gt_array_new( sizeof(AlignmentRecord) );
+  GtArray *parts = gt_array_new( sizeof(GtRange) );
+  GtRange *oldparts = gt_array_get_space(seq->parts);
+  GtUword i, j, maxend = 0, removed = 0;
+  gt_hashmap_reset(seq->gapcounts);
+  for(i = 0; i < gt_array_size(seq->records); i++)
+  {
+    AlignmentRecord record = *(AlignmentRecord *)gt_array_get(seq->records, i);
+    if(record.end < pos)
+    {
+      removed++;
+      continue;
+    }
+
+    GtUword numparts = record.num_segments + record.num_gaps;
+    for(j = 0; j < numparts; j++)
+      gt_array_add(parts, oldparts[record.offset + j]);
+    alignment_sequence_count_gaps(seq, oldparts + record.offset +
+                                  record.num_segments, record.num_gaps);
+    record.offset = gt_array_size(parts) - numparts;
+    if(record.end > maxend)
+      maxend = record.end;
+    record.maxend = maxend;
+    gt_array_add(records, record);
+  }
+
+  gt_array_delete(seq->records);
+  gt_array_delete(seq->parts);
+  seq->records = records;
+  seq->parts = parts;
+  seq->cursor = 0;
+  seq->laststart = 0;
+  return removed;
+}
+
+static void alignment_sequence_sort(AlignmentSequence *seq)
+{
+  gt_array_sort(seq->records, alignment_record_compare);
+  GtUword i, maxend = 0;
+  for(i = 0; i < gt_array_size(seq->records); i++)
+  {
+    AlignmentRecord *record = gt_array_get(seq->records, i);
+    if(record->end > maxend)
+      maxend = record->end;
+    record->maxend = maxend;
+  }
+  seq->sorted = true;
+  seq->cursor = 0;
+  seq->laststart = 0;
+}
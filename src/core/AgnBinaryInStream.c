@@ -0,0 +1,969 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/cstr_api.h"
+#include "core/ma_api.h"
+#include "core/str_array_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "AgnBinaryInStream.h"
+#include "AgnBinaryOutStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * The current file is mapped at ``data``; records are decoded from ``pos`` up
+ * to ``end``. The ``strs`` table caches a ``GtStr`` for each sequence ID and
+ * source string (keyed by its address in the mapped file), so that nodes share
+ * them. The ``laststarts`` array holds the start of the most recent record for
+ * each sequence, from which the next record's start is decoded. Every node is
+ * given ``origin``, the name of the current file, with a line number of 0.
+ */
+struct AgnBinaryInStream
+{
+  const GtNodeStream parent_instance;
+  GtStrArray *filenames;
+  GtUword fileindex;
+  GtStr *origin;
+  GtHashmap *keepattrs;
+  char *selected;
+  const unsigned char *data;
+  GtUword size;
+  GtUword flags;
+  GtUword numstrings;
+  const unsigned char *offsets;
+  const char *heap;
+  GtUword heapsize;
+  GtUword numseqs;
+  const unsigned char *index;
+  GtUword *laststarts;
+  GtUword selseq;
+  GtUword pos;
+  GtUword end;
+  GtHashmap *strs;
+  GtArray *nodes;
+  GtArray *links;
+};
+
+#define BINARY_TRAILER_SIZE (4 * sizeof (GtUword))
+#define BINARY_HEADER_SIZE 16
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define binary_in_stream_cast(GS)\
+        gt_node_stream_cast(binary_in_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* binary_in_stream_class(void);
+
+/**
+ * @function Unmap the current file.
+ */
+static void binary_in_stream_close(AgnBinaryInStream *stream);
+
+/**
+ * @function Decode the feature record between ``pos`` and ``end``.
+ */
+static int binary_in_stream_feature(AgnBinaryInStream *stream, GtStr *seqid,
+                                    GtRange *range, GtUword pos, GtUword end,
+                                    GtGenomeNode **gn, GtError *error);
+
+/**
+ * @function Class destructor.
+ */
+static void binary_in_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Look up a string in the string table of the current file. Returns
+ * NULL if ``index`` is out of range.
+ */
+static const char *binary_in_stream_get_string(AgnBinaryInStream *stream,
+                                               GtUword index);
+
+/**
+ * @function Look up a string in the string table of the current file, and
+ * return the shared ``GtStr`` object for it.
+ */
+static GtStr *binary_in_stream_get_str(AgnBinaryInStream *stream,
+                                       GtUword index);
+
+/**
+ * @function Copy a ``GtUword`` value from the given location of the current
+ * file, which may not be suitably aligned.
+ */
+static GtUword binary_in_stream_get_uword(AgnBinaryInStream *stream,
+                                          GtUword offset);
+
+/**
+ * @function Determine whether attributes with the given key should be kept.
+ */
+static bool binary_in_stream_keep(AgnBinaryInStream *stream, const char *key);
+
+/**
+ * @function Decodes nodes from the input files, opening each file in turn.
+ */
+static int binary_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                 GtError *error);
+
+/**
+ * @function Map the next input file into memory and check its header,
+ * trailer, and tables.
+ */
+static int binary_in_stream_open(AgnBinaryInStream *stream, GtError *error);
+
+/**
+ * @function Read a variable-length integer at ``*pos`` (but before ``end``),
+ * advancing ``*pos`` past it. Returns false if the data ends prematurely.
+ */
+static bool binary_in_stream_read(AgnBinaryInStream *stream, GtUword *pos,
+                                  GtUword end, GtUword *value);
+
+/**
+ * @function Read an offset, which may be negative, from ``base`` at ``*pos``
+ * (but before ``end``), advancing ``*pos`` past it.
+ */
+static bool binary_in_stream_read_offset(AgnBinaryInStream *stream,
+                                         GtUword *pos, GtUword end,
+                                         GtUword base, GtUword *value);
+
+/**
+ * @function Check that the feature graphs in ``feats1`` and ``feats2`` have
+ * the same structure, coordinates, and attributes.
+ */
+static bool binary_in_stream_test_compare(GtArray *feats1, GtArray *feats2);
+
+/**
+ * @function Load the nodes of the given file for unit testing, converting them
+ * to the binary format and back if ``binary`` is true and keeping only the
+ * nodes on sequence ``seqid`` if it is not NULL.
+ */
+static void binary_in_stream_test_data(const char *filename, bool binary,
+                                       const char *seqid, GtArray *feats);
+
+/**
+ * @function Write an otherwise empty binary file with the given word size and
+ * byte order marker in its header, and check that reading it fails with an
+ * error message containing ``message``.
+ */
+static bool binary_in_stream_test_header(unsigned char wordsize,
+                                         uint32_t byteorder,
+                                         const char *message);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_binary_in_stream_new(int numfiles, const char **filenames,
+                                       GtHashmap *keepattrs)
+{
+  GtNodeStream *ns = gt_node_stream_create(binary_in_stream_class(), false);
+  AgnBinaryInStream *stream = binary_in_stream_cast(ns);
+  stream->filenames = gt_str_array_new();
+  int i;
+  for(i = 0; i < numfiles; i++)
+    gt_str_array_add_cstr(stream->filenames, filenames[i]);
+  stream->fileindex = 0;
+  stream->origin = NULL;
+  stream->keepattrs = NULL;
+  if(keepattrs != NULL)
+    stream->keepattrs = gt_hashmap_ref(keepattrs);
+  stream->selected = NULL;
+  stream->data = NULL;
+  stream->laststarts = NULL;
+  stream->strs = gt_hashmap_new(GT_HASH_DIRECT, NULL,
+                                (GtFree)gt_str_delete);
+  stream->nodes = gt_array_new( sizeof(GtFeatureNode *) );
+  stream->links = gt_array_new( sizeof(GtUword) );
+  return ns;
+}
+
+bool agn_binary_in_stream_probe(const char *filename, bool *sorted)
+{
+  agn_assert(filename);
+  if(strcmp(filename, "-") == 0)
+    return false;
+  FILE *instream = fopen(filename, "rb");
+  if(instream == NULL)
+    return false;
+
+  // Files from other machines are still reported as binary, so that opening
+  // them gives a specific error
+  unsigned char magic[BINARY_HEADER_SIZE];
+  GtUword flags = 0;
+  uint32_t byteorder = 0;
+  bool binary = fread(magic, sizeof (char), 8, instream) == 8 &&
+                strncmp((const char *)magic, AGN_BINARY_MAGIC, 8) == 0;
+  bool native = binary &&
+                fread(magic + 8, sizeof (char), 8, instream) == 8 &&
+                magic[8] == AGN_BINARY_VERSION &&
+                magic[9] == sizeof (GtUword);
+  if(native)
+  {
+    memcpy(&byteorder, magic + 12, sizeof (uint32_t));
+    native = byteorder == AGN_BINARY_BYTE_ORDER;
+  }
+  if(binary && sorted != NULL)
+  {
+    *sorted = native &&
+              fseek(instream, -(long)BINARY_TRAILER_SIZE, SEEK_END) == 0 &&
+              fread(&flags, sizeof (GtUword), 1, instream) == 1 &&
+              (flags & AGN_BINARY_SORTED);
+  }
+  fclose(instream);
+  return binary;
+}
+
+void agn_binary_in_stream_select(AgnBinaryInStream *stream, const char *seqid)
+{
+  agn_assert(stream && seqid && stream->fileindex == 0);
+  if(stream->selected != NULL)
+    gt_free(stream->selected);
+  stream->selected = gt_cstr_dup(seqid);
+}
+
+bool agn_binary_in_stream_unit_test(AgnUnitTest *test)
+{
+  const char *filename = "data/gff3/amel-gene-multitrans.gff3";
+  GtArray *feats = gt_array_new( sizeof(GtGenomeNode *) );
+  binary_in_stream_test_data(filename, false, NULL, feats);
+  GtArray *binfeats = gt_array_new( sizeof(GtGenomeNode *) );
+  binary_in_stream_test_data(filename, true, NULL, binfeats);
+  bool test1 = gt_array_size(feats) > 0 &&
+               binary_in_stream_test_compare(feats, binfeats);
+  agn_unit_test_result(test, "round trip, shared exons", test1);
+
+  // Every node is attributed to the (temporary) binary file
+  bool origins = gt_array_size(binfeats) > 0;
+  GtUword i;
+  for(i = 0; i < gt_array_size(binfeats); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(binfeats, i);
+    if(strstr(gt_genome_node_get_filename(*gn), "/aegean-agn-") == NULL)
+      origins = false;
+    GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+    if(fn == NULL)
+      continue;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      const char *filename = gt_genome_node_get_filename((GtGenomeNode *)
+                                                         feature);
+      if(strstr(filename, "/aegean-agn-") == NULL)
+        origins = false;
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+  agn_unit_test_result(test, "file names", origins);
+
+  GtArray *selfeats = gt_array_new( sizeof(GtGenomeNode *) );
+  binary_in_stream_test_data(filename, true, "NC_007080.3", selfeats);
+  bool test2 = binary_in_stream_test_compare(feats, selfeats);
+  GtArray *nofeats = gt_array_new( sizeof(GtGenomeNode *) );
+  binary_in_stream_test_data(filename, true, "chr8", nofeats);
+  test2 = test2 && gt_array_size(nofeats) == 0;
+  agn_unit_test_result(test, "select sequence", test2);
+
+  bool test3 = binary_in_stream_test_header(sizeof (GtUword) / 2,
+                                            AGN_BINARY_BYTE_ORDER, "-bit") &&
+               binary_in_stream_test_header(sizeof (GtUword), 0x04030201,
+                                            "byte order");
+  agn_unit_test_result(test, "foreign files", test3);
+
+  GtArray *arrays[] = { feats, binfeats, selfeats, nofeats };
+  for(i = 0; i < 4; i++)
+  {
+    while(gt_array_size(arrays[i]) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(arrays[i]);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(arrays[i]);
+  }
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *binary_in_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnBinaryInStream),
+                                   binary_in_stream_free,
+                                   binary_in_stream_next);
+  }
+  return nsc;
+}
+
+static void binary_in_stream_close(AgnBinaryInStream *stream)
+{
+  gt_hashmap_reset(stream->strs);
+  munmap((void *)stream->data, stream->size);
+  stream->data = NULL;
+  gt_free(stream->laststarts);
+  stream->laststarts = NULL;
+}
+
+static int binary_in_stream_feature(AgnBinaryInStream *stream, GtStr *seqid,
+                                    GtRange *range, GtUword pos, GtUword end,
+                                    GtGenomeNode **gn, GtError *error)
+{
+  GtUword i, j, numnodes;
+  bool valid = binary_in_stream_read(stream, &pos, end, &numnodes) &&
+               numnodes > 0 && numnodes <= end - pos;
+
+  // Nodes are created first; parent-child links (pairs of indices) and
+  // multi-feature representatives are collected and resolved afterwards
+  gt_array_reset(stream->nodes);
+  gt_array_reset(stream->links);
+  GtArray *reps = gt_array_new( sizeof(GtUword) );
+  for(i = 0; valid && i < numnodes; i++)
+  {
+    GtUword type, source, numattrs, numchildren, multirep = 0;
+    GtRange noderange = *range;
+    valid = binary_in_stream_read(stream, &pos, end, &type) &&
+            binary_in_stream_read(stream, &pos, end, &source);
+    if(valid && i > 0)
+    {
+      GtUword length;
+      valid = binary_in_stream_read_offset(stream, &pos, end, range->start,
+                                           &noderange.start) &&
+              binary_in_stream_read(stream, &pos, end, &length) &&
+              length > 0;
+      noderange.end = noderange.start + length - 1;
+    }
+    if(!valid || pos >= end)
+    {
+      valid = false;
+      break;
+    }
+    unsigned char flags = stream->data[pos++];
+    bool pseudo = flags & (1 << 5);
+    const char *typestr = binary_in_stream_get_string(stream, type - 1);
+    if((pseudo && (i > 0 || type > 0)) || (!pseudo && typestr == NULL))
+    {
+      valid = false;
+      break;
+    }
+
+    GtStrand strand = flags & 3;
+    GtGenomeNode *node;
+    if(pseudo)
+      node = gt_feature_node_new_pseudo(seqid, noderange.start, noderange.end,
+                                        strand);
+    else
+      node = gt_feature_node_new(seqid, typestr, noderange.start,
+                                 noderange.end, strand);
+    GtFeatureNode *fn = (GtFeatureNode *)node;
+    gt_genome_node_set_origin(node, stream->origin, 0);
+    gt_array_add(stream->nodes, fn);
+    gt_feature_node_set_phase(fn, (flags >> 2) & 3);
+    if(source > 0)
+    {
+      GtStr *sourcestr = binary_in_stream_get_str(stream, source - 1);
+      if(sourcestr == NULL)
+      {
+        valid = false;
+        break;
+      }
+      gt_feature_node_set_source(fn, sourcestr);
+    }
+    if(flags & (1 << 4))
+    {
+      float score;
+      if(pos + sizeof (float) > end)
+      {
+        valid = false;
+        break;
+      }
+      memcpy(&score, stream->data + pos, sizeof (float));
+      pos += sizeof (float);
+      gt_feature_node_set_score(fn, score);
+    }
+    if(flags & (1 << 6))
+    {
+      valid = binary_in_stream_read(stream, &pos, end, &multirep) &&
+              multirep < numnodes;
+      gt_array_add(reps, i);
+      gt_array_add(reps, multirep);
+    }
+
+    valid = valid && binary_in_stream_read(stream, &pos, end, &numattrs);
+    for(j = 0; valid && j < numattrs; j++)
+    {
+      GtUword key, value;
+      valid = binary_in_stream_read(stream, &pos, end, &key) &&
+              binary_in_stream_read(stream, &pos, end, &value);
+      const char *keystr = binary_in_stream_get_string(stream, key);
+      const char *valuestr = binary_in_stream_get_string(stream, value);
+      valid = valid && keystr != NULL && valuestr != NULL;
+      if(valid && binary_in_stream_keep(stream, keystr))
+        gt_feature_node_add_attribute(fn, keystr, valuestr);
+    }
+
+    valid = valid && binary_in_stream_read(stream, &pos, end, &numchildren);
+    for(j = 0; valid && j < numchildren; j++)
+    {
+      GtUword child;
+      valid = binary_in_stream_read(stream, &pos, end, &child) &&
+              child > 0 && child < numnodes && child != i;
+      gt_array_add(stream->links, i);
+      gt_array_add(stream->links, child);
+    }
+  }
+
+  if(valid)
+  {
+    for(i = 0; i < gt_array_size(reps); i += 2)
+    {
+      GtUword *index = gt_array_get(reps, i);
+      GtFeatureNode **fn = gt_array_get(stream->nodes, index[0]);
+      GtFeatureNode **rep = gt_array_get(stream->nodes, index[1]);
+      if(!gt_feature_node_is_multi(*rep))
+        gt_feature_node_make_multi_representative(*rep);
+      if(*fn != *rep)
+        gt_feature_node_set_multi_representative(*fn, *rep);
+    }
+
+    // A node with several parents holds a reference for each of them
+    bool *attached = gt_calloc(numnodes, sizeof (bool));
+    for(i = 0; i < gt_array_size(stream->links); i += 2)
+    {
+      GtUword *index = gt_array_get(stream->links, i);
+      GtFeatureNode **parent = gt_array_get(stream->nodes, index[0]);
+      GtFeatureNode **child = gt_array_get(stream->nodes, index[1]);
+      if(attached[index[1]])
+        gt_genome_node_ref((GtGenomeNode *)*child);
+      gt_feature_node_add_child(*parent, *child);
+      attached[index[1]] = true;
+    }
+    for(i = 1; i < numnodes; i++)
+    {
+      if(!attached[i])
+      {
+        GtGenomeNode **orphan = gt_array_get(stream->nodes, i);
+        gt_genome_node_delete(*orphan);
+        valid = false;
+      }
+    }
+    gt_free(attached);
+    if(!valid)
+    {
+      GtGenomeNode **root = gt_array_get(stream->nodes, 0);
+      gt_genome_node_delete(*root);
+    }
+  }
+  else
+  {
+    // Without links, every node is deleted on its own
+    for(i = 0; i < gt_array_size(stream->nodes); i++)
+    {
+      GtGenomeNode **node = gt_array_get(stream->nodes, i);
+      gt_genome_node_delete(*node);
+    }
+  }
+  gt_array_delete(reps);
+
+  if(!valid)
+  {
+    gt_error_set(error, "binary annotation file '%s' is corrupt",
+                 gt_str_array_get(stream->filenames, stream->fileindex - 1));
+    return -1;
+  }
+
+  *gn = *(GtGenomeNode **)gt_array_get(stream->nodes, 0);
+  return 0;
+}
+
+static void binary_in_stream_free(GtNodeStream *ns)
+{
+  AgnBinaryInStream *stream = binary_in_stream_cast(ns);
+  if(stream->data != NULL)
+    binary_in_stream_close(stream);
+  gt_str_array_delete(stream->filenames);
+  gt_str_delete(stream->origin);
+  if(stream->keepattrs != NULL)
+    gt_hashmap_delete(stream->keepattrs);
+  if(stream->selected != NULL)
+    gt_free(stream->selected);
+  gt_hashmap_delete(stream->strs);
+  gt_array_delete(stream->nodes);
+  gt_array_delete(stream->links);
+}
+
+static const char *binary_in_stream_get_string(AgnBinaryInStream *stream,
+                                               GtUword index)
+{
+  if(index >= stream->numstrings)
+    return NULL;
+  GtUword offset = binary_in_stream_get_uword(stream,
+                       stream->offsets - stream->data + index*sizeof (GtUword));
+  if(offset >= stream->heapsize)
+    return NULL;
+  return stream->heap + offset;
+}
+
+static GtStr *binary_in_stream_get_str(AgnBinaryInStream *stream,
+                                       GtUword index)
+{
+  const char *string = binary_in_stream_get_string(stream, index);
+  if(string == NULL)
+    return NULL;
+  GtStr *str = gt_hashmap_get(stream->strs, string);
+  if(str == NULL)
+  {
+    str = gt_str_new_cstr(string);
+    gt_hashmap_add(stream->strs, (void *)string, str);
+  }
+  return str;
+}
+
+static GtUword binary_in_stream_get_uword(AgnBinaryInStream *stream,
+                                          GtUword offset)
+{
+  GtUword value;
+  memcpy(&value, stream->data + offset, sizeof (GtUword));
+  return value;
+}
+
+static bool binary_in_stream_keep(AgnBinaryInStream *stream, const char *key)
+{
+  return stream->keepattrs == NULL ||
+         strcmp(key, "ID") == 0 || strcmp(key, "Parent") == 0 ||
+         strcmp(key, "Name") == 0 || strcmp(key, "accession") == 0 ||
+         gt_hashmap_get(stream->keepattrs, key) != NULL;
+}
+
+static int binary_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                 GtError *error)
+{
+  gt_error_check(error);
+  AgnBinaryInStream *stream = binary_in_stream_cast(ns);
+  *gn = NULL;
+  while(1)
+  {
+    if(stream->data == NULL)
+    {
+      if(stream->fileindex >= gt_str_array_size(stream->filenames))
+        return 0;
+      if(binary_in_stream_open(stream, error))
+        return -1;
+    }
+    if(stream->pos >= stream->end)
+    {
+      binary_in_stream_close(stream);
+      continue;
+    }
+
+    GtUword pos = stream->pos, reclength, seq, length;
+    bool valid = binary_in_stream_read(stream, &pos, stream->end, &reclength) &&
+                 reclength <= stream->end - pos;
+    GtUword recend = pos + reclength;
+    unsigned char kind = 0;
+    if(valid && pos < recend)
+      kind = stream->data[pos++];
+    valid = valid && binary_in_stream_read(stream, &pos, recend, &seq) &&
+            seq < stream->numseqs;
+    if(!valid)
+    {
+      gt_error_set(error, "binary annotation file '%s' is corrupt",
+                   gt_str_array_get(stream->filenames, stream->fileindex - 1));
+      return -1;
+    }
+    stream->pos = recend;
+    if(stream->selected != NULL && seq != stream->selseq)
+      continue;
+
+    GtRange range;
+    valid = binary_in_stream_read_offset(stream, &pos, recend,
+                                         stream->laststarts[seq],
+                                         &range.start) &&
+            binary_in_stream_read(stream, &pos, recend, &length) &&
+            length > 0;
+    GtUword seqid = valid ? binary_in_stream_get_uword(stream,
+                                stream->index - stream->data +
+                                seq * sizeof (AgnBinarySeqIndex)) : 0;
+    GtStr *seqidstr = valid ? binary_in_stream_get_str(stream, seqid) : NULL;
+    if(seqidstr == NULL || (kind != AGN_BINARY_REGION &&
+                            kind != AGN_BINARY_FEATURE))
+    {
+      gt_error_set(error, "binary annotation file '%s' is corrupt",
+                   gt_str_array_get(stream->filenames, stream->fileindex - 1));
+      return -1;
+    }
+    range.end = range.start + length - 1;
+    stream->laststarts[seq] = range.start;
+
+    if(kind == AGN_BINARY_REGION)
+    {
+      *gn = gt_region_node_new(seqidstr, range.start, range.end);
+      gt_genome_node_set_origin(*gn, stream->origin, 0);
+      return 0;
+    }
+    return binary_in_stream_feature(stream, seqidstr, &range, pos, recend, gn,
+                                    error);
+  }
+}
+
+static int binary_in_stream_open(AgnBinaryInStream *stream, GtError *error)
+{
+  const char *filename = gt_str_array_get(stream->filenames,
+                                          stream->fileindex++);
+  gt_str_delete(stream->origin);
+  stream->origin = gt_str_new_cstr(filename);
+  int fd = open(filename, O_RDONLY);
+  struct stat filestat;
+  if(fd < 0 || fstat(fd, &filestat) != 0)
+  {
+    gt_error_set(error, "unable to open binary annotation file '%s'",
+                 filename);
+    if(fd >= 0)
+      close(fd);
+    return -1;
+  }
+  stream->size = filestat.st_size;
+  if(stream->size < BINARY_HEADER_SIZE + BINARY_TRAILER_SIZE)
+  {
+    gt_error_set(error, "'%s' is not a binary annotation file", filename);
+    close(fd);
+    return -1;
+  }
+  void *data = mmap(NULL, stream->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+  {
+    gt_error_set(error, "unable to map binary annotation file '%s'", filename);
+    return -1;
+  }
+  stream->data = data;
+  stream->laststarts = NULL;
+
+  // The version and word size are single bytes, and are checked before any
+  // native integers are read
+  const unsigned char *header = stream->data + 8;
+  uint32_t byteorder;
+  memcpy(&byteorder, header + 4, sizeof (uint32_t));
+  if(strncmp((const char *)stream->data, AGN_BINARY_MAGIC, 8) != 0 ||
+     header[0] != AGN_BINARY_VERSION)
+  {
+    gt_error_set(error, "'%s' is not a binary annotation file, or was written "
+                 "by an incompatible version of AEGeAn", filename);
+    binary_in_stream_close(stream);
+    return -1;
+  }
+  if(header[1] != sizeof (GtUword))
+  {
+    gt_error_set(error, "binary annotation file '%s' was written on a machine "
+                 "with %d-bit integers, but this machine uses %d-bit "
+                 "integers", filename, 8 * header[1],
+                 (int)(8 * sizeof (GtUword)));
+    binary_in_stream_close(stream);
+    return -1;
+  }
+  if(byteorder != AGN_BINARY_BYTE_ORDER)
+  {
+    gt_error_set(error, "binary annotation file '%s' was written on a machine "
+                 "with a different byte order", filename);
+    binary_in_stream_close(stream);
+    return -1;
+  }
+
+  // Check that the tables lie within the file before anything is decoded
+  GtUword trailer = stream->size - BINARY_TRAILER_SIZE;
+  stream->flags = binary_in_stream_get_uword(stream, trailer);
+  GtUword stringsoffset = binary_in_stream_get_uword(stream,
+                              trailer + 2 * sizeof (GtUword));
+  GtUword indexoffset = binary_in_stream_get_uword(stream,
+                            trailer + 3 * sizeof (GtUword));
+  bool valid = stringsoffset >= BINARY_HEADER_SIZE &&
+               stringsoffset <= indexoffset &&
+               indexoffset <= trailer - sizeof (GtUword);
+  if(valid)
+  {
+    stream->numstrings = binary_in_stream_get_uword(stream, stringsoffset);
+    valid = stream->numstrings <= (indexoffset - stringsoffset) /
+                                  sizeof (GtUword);
+  }
+  if(valid)
+  {
+    GtUword heapoffset = stringsoffset + (stream->numstrings + 1) *
+                                         sizeof (GtUword);
+    valid = heapoffset + sizeof (GtUword) <= indexoffset;
+    if(valid)
+    {
+      stream->offsets = stream->data + stringsoffset + sizeof (GtUword);
+      stream->heapsize = binary_in_stream_get_uword(stream, heapoffset);
+      stream->heap = (const char *)stream->data + heapoffset +
+                     sizeof (GtUword);
+      valid = stream->heapsize <= indexoffset - heapoffset - sizeof (GtUword) &&
+              (stream->heapsize == 0 ||
+               stream->heap[stream->heapsize - 1] == '\0');
+    }
+  }
+  if(valid)
+  {
+    stream->numseqs = binary_in_stream_get_uword(stream, indexoffset);
+    stream->index = stream->data + indexoffset + sizeof (GtUword);
+    valid = stream->numseqs <= (trailer - indexoffset - sizeof (GtUword)) /
+                               sizeof (AgnBinarySeqIndex);
+  }
+  if(!valid)
+  {
+    gt_error_set(error, "binary annotation file '%s' is corrupt", filename);
+    binary_in_stream_close(stream);
+    return -1;
+  }
+
+  stream->laststarts = gt_calloc(stream->numseqs + 1, sizeof (GtUword));
+  stream->pos = BINARY_HEADER_SIZE;
+  stream->end = stringsoffset;
+  if(stream->selected != NULL)
+  {
+    GtUword i;
+    stream->selseq = stream->numseqs;
+    for(i = 0; i < stream->numseqs; i++)
+    {
+      AgnBinarySeqIndex entry;
+      memcpy(&entry, stream->index + i * sizeof (AgnBinarySeqIndex),
+             sizeof (AgnBinarySeqIndex));
+      const char *seqid = binary_in_stream_get_string(stream, entry.seqid);
+      if(seqid == NULL || strcmp(seqid, stream->selected) != 0)
+        continue;
+      stream->selseq = i;
+      if(entry.offset >= BINARY_HEADER_SIZE && entry.offset <= entry.endoffset &&
+         entry.endoffset <= stringsoffset)
+      {
+        stream->pos = entry.offset;
+        stream->end = entry.endoffset;
+      }
+      break;
+    }
+    if(stream->selseq == stream->numseqs)
+      stream->pos = stream->end;
+  }
+  return 0;
+}
+
+static bool binary_in_stream_read(AgnBinaryInStream *stream, GtUword *pos,
+                                  GtUword end, GtUword *value)
+{
+  GtUword shift = 0;
+  *value = 0;
+  while(*pos < end && shift < 8 * sizeof (GtUword))
+  {
+    unsigned char byte = stream->data[(*pos)++];
+    *value |= (GtUword)(byte & 0x7f) << shift;
+    if(!(byte & 0x80))
+      return true;
+    shift += 7;
+  }
+  return false;
+}
+
+static bool binary_in_stream_read_offset(AgnBinaryInStream *stream,
+                                         GtUword *pos, GtUword end,
+                                         GtUword base, GtUword *value)
+{
+  GtUword encoded;
+  if(!binary_in_stream_read(stream, pos, end, &encoded))
+    return false;
+  if(encoded % 2 == 0)
+    *value = base + encoded / 2;
+  else if((encoded + 1) / 2 < base)
+    *value = base - (encoded + 1) / 2;
+  else
+    return false;
+  return *value > 0;
+}
+
+static bool binary_in_stream_test_compare(GtArray *feats1, GtArray *feats2)
+{
+  if(gt_array_size(feats1) != gt_array_size(feats2))
+    return false;
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(feats1); i++)
+  {
+    GtGenomeNode **gn1 = gt_array_get(feats1, i);
+    GtGenomeNode **gn2 = gt_array_get(feats2, i);
+    if(gt_genome_node_cmp(*gn1, *gn2) != 0)
+      return false;
+    GtFeatureNode *fn1 = gt_feature_node_try_cast(*gn1);
+    GtFeatureNode *fn2 = gt_feature_node_try_cast(*gn2);
+    if(fn1 == NULL || fn2 == NULL)
+    {
+      if(fn1 != fn2)
+        return false;
+      continue;
+    }
+
+    GtFeatureNodeIterator *iter1 = gt_feature_node_iterator_new(fn1);
+    GtFeatureNodeIterator *iter2 = gt_feature_node_iterator_new(fn2);
+    GtFeatureNode *f1 = gt_feature_node_iterator_next(iter1);
+    GtFeatureNode *f2 = gt_feature_node_iterator_next(iter2);
+    bool same = true;
+    while(same && f1 != NULL && f2 != NULL)
+    {
+      GtStrArray *attrs = gt_feature_node_get_attribute_list(f1);
+      GtUword j;
+      same = gt_genome_node_cmp((GtGenomeNode *)f1, (GtGenomeNode *)f2) == 0 &&
+             strcmp(gt_feature_node_get_type(f1),
+                    gt_feature_node_get_type(f2)) == 0 &&
+             gt_feature_node_get_strand(f1) == gt_feature_node_get_strand(f2) &&
+             gt_feature_node_get_phase(f1) == gt_feature_node_get_phase(f2);
+      for(j = 0; same && j < gt_str_array_size(attrs); j++)
+      {
+        const char *key = gt_str_array_get(attrs, j);
+        const char *value = gt_feature_node_get_attribute(f2, key);
+        same = value != NULL &&
+               strcmp(value, gt_feature_node_get_attribute(f1, key)) == 0;
+      }
+      gt_str_array_delete(attrs);
+      f1 = gt_feature_node_iterator_next(iter1);
+      f2 = gt_feature_node_iterator_next(iter2);
+    }
+    same = same && f1 == NULL && f2 == NULL;
+    gt_feature_node_iterator_delete(iter1);
+    gt_feature_node_iterator_delete(iter2);
+    if(!same)
+      return false;
+  }
+  return true;
+}
+
+static void binary_in_stream_test_data(const char *filename, bool binary,
+                                       const char *seqid, GtArray *feats)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  GtNodeStream *arraystream;
+  if(!binary)
+  {
+    arraystream = gt_array_out_stream_new(gff3in, feats, error);
+    if(gt_node_stream_pull(arraystream, error) == -1)
+    {
+      fprintf(stderr, "[AgnBinaryInStream::binary_in_stream_test_data] error "
+              "processing features: %s\n", gt_error_get(error));
+    }
+    gt_node_stream_delete(arraystream);
+    gt_node_stream_delete(gff3in);
+    gt_error_delete(error);
+    return;
+  }
+
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *binfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(binfile, "/aegean-agn-XXXXXX");
+  int fd = mkstemp(gt_str_get(binfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "wb");
+  if(outstream == NULL)
+  {
+    fprintf(stderr, "[AgnBinaryInStream::binary_in_stream_test_data] could "
+            "not create temporary file '%s'\n", gt_str_get(binfile));
+    gt_node_stream_delete(gff3in);
+    gt_str_delete(binfile);
+    gt_error_delete(error);
+    return;
+  }
+
+  GtNodeStream *binout = agn_binary_out_stream_new(gff3in, outstream);
+  int had_err = gt_node_stream_pull(binout, error);
+  fclose(outstream);
+  gt_node_stream_delete(binout);
+  gt_node_stream_delete(gff3in);
+
+  const char *binfilename = gt_str_get(binfile);
+  GtNodeStream *binin = agn_binary_in_stream_new(1, &binfilename, NULL);
+  if(seqid != NULL)
+    agn_binary_in_stream_select((AgnBinaryInStream *)binin, seqid);
+  arraystream = gt_array_out_stream_new(binin, feats, error);
+  if(!had_err)
+    had_err = gt_node_stream_pull(arraystream, error);
+  if(had_err)
+  {
+    fprintf(stderr, "[AgnBinaryInStream::binary_in_stream_test_data] error "
+            "processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(arraystream);
+  gt_node_stream_delete(binin);
+  unlink(binfilename);
+  gt_str_delete(binfile);
+  gt_error_delete(error);
+}
+
+static bool binary_in_stream_test_header(unsigned char wordsize,
+                                         uint32_t byteorder,
+                                         const char *message)
+{
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *binfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(binfile, "/aegean-agn-XXXXXX");
+  int fd = mkstemp(gt_str_get(binfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "wb");
+  if(outstream == NULL)
+  {
+    fprintf(stderr, "[AgnBinaryInStream::binary_in_stream_test_header] could "
+            "not create temporary file '%s'\n", gt_str_get(binfile));
+    if(fd >= 0)
+    {
+      close(fd);
+      unlink(gt_str_get(binfile));
+    }
+    gt_str_delete(binfile);
+    return false;
+  }
+
+  unsigned char header[4] = { AGN_BINARY_VERSION, wordsize, 0, 0 };
+  unsigned char trailer[BINARY_TRAILER_SIZE];
+  memset(trailer, 0, BINARY_TRAILER_SIZE);
+  fwrite(AGN_BINARY_MAGIC, sizeof (char), 8, outstream);
+  fwrite(header, sizeof (unsigned char), 4, outstream);
+  fwrite(&byteorder, sizeof (uint32_t), 1, outstream);
+  fwrite(trailer, sizeof (unsigned char), BINARY_TRAILER_SIZE, outstream);
+  fclose(outstream);
+
+  const char *binfilename = gt_str_get(binfile);
+  GtError *error = gt_error_new();
+  GtNodeStream *binin = agn_binary_in_stream_new(1, &binfilename, NULL);
+  GtGenomeNode *gn = NULL;
+  int had_err = gt_node_stream_next(binin, &gn, error);
+  bool success = had_err && gn == NULL &&
+                 strstr(gt_error_get(error), message) != NULL;
+  if(gn != NULL)
+    gt_genome_node_delete(gn);
+  gt_node_stream_delete(binin);
+  unlink(binfilename);
+  gt_str_delete(binfile);
+  gt_error_delete(error);
+  return success;
+}
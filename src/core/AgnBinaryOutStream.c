@@ -0,0 +1,520 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include "core/cstr_api.h"
+#include "core/hashmap_api.h"
+#include "core/ma_api.h"
+#include "extended/feature_node_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/meta_node_api.h"
+#include "AgnBinaryInStream.h"
+#include "AgnBinaryOutStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * @type Sequence index entry, along with the start of the sequence's most
+ * recent record, from which the next record's start is stored as an offset.
+ */
+typedef struct
+{
+  AgnBinarySeqIndex index;
+  GtUword laststart;
+} BinaryOutSeq;
+
+/**
+ * Each record is encoded in ``record`` and written once its length is known.
+ * The string table maps each distinct string to its index (plus one) in
+ * ``strings``; ``seqmap`` likewise maps sequence IDs to entries of ``seqs``.
+ * While a feature is encoded, ``nodemap`` maps each node of the feature graph
+ * to its index (plus one) in ``nodes``.
+ */
+struct AgnBinaryOutStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  FILE *outstream;
+  GtUword offset;
+  GtUword numrecords;
+  GtUword flags;
+  bool finished;
+  GtArray *strings;
+  GtHashmap *stringmap;
+  GtArray *seqs;
+  GtHashmap *seqmap;
+  GtArray *nodes;
+  GtHashmap *nodemap;
+  unsigned char *record;
+  GtUword reclength;
+  GtUword reccapacity;
+};
+
+#define BINARY_OUT_STREAM_SORTED_PRAGMA "aegean-sorted"
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define binary_out_stream_cast(GS)\
+        gt_node_stream_cast(binary_out_stream_class(), GS)
+
+/**
+ * @function Append raw bytes to the record being encoded.
+ */
+static void binary_out_stream_append(AgnBinaryOutStream *stream,
+                                     const void *data, GtUword length);
+
+/**
+ * @function Append a variable-length integer to the record being encoded.
+ */
+static void binary_out_stream_append_uword(AgnBinaryOutStream *stream,
+                                           GtUword value);
+
+/**
+ * @function Append an offset, which may be negative, to the record being
+ * encoded.
+ */
+static void binary_out_stream_append_word(AgnBinaryOutStream *stream,
+                                          GtUword value, GtUword base);
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* binary_out_stream_class(void);
+
+/**
+ * @function Encode ``value`` as a variable-length integer in ``bytes``, which
+ * must have room for at least 10 bytes. Returns the number of bytes used.
+ */
+static GtUword binary_out_stream_encode(unsigned char *bytes, GtUword value);
+
+/**
+ * @function Encode a single node of the feature graph rooted at ``root``.
+ */
+static void binary_out_stream_feature(AgnBinaryOutStream *stream,
+                                      GtFeatureNode *fn, GtFeatureNode *root);
+
+/**
+ * @function Write the string table, the sequence index, and the trailer.
+ */
+static int binary_out_stream_finish(AgnBinaryOutStream *stream,
+                                    GtError *error);
+
+/**
+ * @function Class destructor.
+ */
+static void binary_out_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Look up the index of the given string in the string table, adding
+ * the string if necessary.
+ */
+static GtUword binary_out_stream_intern(AgnBinaryOutStream *stream,
+                                        const char *string);
+
+/**
+ * @function Pulls nodes from the input stream, writes the regions and features
+ * to the output file, and delivers all nodes to the output stream.
+ */
+static int binary_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error);
+
+/**
+ * @function Add the given node and its descendants to ``nodes``, in the order
+ * in which they are first encountered.
+ */
+static void binary_out_stream_number(AgnBinaryOutStream *stream,
+                                     GtFeatureNode *fn);
+
+/**
+ * @function Encode and write a record for the given region or feature.
+ */
+static void binary_out_stream_record(AgnBinaryOutStream *stream,
+                                     GtGenomeNode *gn, unsigned char kind);
+
+/**
+ * @function Write raw bytes to the output file.
+ */
+static void binary_out_stream_write(AgnBinaryOutStream *stream,
+                                    const void *data, size_t size,
+                                    size_t count);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_binary_out_stream_new(GtNodeStream *in_stream,
+                                        FILE *outstream)
+{
+  agn_assert(in_stream && outstream);
+  GtNodeStream *ns = gt_node_stream_create(binary_out_stream_class(), false);
+  AgnBinaryOutStream *stream = binary_out_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->outstream = outstream;
+  stream->offset = 0;
+  stream->numrecords = 0;
+  stream->flags = 0;
+  stream->finished = false;
+  stream->strings = gt_array_new( sizeof(char *) );
+  stream->stringmap = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  stream->seqs = gt_array_new( sizeof(BinaryOutSeq) );
+  stream->seqmap = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  stream->nodes = gt_array_new( sizeof(GtFeatureNode *) );
+  stream->nodemap = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  stream->reclength = 0;
+  stream->reccapacity = 4096;
+  stream->record = gt_malloc( sizeof(unsigned char) * stream->reccapacity );
+
+  unsigned char header[4] = { AGN_BINARY_VERSION, sizeof (GtUword), 0, 0 };
+  uint32_t byteorder = AGN_BINARY_BYTE_ORDER;
+  binary_out_stream_write(stream, AGN_BINARY_MAGIC, sizeof (char), 8);
+  binary_out_stream_write(stream, header, sizeof (unsigned char), 4);
+  binary_out_stream_write(stream, &byteorder, sizeof (uint32_t), 1);
+  return ns;
+}
+
+static void binary_out_stream_append(AgnBinaryOutStream *stream,
+                                     const void *data, GtUword length)
+{
+  if(stream->reclength + length > stream->reccapacity)
+  {
+    while(stream->reclength + length > stream->reccapacity)
+      stream->reccapacity *= 2;
+    stream->record = gt_realloc(stream->record,
+                                sizeof(unsigned char) * stream->reccapacity);
+  }
+  memcpy(stream->record + stream->reclength, data, length);
+  stream->reclength += length;
+}
+
+static void binary_out_stream_append_uword(AgnBinaryOutStream *stream,
+                                           GtUword value)
+{
+  unsigned char bytes[16];
+  GtUword length = binary_out_stream_encode(bytes, value);
+  binary_out_stream_append(stream, bytes, length);
+}
+
+static void binary_out_stream_append_word(AgnBinaryOutStream *stream,
+                                          GtUword value, GtUword base)
+{
+  // Non-negative offsets are even, negative offsets odd
+  if(value >= base)
+    binary_out_stream_append_uword(stream, (value - base) * 2);
+  else
+    binary_out_stream_append_uword(stream, (base - value) * 2 - 1);
+}
+
+static const GtNodeStreamClass *binary_out_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnBinaryOutStream),
+                                   binary_out_stream_free,
+                                   binary_out_stream_next);
+  }
+  return nsc;
+}
+
+static GtUword binary_out_stream_encode(unsigned char *bytes, GtUword value)
+{
+  GtUword length = 0;
+  while(value >= 0x80)
+  {
+    bytes[length++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  bytes[length++] = value;
+  return length;
+}
+
+static void binary_out_stream_feature(AgnBinaryOutStream *stream,
+                                      GtFeatureNode *fn, GtFeatureNode *root)
+{
+  GtGenomeNode *gn = (GtGenomeNode *)fn;
+  bool pseudo = gt_feature_node_is_pseudo(fn);
+  GtUword type = 0, source = 0;
+  if(!pseudo)
+  {
+    type = binary_out_stream_intern(stream, gt_feature_node_get_type(fn)) + 1;
+    if(gt_feature_node_has_source(fn))
+    {
+      source = binary_out_stream_intern(stream,
+                                        gt_feature_node_get_source(fn)) + 1;
+    }
+  }
+  binary_out_stream_append_uword(stream, type);
+  binary_out_stream_append_uword(stream, source);
+
+  // The root's coordinates are stored in the record header
+  if(fn != root)
+  {
+    GtUword rootstart = gt_genome_node_get_start((GtGenomeNode *)root);
+    binary_out_stream_append_word(stream, gt_genome_node_get_start(gn),
+                                  rootstart);
+    binary_out_stream_append_uword(stream, gt_genome_node_get_length(gn));
+  }
+
+  GtUword multirep = 0;
+  if(gt_feature_node_is_multi(fn))
+  {
+    GtFeatureNode *rep = gt_feature_node_get_multi_representative(fn);
+    multirep = (GtUword)gt_hashmap_get(stream->nodemap, rep);
+  }
+  bool hasscore = gt_feature_node_score_is_defined(fn);
+  unsigned char flags = gt_feature_node_get_strand(fn) |
+                        gt_feature_node_get_phase(fn) << 2 |
+                        (hasscore ? 1 << 4 : 0) |
+                        (pseudo   ? 1 << 5 : 0) |
+                        (multirep ? 1 << 6 : 0);
+  binary_out_stream_append(stream, &flags, 1);
+  if(hasscore)
+  {
+    float score = gt_feature_node_get_score(fn);
+    binary_out_stream_append(stream, &score, sizeof (float));
+  }
+  if(multirep)
+    binary_out_stream_append_uword(stream, multirep - 1);
+
+  GtStrArray *attrs = gt_feature_node_get_attribute_list(fn);
+  GtUword i, numattrs = gt_str_array_size(attrs);
+  binary_out_stream_append_uword(stream, numattrs);
+  for(i = 0; i < numattrs; i++)
+  {
+    const char *key = gt_str_array_get(attrs, i);
+    const char *value = gt_feature_node_get_attribute(fn, key);
+    binary_out_stream_append_uword(stream,
+                                   binary_out_stream_intern(stream, key));
+    binary_out_stream_append_uword(stream,
+                                   binary_out_stream_intern(stream, value));
+  }
+  gt_str_array_delete(attrs);
+
+  GtArray *children = gt_array_new( sizeof(GtUword) );
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    GtUword index = (GtUword)gt_hashmap_get(stream->nodemap, child) - 1;
+    gt_array_add(children, index);
+  }
+  gt_feature_node_iterator_delete(iter);
+  binary_out_stream_append_uword(stream, gt_array_size(children));
+  for(i = 0; i < gt_array_size(children); i++)
+  {
+    GtUword *index = gt_array_get(children, i);
+    binary_out_stream_append_uword(stream, *index);
+  }
+  gt_array_delete(children);
+}
+
+static int binary_out_stream_finish(AgnBinaryOutStream *stream,
+                                    GtError *error)
+{
+  GtUword i, stringsoffset = stream->offset;
+  GtUword numstrings = gt_array_size(stream->strings);
+  binary_out_stream_write(stream, &numstrings, sizeof (GtUword), 1);
+  GtUword heapsize = 0;
+  for(i = 0; i < numstrings; i++)
+  {
+    const char *string = *(char **)gt_array_get(stream->strings, i);
+    binary_out_stream_write(stream, &heapsize, sizeof (GtUword), 1);
+    heapsize += strlen(string) + 1;
+  }
+  binary_out_stream_write(stream, &heapsize, sizeof (GtUword), 1);
+  for(i = 0; i < numstrings; i++)
+  {
+    const char *string = *(char **)gt_array_get(stream->strings, i);
+    binary_out_stream_write(stream, string, sizeof (char), strlen(string) + 1);
+  }
+
+  GtUword indexoffset = stream->offset;
+  GtUword numseqs = gt_array_size(stream->seqs);
+  binary_out_stream_write(stream, &numseqs, sizeof (GtUword), 1);
+  for(i = 0; i < numseqs; i++)
+  {
+    BinaryOutSeq *seq = gt_array_get(stream->seqs, i);
+    binary_out_stream_write(stream, &seq->index, sizeof (AgnBinarySeqIndex),
+                            1);
+  }
+
+  GtUword trailer[] = { stream->flags, stream->numrecords, stringsoffset,
+                        indexoffset };
+  binary_out_stream_write(stream, trailer, sizeof (GtUword), 4);
+  if(fflush(stream->outstream) != 0 || ferror(stream->outstream))
+  {
+    gt_error_set(error, "could not write binary annotation file");
+    return -1;
+  }
+  return 0;
+}
+
+static void binary_out_stream_free(GtNodeStream *ns)
+{
+  AgnBinaryOutStream *stream = binary_out_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->strings); i++)
+  {
+    char **string = gt_array_get(stream->strings, i);
+    gt_free(*string);
+  }
+  gt_array_delete(stream->strings);
+  gt_hashmap_delete(stream->stringmap);
+  gt_array_delete(stream->seqs);
+  gt_hashmap_delete(stream->seqmap);
+  gt_array_delete(stream->nodes);
+  gt_hashmap_delete(stream->nodemap);
+  gt_free(stream->record);
+}
+
+static GtUword binary_out_stream_intern(AgnBinaryOutStream *stream,
+                                        const char *string)
+{
+  GtUword index = (GtUword)gt_hashmap_get(stream->stringmap, string);
+  if(index > 0)
+    return index - 1;
+
+  char *copy = gt_cstr_dup(string);
+  gt_array_add(stream->strings, copy);
+  index = gt_array_size(stream->strings);
+  gt_hashmap_add(stream->stringmap, copy, (void *)index);
+  return index - 1;
+}
+
+static int binary_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error)
+{
+  AgnBinaryOutStream *stream;
+  int had_err;
+  gt_error_check(error);
+  stream = binary_out_stream_cast(ns);
+
+  had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  if(had_err)
+    return had_err;
+  if(*gn == NULL)
+  {
+    if(stream->finished)
+      return 0;
+    stream->finished = true;
+    return binary_out_stream_finish(stream, error);
+  }
+
+  GtMetaNode *mn = gt_meta_node_try_cast(*gn);
+  if(mn != NULL && strcmp(gt_meta_node_get_directive(mn),
+                          BINARY_OUT_STREAM_SORTED_PRAGMA) == 0)
+  {
+    stream->flags |= AGN_BINARY_SORTED;
+  }
+  else if(gt_region_node_try_cast(*gn) != NULL)
+    binary_out_stream_record(stream, *gn, AGN_BINARY_REGION);
+  else if(gt_feature_node_try_cast(*gn) != NULL)
+    binary_out_stream_record(stream, *gn, AGN_BINARY_FEATURE);
+
+  return 0;
+}
+
+static void binary_out_stream_number(AgnBinaryOutStream *stream,
+                                     GtFeatureNode *fn)
+{
+  if(gt_hashmap_get(stream->nodemap, fn) != NULL)
+    return;
+  gt_array_add(stream->nodes, fn);
+  gt_hashmap_add(stream->nodemap, fn, (void *)gt_array_size(stream->nodes));
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    binary_out_stream_number(stream, child);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+static void binary_out_stream_record(AgnBinaryOutStream *stream,
+                                     GtGenomeNode *gn, unsigned char kind)
+{
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+  GtUword seqindex = (GtUword)gt_hashmap_get(stream->seqmap, seqid);
+  if(seqindex == 0)
+  {
+    BinaryOutSeq seq;
+    seq.index.seqid = binary_out_stream_intern(stream, seqid);
+    seq.index.range = gt_genome_node_get_range(gn);
+    seq.index.offset = stream->offset;
+    seq.index.endoffset = stream->offset;
+    seq.index.numrecords = 0;
+    seq.laststart = 0;
+    gt_array_add(stream->seqs, seq);
+    seqindex = gt_array_size(stream->seqs);
+    const char *key = *(char **)gt_array_get(stream->strings,
+                                             seq.index.seqid);
+    gt_hashmap_add(stream->seqmap, (void *)key, (void *)seqindex);
+  }
+  BinaryOutSeq *seq = gt_array_get(stream->seqs, seqindex - 1);
+
+  GtRange range = gt_genome_node_get_range(gn);
+  stream->reclength = 0;
+  binary_out_stream_append(stream, &kind, 1);
+  binary_out_stream_append_uword(stream, seqindex - 1);
+  binary_out_stream_append_word(stream, range.start, seq->laststart);
+  binary_out_stream_append_uword(stream, range.end - range.start + 1);
+  if(kind == AGN_BINARY_FEATURE)
+  {
+    gt_array_reset(stream->nodes);
+    gt_hashmap_reset(stream->nodemap);
+    binary_out_stream_number(stream, (GtFeatureNode *)gn);
+    GtUword i, numnodes = gt_array_size(stream->nodes);
+    binary_out_stream_append_uword(stream, numnodes);
+    for(i = 0; i < numnodes; i++)
+    {
+      GtFeatureNode **fn = gt_array_get(stream->nodes, i);
+      binary_out_stream_feature(stream, *fn, (GtFeatureNode *)gn);
+    }
+  }
+
+  // The record is prefixed with its length so that it can be skipped
+  unsigned char prefix[16];
+  GtUword prefixlength = binary_out_stream_encode(prefix, stream->reclength);
+  binary_out_stream_write(stream, prefix, sizeof (unsigned char),
+                          prefixlength);
+  binary_out_stream_write(stream, stream->record, sizeof (unsigned char),
+                          stream->reclength);
+
+  seq->laststart = range.start;
+  seq->index.range.start = range.start < seq->index.range.start ?
+                           range.start : seq->index.range.start;
+  seq->index.range.end = range.end > seq->index.range.end ?
+                         range.end : seq->index.range.end;
+  seq->index.endoffset = stream->offset;
+  seq->index.numrecords++;
+  stream->numrecords++;
+}
+
+static void binary_out_stream_write(AgnBinaryOutStream *stream,
+                                    const void *data, size_t size,
+                                    size_t count)
+{
+  fwrite(data, size, count, stream->outstream);
+  stream->offset += size * count;
+}
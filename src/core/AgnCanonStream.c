@@ -0,0 +1,1165 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/array_api.h"
+#include "core/hashmap_api.h"
+#include "core/queue_api.h"
+#include "AgnCanonStream.h"
+#include "AgnGeneStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define canon_stream_cast(GS)\
+        gt_node_stream_cast(canon_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * A gene or transcript feature, along with all of its subfeatures of interest.
+ * As with ``agn_typecheck_select``, the subfeatures are collected from the
+ * complete feature graph below the feature. Features are stored in the order
+ * of a depth-first traversal: ``parent`` is the index of the closest enclosing
+ * gene or transcript (-1 if there is none) and features with indices in the
+ * range [index + 1, ``end``) are enclosed by this feature. The CDS, UTR, and
+ * codon arrays are only populated for mRNAs.
+ */
+typedef struct
+{
+  GtFeatureNode *node;
+  long parent;
+  GtUword end;
+  bool ismrna;
+  GtArray *cds;
+  GtArray *utrs;
+  GtArray *exons;
+  GtArray *introns;
+  GtArray *starts;
+  GtArray *stops;
+} CanonFeature;
+
+struct AgnCanonStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtArray *features;
+  GtUword numfeatures;
+  GtUword numgenes;
+  GtHashmap *mrnas;
+  GtArray *inferred;
+  GtArray *ranges;
+  GtHashmap *adjacent;
+  GtArray *genes;
+  GtQueue *cache;
+  GtStr *parentstr;
+  GtUword cdscounter;
+  bool defercds;
+  GtLogger *logger;
+  GtStr *source;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add a gene or transcript feature to the current set, reusing the
+ * arrays allocated for a previous node. Returns the feature's index.
+ */
+static GtUword canon_stream_add_feature(AgnCanonStream *stream,
+                                        GtFeatureNode *fn, long parent);
+
+/**
+ * @function Add a subfeature to the appropriate arrays of the feature with the
+ * given index and each of the features enclosing it.
+ */
+static void canon_stream_add_part(AgnCanonStream *stream, long index,
+                                  GtFeatureNode *part);
+
+/**
+ * @function If the mRNA's CDS is discontinuous, ensure each CDS feature is
+ * labeled as a multifeature.
+ */
+static void canon_stream_check_cds_multi(AgnCanonStream *stream,
+                                         CanonFeature *mrna);
+
+/**
+ * @function Check and correct phase attributes for each CDS feature.
+ */
+static void canon_stream_check_cds_phase(CanonFeature *mrna);
+
+/**
+ * @function If start or stop codon is provided explicitly, ensure it agrees
+ * with CDS; otherwise infer it from CDS if possible.
+ */
+static void canon_stream_check_codon(AgnCanonStream *stream, GtUword index,
+                                     bool start);
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* canon_stream_class(void);
+
+/**
+ * @function Traverse the feature graph below ``fn``, collecting each gene and
+ * transcript feature along with its subfeatures.
+ */
+static void canon_stream_collect(AgnCanonStream *stream, GtFeatureNode *fn,
+                                 long parent);
+
+/**
+ * @function If an exon or intron with the given range was inferred earlier for
+ * another mRNA of the same gene, associate it with this mRNA as well instead
+ * of creating a duplicate feature. Returns true if the feature was collapsed.
+ */
+static bool canon_stream_collapse_feature(AgnCanonStream *stream,
+                                          GtUword index, GtRange *range);
+
+/**
+ * @function Create a new feature and add it as a subfeature of the mRNA with
+ * the given index.
+ */
+static GtFeatureNode *canon_stream_create_feature(AgnCanonStream *stream,
+                                                  GtUword index,
+                                                  GtGenomeNode *template,
+                                                  const char *type,
+                                                  GtRange *range,
+                                                  bool setparent);
+
+/**
+ * @function Search the given top-level feature for gene features. Multi-feature
+ * genes are grouped under a pseudo-feature, exactly as ``AgnFilterStream``
+ * does.
+ */
+static void canon_stream_extract_genes(AgnCanonStream *stream,
+                                       GtFeatureNode *fn);
+
+/**
+ * @function Class destructor.
+ */
+static void canon_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Infer CDS from explicitly provided exons and start/stop codons.
+ */
+static void canon_stream_infer_cds(AgnCanonStream *stream, GtUword index);
+
+/**
+ * @function Infer exons and introns for the gene or transcript with the given
+ * index, and check the exons of each of its mRNAs for overlap.
+ */
+static int canon_stream_infer_exons(AgnCanonStream *stream, GtUword index,
+                                    GtError *error);
+
+/**
+ * @function Infer exons for a single mRNA from its CDS and UTR segments.
+ * ``numexons`` is the number of exons in the enclosing gene or transcript.
+ */
+static void canon_stream_infer_exons_mrna(AgnCanonStream *stream,
+                                          GtUword index, GtUword numexons);
+
+/**
+ * @function Infer introns from the exons of each mRNA enclosed by the gene or
+ * transcript with the given index.
+ */
+static void canon_stream_infer_introns(AgnCanonStream *stream, GtUword index);
+
+/**
+ * @function Infer UTRs from explicitly provided exons and CDS or start/stop
+ * codons.
+ */
+static void canon_stream_infer_utrs(AgnCanonStream *stream, GtUword index);
+
+/**
+ * @function Pulls nodes from the input stream, canonicalizes them, and delivers
+ * valid genes to the output stream.
+ */
+static int canon_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                             GtError *error);
+
+/**
+ * @function Collect, canonicalize, and validate the genes of a single top-level
+ * feature. Valid genes are placed in the stream's cache.
+ */
+static int canon_stream_process(AgnCanonStream *stream, GtFeatureNode *fn,
+                                GtError *error);
+
+/**
+ * @function Ensure that UTR types are correctly encoded.
+ */
+static void canon_stream_set_utrs(CanonFeature *mrna);
+
+/**
+ * @function Check that two feature graphs are identical, for unit testing.
+ */
+static bool canon_stream_test_compare(GtFeatureNode *fn1, GtFeatureNode *fn2);
+
+/**
+ * @function Run the given file through a gene stream and through a canon
+ * stream and check that the results are identical, for unit testing.
+ */
+static bool canon_stream_test_file(const char *filename, GtLogger *logger);
+
+/**
+ * @function Perform sanity checks on each mRNA of the given gene, removing the
+ * mRNAs that fail. Returns false if no valid mRNAs remain.
+ */
+static bool canon_stream_validate(AgnCanonStream *stream, GtFeatureNode *gene);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream* agn_canon_stream_new(GtNodeStream *in_stream, GtLogger *logger)
+{
+  GtNodeStream *ns;
+  AgnCanonStream *stream;
+  agn_assert(in_stream && logger);
+
+  ns = gt_node_stream_create(canon_stream_class(), false);
+  stream = canon_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->features = gt_array_new( sizeof(CanonFeature) );
+  stream->numfeatures = 0;
+  stream->numgenes = 0;
+  stream->mrnas = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  stream->inferred = gt_array_new( sizeof(GtFeatureNode *) );
+  stream->ranges = gt_array_new( sizeof(GtRange) );
+  stream->adjacent = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  stream->genes = gt_array_new( sizeof(GtFeatureNode *) );
+  stream->cache = gt_queue_new();
+  stream->parentstr = gt_str_new();
+  stream->cdscounter = 0;
+  stream->defercds = false;
+  stream->logger = logger;
+  stream->source = NULL;
+  return ns;
+}
+
+void agn_canon_stream_set_source(AgnCanonStream *stream, GtStr *source)
+{
+  agn_assert(stream && source);
+  if(stream->source != NULL)
+    gt_str_delete(stream->source);
+  stream->source = gt_str_ref(source);
+}
+
+void agn_canon_stream_defer_cds_ids(AgnCanonStream *stream)
+{
+  agn_assert(stream);
+  stream->defercds = true;
+}
+
+bool agn_canon_stream_unit_test(AgnUnitTest *test)
+{
+  FILE *log = fopen("/dev/null", "w");
+  if(log == NULL)
+  {
+    fprintf(stderr, "[AgnCanonStream::agn_canon_stream_unit_test] error "
+            "opening /dev/null");
+  }
+  GtLogger *logger = gt_logger_new(true, "", log);
+
+  bool test1 = canon_stream_test_file("data/gff3/gene-stream-data.gff3",
+                                      logger);
+  agn_unit_test_result(test, "gene stream data", test1);
+
+  bool test2 = canon_stream_test_file("data/gff3/grape-codons.gff3", logger);
+  agn_unit_test_result(test, "CDS from codons", test2);
+
+  bool test3 = canon_stream_test_file("data/gff3/grape-utrs.gff3", logger);
+  agn_unit_test_result(test, "exons from CDS and UTRs", test3);
+
+  bool test4 = canon_stream_test_file("data/gff3/FBgn0035002-sansexons.gff3",
+                                      logger);
+  agn_unit_test_result(test, "exons shared by isoforms", test4);
+
+  bool test5 = canon_stream_test_file("data/gff3/amel-gene-multitrans.gff3",
+                                      logger);
+  agn_unit_test_result(test, "multiple transcript types", test5);
+
+  gt_logger_delete(logger);
+  if(log != NULL)
+    fclose(log);
+  return agn_unit_test_success(test);
+}
+
+static GtUword canon_stream_add_feature(AgnCanonStream *stream,
+                                        GtFeatureNode *fn, long parent)
+{
+  CanonFeature *feat;
+  if(stream->numfeatures == gt_array_size(stream->features))
+  {
+    CanonFeature newfeat;
+    newfeat.cds     = gt_array_new( sizeof(GtFeatureNode *) );
+    newfeat.utrs    = gt_array_new( sizeof(GtFeatureNode *) );
+    newfeat.exons   = gt_array_new( sizeof(GtFeatureNode *) );
+    newfeat.introns = gt_array_new( sizeof(GtFeatureNode *) );
+    newfeat.starts  = gt_array_new( sizeof(GtFeatureNode *) );
+    newfeat.stops   = gt_array_new( sizeof(GtFeatureNode *) );
+    gt_array_add(stream->features, newfeat);
+  }
+
+  GtUword index = stream->numfeatures++;
+  feat = gt_array_get(stream->features, index);
+  feat->node = fn;
+  feat->parent = parent;
+  feat->end = index + 1;
+  feat->ismrna = agn_typecheck_mrna(fn);
+  gt_array_reset(feat->cds);
+  gt_array_reset(feat->utrs);
+  gt_array_reset(feat->exons);
+  gt_array_reset(feat->introns);
+  gt_array_reset(feat->starts);
+  gt_array_reset(feat->stops);
+
+  if(feat->ismrna)
+    gt_hashmap_add(stream->mrnas, fn, (void *)(index + 1));
+  else if(agn_typecheck_gene(fn))
+    stream->numgenes++;
+  return index;
+}
+
+static void canon_stream_add_part(AgnCanonStream *stream, long index,
+                                  GtFeatureNode *part)
+{
+  bool exon   = agn_typecheck_exon(part);
+  bool intron = !exon && agn_typecheck_intron(part);
+  bool cds    = !exon && !intron && agn_typecheck_cds(part);
+  bool utr    = !exon && !intron && !cds && agn_typecheck_utr(part);
+  bool start  = agn_typecheck_start_codon(part);
+  bool stop   = agn_typecheck_stop_codon(part);
+  if(!exon && !intron && !cds && !utr && !start && !stop)
+    return;
+
+  while(index >= 0)
+  {
+    CanonFeature *feat = gt_array_get(stream->features, index);
+    if(exon)
+      gt_array_add(feat->exons, part);
+    else if(intron)
+      gt_array_add(feat->introns, part);
+    else if(feat->ismrna)
+    {
+      if(cds)
+        gt_array_add(feat->cds, part);
+      else if(utr)
+        gt_array_add(feat->utrs, part);
+      else if(start)
+        gt_array_add(feat->starts, part);
+      else
+        gt_array_add(feat->stops, part);
+    }
+    index = feat->parent;
+  }
+}
+
+static void canon_stream_check_cds_multi(AgnCanonStream *stream,
+                                         CanonFeature *mrna)
+{
+  if(gt_array_size(mrna->cds) <= 1)
+    return;
+
+  GtFeatureNode **firstsegment = gt_array_get(mrna->cds, 0);
+  const char *id = gt_feature_node_get_attribute(*firstsegment, "ID");
+  if(id == NULL && !stream->defercds)
+  {
+    char newid[64];
+    sprintf(newid, "CDS%lu", stream->cdscounter++);
+    gt_feature_node_add_attribute(*firstsegment, "ID", newid);
+  }
+  gt_feature_node_make_multi_representative(*firstsegment);
+  GtUword i;
+  for(i = 0; i < gt_array_size(mrna->cds); i++)
+  {
+    GtFeatureNode **segment = gt_array_get(mrna->cds, i);
+    if(!gt_feature_node_is_multi(*segment))
+      gt_feature_node_set_multi_representative(*segment, *firstsegment);
+  }
+}
+
+static void canon_stream_check_cds_phase(CanonFeature *mrna)
+{
+  GtUword num_cds_feats = gt_array_size(mrna->cds);
+  if(num_cds_feats == 0)
+    return;
+
+  GtFeatureNode *cdsf1 = *(GtFeatureNode **)gt_array_get(mrna->cds, 0);
+  GtStrand strand = gt_feature_node_get_strand(cdsf1);
+  if(strand == GT_STRAND_REVERSE)
+    cdsf1 = *(GtFeatureNode **)gt_array_get(mrna->cds, num_cds_feats - 1);
+  gt_feature_node_set_phase(cdsf1, GT_PHASE_ZERO);
+  if(num_cds_feats == 1)
+    return;
+
+  GtUword cds_length = gt_genome_node_get_length((GtGenomeNode *)cdsf1);
+  GtUword i;
+  for(i = 1; i < num_cds_feats; i++)
+  {
+    GtUword cdsindex = strand == GT_STRAND_REVERSE ? num_cds_feats - 1 - i : i;
+    GtFeatureNode *cds = *(GtFeatureNode **)gt_array_get(mrna->cds, cdsindex);
+    int phasenum = cds_length % 3;
+    GtPhase phase = GT_PHASE_ZERO;
+    if(phasenum == 1)
+      phase = GT_PHASE_TWO;
+    else if(phasenum == 2)
+      phase = GT_PHASE_ONE;
+    gt_feature_node_set_phase(cds, phase);
+    cds_length += gt_genome_node_get_length((GtGenomeNode *)cds);
+  }
+}
+
+static void canon_stream_check_codon(AgnCanonStream *stream, GtUword index,
+                                     bool start)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  GtArray *codons = start ? mrna->starts : mrna->stops;
+  const char *label = start ? "start" : "stop";
+  GtUword numcds = gt_array_size(mrna->cds);
+  if(numcds == 0)
+    return;
+
+  const char *mrnaid = gt_feature_node_get_attribute(mrna->node, "ID");
+  unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)mrna->node);
+  GtStrand strand = gt_feature_node_get_strand(mrna->node);
+
+  // The start codon is at the left end of the CDS on the forward strand, and
+  // the stop codon on the reverse strand.
+  bool left = (start == (strand != GT_STRAND_REVERSE));
+  GtGenomeNode **segment = gt_array_get(mrna->cds, left ? 0 : numcds - 1);
+  GtRange codonrange = gt_genome_node_get_range(*segment);
+  if(left)
+    codonrange.end = codonrange.start + 2;
+  else
+    codonrange.start = codonrange.end - 2;
+
+  if(gt_array_size(codons) > 1)
+  {
+    gt_logger_log(stream->logger, "mRNA '%s' (line %u) has %lu %s codons",
+                  mrnaid, ln, gt_array_size(codons), label);
+  }
+  else if(gt_array_size(codons) == 1)
+  {
+    GtGenomeNode **codon = gt_array_get(codons, 0);
+    GtRange testrange = gt_genome_node_get_range(*codon);
+    if(gt_range_compare(&codonrange, &testrange) != 0)
+    {
+      gt_logger_log(stream->logger, "%s codon inferred from CDS [%lu, %lu] "
+                    "does not match explicitly provided %s codon [%lu, %lu] "
+                    "for mRNA '%s'", label, codonrange.start, codonrange.end,
+                    label, testrange.start, testrange.end, mrnaid);
+    }
+  }
+  else
+  {
+    canon_stream_create_feature(stream, index, (GtGenomeNode *)mrna->node,
+                                start ? "start_codon" : "stop_codon",
+                                &codonrange, false);
+  }
+}
+
+static const GtNodeStreamClass *canon_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnCanonStream),
+                                   canon_stream_free,
+                                   canon_stream_next);
+  }
+  return nsc;
+}
+
+static void canon_stream_collect(AgnCanonStream *stream, GtFeatureNode *fn,
+                                 long parent)
+{
+  long index = parent;
+  if(agn_typecheck_gene(fn) || agn_typecheck_transcript(fn))
+    index = canon_stream_add_feature(stream, fn, parent);
+  else
+    canon_stream_add_part(stream, parent, fn);
+
+  if(gt_feature_node_has_children(fn))
+  {
+    GtFeatureNode *child;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      canon_stream_collect(stream, child, index);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+
+  if(index != parent)
+  {
+    CanonFeature *feat = gt_array_get(stream->features, index);
+    feat->end = stream->numfeatures;
+  }
+}
+
+static bool canon_stream_collapse_feature(AgnCanonStream *stream,
+                                          GtUword index, GtRange *range)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  GtUword i = gt_array_size(stream->inferred);
+  while(i > 0)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(stream->inferred, --i);
+    GtRange fnrange = gt_genome_node_get_range((GtGenomeNode *)fn);
+    if(gt_range_compare(range, &fnrange) != 0)
+      continue;
+
+    gt_feature_node_add_child(mrna->node, fn);
+    gt_genome_node_ref((GtGenomeNode *)fn);
+    const char *parentattr = gt_feature_node_get_attribute(fn, "Parent");
+    const char *tid = gt_feature_node_get_attribute(mrna->node, "ID");
+    if(tid != NULL)
+    {
+      gt_str_reset(stream->parentstr);
+      if(parentattr != NULL)
+      {
+        gt_str_append_cstr(stream->parentstr, parentattr);
+        gt_str_append_char(stream->parentstr, ',');
+      }
+      gt_str_append_cstr(stream->parentstr, tid);
+      gt_feature_node_set_attribute(fn, "Parent",
+                                    gt_str_get(stream->parentstr));
+    }
+    canon_stream_add_part(stream, index, fn);
+    return true;
+  }
+  return false;
+}
+
+static GtFeatureNode *canon_stream_create_feature(AgnCanonStream *stream,
+                                                  GtUword index,
+                                                  GtGenomeNode *template,
+                                                  const char *type,
+                                                  GtRange *range,
+                                                  bool setparent)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  GtStrand strand = gt_feature_node_get_strand((GtFeatureNode *)template);
+  GtGenomeNode *gn = gt_feature_node_new(gt_genome_node_get_seqid(template),
+                                         type, range->start, range->end,
+                                         strand);
+  GtFeatureNode *fn = (GtFeatureNode *)gn;
+  if(stream->source)
+    gt_feature_node_set_source(fn, stream->source);
+  gt_feature_node_add_child(mrna->node, fn);
+  if(setparent)
+  {
+    const char *mrnaid = gt_feature_node_get_attribute(mrna->node, "ID");
+    if(mrnaid)
+      gt_feature_node_add_attribute(fn, "Parent", mrnaid);
+  }
+  canon_stream_add_part(stream, index, fn);
+  return fn;
+}
+
+static void canon_stream_extract_genes(AgnCanonStream *stream,
+                                       GtFeatureNode *fn)
+{
+  gt_array_reset(stream->genes);
+  if(stream->numgenes == 1 && agn_typecheck_gene(fn) &&
+     !gt_feature_node_is_multi(fn))
+  {
+    gt_array_add(stream->genes, fn);
+    return;
+  }
+
+  GtFeatureNode *current;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtHashmap *multi_parents = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    if(!gt_feature_node_has_type(current, "gene"))
+      continue;
+
+    gt_genome_node_ref((GtGenomeNode *)current);
+    if(gt_feature_node_is_multi(current) &&
+       gt_feature_node_is_pseudo(current) == false)
+    {
+      GtFeatureNode *rep = gt_feature_node_get_multi_representative(current);
+      GtFeatureNode *parent = gt_hashmap_get(multi_parents, rep);
+      GtRange currentrange = gt_genome_node_get_range((GtGenomeNode*)current);
+      if(parent == NULL)
+      {
+        GtGenomeNode *parentgn = gt_feature_node_new_pseudo_template(rep);
+        const char *id = gt_feature_node_get_attribute(rep, "ID");
+        const char *parentid = gt_feature_node_get_attribute(rep, "Parent");
+        parent = gt_feature_node_cast(parentgn);
+        if(id)
+          gt_feature_node_set_attribute(parent, "ID", id);
+        if(parentid)
+          gt_feature_node_set_attribute(parent, "Parent", parentid);
+        gt_hashmap_add(multi_parents, rep, parent);
+        gt_array_add(stream->genes, parent);
+      }
+      GtRange parentrange = gt_genome_node_get_range((GtGenomeNode*)parent);
+      GtRange newrange = gt_range_join(&parentrange, &currentrange);
+      gt_genome_node_set_range((GtGenomeNode *)parent, &newrange);
+      gt_feature_node_add_child(parent, current);
+    }
+    else
+      gt_array_add(stream->genes, current);
+  }
+  gt_feature_node_iterator_delete(iter);
+  gt_genome_node_delete((GtGenomeNode *)fn);
+  gt_hashmap_delete(multi_parents);
+}
+
+static void canon_stream_free(GtNodeStream *ns)
+{
+  AgnCanonStream *stream = canon_stream_cast(ns);
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->features); i++)
+  {
+    CanonFeature *feat = gt_array_get(stream->features, i);
+    gt_array_delete(feat->cds);
+    gt_array_delete(feat->utrs);
+    gt_array_delete(feat->exons);
+    gt_array_delete(feat->introns);
+    gt_array_delete(feat->starts);
+    gt_array_delete(feat->stops);
+  }
+  gt_array_delete(stream->features);
+  while(gt_queue_size(stream->cache) > 0)
+  {
+    GtGenomeNode *gn = gt_queue_get(stream->cache);
+    gt_genome_node_delete(gn);
+  }
+  gt_queue_delete(stream->cache);
+  gt_node_stream_delete(stream->in_stream);
+  gt_hashmap_delete(stream->mrnas);
+  gt_array_delete(stream->inferred);
+  gt_array_delete(stream->ranges);
+  gt_hashmap_delete(stream->adjacent);
+  gt_array_delete(stream->genes);
+  gt_str_delete(stream->parentstr);
+  if(stream->source != NULL)
+    gt_str_delete(stream->source);
+}
+
+static void canon_stream_infer_cds(AgnCanonStream *stream, GtUword index)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  if(gt_array_size(mrna->cds) > 0 || gt_array_size(mrna->exons) == 0 ||
+     gt_array_size(mrna->starts) != 1 || gt_array_size(mrna->stops) != 1)
+  {
+    return;
+  }
+
+  GtGenomeNode *start_codon = *(GtGenomeNode **)gt_array_get(mrna->starts, 0);
+  GtGenomeNode *stop_codon  = *(GtGenomeNode **)gt_array_get(mrna->stops, 0);
+  GtRange leftrange  = gt_genome_node_get_range(start_codon);
+  GtRange rightrange = gt_genome_node_get_range(stop_codon);
+  if(gt_feature_node_get_strand(mrna->node) == GT_STRAND_REVERSE)
+  {
+    leftrange  = gt_genome_node_get_range(stop_codon);
+    rightrange = gt_genome_node_get_range(start_codon);
+  }
+
+  GtUword i;
+  GtUword numexons = gt_array_size(mrna->exons);
+  for(i = 0; i < numexons; i++)
+  {
+    GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(mrna->exons, i);
+    GtRange exonrange = gt_genome_node_get_range(exon);
+    GtRange cdsrange = exonrange;
+
+    // UTR
+    if(exonrange.end < leftrange.start || exonrange.start > rightrange.end)
+      continue;
+
+    if(gt_range_overlap(&exonrange, &leftrange))
+      cdsrange.start = leftrange.start;
+    if(gt_range_overlap(&exonrange, &rightrange))
+      cdsrange.end = rightrange.end;
+    canon_stream_create_feature(stream, index, exon, "CDS", &cdsrange, false);
+  }
+}
+
+static int canon_stream_infer_exons(AgnCanonStream *stream, GtUword index,
+                                    GtError *error)
+{
+  CanonFeature *feat = gt_array_get(stream->features, index);
+  GtUword i, numexons = gt_array_size(feat->exons);
+
+  gt_array_reset(stream->inferred);
+  if(numexons == 0)
+  {
+    for(i = index; i < feat->end; i++)
+    {
+      CanonFeature *mrna = gt_array_get(stream->features, i);
+      if(mrna->ismrna)
+      {
+        canon_stream_infer_exons_mrna(stream, i,
+                                      gt_array_size(stream->inferred));
+      }
+    }
+    numexons = gt_array_size(stream->inferred);
+  }
+
+  for(i = feat->end; i > index; i--)
+  {
+    CanonFeature *mrna = gt_array_get(stream->features, i - 1);
+    if(mrna->ismrna && agn_feature_overlap_check(mrna->exons))
+    {
+      const char *rnaid = gt_feature_node_get_attribute(mrna->node, "ID");
+      gt_error_set(error, "mRNA '%s' contains overlapping exons", rnaid);
+      return -1;
+    }
+  }
+
+  if(gt_array_size(feat->introns) == 0 && numexons > 1)
+    canon_stream_infer_introns(stream, index);
+
+  return 0;
+}
+
+static void canon_stream_infer_exons_mrna(AgnCanonStream *stream,
+                                          GtUword index, GtUword numexons)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  const char *mrnaid = gt_feature_node_get_attribute(mrna->node, "ID");
+  unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)mrna->node);
+  if(gt_array_size(mrna->cds) == 0)
+  {
+    gt_logger_log(stream->logger, "cannot infer missing exons for mRNA '%s' "
+                  "(line %u) without CDS feature(s)", mrnaid, ln);
+    return;
+  }
+
+  GtUword i, j;
+  gt_array_sort(mrna->cds, (GtCompare)agn_genome_node_compare);
+  gt_array_sort(mrna->utrs, (GtCompare)agn_genome_node_compare);
+  gt_hashmap_reset(stream->adjacent);
+  gt_array_reset(stream->ranges);
+  for(i = 0; i < gt_array_size(mrna->cds); i++)
+  {
+    GtGenomeNode *cdssegment = *(GtGenomeNode **)gt_array_get(mrna->cds, i);
+    GtRange crange = gt_genome_node_get_range(cdssegment);
+    GtRange erange = crange;
+    for(j = 0; j < gt_array_size(mrna->utrs); j++)
+    {
+      GtGenomeNode *utrsegment = *(GtGenomeNode **)gt_array_get(mrna->utrs, j);
+      GtRange urange = gt_genome_node_get_range(utrsegment);
+
+      // If the UTR segment is adjacent to the CDS, merge the ranges
+      if(urange.end+1 == crange.start || crange.end+1 == urange.start)
+      {
+        erange = gt_range_join(&erange, &urange);
+        gt_hashmap_add(stream->adjacent, utrsegment, utrsegment);
+      }
+    }
+    gt_array_add(stream->ranges, erange);
+  }
+
+  // Now create UTR-only exons
+  for(i = 0; i < gt_array_size(mrna->utrs); i++)
+  {
+    GtGenomeNode *utrsegment = *(GtGenomeNode **)gt_array_get(mrna->utrs, i);
+    if(gt_hashmap_get(stream->adjacent, utrsegment) == NULL)
+    {
+      GtRange urange = gt_genome_node_get_range(utrsegment);
+      gt_array_add(stream->ranges, urange);
+    }
+  }
+
+  GtGenomeNode *firstcds = *(GtGenomeNode **)gt_array_get(mrna->cds, 0);
+  for(i = 0; i < gt_array_size(stream->ranges); i++)
+  {
+    GtRange *erange = gt_array_get(stream->ranges, i);
+    if(canon_stream_collapse_feature(stream, index, erange))
+      continue;
+
+    GtFeatureNode *exon = canon_stream_create_feature(stream, index, firstcds,
+                                                      "exon", erange, true);
+    gt_array_add(stream->inferred, exon);
+    numexons++;
+  }
+
+  if(numexons == 0)
+  {
+    gt_logger_log(stream->logger, "unable to infer exons for mRNA '%s' (line "
+                  "%u)", mrnaid, ln);
+  }
+}
+
+static void canon_stream_infer_introns(AgnCanonStream *stream, GtUword index)
+{
+  CanonFeature *feat = gt_array_get(stream->features, index);
+  GtUword i, j;
+
+  gt_array_reset(stream->inferred);
+  for(i = index; i < feat->end; i++)
+  {
+    CanonFeature *mrna = gt_array_get(stream->features, i);
+    if(!mrna->ismrna || gt_array_size(mrna->exons) < 2)
+      continue;
+
+    const char *mrnaid = gt_feature_node_get_attribute(mrna->node, "ID");
+    unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode*)mrna->node);
+    gt_array_sort(mrna->exons, (GtCompare)agn_genome_node_compare);
+    gt_array_reset(stream->ranges);
+    for(j = 1; j < gt_array_size(mrna->exons); j++)
+    {
+      GtGenomeNode *exon1 = *(GtGenomeNode **)gt_array_get(mrna->exons, j-1);
+      GtGenomeNode *exon2 = *(GtGenomeNode **)gt_array_get(mrna->exons, j);
+      GtRange first_range  = gt_genome_node_get_range(exon1);
+      GtRange second_range = gt_genome_node_get_range(exon2);
+      if(first_range.end == second_range.start - 1)
+      {
+        gt_logger_log(stream->logger, "mRNA '%s' (line %u) has directly "
+                      "adjacent exons", mrnaid, ln);
+        return;
+      }
+      GtRange irange = { first_range.end + 1, second_range.start - 1 };
+      gt_array_add(stream->ranges, irange);
+    }
+
+    GtGenomeNode *firstexon = *(GtGenomeNode **)gt_array_get(mrna->exons, 0);
+    for(j = 0; j < gt_array_size(stream->ranges); j++)
+    {
+      GtRange *irange = gt_array_get(stream->ranges, j);
+      if(canon_stream_collapse_feature(stream, i, irange))
+        continue;
+
+      GtFeatureNode *intron = canon_stream_create_feature(stream, i, firstexon,
+                                                          "intron", irange,
+                                                          true);
+      gt_array_add(stream->inferred, intron);
+    }
+  }
+}
+
+static void canon_stream_infer_utrs(AgnCanonStream *stream, GtUword index)
+{
+  CanonFeature *mrna = gt_array_get(stream->features, index);
+  bool caninferutrs = gt_array_size(mrna->exons) > 0 &&
+                      gt_array_size(mrna->starts) == 1 &&
+                      gt_array_size(mrna->stops) == 1;
+  if(gt_array_size(mrna->utrs) > 0)
+    return;
+  else if(gt_array_size(mrna->cds) == 0 && !caninferutrs)
+    return;
+
+  GtGenomeNode *leftcodon  = *(GtGenomeNode **)gt_array_get(mrna->starts, 0);
+  GtGenomeNode *rightcodon = *(GtGenomeNode **)gt_array_get(mrna->stops, 0);
+  GtStrand strand = gt_feature_node_get_strand(mrna->node);
+  const char *lefttype  = "five_prime_UTR";
+  const char *righttype = "three_prime_UTR";
+  if(strand == GT_STRAND_REVERSE)
+  {
+    GtGenomeNode *temp = leftcodon;
+    lefttype   = "three_prime_UTR";
+    righttype  = "five_prime_UTR";
+    leftcodon  = rightcodon;
+    rightcodon = temp;
+  }
+  GtRange leftrange  = gt_genome_node_get_range(leftcodon);
+  GtRange rightrange = gt_genome_node_get_range(rightcodon);
+
+  GtUword i;
+  GtUword numexons = gt_array_size(mrna->exons);
+  for(i = 0; i < numexons; i++)
+  {
+    GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(mrna->exons, i);
+    GtRange exonrange = gt_genome_node_get_range(exon);
+    if(exonrange.start < leftrange.start)
+    {
+      GtRange utrrange = exonrange;
+      if(gt_range_overlap(&exonrange, &leftrange))
+        utrrange.end = leftrange.start - 1;
+      canon_stream_create_feature(stream, index, (GtGenomeNode *)mrna->node,
+                                  lefttype, &utrrange, false);
+    }
+    if(exonrange.end > rightrange.end)
+    {
+      GtRange utrrange = exonrange;
+      if(gt_range_overlap(&exonrange, &rightrange))
+        utrrange.start = rightrange.end + 1;
+      canon_stream_create_feature(stream, index, (GtGenomeNode *)mrna->node,
+                                  righttype, &utrrange, false);
+    }
+  }
+}
+
+static int canon_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                             GtError *error)
+{
+  AgnCanonStream *stream;
+  GtFeatureNode *fn;
+  int had_err;
+  gt_error_check(error);
+  stream = canon_stream_cast(ns);
+
+  while(gt_queue_size(stream->cache) == 0)
+  {
+    had_err = gt_node_stream_next(stream->in_stream, gn, error);
+    if(had_err || !*gn)
+      return had_err;
+
+    fn = gt_feature_node_try_cast(*gn);
+    if(!fn)
+      return 0;
+
+    had_err = canon_stream_process(stream, fn, error);
+    if(had_err)
+    {
+      gt_genome_node_delete(*gn);
+      *gn = NULL;
+      return had_err;
+    }
+  }
+
+  *gn = gt_queue_get(stream->cache);
+  return 0;
+}
+
+static int canon_stream_process(AgnCanonStream *stream, GtFeatureNode *fn,
+                                GtError *error)
+{
+  GtUword i;
+  stream->numfeatures = 0;
+  stream->numgenes = 0;
+  gt_hashmap_reset(stream->mrnas);
+  canon_stream_collect(stream, fn, -1);
+
+  // CDS, codons, and UTRs for each mRNA, then exons and introns for each gene
+  // and transcript; a feature's subfeatures are sorted before they are used.
+  for(i = 0; i < stream->numfeatures; i++)
+  {
+    CanonFeature *mrna = gt_array_get(stream->features, i);
+    if(!mrna->ismrna)
+      continue;
+
+    gt_array_sort(mrna->cds, (GtCompare)agn_genome_node_compare);
+    gt_array_sort(mrna->utrs, (GtCompare)agn_genome_node_compare);
+    gt_array_sort(mrna->exons, (GtCompare)agn_genome_node_compare);
+    gt_array_sort(mrna->starts, (GtCompare)agn_genome_node_compare);
+    gt_array_sort(mrna->stops, (GtCompare)agn_genome_node_compare);
+    canon_stream_infer_cds(stream, i);
+    canon_stream_check_codon(stream, i, true);
+    canon_stream_check_codon(stream, i, false);
+    canon_stream_infer_utrs(stream, i);
+    canon_stream_check_cds_multi(stream, mrna);
+    canon_stream_check_cds_phase(mrna);
+    canon_stream_set_utrs(mrna);
+  }
+  for(i = 0; i < stream->numfeatures; i++)
+  {
+    if(canon_stream_infer_exons(stream, i, error))
+      return -1;
+  }
+
+  canon_stream_extract_genes(stream, fn);
+  for(i = 0; i < gt_array_size(stream->genes); i++)
+  {
+    GtFeatureNode *gene = *(GtFeatureNode **)gt_array_get(stream->genes, i);
+    if(canon_stream_validate(stream, gene))
+      gt_queue_add(stream->cache, gene);
+    else
+      gt_genome_node_delete((GtGenomeNode *)gene);
+  }
+  return 0;
+}
+
+static void canon_stream_set_utrs(CanonFeature *mrna)
+{
+  GtGenomeNode **start;
+  GtUword i, cds_start;
+
+  if(gt_array_size(mrna->starts) != 1)
+    return;
+  start = gt_array_get(mrna->starts, 0);
+  cds_start = gt_genome_node_get_start(*start);
+
+  for(i = 0; i < gt_array_size(mrna->utrs); i++)
+  {
+    GtFeatureNode *utr = *(GtFeatureNode **)gt_array_get(mrna->utrs, i);
+    GtStrand strand = gt_feature_node_get_strand(utr);
+    GtUword utr_start = gt_genome_node_get_start((GtGenomeNode *)utr);
+
+    if(!gt_feature_node_has_type(utr, "five_prime_UTR") &&
+       !gt_feature_node_has_type(utr, "three_prime_UTR"))
+    {
+      bool upstream = utr_start < cds_start;
+      if(strand != GT_STRAND_FORWARD)
+        upstream = !upstream;
+      gt_feature_node_set_type(utr, upstream ? "five_prime_UTR"
+                                             : "three_prime_UTR");
+    }
+  }
+}
+
+static bool canon_stream_test_compare(GtFeatureNode *fn1, GtFeatureNode *fn2)
+{
+  const char *attrs[] = { "ID", "Parent", NULL };
+  bool identical = true;
+  GtFeatureNode *feat1, *feat2;
+  GtFeatureNodeIterator *iter1 = gt_feature_node_iterator_new(fn1);
+  GtFeatureNodeIterator *iter2 = gt_feature_node_iterator_new(fn2);
+  for(feat1 = gt_feature_node_iterator_next(iter1),
+      feat2 = gt_feature_node_iterator_next(iter2);
+      identical && feat1 != NULL && feat2 != NULL;
+      feat1 = gt_feature_node_iterator_next(iter1),
+      feat2 = gt_feature_node_iterator_next(iter2))
+  {
+    GtRange range1 = gt_genome_node_get_range((GtGenomeNode *)feat1);
+    GtRange range2 = gt_genome_node_get_range((GtGenomeNode *)feat2);
+    identical = gt_range_compare(&range1, &range2) == 0 &&
+                strcmp(gt_feature_node_get_type(feat1),
+                       gt_feature_node_get_type(feat2)) == 0 &&
+                gt_feature_node_get_strand(feat1) ==
+                gt_feature_node_get_strand(feat2) &&
+                gt_feature_node_get_phase(feat1) ==
+                gt_feature_node_get_phase(feat2);
+
+    int i;
+    for(i = 0; identical && attrs[i] != NULL; i++)
+    {
+      const char *value1 = gt_feature_node_get_attribute(feat1, attrs[i]);
+      const char *value2 = gt_feature_node_get_attribute(feat2, attrs[i]);
+      if(value1 == NULL || value2 == NULL)
+        identical = value1 == value2;
+      else
+        identical = strcmp(value1, value2) == 0;
+    }
+  }
+  identical = identical && feat1 == NULL && feat2 == NULL;
+  gt_feature_node_iterator_delete(iter1);
+  gt_feature_node_iterator_delete(iter2);
+  return identical;
+}
+
+static bool canon_stream_test_file(const char *filename, GtLogger *logger)
+{
+  GtError *error = gt_error_new();
+  GtArray *feats[2];
+  int i;
+  for(i = 0; i < 2; i++)
+  {
+    GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &filename);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+    GtNodeStream *stream = i == 0 ? agn_gene_stream_new(gff3in, logger)
+                                  : agn_canon_stream_new(gff3in, logger);
+    feats[i] = gt_array_new( sizeof(GtFeatureNode *) );
+    GtNodeStream *arraystream = gt_array_out_stream_new(stream, feats[i],
+                                                        error);
+    int pullresult = gt_node_stream_pull(arraystream, error);
+    if(pullresult == -1)
+    {
+      fprintf(stderr, "[AgnCanonStream::canon_stream_test_file] error "
+              "processing features: %s\n", gt_error_get(error));
+    }
+    gt_node_stream_delete(gff3in);
+    gt_node_stream_delete(stream);
+    gt_node_stream_delete(arraystream);
+    gt_array_sort(feats[i], (GtCompare)agn_genome_node_compare);
+  }
+
+  bool identical = gt_array_size(feats[0]) == gt_array_size(feats[1]) &&
+                   gt_array_size(feats[0]) > 0;
+  GtUword j;
+  for(j = 0; identical && j < gt_array_size(feats[0]); j++)
+  {
+    GtFeatureNode *fn1 = *(GtFeatureNode **)gt_array_get(feats[0], j);
+    GtFeatureNode *fn2 = *(GtFeatureNode **)gt_array_get(feats[1], j);
+    identical = canon_stream_test_compare(fn1, fn2);
+  }
+
+  for(i = 0; i < 2; i++)
+  {
+    while(gt_array_size(feats[i]) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(feats[i]);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(feats[i]);
+  }
+  gt_error_delete(error);
+  return identical;
+}
+
+static bool canon_stream_validate(AgnCanonStream *stream, GtFeatureNode *gene)
+{
+  GtUword num_valid_mrnas = 0;
+  GtRange generange = gt_genome_node_get_range((GtGenomeNode *)gene);
+  GtFeatureNode *current;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(gene);
+  GtQueue *invalid_transcripts = gt_queue_new();
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    GtUword index = (GtUword)gt_hashmap_get(stream->mrnas, current);
+    if(index == 0)
+    {
+      gt_queue_add(invalid_transcripts, current);
+      continue;
+    }
+
+    CanonFeature *mrna = gt_array_get(stream->features, index - 1);
+    GtUword numexons = gt_array_size(mrna->exons);
+    GtUword numintrons = gt_array_size(mrna->introns);
+    const char *mrnaid = agn_feature_node_get_label(current);
+    bool keepmrna = true;
+    if(gt_array_size(mrna->cds) < 1)
+    {
+      gt_logger_log(stream->logger, "ignoring mRNA '%s': no CDS", mrnaid);
+      keepmrna = false;
+    }
+    if(numexons != numintrons + 1)
+    {
+      gt_logger_log(stream->logger, "error: mRNA '%s' has %lu exons but %lu "
+                    "introns", mrnaid, numexons, numintrons);
+      keepmrna = false;
+    }
+
+    GtRange mrnarange = gt_genome_node_get_range((GtGenomeNode *)current);
+    if(!gt_range_contains(&generange, &mrnarange))
+    {
+      gt_logger_log(stream->logger, "mRNA '%s' extends beyond the range of "
+                    "its parent; ignoring", mrnaid);
+      keepmrna = false;
+    }
+
+    if(keepmrna)
+      num_valid_mrnas++;
+    else
+      gt_queue_add(invalid_transcripts, current);
+  }
+  gt_feature_node_iterator_delete(iter);
+  while(gt_queue_size(invalid_transcripts) > 0)
+  {
+    GtFeatureNode *mrna = gt_queue_get(invalid_transcripts);
+    agn_feature_node_remove_tree(gene, mrna);
+  }
+  gt_queue_delete(invalid_transcripts);
+
+  if(num_valid_mrnas == 0)
+  {
+    const char *label = agn_feature_node_get_label(gene);
+    gt_logger_log(stream->logger, "warning: found no valid mRNAs for gene "
+                  "'%s'", label);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,202 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "AgnCdsIdVisitor.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define cds_id_visitor_cast(GV)\
+        gt_node_visitor_cast(cds_id_visitor_class(), GV)
+
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCdsIdVisitor
+{
+  const GtNodeVisitor parent_instance;
+  GtUword cdscounter;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the interface to the GtNodeVisitor class.
+ */
+static const GtNodeVisitorClass *cds_id_visitor_class();
+
+/**
+ * @function Create a gene for unit testing with one mRNA for each of the given
+ * CDS IDs (NULL for none); each mRNA has a CDS of two segments.
+ */
+static GtFeatureNode *cds_id_visitor_test_gene(GtStr *seqid, GtUword start,
+                                               const char **cdsids,
+                                               GtUword nummrnas);
+
+/**
+ * @function Check that the CDS features of the gene have the expected IDs,
+ * listed in the order of the gene's mRNAs.
+ */
+static bool cds_id_visitor_test_ids(GtFeatureNode *gene, const char **expected,
+                                    GtUword nummrnas);
+
+/**
+ * @function Assign an ID to each multi-segment CDS feature lacking one.
+ */
+static int
+cds_id_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
+                          GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream* agn_cds_id_stream_new(GtNodeStream *in)
+{
+  GtNodeVisitor *nv = agn_cds_id_visitor_new();
+  GtNodeStream *ns = gt_visitor_stream_new(in, nv);
+  return ns;
+}
+
+GtNodeVisitor *agn_cds_id_visitor_new()
+{
+  GtNodeVisitor *nv = gt_node_visitor_create(cds_id_visitor_class());
+  AgnCdsIdVisitor *v = cds_id_visitor_cast(nv);
+  v->cdscounter = 0;
+  return nv;
+}
+
+bool agn_cds_id_visitor_unit_test(AgnUnitTest *test)
+{
+  GtError *error = gt_error_new();
+  GtStr *seqid = gt_str_new_cstr("chr");
+  const char *ids1[] = { NULL, "cds-b", NULL };
+  const char *ids2[] = { NULL };
+  GtFeatureNode *gene1 = cds_id_visitor_test_gene(seqid, 1000, ids1, 3);
+  GtFeatureNode *gene2 = cds_id_visitor_test_gene(seqid, 5000, ids2, 1);
+
+  GtNodeVisitor *nv = agn_cds_id_visitor_new();
+  bool success = gt_genome_node_accept((GtGenomeNode *)gene1, nv, error) == 0;
+  const char *expected1[] = { "CDS0", "cds-b", "CDS1" };
+  bool test1 = success && cds_id_visitor_test_ids(gene1, expected1, 3);
+  agn_unit_test_result(test, "one gene", test1);
+
+  success = gt_genome_node_accept((GtGenomeNode *)gene2, nv, error) == 0;
+  const char *expected2[] = { "CDS2" };
+  bool test2 = success && cds_id_visitor_test_ids(gene2, expected2, 1);
+  agn_unit_test_result(test, "numbering continues", test2);
+
+  gt_node_visitor_delete(nv);
+  gt_genome_node_delete((GtGenomeNode *)gene1);
+  gt_genome_node_delete((GtGenomeNode *)gene2);
+  gt_str_delete(seqid);
+  gt_error_delete(error);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeVisitorClass *cds_id_visitor_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCdsIdVisitor), NULL, NULL,
+                                    cds_id_visit_feature_node, NULL, NULL,
+                                    NULL);
+  }
+  return nvc;
+}
+
+static GtFeatureNode *cds_id_visitor_test_gene(GtStr *seqid, GtUword start,
+                                               const char **cdsids,
+                                               GtUword nummrnas)
+{
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", start, start + 999,
+                                           GT_STRAND_FORWARD);
+  GtUword i;
+  for(i = 0; i < nummrnas; i++)
+  {
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", start, start + 999,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+    GtFeatureNode *first = NULL;
+    GtUword j;
+    for(j = 0; j < 2; j++)
+    {
+      GtGenomeNode *cds = gt_feature_node_new(seqid, "CDS", start + 500*j + 100,
+                                              start + 500*j + 299,
+                                              GT_STRAND_FORWARD);
+      GtFeatureNode *cdsfn = (GtFeatureNode *)cds;
+      gt_feature_node_add_child((GtFeatureNode *)mrna, cdsfn);
+      if(first == NULL)
+      {
+        first = cdsfn;
+        if(cdsids[i] != NULL)
+          gt_feature_node_add_attribute(first, "ID", cdsids[i]);
+        gt_feature_node_make_multi_representative(first);
+      }
+      else
+        gt_feature_node_set_multi_representative(cdsfn, first);
+    }
+  }
+  return (GtFeatureNode *)gene;
+}
+
+static bool cds_id_visitor_test_ids(GtFeatureNode *gene, const char **expected,
+                                    GtUword nummrnas)
+{
+  GtArray *mrnas = agn_typecheck_select(gene, agn_typecheck_mrna);
+  bool success = gt_array_size(mrnas) == nummrnas;
+  GtUword i;
+  for(i = 0; success && i < nummrnas; i++)
+  {
+    GtFeatureNode **mrna = gt_array_get(mrnas, i);
+    GtArray *cds = agn_typecheck_select(*mrna, agn_typecheck_cds);
+    GtFeatureNode **first = gt_array_get(cds, 0);
+    const char *id = gt_feature_node_get_attribute(*first, "ID");
+    success = id != NULL && strcmp(id, expected[i]) == 0;
+    gt_array_delete(cds);
+  }
+  gt_array_delete(mrnas);
+  return success;
+}
+
+static int
+cds_id_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
+                          GtError *error)
+{
+  gt_error_check(error);
+  AgnCdsIdVisitor *v = cds_id_visitor_cast(nv);
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    if(!agn_typecheck_cds(current) || !gt_feature_node_is_multi(current) ||
+       gt_feature_node_get_multi_representative(current) != current ||
+       gt_feature_node_get_attribute(current, "ID") != NULL)
+    {
+      continue;
+    }
+
+    char newid[64];
+    sprintf(newid, "CDS%lu", v->cdscounter++);
+    gt_feature_node_add_attribute(current, "ID", newid);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  return 0;
+}
@@ -0,0 +1,252 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "AgnCompareCacheStream.h"
+#include "AgnLocus.h"
+
+#define compare_cache_stream_cast(GS)\
+        gt_node_stream_cast(compare_cache_stream_class(), GS)
+
+#define COMPARE_CACHE_HEADER "##aegean-parseval-cache 1"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnCompareCacheStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtHashmap *cache;
+  GtStr *filename;
+  GtStr *tempfilename;
+  FILE *outstream;
+  GtStr *selection;
+  GtUword delta;
+  int maxtrans;
+  GtLogger *logger;
+  GtUword hits;
+  GtUword misses;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* compare_cache_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void compare_cache_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Load the entries of an existing cache file into the lookup table.
+ * A missing file is not an error: the cache simply starts out empty.
+ */
+static int compare_cache_stream_load(AgnCompareCacheStream *stream,
+                                     GtError *error);
+
+/**
+ * @function Pulls loci from the input stream, restores or performs their
+ * comparative analysis, and records the outcome in the new cache file.
+ */
+static int compare_cache_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_compare_cache_stream_new(GtNodeStream *in_stream,
+                                           const char *cachefile,
+                                           GtUword delta, int maxtrans,
+                                           GtLogger *logger, GtError *error)
+{
+  GtNodeStream *ns;
+  AgnCompareCacheStream *stream;
+  agn_assert(in_stream && cachefile);
+  ns = gt_node_stream_create(compare_cache_stream_class(), false);
+  stream = compare_cache_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->cache = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  stream->filename = gt_str_new_cstr(cachefile);
+  stream->tempfilename = gt_str_new_cstr(cachefile);
+  gt_str_append_cstr(stream->tempfilename, ".tmp");
+  stream->outstream = NULL;
+  stream->selection = gt_str_new();
+  stream->delta = delta;
+  stream->maxtrans = maxtrans;
+  stream->logger = logger;
+  stream->hits = 0;
+  stream->misses = 0;
+
+  if(compare_cache_stream_load(stream, error))
+  {
+    gt_node_stream_delete(ns);
+    return NULL;
+  }
+
+  stream->outstream = fopen(gt_str_get(stream->tempfilename), "w");
+  if(stream->outstream == NULL)
+  {
+    gt_error_set(error, "unable to open cache file '%s'",
+                 gt_str_get(stream->tempfilename));
+    gt_node_stream_delete(ns);
+    return NULL;
+  }
+  fprintf(stream->outstream, "%s\n", COMPARE_CACHE_HEADER);
+
+  return ns;
+}
+
+static const GtNodeStreamClass *compare_cache_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnCompareCacheStream),
+                                   compare_cache_stream_free,
+                                   compare_cache_stream_next);
+  }
+  return nsc;
+}
+
+static void compare_cache_stream_free(GtNodeStream *ns)
+{
+  AgnCompareCacheStream *stream = compare_cache_stream_cast(ns);
+  if(stream->outstream != NULL)
+  {
+    // The stream was not processed to completion; keep the old cache
+    fclose(stream->outstream);
+    remove(gt_str_get(stream->tempfilename));
+  }
+  gt_node_stream_delete(stream->in_stream);
+  gt_hashmap_delete(stream->cache);
+  gt_str_delete(stream->filename);
+  gt_str_delete(stream->tempfilename);
+  gt_str_delete(stream->selection);
+}
+
+static int compare_cache_stream_load(AgnCompareCacheStream *stream,
+                                     GtError *error)
+{
+  FILE *instream = fopen(gt_str_get(stream->filename), "r");
+  if(instream == NULL)
+    return 0;
+
+  int had_err = 0;
+  GtUword linenum = 0;
+  GtStr *line = gt_str_new();
+  while(!had_err && gt_str_read_next_line(line, instream) != EOF)
+  {
+    linenum++;
+    const char *linestr = gt_str_get(line);
+    if(linenum == 1)
+    {
+      if(strcmp(linestr, COMPARE_CACHE_HEADER) != 0)
+      {
+        gt_error_set(error, "'%s' is not a ParsEval cache file",
+                     gt_str_get(stream->filename));
+        had_err = -1;
+      }
+    }
+    else
+    {
+      const char *tab = strchr(linestr, '\t');
+      if(tab == NULL)
+      {
+        gt_error_set(error, "malformed entry at line %lu of cache file '%s'",
+                     linenum, gt_str_get(stream->filename));
+        had_err = -1;
+      }
+      else
+      {
+        char *key = gt_cstr_dup_nt(linestr, tab - linestr);
+        gt_hashmap_add(stream->cache, key, gt_cstr_dup(tab + 1));
+      }
+    }
+    gt_str_reset(line);
+  }
+  gt_str_delete(line);
+  fclose(instream);
+
+  return had_err;
+}
+
+static int compare_cache_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error)
+{
+  AgnCompareCacheStream *stream;
+  GtFeatureNode *fn;
+  int had_err;
+  gt_error_check(error);
+  stream = compare_cache_stream_cast(ns);
+
+  had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  if(had_err)
+    return had_err;
+  if(!*gn)
+  {
+    if(stream->outstream != NULL)
+    {
+      fclose(stream->outstream);
+      stream->outstream = NULL;
+      if(rename(gt_str_get(stream->tempfilename),
+                gt_str_get(stream->filename)) != 0)
+      {
+        gt_error_set(error, "unable to update cache file '%s'",
+                     gt_str_get(stream->filename));
+        return -1;
+      }
+      gt_logger_log(stream->logger, "[AgnCompareCacheStream] reused cached "
+                    "comparisons for %lu of %lu loci", stream->hits,
+                    stream->hits + stream->misses);
+    }
+    return 0;
+  }
+
+  fn = gt_feature_node_try_cast(*gn);
+  if(!fn)
+    return 0;
+
+  agn_assert(gt_feature_node_has_type(fn, "locus"));
+  char key[64];
+  GtUint64 hash = agn_locus_content_hash(*gn);
+  sprintf(key, "%016llx:%lu:%d", (unsigned long long)hash, stream->delta,
+          stream->maxtrans);
+
+  const char *selection = gt_hashmap_get(stream->cache, key);
+  if(selection != NULL &&
+     agn_locus_comparative_analysis_restore(*gn, selection))
+  {
+    stream->hits++;
+  }
+  else
+  {
+    agn_locus_comparative_analysis(*gn, stream->logger);
+    stream->misses++;
+  }
+
+  if(agn_locus_selection_encode(*gn, stream->selection))
+  {
+    fprintf(stream->outstream, "%s\t%s\n", key,
+            gt_str_get(stream->selection));
+  }
+
+  return 0;
+}
@@ -0,0 +1,270 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "AgnCliquePair.h"
+#include "AgnComparison.h"
+#include "AgnCompareReportCSV.h"
+#include "AgnLocus.h"
+
+#define compare_report_csv_cast(GV)\
+        gt_node_visitor_cast(compare_report_csv_class(), GV)
+
+#define COMPARE_REPORT_CSV_BUFFER_SIZE (1 << 20)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareReportCSV
+{
+  const GtNodeVisitor parent_instance;
+  FILE *outstream;
+  GtStr *buffer;
+  GtStr *field;
+  char delim;
+  GtLogger *logger;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Append the IDs of all transcripts in the clique to the buffer.
+ */
+static void compare_report_csv_append_ids(AgnCompareReportCSV *rpt,
+                                          AgnTranscriptClique *clique);
+
+/**
+ * @function Append a text value to the buffer, enclosing it in double quotes
+ * (and doubling any quotes it contains) if it contains the delimiter, a quote,
+ * or a line break, as described in RFC 4180.
+ */
+static void compare_report_csv_append_field(AgnCompareReportCSV *rpt,
+                                            const char *value);
+
+/**
+ * @function Append an unsigned integer value (preceded by the delimiter) to the
+ * buffer.
+ */
+static void compare_report_csv_append_ulong(AgnCompareReportCSV *rpt,
+                                            GtUword value);
+
+/**
+ * @function Implement the GtNodeVisitor interface.
+ */
+static const GtNodeVisitorClass *compare_report_csv_class();
+
+/**
+ * @function Free memory used by this node visitor.
+ */
+static void compare_report_csv_free(GtNodeVisitor *nv);
+
+/**
+ * @function Add one row to the buffer for the given clique pair.
+ */
+static void compare_report_csv_pair(AgnCompareReportCSV *rpt, AgnLocus *locus,
+                                    AgnCliquePair *pair);
+
+/**
+ * @function Process feature nodes.
+ */
+static int compare_report_csv_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_report_csv_flush(AgnCompareReportCSV *rpt)
+{
+  agn_assert(rpt);
+  if(gt_str_length(rpt->buffer) == 0)
+    return;
+
+  fwrite(gt_str_get(rpt->buffer), sizeof(char), gt_str_length(rpt->buffer),
+         rpt->outstream);
+  gt_str_reset(rpt->buffer);
+}
+
+GtNodeVisitor *agn_compare_report_csv_new(FILE *outstream, char delim,
+                                          GtLogger *logger)
+{
+  agn_assert(outstream);
+  GtNodeVisitor *nv = gt_node_visitor_create(compare_report_csv_class());
+  AgnCompareReportCSV *rpt = compare_report_csv_cast(nv);
+  rpt->outstream = outstream;
+  rpt->buffer = gt_str_new();
+  rpt->field = gt_str_new();
+  rpt->delim = delim;
+  rpt->logger = logger;
+
+  const char *columns[] = {
+    "Seqid", "Start", "End", "RefrTranscripts", "PredTranscripts",
+    "Classification", "CDSNucTP", "CDSNucFN", "CDSNucFP", "CDSNucTN",
+    "UTRNucTP", "UTRNucFN", "UTRNucFP", "UTRNucTN", "CDSStrucCorrect",
+    "CDSStrucMissing", "CDSStrucWrong", "ExonStrucCorrect", "ExonStrucMissing",
+    "ExonStrucWrong", "UTRStrucCorrect", "UTRStrucMissing", "UTRStrucWrong",
+    "OverallMatches", "OverallLength", NULL
+  };
+  GtUword i;
+  for(i = 0; columns[i] != NULL; i++)
+  {
+    if(i > 0)
+      gt_str_append_char(rpt->buffer, rpt->delim);
+    gt_str_append_cstr(rpt->buffer, columns[i]);
+  }
+  gt_str_append_char(rpt->buffer, '\n');
+
+  return nv;
+}
+
+static void compare_report_csv_append_ids(AgnCompareReportCSV *rpt,
+                                          AgnTranscriptClique *clique)
+{
+  GtArray *ids = agn_transcript_clique_ids(clique);
+  GtUword i;
+  gt_str_reset(rpt->field);
+  for(i = 0; i < gt_array_size(ids); i++)
+  {
+    const char *id = *(const char **)gt_array_get(ids, i);
+    if(i > 0)
+      gt_str_append_char(rpt->field, ';');
+    gt_str_append_cstr(rpt->field, id);
+  }
+  gt_array_delete(ids);
+  compare_report_csv_append_field(rpt, gt_str_get(rpt->field));
+}
+
+static void compare_report_csv_append_field(AgnCompareReportCSV *rpt,
+                                            const char *value)
+{
+  const char special[] = { rpt->delim, '"', '\n', '\r', '\0' };
+  if(strpbrk(value, special) == NULL)
+  {
+    gt_str_append_cstr(rpt->buffer, value);
+    return;
+  }
+
+  const char *c;
+  gt_str_append_char(rpt->buffer, '"');
+  for(c = value; *c != '\0'; c++)
+  {
+    if(*c == '"')
+      gt_str_append_char(rpt->buffer, '"');
+    gt_str_append_char(rpt->buffer, *c);
+  }
+  gt_str_append_char(rpt->buffer, '"');
+}
+
+static void compare_report_csv_append_ulong(AgnCompareReportCSV *rpt,
+                                            GtUword value)
+{
+  gt_str_append_char(rpt->buffer, rpt->delim);
+  gt_str_append_ulong(rpt->buffer, value);
+}
+
+static const GtNodeVisitorClass *compare_report_csv_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportCSV),
+                                    compare_report_csv_free, NULL,
+                                    compare_report_csv_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static void compare_report_csv_free(GtNodeVisitor *nv)
+{
+  AgnCompareReportCSV *rpt;
+  agn_assert(nv);
+
+  rpt = compare_report_csv_cast(nv);
+  agn_compare_report_csv_flush(rpt);
+  gt_str_delete(rpt->buffer);
+  gt_str_delete(rpt->field);
+}
+
+static void compare_report_csv_pair(AgnCompareReportCSV *rpt, AgnLocus *locus,
+                                    AgnCliquePair *pair)
+{
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  GtRange range = gt_genome_node_get_range(locus);
+  compare_report_csv_append_field(rpt, gt_str_get(seqid));
+  compare_report_csv_append_ulong(rpt, range.start);
+  compare_report_csv_append_ulong(rpt, range.end);
+
+  gt_str_append_char(rpt->buffer, rpt->delim);
+  compare_report_csv_append_ids(rpt, agn_clique_pair_get_refr_clique(pair));
+  gt_str_append_char(rpt->buffer, rpt->delim);
+  compare_report_csv_append_ids(rpt, agn_clique_pair_get_pred_clique(pair));
+  gt_str_append_char(rpt->buffer, rpt->delim);
+  AgnCompClassification cls = agn_clique_pair_classify(pair);
+  gt_str_append_cstr(rpt->buffer, agn_comp_classification_label(cls));
+
+  AgnComparison *stats = agn_clique_pair_get_stats(pair);
+  AgnCompStatsScaled *nucs[] = { &stats->cds_nuc_stats, &stats->utr_nuc_stats };
+  GtUword i;
+  for(i = 0; i < 2; i++)
+  {
+    compare_report_csv_append_ulong(rpt, nucs[i]->tp);
+    compare_report_csv_append_ulong(rpt, nucs[i]->fn);
+    compare_report_csv_append_ulong(rpt, nucs[i]->fp);
+    compare_report_csv_append_ulong(rpt, nucs[i]->tn);
+  }
+  AgnCompStatsBinary *strucs[] = { &stats->cds_struc_stats,
+                                   &stats->exon_struc_stats,
+                                   &stats->utr_struc_stats };
+  for(i = 0; i < 3; i++)
+  {
+    compare_report_csv_append_ulong(rpt, strucs[i]->correct);
+    compare_report_csv_append_ulong(rpt, strucs[i]->missing);
+    compare_report_csv_append_ulong(rpt, strucs[i]->wrong);
+  }
+  compare_report_csv_append_ulong(rpt, stats->overall_matches);
+  compare_report_csv_append_ulong(rpt, stats->overall_length);
+  gt_str_append_char(rpt->buffer, '\n');
+}
+
+static int compare_report_csv_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error)
+{
+  AgnCompareReportCSV *rpt;
+  AgnLocus *locus;
+
+  gt_error_check(error);
+  agn_assert(nv && fn && gt_feature_node_has_type(fn, "locus"));
+
+  rpt = compare_report_csv_cast(nv);
+  locus = (AgnLocus *)fn;
+  agn_locus_comparative_analysis(locus, rpt->logger);
+
+  GtArray *pairs2report = agn_locus_pairs_to_report(locus);
+  if(pairs2report != NULL)
+  {
+    GtUword i;
+    for(i = 0; i < gt_array_size(pairs2report); i++)
+    {
+      AgnCliquePair *pair = *(AgnCliquePair **)gt_array_get(pairs2report, i);
+      compare_report_csv_pair(rpt, locus, pair);
+    }
+  }
+
+  if(gt_str_length(rpt->buffer) >= COMPARE_REPORT_CSV_BUFFER_SIZE)
+    agn_compare_report_csv_flush(rpt);
+
+  return 0;
+}
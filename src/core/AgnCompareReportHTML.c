@@ -8,8 +8,10 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <errno.h>
 #include <string.h>
 #include "core/hashmap_api.h"
+#include "core/thread_api.h"
 #include "AgnComparison.h"
 #include "AgnCompareReportHTML.h"
 #include "AgnLocus.h"
@@ -18,6 +20,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define compare_report_html_cast(GV)\
         gt_node_visitor_cast(compare_report_html_class(), GV)
 
+#define COMPARE_REPORT_HTML_PNG_BATCH 64
+#define COMPARE_REPORT_HTML_NUM_CLASSES 6
+
 //------------------------------------------------------------------------------
 // Data structure definitions
 //------------------------------------------------------------------------------
@@ -30,14 +35,22 @@ struct AgnCompareReportHTML
   GtStrArray *seqids;
   const char *outdir;
   GtHashmap *seqdata;
-  GtHashmap *seqlocusdata;
-  GtHashmap *compclassdata;
+  FILE *seqspill;
+  GtStr *seqspillid;
+  FILE *classspill[COMPARE_REPORT_HTML_NUM_CLASSES];
   AgnCompareReportHTMLOverviewFunc ofunc;
   void *ofuncdata;
   GtLogger *logger;
   GtStr *summary_title;
   bool gff3;
   GtUword locuscount;
+  GtArray *pngqueue;
+  GtUword pngthreads;
+  GtUword shardsize;
+  GtUword shardcount;
+  FILE *shard;
+  FILE *shardindex;
+  long shardoffset;
 };
 
 typedef struct
@@ -49,6 +62,25 @@ typedef struct
   GtUword  refrtrans, predtrans;
 } SeqfileLocusData;
 
+typedef struct
+{
+  GtArray *graphics;
+  GtUword offset;
+  GtUword stride;
+} PngWorker;
+
+static const char *compclass_files[COMPARE_REPORT_HTML_NUM_CLASSES] =
+{
+  "perfectmatches", "mislabeled", "cdsmatches", "exonmatches", "utrmatches",
+  "nonmatches"
+};
+
+static const char *compclass_labels[COMPARE_REPORT_HTML_NUM_CLASSES] =
+{
+  "perfect matches", "perfect matches with mislabeled UTRs", "CDS matches",
+  "exon matches", "UTR matches", "non-matches"
+};
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -79,6 +111,14 @@ static void compare_report_html_footer(FILE *outstream);
  */
 static void compare_report_html_free(GtNodeVisitor *nv);
 
+/**
+ * @function Finish writing the report for the given locus. In sharded mode, the
+ * location of the report is added to the shard index, and a new shard is
+ * started if the current one is full.
+ */
+static void compare_report_html_locus_close(AgnCompareReportHTML *rpt,
+                                            AgnLocus *locus, FILE *outstream);
+
 /**
  * @function Create a report for each locus.
  */
@@ -90,6 +130,13 @@ static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
  */
 static void compare_report_html_locus_header(AgnLocus *locus, FILE *outstream);
 
+/**
+ * @function Get the output stream to which the given locus' report should be
+ * written: a new file for the locus, or the current shard in sharded mode.
+ */
+static FILE *compare_report_html_locus_open(AgnCompareReportHTML *rpt,
+                                            AgnLocus *locus);
+
 /**
  * @function Print gene IDs for locus report header.
  */
@@ -111,6 +158,20 @@ static void compare_report_html_pair_structure(FILE *outstream,
                                                const char *label,
                                                const char *units);
 
+#ifndef WITHOUT_CAIRO
+/**
+ * @function Render all queued graphics, dividing the work among the
+ * configured number of threads, and then delete them.
+ */
+static void compare_report_html_png_flush(AgnCompareReportHTML *rpt);
+
+/**
+ * @function Thread function: render every ``stride``th graphic in the queue,
+ * beginning with the ``offset``th graphic.
+ */
+static void *compare_report_html_png_worker(void *data);
+#endif
+
 /**
  * @function List loci according to their comparison class: perfect match, CDS
  * match, etc.
@@ -121,7 +182,8 @@ static void compare_report_html_print_compclassfiles(AgnCompareReportHTML *rpt);
  * @function Add the locus' information to the sequence summary page
  */
 static void
-compare_report_html_print_locus_to_seqfile(SeqfileLocusData *data,
+compare_report_html_print_locus_to_seqfile(AgnCompareReportHTML *rpt,
+                                           SeqfileLocusData *data,
                                            bool printseqid, FILE *outstream);
 
 /**
@@ -137,8 +199,9 @@ static void compare_report_html_print_pair(AgnCliquePair *pair, FILE *outstream,
 static void compare_report_html_print_seqfiles(AgnCompareReportHTML *rpt);
 
 /**
- * @function Store informatino about each locus for later use when creating the
- * sequence-level summary pages.
+ * @function Write a row for each locus to the temporary spill files from which
+ * the sequence-level and classification-level summary pages are later
+ * assembled.
  */
 static void
 compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
@@ -157,6 +220,34 @@ static void compare_report_html_seqfile_header(FILE *outstream,
  */
 static void compare_report_html_seqfile_footer(FILE *outstream);
 
+/**
+ * @function Close the current shard and the shard index, if open.
+ */
+static void compare_report_html_shard_close(AgnCompareReportHTML *rpt);
+
+/**
+ * @function Close any open spill files.
+ */
+static void compare_report_html_spill_close(AgnCompareReportHTML *rpt);
+
+/**
+ * @function Copy the contents of a spill file to the output stream, then delete
+ * the spill file. Returns false if the spill file does not exist.
+ */
+static bool compare_report_html_spill_copy(const char *filename,
+                                           FILE *outstream);
+
+/**
+ * @function Open a spill file for appending, exiting on failure.
+ */
+static FILE *compare_report_html_spill_open(const char *filename);
+
+/**
+ * @function Delete any spill file left over at the given location, so that
+ * rows appended during this run are not mixed with stale ones.
+ */
+static void compare_report_html_spill_reset(const char *filename);
+
 /**
  * @function Print an overview of reference and prediction annotations for the
  * summary report.
@@ -206,6 +297,11 @@ static int compare_report_html_visit_region_node(GtNodeVisitor *nv,
 void agn_compare_report_html_create_summary(AgnCompareReportHTML *rpt)
 {
   agn_assert(rpt);
+#ifndef WITHOUT_CAIRO
+  compare_report_html_png_flush(rpt);
+#endif
+  compare_report_html_shard_close(rpt);
+  compare_report_html_spill_close(rpt);
 
   // Create the output file
   char filename[1024];
@@ -247,26 +343,27 @@ GtNodeVisitor *agn_compare_report_html_new(const char *outdir, bool gff3,
   rpt->seqids = gt_str_array_new();
   rpt->outdir = outdir;
   rpt->seqdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
-  rpt->seqlocusdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
-                                     (GtFree)gt_array_delete);
-  rpt->compclassdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
-                                      (GtFree)gt_array_delete);
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("perfect"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("mislabeled"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("cds"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("exon"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("utr"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("nonmatch"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
+  rpt->seqspill = NULL;
+  rpt->seqspillid = gt_str_new();
+  GtUword i;
+  for(i = 0; i < COMPARE_REPORT_HTML_NUM_CLASSES; i++)
+  {
+    char spillname[AGN_MAX_FILENAME_SIZE];
+    sprintf(spillname, "%s/%s.tmp", rpt->outdir, compclass_files[i]);
+    compare_report_html_spill_reset(spillname);
+    rpt->classspill[i] = NULL;
+  }
   rpt->logger = logger;
   rpt->summary_title = gt_str_new_cstr("ParsEval Summary");
   rpt->gff3 = gff3;
   rpt->locuscount = 0;
+  rpt->pngqueue = gt_array_new(sizeof(void *));
+  rpt->pngthreads = 1;
+  rpt->shardsize = 0;
+  rpt->shardcount = 0;
+  rpt->shard = NULL;
+  rpt->shardindex = NULL;
+  rpt->shardoffset = 0;
 
   return nv;
 }
@@ -286,6 +383,20 @@ void agn_compare_report_html_set_overview_func(AgnCompareReportHTML *rpt,
   rpt->ofuncdata = funcdata;
 }
 
+void agn_compare_report_html_set_png_threads(AgnCompareReportHTML *rpt,
+                                             GtUword numthreads)
+{
+  agn_assert(rpt);
+  rpt->pngthreads = numthreads > 0 ? numthreads : 1;
+}
+
+void agn_compare_report_html_set_shard_size(AgnCompareReportHTML *rpt,
+                                            GtUword shardsize)
+{
+  agn_assert(rpt && rpt->locuscount == 0);
+  rpt->shardsize = shardsize;
+}
+
 static const GtNodeVisitorClass *compare_report_html_class()
 {
   static const GtNodeVisitorClass *nvc = NULL;
@@ -416,13 +527,46 @@ static void compare_report_html_free(GtNodeVisitor *nv)
   agn_assert(nv);
 
   rpt = compare_report_html_cast(nv);
+  GtUword i;
+#ifndef WITHOUT_CAIRO
+  for(i = 0; i < gt_array_size(rpt->pngqueue); i++)
+  {
+    AgnLocusPng *png = *(AgnLocusPng **)gt_array_get(rpt->pngqueue, i);
+    agn_locus_png_delete(png);
+  }
+#endif
+  gt_array_delete(rpt->pngqueue);
+  compare_report_html_shard_close(rpt);
   gt_str_array_delete(rpt->seqids);
   gt_hashmap_delete(rpt->seqdata);
-  gt_hashmap_delete(rpt->seqlocusdata);
-  gt_hashmap_delete(rpt->compclassdata);
+  compare_report_html_spill_close(rpt);
+  gt_str_delete(rpt->seqspillid);
   gt_str_delete(rpt->summary_title);
 }
 
+static void compare_report_html_locus_close(AgnCompareReportHTML *rpt,
+                                            AgnLocus *locus, FILE *outstream)
+{
+  if(rpt->shardsize == 0)
+  {
+    fclose(outstream);
+    return;
+  }
+
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  GtRange rng = gt_genome_node_get_range(locus);
+  long end = ftell(outstream);
+  fprintf(rpt->shardindex, "%s\t%lu\t%lu\tloci-%04lu.html\t%ld\t%ld\n",
+          gt_str_get(seqid), rng.start, rng.end, rpt->shardcount,
+          rpt->shardoffset, end - rpt->shardoffset);
+  if((GtUword)end >= rpt->shardsize)
+  {
+    fclose(rpt->shard);
+    rpt->shard = NULL;
+    rpt->shardcount++;
+  }
+}
+
 static void compare_report_html_locus_gene_ids(AgnLocus *locus, FILE *outstream)
 {
   GtUword i;
@@ -476,21 +620,25 @@ static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
   AgnComparisonData *seqdat = gt_hashmap_get(rpt->seqdata, gt_str_get(seqid));
   agn_locus_data_aggregate(locus, seqdat);
 
-  char filename[1024];
-  sprintf(filename, "%s/%s/%lu-%lu.html", rpt->outdir, gt_str_get(seqid),
-          rng.start, rng.end);
-  FILE *outstream = fopen(filename, "w");
-  if(outstream == NULL)
-  {
-    fprintf(stderr, "error: unable to open output file '%s'\n", filename);
-    exit(1);
-  }
-
+  FILE *outstream = compare_report_html_locus_open(rpt, locus);
   compare_report_html_locus_header(locus, outstream);
 #ifndef WITHOUT_CAIRO
   if(rpt->pngdata != NULL)
   {
-    agn_locus_print_png(locus, rpt->pngdata);
+    if(rpt->pngthreads > 1)
+    {
+      // Image filenames depend only on the locus coordinates, so the markup
+      // can be written now and the graphic rendered later with the next batch.
+      AgnLocusPng *png = agn_locus_png_new(locus, rpt->pngdata);
+      gt_array_add(rpt->pngqueue, png);
+      if(gt_array_size(rpt->pngqueue) >=
+         COMPARE_REPORT_HTML_PNG_BATCH * rpt->pngthreads)
+      {
+        compare_report_html_png_flush(rpt);
+      }
+    }
+    else
+      agn_locus_print_png(locus, rpt->pngdata);
     fprintf(outstream,
             "      <div class='graphic'>\n"
             "        <a href='%s_%lu-%lu.png'><img src='%s_%lu-%lu.png' /></a>\n"
@@ -506,7 +654,7 @@ static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
     fputs("      <p>No comparisons were performed for this locus.</p>\n\n",
           outstream);
     compare_report_html_footer(outstream);
-    fclose(outstream);
+    compare_report_html_locus_close(rpt, locus, outstream);
     return;
   }
 
@@ -566,7 +714,7 @@ static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
         "  </body>\n"
         "</html>",
         outstream);
-  fclose(outstream);
+  compare_report_html_locus_close(rpt, locus, outstream);
 }
 
 static void compare_report_html_locus_header(AgnLocus *locus, FILE *outstream)
@@ -630,6 +778,49 @@ static void compare_report_html_locus_header(AgnLocus *locus, FILE *outstream)
   compare_report_html_locus_gene_ids(locus, outstream);
 }
 
+static FILE *compare_report_html_locus_open(AgnCompareReportHTML *rpt,
+                                            AgnLocus *locus)
+{
+  char filename[1024];
+  if(rpt->shardsize == 0)
+  {
+    GtStr *seqid = gt_genome_node_get_seqid(locus);
+    GtRange rng = gt_genome_node_get_range(locus);
+    sprintf(filename, "%s/%s/%lu-%lu.html", rpt->outdir, gt_str_get(seqid),
+            rng.start, rng.end);
+    FILE *outstream = fopen(filename, "w");
+    if(outstream == NULL)
+    {
+      fprintf(stderr, "error: unable to open output file '%s'\n", filename);
+      exit(1);
+    }
+    return outstream;
+  }
+
+  if(rpt->shardindex == NULL)
+  {
+    sprintf(filename, "%s/loci.tsv", rpt->outdir);
+    rpt->shardindex = fopen(filename, "w");
+    if(rpt->shardindex == NULL)
+    {
+      fprintf(stderr, "error: unable to open output file '%s'\n", filename);
+      exit(1);
+    }
+  }
+  if(rpt->shard == NULL)
+  {
+    sprintf(filename, "%s/loci-%04lu.html", rpt->outdir, rpt->shardcount);
+    rpt->shard = fopen(filename, "w");
+    if(rpt->shard == NULL)
+    {
+      fprintf(stderr, "error: unable to open output file '%s'\n", filename);
+      exit(1);
+    }
+  }
+  rpt->shardoffset = ftell(rpt->shard);
+  return rpt->shard;
+}
+
 static void compare_report_html_pair_nucleotide(FILE *outstream,
                                                 AgnCliquePair *pair)
 {
@@ -706,156 +897,120 @@ static void compare_report_html_pair_structure(FILE *outstream,
   fputs("        </table>\n\n", outstream);
 }
 
-
-
-static void compare_report_html_print_compclassfiles(AgnCompareReportHTML *rpt)
+#ifndef WITHOUT_CAIRO
+static void compare_report_html_png_flush(AgnCompareReportHTML *rpt)
 {
-  GtArray *compclassdata;
-  GtUword i;
-
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "perfect");
-  if(gt_array_size(compclassdata) > 0)
-  {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/perfectmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "perfect matches");
+  GtUword i, numloci = gt_array_size(rpt->pngqueue);
+  if(numloci == 0)
+    return;
 
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
-  }
+  GtUword numworkers = rpt->pngthreads;
+  if(numworkers > numloci)
+    numworkers = numloci;
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "mislabeled");
-  if(gt_array_size(compclassdata) > 0)
+  // The graphics were laid out on the main thread and are deleted here after
+  // the batch is rendered; the workers never update reference counts.
+  PngWorker *workers = gt_malloc(sizeof(PngWorker) * numworkers);
+  GtThread **threads = gt_malloc(sizeof(GtThread *) * numworkers);
+  GtError *error = gt_error_new();
+  for(i = 0; i < numworkers; i++)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/mislabeled.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
+    workers[i].graphics = rpt->pngqueue;
+    workers[i].offset = i;
+    workers[i].stride = numworkers;
+    threads[i] = NULL;
+    if(i == 0)
+      continue;
+
+    threads[i] = gt_thread_new(compare_report_html_png_worker, workers + i,
+                               error);
+    if(threads[i] == NULL)
     {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
+      gt_error_unset(error);
+      compare_report_html_png_worker(workers + i);
     }
-    compare_report_html_compclass_header(outstream, "perfect matches with "
-                                         "mislabeled UTRs");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
   }
-
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "cds");
-  if(gt_array_size(compclassdata) > 0)
+  compare_report_html_png_worker(workers);
+  for(i = 1; i < numworkers; i++)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/cdsmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "CDS matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
+    if(threads[i] != NULL)
     {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
     }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
   }
+  gt_error_delete(error);
+  gt_free(threads);
+  gt_free(workers);
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "exon");
-  if(gt_array_size(compclassdata) > 0)
+  for(i = 0; i < numloci; i++)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/exonmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "exon matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    AgnLocusPng *png = *(AgnLocusPng **)gt_array_get(rpt->pngqueue, i);
+    agn_locus_png_delete(png);
   }
+  gt_array_reset(rpt->pngqueue);
+}
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "utr");
-  if(gt_array_size(compclassdata) > 0)
+static void *compare_report_html_png_worker(void *data)
+{
+  PngWorker *worker = data;
+  GtUword i;
+  for(i = worker->offset; i < gt_array_size(worker->graphics);
+      i += worker->stride)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/utrmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "UTR matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    AgnLocusPng *png = *(AgnLocusPng **)gt_array_get(worker->graphics, i);
+    agn_locus_png_render(png);
   }
+  return NULL;
+}
+#endif
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "nonmatch");
-  if(gt_array_size(compclassdata) > 0)
+static void compare_report_html_print_compclassfiles(AgnCompareReportHTML *rpt)
+{
+  GtUword i;
+  for(i = 0; i < COMPARE_REPORT_HTML_NUM_CLASSES; i++)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/nonmatches.html", rpt->outdir);
+    char filename[AGN_MAX_FILENAME_SIZE], spillname[AGN_MAX_FILENAME_SIZE];
+    sprintf(spillname, "%s/%s.tmp", rpt->outdir, compclass_files[i]);
+    FILE *spill = fopen(spillname, "r");
+    if(spill == NULL)
+      continue;
+    fclose(spill);
+
+    sprintf(filename, "%s/%s.html", rpt->outdir, compclass_files[i]);
     FILE *outstream = fopen(filename, "w");
     if(!outstream)
     {
       fprintf(stderr, "error: unable to open %s\n", filename);
       exit(1);
     }
-    compare_report_html_compclass_header(outstream, "non-matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
+    compare_report_html_compclass_header(outstream, compclass_labels[i]);
+    compare_report_html_spill_copy(spillname, outstream);
     compare_report_html_seqfile_footer(outstream);
     fclose(outstream);
   }
 }
 
 static void
-compare_report_html_print_locus_to_seqfile(SeqfileLocusData *data,
+compare_report_html_print_locus_to_seqfile(AgnCompareReportHTML *rpt,
+                                           SeqfileLocusData *data,
                                            bool printseqid, FILE *outstream)
 {
   char sstart[64], send[64], slength[64];
   agn_sprintf_comma(data->lrange.start, sstart);
   agn_sprintf_comma(data->lrange.end, send);
   agn_sprintf_comma(gt_range_length(&data->lrange), slength);
-  if(printseqid)
+  if(rpt->shardsize > 0)
+  {
+    fprintf(outstream,
+            "        <tr>\n"
+            "          <td><a href=\"%slocus.html#%s:%lu-%lu\">(+)</a></td>\n",
+            printseqid ? "" : "../", data->seqid, data->lrange.start,
+            data->lrange.end);
+    if(printseqid)
+      fprintf(outstream, "          <td>%s</td>\n", data->seqid);
+  }
+  else if(printseqid)
   {
     fprintf(outstream,
             "        <tr>\n"
@@ -961,7 +1116,7 @@ static void compare_report_html_print_pair(AgnCliquePair *pair, FILE *outstream,
 
 static void compare_report_html_print_seqfiles(AgnCompareReportHTML *rpt)
 {
-  GtUword i, j;
+  GtUword i;
   for(i = 0; i < gt_str_array_size(rpt->seqids); i++)
   {
     const char *seqid = gt_str_array_get(rpt->seqids, i);
@@ -975,13 +1130,9 @@ static void compare_report_html_print_seqfiles(AgnCompareReportHTML *rpt)
     }
     compare_report_html_seqfile_header(outstream, seqid);
 
-    GtArray *sld = gt_hashmap_get(rpt->seqlocusdata, seqid);
-    agn_assert(sld);
-    for(j = 0; j < gt_array_size(sld); j++)
-    {
-      SeqfileLocusData *data = gt_array_get(sld, j);
-      compare_report_html_print_locus_to_seqfile(data, false, outstream);
-    }
+    char spillname[AGN_MAX_FILENAME_SIZE];
+    sprintf(spillname, "%s/%s/loci.tmp", rpt->outdir, seqid);
+    compare_report_html_spill_copy(spillname, outstream);
     compare_report_html_seqfile_footer(outstream);
     fclose(outstream);
   }
@@ -992,7 +1143,7 @@ compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
                                         AgnLocus *locus)
 {
   SeqfileLocusData data;
-  GtArray *pairs2report, *seqlocusdata;
+  GtArray *pairs2report;
   GtStr *seqid;
   GtUword i;
 
@@ -1024,39 +1175,36 @@ compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
     else agn_assert(false);
   }
 
-  seqlocusdata = gt_hashmap_get(rpt->seqlocusdata, gt_str_get(seqid));
-  gt_array_add(seqlocusdata, data);
-
-  GtArray *ccdata;
-  if(data.numperfect > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "perfect");
-    gt_array_add(ccdata, data);
-  }
-  if(data.nummislabeled > 0)
+  // Loci arrive grouped by sequence, so only one sequence's spill file needs
+  // to be open at a time; appending handles any sequence that is revisited.
+  if(rpt->seqspill == NULL || gt_str_cmp(rpt->seqspillid, seqid) != 0)
   {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "mislabeled");
-    gt_array_add(ccdata, data);
+    char spillname[AGN_MAX_FILENAME_SIZE];
+    if(rpt->seqspill != NULL)
+      fclose(rpt->seqspill);
+    sprintf(spillname, "%s/%s/loci.tmp", rpt->outdir, gt_str_get(seqid));
+    rpt->seqspill = compare_report_html_spill_open(spillname);
+    gt_str_reset(rpt->seqspillid);
+    gt_str_append_str(rpt->seqspillid, seqid);
   }
-  if(data.numcdsmatch > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "cds");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numexonmatch > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "exon");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numutrmatch > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "utr");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numnonmatch > 0)
+  compare_report_html_print_locus_to_seqfile(rpt, &data, false, rpt->seqspill);
+
+  unsigned classcounts[COMPARE_REPORT_HTML_NUM_CLASSES] = {
+    data.numperfect, data.nummislabeled, data.numcdsmatch, data.numexonmatch,
+    data.numutrmatch, data.numnonmatch
+  };
+  for(i = 0; i < COMPARE_REPORT_HTML_NUM_CLASSES; i++)
   {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "nonmatch");
-    gt_array_add(ccdata, data);
+    if(classcounts[i] == 0)
+      continue;
+    if(rpt->classspill[i] == NULL)
+    {
+      char spillname[AGN_MAX_FILENAME_SIZE];
+      sprintf(spillname, "%s/%s.tmp", rpt->outdir, compclass_files[i]);
+      rpt->classspill[i] = compare_report_html_spill_open(spillname);
+    }
+    compare_report_html_print_locus_to_seqfile(rpt, &data, true,
+                                               rpt->classspill[i]);
   }
 }
 
@@ -1118,6 +1266,75 @@ static void compare_report_html_seqfile_footer(FILE *outstream)
   fputs("</html>\n", outstream);
 }
 
+static void compare_report_html_shard_close(AgnCompareReportHTML *rpt)
+{
+  if(rpt->shard != NULL)
+  {
+    fclose(rpt->shard);
+    rpt->shard = NULL;
+  }
+  if(rpt->shardindex != NULL)
+  {
+    fclose(rpt->shardindex);
+    rpt->shardindex = NULL;
+  }
+}
+
+static void compare_report_html_spill_close(AgnCompareReportHTML *rpt)
+{
+  GtUword i;
+  if(rpt->seqspill != NULL)
+  {
+    fclose(rpt->seqspill);
+    rpt->seqspill = NULL;
+  }
+  for(i = 0; i < COMPARE_REPORT_HTML_NUM_CLASSES; i++)
+  {
+    if(rpt->classspill[i] != NULL)
+    {
+      fclose(rpt->classspill[i]);
+      rpt->classspill[i] = NULL;
+    }
+  }
+}
+
+static bool compare_report_html_spill_copy(const char *filename,
+                                           FILE *outstream)
+{
+  FILE *spill = fopen(filename, "r");
+  if(spill == NULL)
+    return false;
+
+  char buffer[65536];
+  size_t numread;
+  while((numread = fread(buffer, sizeof(char), sizeof(buffer), spill)) > 0)
+    fwrite(buffer, sizeof(char), numread, outstream);
+  fclose(spill);
+  remove(filename);
+  return true;
+}
+
+static FILE *compare_report_html_spill_open(const char *filename)
+{
+  FILE *spill = fopen(filename, "a");
+  if(spill == NULL)
+  {
+    fprintf(stderr, "error: unable to open temporary file '%s'\n", filename);
+    exit(1);
+  }
+  return spill;
+}
+
+static void compare_report_html_spill_reset(const char *filename)
+{
+  if(remove(filename) != 0 && errno != ENOENT)
+  {
+    fprintf(stderr, "error: unable to remove stale temporary file '%s'\n",
+            filename);
+    exit(1);
+  }
+}
+
 static void compare_report_html_summary_annot(AgnCompInfo *info,
                                               FILE *outstream)
 {
@@ -1397,10 +1614,6 @@ static int compare_report_html_visit_region_node(GtNodeVisitor *nv,
   agn_comparison_data_init(data);
   gt_hashmap_add(rpt->seqdata, (char *)seqid, data);
 
-  GtArray *sld = gt_array_new( sizeof(SeqfileLocusData) );
-  agn_assert(sld);
-  gt_hashmap_add(rpt->seqlocusdata, gt_cstr_dup(seqid), sld);
-
   char seqdircmd[AGN_MAX_FILENAME_SIZE];
   sprintf(seqdircmd, "mkdir %s/%s", rpt->outdir, seqid);
   if(system(seqdircmd))
@@ -1409,6 +1622,9 @@ static int compare_report_html_visit_region_node(GtNodeVisitor *nv,
             seqid);
     exit(1);
   }
+  char spillname[AGN_MAX_FILENAME_SIZE];
+  sprintf(spillname, "%s/%s/loci.tmp", rpt->outdir, seqid);
+  compare_report_html_spill_reset(spillname);
 
   return 0;
 }
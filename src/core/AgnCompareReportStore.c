@@ -0,0 +1,342 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "core/str_array_api.h"
+#include "AgnCliquePair.h"
+#include "AgnComparison.h"
+#include "AgnCompareReportStore.h"
+#include "AgnCompareStore.h"
+#include "AgnLocus.h"
+
+#define compare_report_store_cast(GV)\
+        gt_node_visitor_cast(compare_report_store_class(), GV)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareReportStore
+{
+  const GtNodeVisitor parent_instance;
+  FILE *outstream;
+  GtUword offset;
+  GtArray *columns[AGN_COMPARE_STORE_NUM_COLUMNS];
+  GtStr *heap;
+  GtStrArray *seqids;
+  GtArray *blocks;
+  AgnCompareStoreBlock block;
+  bool finished;
+  GtLogger *logger;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add the given value to the end of a column of the current block.
+ */
+static void compare_report_store_add(AgnCompareReportStore *rpt,
+                                     AgnCompareStoreColumn column,
+                                     GtUword value);
+
+/**
+ * @function Append the IDs of all transcripts in the clique to the ID heap and
+ * return the offset of the resulting string.
+ */
+static GtUword compare_report_store_add_ids(AgnCompareReportStore *rpt,
+                                            AgnTranscriptClique *clique);
+
+/**
+ * @function Implement the GtNodeVisitor interface.
+ */
+static const GtNodeVisitorClass *compare_report_store_class();
+
+/**
+ * @function Write the rows collected so far as a single block and record it in
+ * the block index.
+ */
+static void compare_report_store_flush(AgnCompareReportStore *rpt);
+
+/**
+ * @function Free memory used by this node visitor.
+ */
+static void compare_report_store_free(GtNodeVisitor *nv);
+
+/**
+ * @function Add one row to the current block for the given clique pair.
+ */
+static void compare_report_store_pair(AgnCompareReportStore *rpt,
+                                      AgnLocus *locus, AgnCliquePair *pair);
+
+/**
+ * @function Process feature nodes.
+ */
+static int compare_report_store_visit_feature_node(GtNodeVisitor *nv,
+                                                   GtFeatureNode *fn,
+                                                   GtError *error);
+
+/**
+ * @function Write ``count`` values of ``size`` bytes each to the output stream
+ * and keep track of the current file offset.
+ */
+static void compare_report_store_write(AgnCompareReportStore *rpt,
+                                       const void *data, size_t size,
+                                       size_t count);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_report_store_finish(AgnCompareReportStore *rpt)
+{
+  GtUword indexoffset, count, i;
+  agn_assert(rpt);
+  if(rpt->finished)
+    return;
+
+  compare_report_store_flush(rpt);
+  indexoffset = rpt->offset;
+
+  count = gt_str_array_size(rpt->seqids);
+  compare_report_store_write(rpt, &count, sizeof (GtUword), 1);
+  for(i = 0; i < count; i++)
+  {
+    const char *seqid = gt_str_array_get(rpt->seqids, i);
+    GtUword length = strlen(seqid);
+    compare_report_store_write(rpt, &length, sizeof (GtUword), 1);
+    compare_report_store_write(rpt, seqid, sizeof (char), length);
+  }
+
+  count = gt_array_size(rpt->blocks);
+  compare_report_store_write(rpt, &count, sizeof (GtUword), 1);
+  for(i = 0; i < count; i++)
+  {
+    AgnCompareStoreBlock *block = gt_array_get(rpt->blocks, i);
+    GtUword values[5] = { block->offset, block->numrows, block->seqid,
+                          block->range.start, block->range.end };
+    compare_report_store_write(rpt, values, sizeof (GtUword), 5);
+  }
+
+  compare_report_store_write(rpt, &indexoffset, sizeof (GtUword), 1);
+  fflush(rpt->outstream);
+  rpt->finished = true;
+}
+
+GtNodeVisitor *agn_compare_report_store_new(FILE *outstream, GtLogger *logger)
+{
+  GtUword version = AGN_COMPARE_STORE_VERSION;
+  GtUword i;
+  agn_assert(outstream);
+
+  GtNodeVisitor *nv = gt_node_visitor_create(compare_report_store_class());
+  AgnCompareReportStore *rpt = compare_report_store_cast(nv);
+  rpt->outstream = outstream;
+  rpt->offset = 0;
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+    rpt->columns[i] = gt_array_new(sizeof (GtUword));
+  rpt->heap = gt_str_new();
+  rpt->seqids = gt_str_array_new();
+  rpt->blocks = gt_array_new(sizeof (AgnCompareStoreBlock));
+  rpt->block.numrows = 0;
+  rpt->finished = false;
+  rpt->logger = logger;
+
+  compare_report_store_write(rpt, AGN_COMPARE_STORE_MAGIC, sizeof (char), 8);
+  compare_report_store_write(rpt, &version, sizeof (GtUword), 1);
+
+  return nv;
+}
+
+static void compare_report_store_add(AgnCompareReportStore *rpt,
+                                     AgnCompareStoreColumn column,
+                                     GtUword value)
+{
+  gt_array_add(rpt->columns[column], value);
+}
+
+static GtUword compare_report_store_add_ids(AgnCompareReportStore *rpt,
+                                            AgnTranscriptClique *clique)
+{
+  GtUword offset = gt_str_length(rpt->heap);
+  GtArray *ids = agn_transcript_clique_ids(clique);
+  GtUword i;
+  for(i = 0; i < gt_array_size(ids); i++)
+  {
+    const char *id = *(const char **)gt_array_get(ids, i);
+    if(i > 0)
+      gt_str_append_char(rpt->heap, ';');
+    gt_str_append_cstr(rpt->heap, id);
+  }
+  gt_str_append_char(rpt->heap, '\0');
+  gt_array_delete(ids);
+  return offset;
+}
+
+static const GtNodeVisitorClass *compare_report_store_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportStore),
+                                    compare_report_store_free, NULL,
+                                    compare_report_store_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static void compare_report_store_flush(AgnCompareReportStore *rpt)
+{
+  GtUword i;
+  if(rpt->block.numrows == 0)
+    return;
+
+  rpt->block.offset = rpt->offset;
+  compare_report_store_write(rpt, &rpt->block.numrows, sizeof (GtUword), 1);
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+  {
+    agn_assert(gt_array_size(rpt->columns[i]) == rpt->block.numrows);
+    compare_report_store_write(rpt, gt_array_get_space(rpt->columns[i]),
+                               sizeof (GtUword), rpt->block.numrows);
+    gt_array_reset(rpt->columns[i]);
+  }
+
+  GtUword heapsize = gt_str_length(rpt->heap);
+  compare_report_store_write(rpt, &heapsize, sizeof (GtUword), 1);
+  compare_report_store_write(rpt, gt_str_get(rpt->heap), sizeof (char),
+                             heapsize);
+  gt_str_reset(rpt->heap);
+
+  gt_array_add(rpt->blocks, rpt->block);
+  rpt->block.numrows = 0;
+}
+
+static void compare_report_store_free(GtNodeVisitor *nv)
+{
+  AgnCompareReportStore *rpt;
+  GtUword i;
+  agn_assert(nv);
+
+  rpt = compare_report_store_cast(nv);
+  agn_compare_report_store_finish(rpt);
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+    gt_array_delete(rpt->columns[i]);
+  gt_str_delete(rpt->heap);
+  gt_str_array_delete(rpt->seqids);
+  gt_array_delete(rpt->blocks);
+}
+
+static void compare_report_store_pair(AgnCompareReportStore *rpt,
+                                      AgnLocus *locus, AgnCliquePair *pair)
+{
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  GtRange range = gt_genome_node_get_range(locus);
+  GtUword numseqs = gt_str_array_size(rpt->seqids);
+
+  // Rows from different sequences never share a block. Input sorted by seqid
+  // gives one table entry per sequence.
+  if(rpt->block.numrows > 0 &&
+     strcmp(gt_str_get(seqid),
+            gt_str_array_get(rpt->seqids, rpt->block.seqid)) != 0)
+  {
+    compare_report_store_flush(rpt);
+  }
+  if(rpt->block.numrows == 0)
+  {
+    if(numseqs == 0 || strcmp(gt_str_get(seqid),
+                              gt_str_array_get(rpt->seqids, numseqs - 1)) != 0)
+    {
+      gt_str_array_add(rpt->seqids, seqid);
+      numseqs++;
+    }
+    rpt->block.seqid = numseqs - 1;
+    rpt->block.range = range;
+  }
+  rpt->block.range = gt_range_join(&rpt->block.range, &range);
+
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_SEQID, rpt->block.seqid);
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_START, range.start);
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_END, range.end);
+  GtUword refroffset = compare_report_store_add_ids(rpt,
+                                      agn_clique_pair_get_refr_clique(pair));
+  GtUword predoffset = compare_report_store_add_ids(rpt,
+                                      agn_clique_pair_get_pred_clique(pair));
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_REFRIDS, refroffset);
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_PREDIDS, predoffset);
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_CLASS,
+                           agn_clique_pair_classify(pair));
+
+  AgnComparison *stats = agn_clique_pair_get_stats(pair);
+  AgnCompStatsScaled *nucs[] = { &stats->cds_nuc_stats, &stats->utr_nuc_stats };
+  AgnCompStatsBinary *strucs[] = { &stats->cds_struc_stats,
+                                   &stats->exon_struc_stats,
+                                   &stats->utr_struc_stats };
+  GtUword column = AGN_COMPARE_STORE_CDS_NUC_TP;
+  GtUword i;
+  for(i = 0; i < 2; i++)
+  {
+    compare_report_store_add(rpt, column++, nucs[i]->tp);
+    compare_report_store_add(rpt, column++, nucs[i]->fn);
+    compare_report_store_add(rpt, column++, nucs[i]->fp);
+    compare_report_store_add(rpt, column++, nucs[i]->tn);
+  }
+  for(i = 0; i < 3; i++)
+  {
+    compare_report_store_add(rpt, column++, strucs[i]->correct);
+    compare_report_store_add(rpt, column++, strucs[i]->missing);
+    compare_report_store_add(rpt, column++, strucs[i]->wrong);
+  }
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_OVERALL_MATCHES,
+                           stats->overall_matches);
+  compare_report_store_add(rpt, AGN_COMPARE_STORE_OVERALL_LENGTH,
+                           stats->overall_length);
+
+  rpt->block.numrows++;
+  if(rpt->block.numrows == AGN_COMPARE_STORE_BLOCK_SIZE)
+    compare_report_store_flush(rpt);
+}
+
+static int compare_report_store_visit_feature_node(GtNodeVisitor *nv,
+                                                   GtFeatureNode *fn,
+                                                   GtError *error)
+{
+  AgnCompareReportStore *rpt;
+  AgnLocus *locus;
+
+  gt_error_check(error);
+  agn_assert(nv && fn && gt_feature_node_has_type(fn, "locus"));
+
+  rpt = compare_report_store_cast(nv);
+  locus = (AgnLocus *)fn;
+  agn_locus_comparative_analysis(locus, rpt->logger);
+
+  GtArray *pairs2report = agn_locus_pairs_to_report(locus);
+  if(pairs2report != NULL)
+  {
+    GtUword i;
+    for(i = 0; i < gt_array_size(pairs2report); i++)
+    {
+      AgnCliquePair *pair = *(AgnCliquePair **)gt_array_get(pairs2report, i);
+      compare_report_store_pair(rpt, locus, pair);
+    }
+  }
+
+  return 0;
+}
+
+static void compare_report_store_write(AgnCompareReportStore *rpt,
+                                       const void *data, size_t size,
+                                       size_t count)
+{
+  fwrite(data, size, count, rpt->outstream);
+  rpt->offset += size * count;
+}
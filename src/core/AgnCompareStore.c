@@ -0,0 +1,386 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "core/array_api.h"
+#include "core/ma_api.h"
+#include "core/str_array_api.h"
+#include "AgnCompareStore.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareStore
+{
+  GtStrArray *seqids;
+  GtArray *columns[AGN_COMPARE_STORE_NUM_COLUMNS];
+  char *heap;
+  GtUword heapsize;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Read the block at the current file position, keeping only the rows
+ * that overlap with ``range`` (or all rows if ``range`` is NULL). Offsets into
+ * the block's ID heap are adjusted to refer to the store's combined heap. Sizes,
+ * sequence indices, and heap offsets are checked against ``filesize``, the
+ * sequence table, and the block's heap before anything is allocated or kept.
+ */
+static int compare_store_load_block(AgnCompareStore *store, FILE *instream,
+                                    AgnCompareStoreBlock *block,
+                                    GtRange *range, GtUword filesize,
+                                    GtError *error);
+
+/**
+ * @function Read ``count`` values of ``size`` bytes each from the file, setting
+ * an error if the file ends prematurely.
+ */
+static int compare_store_read(FILE *instream, void *buffer, size_t size,
+                              size_t count, GtError *error);
+
+/**
+ * @function Read the sequence ID table and the block index from the end of the
+ * file, checking all offsets and lengths against ``filesize``.
+ */
+static int compare_store_read_index(AgnCompareStore *store, FILE *instream,
+                                    GtArray *blocks, GtUword filesize,
+                                    GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_store_delete(AgnCompareStore *store)
+{
+  GtUword i;
+  if(store == NULL)
+    return;
+
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+    gt_array_delete(store->columns[i]);
+  gt_str_array_delete(store->seqids);
+  gt_free(store->heap);
+  gt_free(store);
+}
+
+void agn_compare_store_get(AgnCompareStore *store, GtUword row,
+                           AgnCompareRecord *record)
+{
+  GtUword values[AGN_COMPARE_STORE_NUM_COLUMNS];
+  GtUword i;
+  agn_assert(store && record && row < agn_compare_store_size(store));
+
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+    values[i] = *(GtUword *)gt_array_get(store->columns[i], row);
+
+  record->seqid = gt_str_array_get(store->seqids,
+                                   values[AGN_COMPARE_STORE_SEQID]);
+  record->range.start = values[AGN_COMPARE_STORE_START];
+  record->range.end = values[AGN_COMPARE_STORE_END];
+  record->refrids = store->heap + values[AGN_COMPARE_STORE_REFRIDS];
+  record->predids = store->heap + values[AGN_COMPARE_STORE_PREDIDS];
+  record->classification = values[AGN_COMPARE_STORE_CLASS];
+
+  AgnComparison *stats = &record->stats;
+  agn_comparison_init(stats);
+  stats->cds_nuc_stats.tp = values[AGN_COMPARE_STORE_CDS_NUC_TP];
+  stats->cds_nuc_stats.fn = values[AGN_COMPARE_STORE_CDS_NUC_FN];
+  stats->cds_nuc_stats.fp = values[AGN_COMPARE_STORE_CDS_NUC_FP];
+  stats->cds_nuc_stats.tn = values[AGN_COMPARE_STORE_CDS_NUC_TN];
+  stats->utr_nuc_stats.tp = values[AGN_COMPARE_STORE_UTR_NUC_TP];
+  stats->utr_nuc_stats.fn = values[AGN_COMPARE_STORE_UTR_NUC_FN];
+  stats->utr_nuc_stats.fp = values[AGN_COMPARE_STORE_UTR_NUC_FP];
+  stats->utr_nuc_stats.tn = values[AGN_COMPARE_STORE_UTR_NUC_TN];
+  stats->cds_struc_stats.correct = values[AGN_COMPARE_STORE_CDS_STRUC_CORRECT];
+  stats->cds_struc_stats.missing = values[AGN_COMPARE_STORE_CDS_STRUC_MISSING];
+  stats->cds_struc_stats.wrong = values[AGN_COMPARE_STORE_CDS_STRUC_WRONG];
+  stats->exon_struc_stats.correct =
+      values[AGN_COMPARE_STORE_EXON_STRUC_CORRECT];
+  stats->exon_struc_stats.missing =
+      values[AGN_COMPARE_STORE_EXON_STRUC_MISSING];
+  stats->exon_struc_stats.wrong = values[AGN_COMPARE_STORE_EXON_STRUC_WRONG];
+  stats->utr_struc_stats.correct = values[AGN_COMPARE_STORE_UTR_STRUC_CORRECT];
+  stats->utr_struc_stats.missing = values[AGN_COMPARE_STORE_UTR_STRUC_MISSING];
+  stats->utr_struc_stats.wrong = values[AGN_COMPARE_STORE_UTR_STRUC_WRONG];
+  stats->overall_matches = values[AGN_COMPARE_STORE_OVERALL_MATCHES];
+  stats->overall_length = values[AGN_COMPARE_STORE_OVERALL_LENGTH];
+  agn_comparison_resolve(stats);
+}
+
+AgnCompareStore *agn_compare_store_open(const char *filename,
+                                        const char *seqid, GtRange *range,
+                                        GtError *error)
+{
+  AgnCompareStore *store;
+  FILE *instream;
+  char magic[8];
+  GtUword version, filesize, i;
+  long endoffset;
+  int had_err = 0;
+  agn_assert(filename);
+
+  instream = fopen(filename, "rb");
+  if(instream == NULL)
+  {
+    gt_error_set(error, "unable to open comparison store '%s'", filename);
+    return NULL;
+  }
+  if(fseek(instream, 0, SEEK_END) != 0 || (endoffset = ftell(instream)) < 0 ||
+     fseek(instream, 0, SEEK_SET) != 0)
+  {
+    gt_error_set(error, "unable to read comparison store '%s'", filename);
+    fclose(instream);
+    return NULL;
+  }
+  filesize = endoffset;
+
+  store = gt_malloc(sizeof (AgnCompareStore));
+  store->seqids = gt_str_array_new();
+  for(i = 0; i < AGN_COMPARE_STORE_NUM_COLUMNS; i++)
+    store->columns[i] = gt_array_new(sizeof (GtUword));
+  store->heap = NULL;
+  store->heapsize = 0;
+
+  had_err = compare_store_read(instream, magic, sizeof (char), 8, error);
+  if(!had_err)
+    had_err = compare_store_read(instream, &version, sizeof (GtUword), 1,
+                                 error);
+  if(!had_err && (strncmp(magic, AGN_COMPARE_STORE_MAGIC, 8) != 0 ||
+                  version != AGN_COMPARE_STORE_VERSION))
+  {
+    gt_error_set(error, "'%s' is not a comparison store, or was written by an "
+                 "incompatible version of ParsEval", filename);
+    had_err = -1;
+  }
+
+  GtArray *blocks = gt_array_new(sizeof (AgnCompareStoreBlock));
+  if(!had_err)
+    had_err = compare_store_read_index(store, instream, blocks, filesize,
+                                       error);
+  for(i = 0; !had_err && i < gt_array_size(blocks); i++)
+  {
+    AgnCompareStoreBlock *block = gt_array_get(blocks, i);
+    const char *blockseqid = gt_str_array_get(store->seqids, block->seqid);
+    if(seqid != NULL && strcmp(seqid, blockseqid) != 0)
+      continue;
+    if(seqid != NULL && range != NULL && !gt_range_overlap(range,&block->range))
+      continue;
+
+    if(fseek(instream, block->offset, SEEK_SET) != 0)
+    {
+      gt_error_set(error, "comparison store '%s' is truncated", filename);
+      had_err = -1;
+    }
+    else
+    {
+      had_err = compare_store_load_block(store, instream, block,
+                                         seqid != NULL ? range : NULL,
+                                         filesize, error);
+    }
+  }
+  gt_array_delete(blocks);
+  fclose(instream);
+
+  if(had_err)
+  {
+    agn_compare_store_delete(store);
+    return NULL;
+  }
+  return store;
+}
+
+GtUword agn_compare_store_size(AgnCompareStore *store)
+{
+  agn_assert(store);
+  return gt_array_size(store->columns[AGN_COMPARE_STORE_SEQID]);
+}
+
+static int compare_store_load_block(AgnCompareStore *store, FILE *instream,
+                                    AgnCompareStoreBlock *block,
+                                    GtRange *range, GtUword filesize,
+                                    GtError *error)
+{
+  GtUword numrows, heapsize, row, col;
+  GtUword *values;
+  int had_err;
+
+  had_err = compare_store_read(instream, &numrows, sizeof (GtUword), 1, error);
+  if(!had_err && numrows != block->numrows)
+  {
+    gt_error_set(error, "comparison store block index is inconsistent");
+    had_err = -1;
+  }
+  if(!had_err && numrows > filesize / (sizeof (GtUword) *
+                                       AGN_COMPARE_STORE_NUM_COLUMNS))
+  {
+    gt_error_set(error, "comparison store block is larger than the file");
+    had_err = -1;
+  }
+  if(had_err)
+    return had_err;
+
+  values = gt_malloc(sizeof (GtUword) * numrows *
+                     AGN_COMPARE_STORE_NUM_COLUMNS);
+  had_err = compare_store_read(instream, values, sizeof (GtUword),
+                               numrows * AGN_COMPARE_STORE_NUM_COLUMNS, error);
+  if(!had_err)
+    had_err = compare_store_read(instream, &heapsize, sizeof (GtUword), 1,
+                                 error);
+  if(!had_err && heapsize > filesize)
+  {
+    gt_error_set(error, "comparison store ID heap is larger than the file");
+    had_err = -1;
+  }
+  if(!had_err)
+  {
+    store->heap = gt_realloc(store->heap, store->heapsize + heapsize);
+    had_err = compare_store_read(instream, store->heap + store->heapsize,
+                                 sizeof (char), heapsize, error);
+  }
+  if(!had_err && heapsize > 0 && store->heap[store->heapsize + heapsize - 1])
+  {
+    gt_error_set(error, "comparison store ID heap is not NUL-terminated");
+    had_err = -1;
+  }
+  for(row = 0; !had_err && row < numrows; row++)
+  {
+    GtUword refrids = values[AGN_COMPARE_STORE_REFRIDS * numrows + row];
+    GtUword predids = values[AGN_COMPARE_STORE_PREDIDS * numrows + row];
+    if(values[AGN_COMPARE_STORE_SEQID * numrows + row] != block->seqid ||
+       refrids >= heapsize || predids >= heapsize)
+    {
+      gt_error_set(error, "comparison store row %lu of block at offset %lu "
+                   "is corrupt", row, block->offset);
+      had_err = -1;
+    }
+  }
+  if(had_err)
+  {
+    gt_free(values);
+    return had_err;
+  }
+
+  for(row = 0; row < numrows; row++)
+  {
+    if(range != NULL)
+    {
+      GtRange rowrange = {
+        values[AGN_COMPARE_STORE_START * numrows + row],
+        values[AGN_COMPARE_STORE_END * numrows + row]
+      };
+      if(!gt_range_overlap(range, &rowrange))
+        continue;
+    }
+    for(col = 0; col < AGN_COMPARE_STORE_NUM_COLUMNS; col++)
+    {
+      GtUword value = values[col * numrows + row];
+      if(col == AGN_COMPARE_STORE_REFRIDS || col == AGN_COMPARE_STORE_PREDIDS)
+        value += store->heapsize;
+      gt_array_add(store->columns[col], value);
+    }
+  }
+  store->heapsize += heapsize;
+  gt_free(values);
+
+  return 0;
+}
+
+static int compare_store_read(FILE *instream, void *buffer, size_t size,
+                              size_t count, GtError *error)
+{
+  if(fread(buffer, size, count, instream) != count)
+  {
+    gt_error_set(error, "unexpected end of comparison store");
+    return -1;
+  }
+  return 0;
+}
+
+static int compare_store_read_index(AgnCompareStore *store, FILE *instream,
+                                    GtArray *blocks, GtUword filesize,
+                                    GtError *error)
+{
+  GtUword indexoffset, numseqs, numblocks, length, i;
+  int had_err = 0;
+
+  if(fseek(instream, -(long)sizeof (GtUword), SEEK_END) != 0)
+  {
+    gt_error_set(error, "unexpected end of comparison store");
+    return -1;
+  }
+  had_err = compare_store_read(instream, &indexoffset, sizeof (GtUword), 1,
+                               error);
+  if(!had_err && indexoffset >= filesize)
+  {
+    gt_error_set(error, "comparison store index offset is out of range");
+    had_err = -1;
+  }
+  if(!had_err && fseek(instream, indexoffset, SEEK_SET) != 0)
+  {
+    gt_error_set(error, "unexpected end of comparison store");
+    had_err = -1;
+  }
+  if(!had_err)
+    had_err = compare_store_read(instream, &numseqs, sizeof (GtUword), 1,
+                                 error);
+
+  GtStr *seqid = gt_str_new();
+  for(i = 0; !had_err && i < numseqs; i++)
+  {
+    had_err = compare_store_read(instream, &length, sizeof (GtUword), 1, error);
+    if(!had_err && length > filesize - indexoffset)
+    {
+      gt_error_set(error, "comparison store sequence table is corrupt");
+      had_err = -1;
+    }
+    if(!had_err)
+    {
+      char *buffer = gt_malloc(sizeof (char) * length);
+      had_err = compare_store_read(instream, buffer, sizeof (char), length,
+                                   error);
+      gt_str_reset(seqid);
+      gt_str_append_cstr_nt(seqid, buffer, length);
+      gt_str_array_add(store->seqids, seqid);
+      gt_free(buffer);
+    }
+  }
+  gt_str_delete(seqid);
+
+  if(!had_err)
+    had_err = compare_store_read(instream, &numblocks, sizeof (GtUword), 1,
+                                 error);
+  for(i = 0; !had_err && i < numblocks; i++)
+  {
+    AgnCompareStoreBlock block;
+    GtUword values[5];
+    had_err = compare_store_read(instream, values, sizeof (GtUword), 5, error);
+    if(!had_err && (values[0] >= indexoffset || values[2] >= numseqs))
+    {
+      gt_error_set(error, "comparison store block index is inconsistent");
+      had_err = -1;
+    }
+    if(!had_err)
+    {
+      block.offset = values[0];
+      block.numrows = values[1];
+      block.seqid = values[2];
+      block.range.start = values[3];
+      block.range.end = values[4];
+      gt_array_add(blocks, block);
+    }
+  }
+
+  return had_err;
+}
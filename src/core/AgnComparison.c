@@ -9,6 +9,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "AgnComparison.h"
 
 void agn_comparison_aggregate(AgnComparison *a, AgnComparison *b)
@@ -127,6 +128,31 @@ void agn_comp_class_summary_init(AgnCompClassSummary *summ)
   agn_comp_class_desc_init(&summ->non_matches);
 }
 
+const char *agn_comp_classification_label(AgnCompClassification cls)
+{
+  switch(cls)
+  {
+    case AGN_COMP_CLASS_PERFECT_MATCH: return "perfect_match";
+    case AGN_COMP_CLASS_MISLABELED:    return "mislabeled";
+    case AGN_COMP_CLASS_CDS_MATCH:     return "cds_match";
+    case AGN_COMP_CLASS_EXON_MATCH:    return "exon_match";
+    case AGN_COMP_CLASS_UTR_MATCH:     return "utr_match";
+    case AGN_COMP_CLASS_NON_MATCH:     return "non_match";
+    default:                           return "unclassified";
+  }
+}
+
+AgnCompClassification agn_comp_classification_parse(const char *label)
+{
+  AgnCompClassification cls;
+  for(cls = AGN_COMP_CLASS_PERFECT_MATCH; cls <= AGN_COMP_CLASS_NON_MATCH; cls++)
+  {
+    if(strcmp(label, agn_comp_classification_label(cls)) == 0)
+      return cls;
+  }
+  return AGN_COMP_CLASS_UNCLASSIFIED;
+}
+
 void agn_comp_info_aggregate(AgnCompInfo *agg_info, AgnCompInfo *info)
 {
   agg_info->num_loci = info->num_loci;
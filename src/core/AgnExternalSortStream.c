@@ -0,0 +1,644 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "core/file_api.h"
+#include "core/str_api.h"
+#include "core/str_array_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "extended/gff3_visitor_api.h"
+#include "AgnExternalSortStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * The input is loaded when the first node is requested. Until then,
+ * ``memory`` collects the features of the current run; afterwards it holds the
+ * sorted nodes that were never written to disk, delivered from ``memindex``
+ * onward. ``heads`` holds the next feature of each run (NULL once the run is
+ * exhausted), parallel to ``runs``. ``origins`` holds the names of the files
+ * from which the spilled features were parsed, referred to by index in the
+ * origin attribute written with each feature. ``numids`` counts the temporary
+ * IDs given to spilled parent features that lack one.
+ */
+struct AgnExternalSortStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtUword budget;
+  GtUword size;
+  GtArray *memory;
+  GtUword memindex;
+  GtArray *others;
+  GtStrArray *runfiles;
+  GtArray *runs;
+  GtArray *heads;
+  GtArray *origins;
+  GtUword numids;
+  bool loaded;
+};
+
+/**
+ * Rough memory footprint of a single feature node, not including its
+ * attributes.
+ */
+#define EXTERNAL_SORT_NODE_SIZE 512
+
+/**
+ * Attribute recording the original file and line of each spilled feature, and
+ * whether it was given a temporary ID; it is removed when the feature is read
+ * back from the run.
+ */
+#define EXTERNAL_SORT_ORIGIN_KEY "aegean_origin"
+
+/**
+ * Prefix of the temporary IDs given to spilled features that need an ID to be
+ * written as parents (or as multi-features), so that the GFF3 writer does not
+ * make up IDs of its own that could collide with those of other features.
+ */
+#define EXTERNAL_SORT_ID_PREFIX "aegean_sort_"
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define external_sort_stream_cast(GS)\
+        gt_node_stream_cast(external_sort_stream_class(), GS)
+
+/**
+ * @function Attribute iteration function adding the size of each attribute to
+ * the total pointed to by ``data``.
+ */
+static void external_sort_stream_attribute_size(const char *key,
+                                                const char *value, void *data);
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* external_sort_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void external_sort_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pull all nodes from the input stream, writing a run whenever the
+ * features held in memory exceed the budget, then open each run and read its
+ * first feature.
+ */
+static int external_sort_stream_load(AgnExternalSortStream *stream,
+                                     GtError *error);
+
+/**
+ * @function Delivers the next node in sorted order, loading the input on the
+ * first call.
+ */
+static int external_sort_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error);
+
+/**
+ * @function Restore the original file name and line number of a feature read
+ * back from a run, and of all of its subfeatures, from their origin
+ * attributes, and remove any temporary IDs.
+ */
+static void external_sort_stream_restore(AgnExternalSortStream *stream,
+                                         GtFeatureNode *fn);
+
+/**
+ * @function Read the next feature of the given run into ``heads``, skipping
+ * the sequence regions and other nodes created by the GFF3 parser.
+ */
+static int external_sort_stream_run_next(AgnExternalSortStream *stream,
+                                         GtUword runindex, GtError *error);
+
+/**
+ * @function Sort the features held in memory and write them to a new temporary
+ * file.
+ */
+static int external_sort_stream_spill(AgnExternalSortStream *stream,
+                                      GtError *error);
+
+/**
+ * @function Record the file name and line number of the feature and each of
+ * its subfeatures in an origin attribute, before the feature is spilled, and
+ * give a temporary ID to each ID-less feature that needs one.
+ */
+static void external_sort_stream_tag(AgnExternalSortStream *stream,
+                                     GtFeatureNode *fn);
+
+/**
+ * @function Sort the given nodes with the given memory budget, and check that
+ * they are delivered in sorted order with their subfeatures intact, with
+ * their original file names and line numbers, and with only their own IDs.
+ */
+static bool external_sort_stream_test(GtArray *nodes, GtUword budget,
+                                      GtUword numfeatures, GtUword numnodes,
+                                      GtUword numids);
+
+/**
+ * @function Estimate the memory occupied by the given feature and all of its
+ * subfeatures, including their attributes.
+ */
+static GtUword external_sort_stream_tree_size(GtFeatureNode *fn);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_external_sort_stream_new(GtNodeStream *in_stream,
+                                           GtUword budget)
+{
+  agn_assert(in_stream);
+  GtNodeStream *ns = gt_node_stream_create(external_sort_stream_class(), true);
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->budget = budget;
+  stream->size = 0;
+  stream->memory = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->memindex = 0;
+  stream->others = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->runfiles = gt_str_array_new();
+  stream->runs = gt_array_new( sizeof(GtNodeStream *) );
+  stream->heads = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->origins = gt_array_new( sizeof(GtStr *) );
+  stream->numids = 0;
+  stream->loaded = false;
+  return ns;
+}
+
+bool agn_external_sort_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtStr *origin = gt_str_new_cstr("test.gff3");
+  GtUword budgets[] = { 1, 2 * EXTERNAL_SORT_NODE_SIZE, 1048576 };
+  const char *labels[] = { "one feature per run", "two features per run",
+                           "in memory" };
+  int i;
+  for(i = 0; i < 3; i++)
+  {
+    GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+    GtGenomeNode *gn = gt_region_node_new(chr2, 1, 1000);
+    gt_array_add(nodes, gn);
+    gn = gt_region_node_new(chr1, 1, 1000);
+    gt_array_add(nodes, gn);
+    gn = gt_feature_node_new(chr2, "gene", 100, 500, GT_STRAND_FORWARD);
+    gt_feature_node_add_attribute((GtFeatureNode *)gn, "ID", "gene1");
+    GtGenomeNode *mrna = gt_feature_node_new(chr2, "mRNA", 100, 500,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_attribute((GtFeatureNode *)mrna, "ID", "mRNA1");
+    gt_feature_node_add_child((GtFeatureNode *)gn, (GtFeatureNode *)mrna);
+    gt_array_add(nodes, gn);
+    gn = gt_feature_node_new(chr1, "gene", 800, 900, GT_STRAND_REVERSE);
+    gt_array_add(nodes, gn);
+    // Parent features without IDs must not be given any
+    gn = gt_feature_node_new(chr1, "gene", 100, 300, GT_STRAND_FORWARD);
+    mrna = gt_feature_node_new(chr1, "mRNA", 100, 300, GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)gn, (GtFeatureNode *)mrna);
+    GtGenomeNode *exon = gt_feature_node_new(chr1, "exon", 100, 300,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)exon);
+    gt_array_add(nodes, gn);
+    gn = gt_feature_node_new(chr1, "gene", 100, 200, GT_STRAND_FORWARD);
+    gt_array_add(nodes, gn);
+    gn = gt_feature_node_new(chr2, "gene", 50, 80, GT_STRAND_REVERSE);
+    gt_array_add(nodes, gn);
+
+    // Each feature's line number is set to its start coordinate
+    GtUword j;
+    for(j = 2; j < gt_array_size(nodes); j++)
+    {
+      GtFeatureNode **fn = gt_array_get(nodes, j);
+      GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(*fn);
+      GtFeatureNode *feature;
+      for(feature  = gt_feature_node_iterator_next(iter);
+          feature != NULL;
+          feature  = gt_feature_node_iterator_next(iter))
+      {
+        GtGenomeNode *fgn = (GtGenomeNode *)feature;
+        gt_genome_node_set_origin(fgn, origin, gt_genome_node_get_start(fgn));
+      }
+      gt_feature_node_iterator_delete(iter);
+    }
+
+    bool result = external_sort_stream_test(nodes, budgets[i], 5, 8, 2);
+    agn_unit_test_result(test, labels[i], result);
+    gt_array_delete(nodes);
+  }
+
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+  gt_str_delete(origin);
+  return agn_unit_test_success(test);
+}
+
+static void external_sort_stream_attribute_size(const char *key,
+                                                const char *value, void *data)
+{
+  GtUword *size = data;
+  *size += strlen(key) + strlen(value) + 2;
+}
+
+static const GtNodeStreamClass *external_sort_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnExternalSortStream),
+                                   external_sort_stream_free,
+                                   external_sort_stream_next);
+  }
+  return nsc;
+}
+
+static void external_sort_stream_free(GtNodeStream *ns)
+{
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+
+  GtUword i;
+  for(i = stream->memindex; i < gt_array_size(stream->memory); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(stream->memory, i);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(stream->memory);
+  for(i = 0; i < gt_array_size(stream->others); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(stream->others, i);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(stream->others);
+
+  for(i = 0; i < gt_array_size(stream->runs); i++)
+  {
+    GtNodeStream **run = gt_array_get(stream->runs, i);
+    GtGenomeNode **head = gt_array_get(stream->heads, i);
+    if(*head != NULL)
+      gt_genome_node_delete(*head);
+    gt_node_stream_delete(*run);
+  }
+  gt_array_delete(stream->runs);
+  gt_array_delete(stream->heads);
+
+  for(i = 0; i < gt_str_array_size(stream->runfiles); i++)
+    unlink(gt_str_array_get(stream->runfiles, i));
+  gt_str_array_delete(stream->runfiles);
+  for(i = 0; i < gt_array_size(stream->origins); i++)
+    gt_str_delete(*(GtStr **)gt_array_get(stream->origins, i));
+  gt_array_delete(stream->origins);
+}
+
+static int external_sort_stream_load(AgnExternalSortStream *stream,
+                                     GtError *error)
+{
+  GtGenomeNode *gn;
+  int had_err;
+  while((had_err = gt_node_stream_next(stream->in_stream, &gn, error)) == 0 &&
+        gn != NULL)
+  {
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+    {
+      gt_array_add(stream->others, gn);
+      continue;
+    }
+
+    gt_array_add(stream->memory, gn);
+    stream->size += external_sort_stream_tree_size(fn);
+    if(stream->size >= stream->budget)
+    {
+      if(external_sort_stream_spill(stream, error))
+        return -1;
+    }
+  }
+  if(had_err)
+    return had_err;
+
+  // Nodes that stay in memory are sorted together, as in a GtSortStream
+  gt_array_add_array(stream->memory, stream->others);
+  gt_array_reset(stream->others);
+  gt_array_sort_stable(stream->memory, (GtCompare)agn_genome_node_compare);
+
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(stream->runfiles); i++)
+  {
+    GtNodeStream *run = gt_gff3_in_stream_new_sorted(
+                            gt_str_array_get(stream->runfiles, i));
+    GtGenomeNode *head = NULL;
+    gt_array_add(stream->runs, run);
+    gt_array_add(stream->heads, head);
+    if(external_sort_stream_run_next(stream, i, error))
+      return -1;
+  }
+  return 0;
+}
+
+static int external_sort_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error)
+{
+  gt_error_check(error);
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+  if(!stream->loaded)
+  {
+    stream->loaded = true;
+    if(external_sort_stream_load(stream, error))
+      return -1;
+  }
+
+  // Ties go to the earliest run, and the nodes in memory were read last
+  GtUword i, numruns = gt_array_size(stream->runs), minindex = numruns;
+  GtGenomeNode *min = NULL;
+  for(i = 0; i < numruns; i++)
+  {
+    GtGenomeNode **head = gt_array_get(stream->heads, i);
+    if(*head != NULL && (min == NULL || gt_genome_node_cmp(*head, min) < 0))
+    {
+      min = *head;
+      minindex = i;
+    }
+  }
+  if(stream->memindex < gt_array_size(stream->memory))
+  {
+    GtGenomeNode **next = gt_array_get(stream->memory, stream->memindex);
+    if(min == NULL || gt_genome_node_cmp(*next, min) < 0)
+    {
+      stream->memindex++;
+      *gn = *next;
+      return 0;
+    }
+  }
+
+  *gn = min;
+  if(min != NULL)
+    return external_sort_stream_run_next(stream, minindex, error);
+  return 0;
+}
+
+static void external_sort_stream_restore(AgnExternalSortStream *stream,
+                                         GtFeatureNode *fn)
+{
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    // Features with multiple parents are visited more than once
+    const char *origin = gt_feature_node_get_attribute(feature,
+                                                       EXTERNAL_SORT_ORIGIN_KEY);
+    if(origin == NULL)
+      continue;
+    GtUword index, line;
+    int tempid;
+    if(sscanf(origin, "%lu:%lu:%d", &index, &line, &tempid) == 3 &&
+       index < gt_array_size(stream->origins))
+    {
+      GtStr *filename = *(GtStr **)gt_array_get(stream->origins, index);
+      gt_genome_node_set_origin((GtGenomeNode *)feature, filename, line);
+      if(tempid && gt_feature_node_get_attribute(feature, "ID") != NULL)
+        gt_feature_node_remove_attribute(feature, "ID");
+    }
+    gt_feature_node_remove_attribute(feature, EXTERNAL_SORT_ORIGIN_KEY);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  // Pseudo-features are not written, and take the origin of their first child
+  if(gt_feature_node_is_pseudo(fn))
+  {
+    iter = gt_feature_node_iterator_new_direct(fn);
+    GtGenomeNode *child = (GtGenomeNode *)gt_feature_node_iterator_next(iter);
+    gt_feature_node_iterator_delete(iter);
+    if(child != NULL)
+    {
+      GtStr *filename = gt_str_new_cstr(gt_genome_node_get_filename(child));
+      gt_genome_node_set_origin((GtGenomeNode *)fn, filename,
+                                gt_genome_node_get_line_number(child));
+      gt_str_delete(filename);
+    }
+  }
+}
+
+static int external_sort_stream_run_next(AgnExternalSortStream *stream,
+                                         GtUword runindex, GtError *error)
+{
+  GtNodeStream **run = gt_array_get(stream->runs, runindex);
+  GtGenomeNode **head = gt_array_get(stream->heads, runindex);
+  *head = NULL;
+  while(1)
+  {
+    GtGenomeNode *gn;
+    int had_err = gt_node_stream_next(*run, &gn, error);
+    if(had_err || gn == NULL)
+      return had_err;
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn != NULL)
+    {
+      external_sort_stream_restore(stream, fn);
+      *head = gn;
+      return 0;
+    }
+    gt_genome_node_delete(gn);
+  }
+}
+
+static int external_sort_stream_spill(AgnExternalSortStream *stream,
+                                      GtError *error)
+{
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *runfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(runfile, "/aegean-sort-XXXXXX");
+  int fd = mkstemp(gt_str_get(runfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "w");
+  if(outstream == NULL)
+  {
+    gt_error_set(error, "could not create temporary file '%s'",
+                 gt_str_get(runfile));
+    if(fd >= 0)
+    {
+      close(fd);
+      unlink(gt_str_get(runfile));
+    }
+    gt_str_delete(runfile);
+    return -1;
+  }
+  gt_str_array_add(stream->runfiles, runfile);
+
+  gt_array_sort_stable(stream->memory, (GtCompare)agn_genome_node_compare);
+  GtFile *outfile = gt_file_new_from_fileptr(outstream);
+  GtNodeVisitor *nv = gt_gff3_visitor_new(outfile);
+  gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)nv);
+  int had_err = 0;
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->memory); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(stream->memory, i);
+    external_sort_stream_tag(stream, gt_feature_node_cast(*gn));
+    if(!had_err)
+      had_err = gt_genome_node_accept(*gn, nv, error);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_reset(stream->memory);
+  stream->size = 0;
+  gt_node_visitor_delete(nv);
+  gt_file_delete_without_handle(outfile);
+
+  if(fclose(outstream) != 0 && !had_err)
+  {
+    gt_error_set(error, "could not write temporary file '%s'",
+                 gt_str_get(runfile));
+    had_err = -1;
+  }
+  gt_str_delete(runfile);
+  return had_err;
+}
+
+static void external_sort_stream_tag(AgnExternalSortStream *stream,
+                                     GtFeatureNode *fn)
+{
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    // There are rarely more than a few input files, and features from the
+    // same file tend to be spilled together
+    GtGenomeNode *gn = (GtGenomeNode *)feature;
+    const char *filename = gt_genome_node_get_filename(gn);
+    GtUword index = gt_array_size(stream->origins);
+    while(index > 0)
+    {
+      GtStr **origin = gt_array_get(stream->origins, index - 1);
+      if(strcmp(gt_str_get(*origin), filename) == 0)
+        break;
+      index--;
+    }
+    if(index == 0)
+    {
+      GtStr *origin = gt_str_new_cstr(filename);
+      gt_array_add(stream->origins, origin);
+      index = gt_array_size(stream->origins);
+    }
+
+    // The segments of a multi-feature share the ID of its representative
+    bool tempid = false;
+    if(gt_feature_node_get_attribute(feature, "ID") == NULL &&
+       (gt_feature_node_number_of_children(feature) > 0 ||
+        gt_feature_node_is_multi(feature)))
+    {
+      tempid = true;
+      if(!gt_feature_node_is_multi(feature) ||
+         gt_feature_node_get_multi_representative(feature) == feature)
+      {
+        char id[64];
+        sprintf(id, "%s%lu", EXTERNAL_SORT_ID_PREFIX, stream->numids++);
+        gt_feature_node_add_attribute(feature, "ID", id);
+      }
+    }
+
+    char origin[64];
+    sprintf(origin, "%lu:%lu:%d", index - 1,
+            gt_genome_node_get_line_number(gn), tempid);
+    gt_feature_node_set_attribute(feature, EXTERNAL_SORT_ORIGIN_KEY, origin);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+static bool external_sort_stream_test(GtArray *nodes, GtUword budget,
+                                      GtUword numfeatures, GtUword numnodes,
+                                      GtUword numids)
+{
+  GtError *error = gt_error_new();
+  GtUword progress;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *ess = agn_external_sort_stream_new(ais, budget);
+
+  GtUword featcount = 0, nodecount = 0, idcount = 0, regioncount = 0;
+  GtGenomeNode *gn, *prev = NULL;
+  bool sorted = true, origins = true;
+  int had_err;
+  while((had_err = gt_node_stream_next(ess, &gn, error)) == 0 && gn != NULL)
+  {
+    if(prev != NULL && gt_genome_node_cmp(prev, gn) > 0)
+      sorted = false;
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn != NULL)
+    {
+      featcount++;
+      GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+      GtFeatureNode *feature;
+      for(feature  = gt_feature_node_iterator_next(iter);
+          feature != NULL;
+          feature  = gt_feature_node_iterator_next(iter))
+      {
+        GtGenomeNode *fgn = (GtGenomeNode *)feature;
+        nodecount++;
+        if(gt_feature_node_get_attribute(feature, "ID") != NULL)
+          idcount++;
+        if(strcmp(gt_genome_node_get_filename(fgn), "test.gff3") != 0 ||
+           gt_genome_node_get_line_number(fgn) !=
+           gt_genome_node_get_start(fgn) ||
+           gt_feature_node_get_attribute(feature,
+                                         EXTERNAL_SORT_ORIGIN_KEY) != NULL)
+        {
+          origins = false;
+        }
+      }
+      gt_feature_node_iterator_delete(iter);
+    }
+    else if(gt_region_node_try_cast(gn) != NULL)
+      regioncount++;
+    if(prev != NULL)
+      gt_genome_node_delete(prev);
+    prev = gn;
+  }
+  if(prev != NULL)
+    gt_genome_node_delete(prev);
+  if(had_err)
+  {
+    fprintf(stderr, "[AgnExternalSortStream::external_sort_stream_test] "
+            "error sorting features: %s\n", gt_error_get(error));
+  }
+
+  gt_node_stream_delete(ess);
+  gt_node_stream_delete(ais);
+  gt_error_delete(error);
+  return !had_err && sorted && origins && featcount == numfeatures &&
+         nodecount == numnodes && idcount == numids && regioncount == 2;
+}
+
+static GtUword external_sort_stream_tree_size(GtFeatureNode *fn)
+{
+  GtUword size = 0;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    size += EXTERNAL_SORT_NODE_SIZE;
+    gt_feature_node_foreach_attribute(feature,
+                                      external_sort_stream_attribute_size,
+                                      &size);
+  }
+  gt_feature_node_iterator_delete(iter);
+  return size;
+}
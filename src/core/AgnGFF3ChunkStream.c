@@ -0,0 +1,1205 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/array_api.h"
+#include "core/cstr_api.h"
+#include "core/file_api.h"
+#include "core/hashmap_api.h"
+#include "core/ma_api.h"
+#include "core/str_array_api.h"
+#include "core/thread_api.h"
+#include "extended/feature_node_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "extended/region_node_api.h"
+#include "AgnGFF3ChunkStream.h"
+#include "AgnUtils.h"
+
+#define gff3_chunk_stream_cast(GS)\
+        gt_node_stream_cast(gff3_chunk_stream_class(), GS)
+
+#define GFF3_CHUNK_STREAM_MIN_SIZE 1048576
+#define GFF3_CHUNK_STREAM_CHUNKS_PER_WORKER 4
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * @type Byte range of a chunk in the mapped file, ``end`` exclusive, and the
+ * number of its first line.
+ */
+typedef struct
+{
+  GtUword start;
+  GtUword end;
+  GtUword line;
+} GFF3Chunk;
+
+/**
+ * @type Sequence seen while scanning a file. The range of an undeclared
+ * sequence spans all of its features, and is only valid if ``ranged`` is set.
+ */
+typedef struct
+{
+  GtRange range;
+  bool declared;
+  bool ranged;
+} GFF3ChunkSeqid;
+
+/**
+ * @type Each worker parses the chunk with index ``chunk`` and stores the
+ * resulting nodes in ``output``.
+ */
+typedef struct
+{
+  AgnGFF3ChunkStream *stream;
+  GtUword chunk;
+  GtArray *output;
+  GtError *error;
+  int had_err;
+} GFF3ChunkWorker;
+
+/**
+ * The current file is either parsed by the ``serial`` parser, or mapped into
+ * memory at ``data`` and split into ``chunks``; the file header, ending at
+ * ``bodystart``, is only given to the first chunk, while the ``declared`` and
+ * ``implied`` sequence region pragmas (``numdeclared`` and ``numimplied``
+ * lines) are given to all of them. Parsed nodes are given ``origin``, the name
+ * of the current file, in place of the temporary file name, and the ``ids``
+ * of the current file map each ID to the line on which it was first used, so
+ * that IDs can be checked across chunks. The output of
+ * the current round is delivered from ``numactive`` workers, starting with
+ * node ``nextnode`` of worker ``nextworker``.
+ */
+struct AgnGFF3ChunkStream
+{
+  const GtNodeStream parent_instance;
+  GtStrArray *infiles;
+  GtUword nextfile;
+  bool sorted;
+  GtUword chunksize;
+  GtNodeStream *serial;
+  GtStr *origin;
+  GtHashmap *ids;
+  const char *data;
+  GtUword size;
+  GtUword bodystart;
+  GtStr *declared;
+  GtStr *implied;
+  GtUword numdeclared;
+  GtUword numimplied;
+  GtArray *chunks;
+  GtUword nextchunk;
+  GFF3ChunkWorker *workers;
+  GtUword numworkers;
+  GtUword numactive;
+  GtUword nextworker;
+  GtUword nextnode;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Check that the IDs of the given feature and its subfeatures have
+ * not been used by an earlier feature of the current file.
+ */
+static int gff3_chunk_stream_check_ids(AgnGFF3ChunkStream *stream,
+                                       GtGenomeNode *gn, GtError *error);
+
+/**
+ * @function Delete all nodes of the current round that have not yet been
+ * delivered.
+ */
+static void gff3_chunk_stream_clear(AgnGFF3ChunkStream *stream);
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* gff3_chunk_stream_class(void);
+
+/**
+ * @function Unmap the current file and discard its chunks.
+ */
+static void gff3_chunk_stream_close(AgnGFF3ChunkStream *stream);
+
+/**
+ * @function Parse the start and end coordinates (columns 4 and 5) of the
+ * feature line ending at ``eol``. Returns false if the line is malformed.
+ */
+static bool gff3_chunk_stream_coords(const char *line, const char *eol,
+                                     GtRange *range);
+
+/**
+ * @function Rewrite a parser error message for the given chunk, replacing the
+ * name of the temporary file with that of the original file and line numbers
+ * in the temporary file with those in the original file.
+ */
+static void gff3_chunk_stream_error(AgnGFF3ChunkStream *stream,
+                                    GFF3Chunk *chunk, const char *tempfile,
+                                    GtError *error);
+
+/**
+ * @function Class destructor.
+ */
+static void gff3_chunk_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Map a line number in the temporary file of the given chunk to the
+ * corresponding line number in the original file, or 0 for lines that were
+ * added to the chunk's header.
+ */
+static GtUword gff3_chunk_stream_line(AgnGFF3ChunkStream *stream,
+                                      GFF3Chunk *chunk, GtUword line);
+
+/**
+ * @function Pulls nodes from the workers' output, parsing a new round of
+ * chunks whenever the previous one is exhausted and opening the next file
+ * whenever the current one is exhausted.
+ */
+static int gff3_chunk_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error);
+
+/**
+ * @function Open the next input file, either mapping it and splitting it into
+ * chunks or creating a serial parser for it.
+ */
+static void gff3_chunk_stream_open(AgnGFF3ChunkStream *stream);
+
+/**
+ * @function Create a GenomeTools GFF3 parser for the given file.
+ */
+static GtNodeStream *gff3_chunk_stream_parser(const char *filename,
+                                              bool sorted);
+
+/**
+ * @function Determine whether the line ending at ``eol`` is the given pragma,
+ * alone or followed by whitespace.
+ */
+static bool gff3_chunk_stream_pragma(const char *line, const char *eol,
+                                     const char *pragma);
+
+/**
+ * @function Give the node, and all of its subfeatures, the name of the
+ * original file and the number of the corresponding line in it (0 for lines
+ * that were added to the chunk's header).
+ */
+static void gff3_chunk_stream_restore(AgnGFF3ChunkStream *stream,
+                                      GFF3Chunk *chunk, GtGenomeNode *gn);
+
+/**
+ * @function Parse the next round of chunks, one per worker.
+ */
+static int gff3_chunk_stream_round(AgnGFF3ChunkStream *stream,
+                                   GtError *error);
+
+/**
+ * @function Scan the mapped file, recording chunk boundaries and sequence
+ * regions. Returns false if the file cannot be split into several chunks.
+ */
+static bool gff3_chunk_stream_scan(AgnGFF3ChunkStream *stream);
+
+/**
+ * @function Look up (or create) the entry for the given sequence ID.
+ */
+static GFF3ChunkSeqid *gff3_chunk_stream_seqid(GtHashmap *seqids,
+                                               GtStrArray *order,
+                                               const char *seqid,
+                                               GtUword length);
+
+/**
+ * @function Compare the nodes produced by two runs: features (including their
+ * file names and line numbers) position by position, and sequence regions by
+ * sequence ID.
+ */
+static bool gff3_chunk_stream_test_compare(GtArray *nodes1, GtArray *nodes2);
+
+/**
+ * @function Parse the given GFF3 file, either with a single GenomeTools parser
+ * or with a chunk stream running the given number of threads on the smallest
+ * possible chunks, discarding all nodes. Returns the parser's status.
+ */
+static int gff3_chunk_stream_test_error(const char *filename,
+                                        GtUword numthreads, GtError *error);
+
+/**
+ * @function Write the given GFF3 data to a temporary file for unit testing,
+ * and return the name of the file (or NULL if it could not be written).
+ */
+static GtStr *gff3_chunk_stream_test_file(const char *data);
+
+/**
+ * @function Load all nodes of a GFF3 file, parsed either with a single
+ * GenomeTools parser or with a chunk stream running the given number of
+ * threads on chunks of (at least) the given size.
+ */
+static GtArray *gff3_chunk_stream_test_load(const char *filename,
+                                            GtUword numthreads,
+                                            GtUword chunksize);
+
+/**
+ * @function Delete the nodes loaded for unit testing.
+ */
+static void gff3_chunk_stream_test_unload(GtArray *nodes);
+
+/**
+ * @function Thread function for parsing a worker's chunk.
+ */
+static void *gff3_chunk_stream_worker(void *data);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_gff3_chunk_stream_new(int numfiles, const char **filenames,
+                                        bool sorted, GtUword numthreads)
+{
+  agn_assert(numthreads > 0);
+  GtNodeStream *ns = gt_node_stream_create(gff3_chunk_stream_class(), sorted);
+  AgnGFF3ChunkStream *stream = gff3_chunk_stream_cast(ns);
+  stream->infiles = gt_str_array_new();
+  int i;
+  for(i = 0; i < numfiles; i++)
+    gt_str_array_add_cstr(stream->infiles, filenames[i]);
+  if(numfiles == 0)
+    gt_str_array_add_cstr(stream->infiles, "-");
+  stream->nextfile = 0;
+  stream->sorted = sorted;
+  stream->chunksize = 0;
+  stream->serial = NULL;
+  stream->origin = NULL;
+  stream->ids = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  stream->data = NULL;
+  stream->size = 0;
+  stream->bodystart = 0;
+  stream->declared = gt_str_new();
+  stream->implied = gt_str_new();
+  stream->numdeclared = 0;
+  stream->numimplied = 0;
+  stream->chunks = gt_array_new( sizeof(GFF3Chunk) );
+  stream->nextchunk = 0;
+
+  GtUword j;
+  stream->numworkers = numthreads;
+  stream->workers = gt_malloc( sizeof(GFF3ChunkWorker) * numthreads );
+  for(j = 0; j < numthreads; j++)
+  {
+    GFF3ChunkWorker *worker = stream->workers + j;
+    worker->stream = stream;
+    worker->chunk = 0;
+    worker->output = gt_array_new( sizeof(GtGenomeNode *) );
+    worker->error = gt_error_new();
+    worker->had_err = 0;
+  }
+  stream->numactive = 0;
+  stream->nextworker = 0;
+  stream->nextnode = 0;
+  return ns;
+}
+
+bool agn_gff3_chunk_stream_unit_test(AgnUnitTest *test)
+{
+  const char *filename = "data/gff3/grape-refr.gff3";
+  GtArray *serial = gff3_chunk_stream_test_load(filename, 0, 0);
+  GtArray *single = gff3_chunk_stream_test_load(filename, 1, 1);
+  GtArray *parallel = gff3_chunk_stream_test_load(filename, 3, 1);
+  bool test1 = gt_array_size(serial) > 0 &&
+               gff3_chunk_stream_test_compare(serial, single);
+  agn_unit_test_result(test, "grape: single worker", test1);
+  bool test2 = gff3_chunk_stream_test_compare(serial, parallel);
+  agn_unit_test_result(test, "grape: three workers", test2);
+  gff3_chunk_stream_test_unload(serial);
+  gff3_chunk_stream_test_unload(single);
+  gff3_chunk_stream_test_unload(parallel);
+
+  filename = "data/gff3/amel-ogs-g7.gff3";
+  serial = gff3_chunk_stream_test_load(filename, 0, 0);
+  parallel = gff3_chunk_stream_test_load(filename, 4, 4096);
+  bool test3 = gt_array_size(serial) > 0 &&
+               gff3_chunk_stream_test_compare(serial, parallel);
+  agn_unit_test_result(test, "Amel: several sequences", test3);
+  gff3_chunk_stream_test_unload(serial);
+  gff3_chunk_stream_test_unload(parallel);
+
+  // Same data without the sequence region pragma
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *tempfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(tempfile, "/aegean-chunk-XXXXXX");
+  int fd = mkstemp(gt_str_get(tempfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "w");
+  FILE *instream = fopen("data/gff3/grape-refr.gff3", "r");
+  bool test4 = outstream != NULL && instream != NULL;
+  if(test4)
+  {
+    char buffer[4096];
+    while(fgets(buffer, sizeof(buffer), instream) != NULL)
+    {
+      if(strncmp(buffer, "##sequence-region", 17) != 0)
+        fputs(buffer, outstream);
+    }
+    fclose(outstream);
+    outstream = NULL;
+    filename = gt_str_get(tempfile);
+    serial = gff3_chunk_stream_test_load(filename, 0, 0);
+    parallel = gff3_chunk_stream_test_load(filename, 3, 1);
+    test4 = gt_array_size(serial) > 0 &&
+            gff3_chunk_stream_test_compare(serial, parallel);
+    gff3_chunk_stream_test_unload(serial);
+    gff3_chunk_stream_test_unload(parallel);
+  }
+  agn_unit_test_result(test, "grape: implied sequence region", test4);
+  if(instream != NULL)
+    fclose(instream);
+  if(outstream != NULL)
+    fclose(outstream);
+  if(fd >= 0)
+    unlink(gt_str_get(tempfile));
+  gt_str_delete(tempfile);
+
+  // Error messages refer to the input file, as with a single parser
+  GtError *error1 = gt_error_new();
+  GtError *error2 = gt_error_new();
+  tempfile = gff3_chunk_stream_test_file(
+      "##gff-version   3\n"
+      "##sequence-region   chr1 1 10000\n"
+      "chr1\ttest\tgene\t1000\t2000\t.\t+\t.\tID=gene1\n"
+      "###\n"
+      "chr1\ttest\tgene\t3000\t4000\t.\t+\t.\tID=gene2\n"
+      "chr1\ttest\tgene\t3000\n"
+      "###\n");
+  bool test5 = tempfile != NULL &&
+               gff3_chunk_stream_test_error(gt_str_get(tempfile), 0,
+                                            error1) != 0 &&
+               gff3_chunk_stream_test_error(gt_str_get(tempfile), 2,
+                                            error2) != 0 &&
+               strcmp(gt_error_get(error1), gt_error_get(error2)) == 0;
+  agn_unit_test_result(test, "error messages", test5);
+  if(tempfile != NULL)
+    unlink(gt_str_get(tempfile));
+  gt_str_delete(tempfile);
+
+  // IDs must be unique across chunks, as with a single parser
+  gt_error_unset(error1);
+  gt_error_unset(error2);
+  tempfile = gff3_chunk_stream_test_file(
+      "##gff-version   3\n"
+      "##sequence-region   chr1 1 10000\n"
+      "chr1\ttest\tgene\t1000\t2000\t.\t+\t.\tID=gene1\n"
+      "###\n"
+      "chr1\ttest\tgene\t3000\t4000\t.\t+\t.\tID=gene2\n"
+      "###\n"
+      "chr1\ttest\tgene\t5000\t6000\t.\t+\t.\tID=gene1\n"
+      "###\n");
+  bool test6 = tempfile != NULL &&
+               gff3_chunk_stream_test_error(gt_str_get(tempfile), 0,
+                                            error1) != 0 &&
+               gff3_chunk_stream_test_error(gt_str_get(tempfile), 3,
+                                            error2) != 0 &&
+               strstr(gt_error_get(error2), "line 7") != NULL &&
+               strstr(gt_error_get(error2), "line 3") != NULL &&
+               strstr(gt_error_get(error2), gt_str_get(tempfile)) != NULL;
+  agn_unit_test_result(test, "duplicate IDs", test6);
+  if(tempfile != NULL)
+    unlink(gt_str_get(tempfile));
+  gt_str_delete(tempfile);
+  gt_error_delete(error1);
+  gt_error_delete(error2);
+
+  return agn_unit_test_success(test);
+}
+
+static int gff3_chunk_stream_check_ids(AgnGFF3ChunkStream *stream,
+                                       GtGenomeNode *gn, GtError *error)
+{
+  GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+  if(fn == NULL)
+    return 0;
+
+  int had_err = 0;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL && !had_err;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    // Segments of a multi-feature share its ID, and features with several
+    // parents are visited more than once
+    const char *id = gt_feature_node_get_attribute(feature, "ID");
+    if(id == NULL || (gt_feature_node_is_multi(feature) &&
+                      gt_feature_node_get_multi_representative(feature) !=
+                      feature))
+    {
+      continue;
+    }
+    GtUword line = gt_genome_node_get_line_number((GtGenomeNode *)feature);
+    GtUword *firstline = gt_hashmap_get(stream->ids, id);
+    if(firstline == NULL)
+    {
+      firstline = gt_malloc( sizeof(GtUword) );
+      *firstline = line;
+      gt_hashmap_add(stream->ids, gt_cstr_dup(id), firstline);
+    }
+    else if(*firstline != line)
+    {
+      gt_error_set(error, "the feature with ID \"%s\" on line %lu in file "
+                   "\"%s\" has the same ID as the feature on line %lu", id,
+                   line, gt_str_get(stream->origin), *firstline);
+      had_err = -1;
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+  return had_err;
+}
+
+static void gff3_chunk_stream_clear(AgnGFF3ChunkStream *stream)
+{
+  GtUword i, j;
+  for(i = stream->nextworker; i < stream->numactive; i++)
+  {
+    GFF3ChunkWorker *worker = stream->workers + i;
+    j = i == stream->nextworker ? stream->nextnode : 0;
+    for(; j < gt_array_size(worker->output); j++)
+    {
+      GtGenomeNode **gn = gt_array_get(worker->output, j);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_reset(worker->output);
+  }
+  stream->numactive = 0;
+  stream->nextworker = 0;
+  stream->nextnode = 0;
+}
+
+static const GtNodeStreamClass *gff3_chunk_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnGFF3ChunkStream),
+                                   gff3_chunk_stream_free,
+                                   gff3_chunk_stream_next);
+  }
+  return nsc;
+}
+
+static void gff3_chunk_stream_close(AgnGFF3ChunkStream *stream)
+{
+  if(stream->data != NULL)
+    munmap((void *)stream->data, stream->size);
+  stream->data = NULL;
+  stream->size = 0;
+  stream->bodystart = 0;
+  gt_str_reset(stream->declared);
+  gt_str_reset(stream->implied);
+  gt_hashmap_reset(stream->ids);
+  stream->numdeclared = 0;
+  stream->numimplied = 0;
+  gt_array_reset(stream->chunks);
+  stream->nextchunk = 0;
+}
+
+static bool gff3_chunk_stream_coords(const char *line, const char *eol,
+                                     GtRange *range)
+{
+  int numtabs = 0;
+  const char *col = line;
+  while(numtabs < 3 && (col = memchr(col, '\t', eol - col)) != NULL)
+  {
+    col++;
+    numtabs++;
+  }
+  if(numtabs < 3)
+    return false;
+
+  GtUword values[2] = { 0, 0 };
+  int i;
+  for(i = 0; i < 2; i++)
+  {
+    const char *digits = col;
+    while(col < eol && *col >= '0' && *col <= '9')
+      values[i] = values[i] * 10 + (*col++ - '0');
+    if(col == digits || col == eol || *col != '\t')
+      return false;
+    col++;
+  }
+  if(values[0] == 0 || values[0] > values[1])
+    return false;
+  range->start = values[0];
+  range->end = values[1];
+  return true;
+}
+
+static void gff3_chunk_stream_error(AgnGFF3ChunkStream *stream,
+                                    GFF3Chunk *chunk, const char *tempfile,
+                                    GtError *error)
+{
+  GtStr *message = gt_str_new();
+  const char *c = gt_error_get(error);
+  size_t templength = strlen(tempfile);
+  while(*c != '\0')
+  {
+    if(strncmp(c, tempfile, templength) == 0)
+    {
+      gt_str_append_str(message, stream->origin);
+      c += templength;
+    }
+    else if(strncmp(c, "line ", 5) == 0 && c[5] >= '0' && c[5] <= '9')
+    {
+      char *end;
+      GtUword line = strtoul(c + 5, &end, 10);
+      gt_str_append_cstr(message, "line ");
+      gt_str_append_uword(message, gff3_chunk_stream_line(stream, chunk,
+                                                           line));
+      c = end;
+    }
+    else
+      gt_str_append_char(message, *c++);
+  }
+  gt_error_set(error, "%s", gt_str_get(message));
+  gt_str_delete(message);
+}
+
+static void gff3_chunk_stream_free(GtNodeStream *ns)
+{
+  AgnGFF3ChunkStream *stream = gff3_chunk_stream_cast(ns);
+  gff3_chunk_stream_clear(stream);
+  gff3_chunk_stream_close(stream);
+  if(stream->serial != NULL)
+    gt_node_stream_delete(stream->serial);
+
+  GtUword i;
+  for(i = 0; i < stream->numworkers; i++)
+  {
+    gt_array_delete(stream->workers[i].output);
+    gt_error_delete(stream->workers[i].error);
+  }
+  gt_free(stream->workers);
+  gt_array_delete(stream->chunks);
+  gt_str_delete(stream->declared);
+  gt_str_delete(stream->implied);
+  gt_str_delete(stream->origin);
+  gt_hashmap_delete(stream->ids);
+  gt_str_array_delete(stream->infiles);
+}
+
+static GtUword gff3_chunk_stream_line(AgnGFF3ChunkStream *stream,
+                                      GFF3Chunk *chunk, GtUword line)
+{
+  // The first chunk keeps the file header, ahead of the implied regions
+  GtUword headerlines = 1 + stream->numdeclared + stream->numimplied;
+  if(chunk->start == stream->bodystart)
+    headerlines = chunk->line - 1 + stream->numimplied;
+  if(line > headerlines)
+    return line - headerlines + chunk->line - 1;
+  if(chunk->start == stream->bodystart && line < chunk->line)
+    return line;
+  return 0;
+}
+
+static int gff3_chunk_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error)
+{
+  gt_error_check(error);
+  AgnGFF3ChunkStream *stream = gff3_chunk_stream_cast(ns);
+  while(1)
+  {
+    if(stream->serial != NULL)
+    {
+      int had_err = gt_node_stream_next(stream->serial, gn, error);
+      if(had_err || *gn != NULL)
+        return had_err;
+      gt_node_stream_delete(stream->serial);
+      stream->serial = NULL;
+    }
+
+    while(stream->nextworker < stream->numactive)
+    {
+      GFF3ChunkWorker *worker = stream->workers + stream->nextworker;
+      if(stream->nextnode < gt_array_size(worker->output))
+      {
+        GtGenomeNode **outnode = gt_array_get(worker->output,
+                                              stream->nextnode++);
+        *gn = *outnode;
+        return 0;
+      }
+      gt_array_reset(worker->output);
+      stream->nextworker++;
+      stream->nextnode = 0;
+    }
+
+    if(stream->nextchunk < gt_array_size(stream->chunks))
+    {
+      int had_err = gff3_chunk_stream_round(stream, error);
+      if(had_err)
+      {
+        gff3_chunk_stream_clear(stream);
+        *gn = NULL;
+        return had_err;
+      }
+      continue;
+    }
+    gff3_chunk_stream_close(stream);
+
+    if(stream->nextfile < gt_str_array_size(stream->infiles))
+    {
+      gff3_chunk_stream_open(stream);
+      continue;
+    }
+    *gn = NULL;
+    return 0;
+  }
+}
+
+static void gff3_chunk_stream_open(AgnGFF3ChunkStream *stream)
+{
+  const char *filename = gt_str_array_get(stream->infiles,
+                                          stream->nextfile++);
+  gt_str_delete(stream->origin);
+  stream->origin = gt_str_new_cstr(filename);
+
+  // Anything that cannot be mapped is left to the parser, which also reports
+  // missing or unreadable files
+  int fd = -1;
+  struct stat filestat;
+  if(strcmp(filename, "-") != 0 &&
+     gt_file_mode_determine(filename) == GT_FILE_MODE_UNCOMPRESSED)
+    fd = open(filename, O_RDONLY);
+  if(fd >= 0 && fstat(fd, &filestat) == 0 && S_ISREG(filestat.st_mode) &&
+     filestat.st_size > 0)
+  {
+    void *data = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data != MAP_FAILED)
+    {
+      stream->data = data;
+      stream->size = filestat.st_size;
+    }
+  }
+  if(fd >= 0)
+    close(fd);
+
+  if(stream->data != NULL && gff3_chunk_stream_scan(stream))
+    return;
+  gff3_chunk_stream_close(stream);
+  stream->serial = gff3_chunk_stream_parser(filename, stream->sorted);
+}
+
+static GtNodeStream *gff3_chunk_stream_parser(const char *filename,
+                                              bool sorted)
+{
+  GtNodeStream *parser;
+  if(sorted)
+    parser = gt_gff3_in_stream_new_sorted(filename);
+  else
+    parser = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)parser);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)parser);
+  return parser;
+}
+
+static bool gff3_chunk_stream_pragma(const char *line, const char *eol,
+                                     const char *pragma)
+{
+  size_t length = strlen(pragma);
+  if((size_t)(eol - line) < length || strncmp(line, pragma, length) != 0)
+    return false;
+  return line + length == eol || line[length] == ' ' ||
+         line[length] == '\t' || line[length] == '\r';
+}
+
+static void gff3_chunk_stream_restore(AgnGFF3ChunkStream *stream,
+                                      GFF3Chunk *chunk, GtGenomeNode *gn)
+{
+  GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+  GtFeatureNodeIterator *iter = NULL;
+  if(fn != NULL)
+    iter = gt_feature_node_iterator_new(fn);
+  GtGenomeNode *current = gn;
+  while(current != NULL)
+  {
+    // Features with several parents are visited more than once
+    if(strcmp(gt_genome_node_get_filename(current),
+              gt_str_get(stream->origin)) != 0)
+    {
+      GtUword line = gff3_chunk_stream_line(stream, chunk,
+                         gt_genome_node_get_line_number(current));
+      gt_genome_node_set_origin(current, stream->origin, line);
+    }
+    current = iter == NULL ? NULL
+            : (GtGenomeNode *)gt_feature_node_iterator_next(iter);
+  }
+  if(iter != NULL)
+    gt_feature_node_iterator_delete(iter);
+}
+
+static int gff3_chunk_stream_round(AgnGFF3ChunkStream *stream,
+                                   GtError *error)
+{
+  GtUword i, numchunks = gt_array_size(stream->chunks);
+  stream->numactive = numchunks - stream->nextchunk;
+  if(stream->numactive > stream->numworkers)
+    stream->numactive = stream->numworkers;
+  stream->nextworker = 0;
+  stream->nextnode = 0;
+  for(i = 0; i < stream->numactive; i++)
+  {
+    stream->workers[i].chunk = stream->nextchunk++;
+    gt_array_reset(stream->workers[i].output);
+  }
+
+  GtThread **threads = gt_malloc( sizeof(GtThread *) * stream->numworkers );
+  for(i = 0; i < stream->numactive; i++)
+    threads[i] = NULL;
+
+  // The calling thread parses the first chunk; if GenomeTools was compiled
+  // without thread support, gt_thread_new fails and chunks are run serially.
+  GtError *threaderror = gt_error_new();
+  for(i = 1; i < stream->numactive; i++)
+  {
+    threads[i] = gt_thread_new(gff3_chunk_stream_worker, stream->workers + i,
+                               threaderror);
+    if(threads[i] == NULL)
+    {
+      gt_error_unset(threaderror);
+      gff3_chunk_stream_worker(stream->workers + i);
+    }
+  }
+  if(stream->numactive > 0)
+    gff3_chunk_stream_worker(stream->workers);
+  for(i = 1; i < stream->numactive; i++)
+  {
+    if(threads[i] != NULL)
+    {
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
+    }
+  }
+  gt_error_delete(threaderror);
+  gt_free(threads);
+
+  // Origins are shared by all nodes of a file, so they are set here rather
+  // than by the workers; IDs are checked across chunks in file order
+  int had_err = 0;
+  for(i = 0; i < stream->numactive; i++)
+  {
+    GFF3ChunkWorker *worker = stream->workers + i;
+    GFF3Chunk *chunk = gt_array_get(stream->chunks, worker->chunk);
+    GtUword j;
+    for(j = 0; j < gt_array_size(worker->output); j++)
+    {
+      GtGenomeNode **gn = gt_array_get(worker->output, j);
+      gff3_chunk_stream_restore(stream, chunk, *gn);
+      if(!had_err)
+        had_err = gff3_chunk_stream_check_ids(stream, *gn, error);
+    }
+    if(worker->had_err && !had_err)
+    {
+      gt_error_set(error, "%s", gt_error_get(worker->error));
+      had_err = worker->had_err;
+    }
+    worker->had_err = 0;
+    gt_error_unset(worker->error);
+  }
+  return had_err;
+}
+
+static bool gff3_chunk_stream_scan(AgnGFF3ChunkStream *stream)
+{
+  GtUword chunksize = stream->chunksize;
+  if(chunksize == 0)
+  {
+    chunksize = stream->size / (stream->numworkers *
+                                GFF3_CHUNK_STREAM_CHUNKS_PER_WORKER);
+    if(chunksize < GFF3_CHUNK_STREAM_MIN_SIZE)
+      chunksize = GFF3_CHUNK_STREAM_MIN_SIZE;
+  }
+
+  GtHashmap *seqids = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                     gt_free_func);
+  GtStrArray *order = gt_str_array_new();
+  GFF3ChunkSeqid *current = NULL;
+  const char *currentid = NULL;
+  GtUword currentlength = 0;
+  bool splittable = true, body = false;
+  GFF3Chunk chunk = { 0, 0, 0 };
+  const char *data = stream->data, *end = stream->data + stream->size;
+  const char *line = data;
+  GtUword lineno = 1;
+  while(splittable && line < end)
+  {
+    const char *eol = memchr(line, '\n', end - line);
+    if(eol == NULL)
+      eol = end;
+    const char *next = eol < end ? eol + 1 : end;
+
+    // Sequence data always goes with the last chunk
+    if(*line == '>' || gff3_chunk_stream_pragma(line, eol, "##FASTA"))
+      break;
+
+    if(gff3_chunk_stream_pragma(line, eol, "###"))
+    {
+      GtUword offset = next - data;
+      if(body && next < end && offset - chunk.start >= chunksize)
+      {
+        chunk.end = offset;
+        gt_array_add(stream->chunks, chunk);
+        chunk.start = chunk.end;
+        chunk.line = lineno + 1;
+      }
+    }
+    else if(gff3_chunk_stream_pragma(line, eol, "##sequence-region"))
+    {
+      // Regions declared between features would be declared twice
+      if(body)
+        splittable = false;
+      else
+      {
+        const char *seqid = line + strlen("##sequence-region");
+        while(seqid < eol && (*seqid == ' ' || *seqid == '\t'))
+          seqid++;
+        const char *seqidend = seqid;
+        while(seqidend < eol && *seqidend != ' ' && *seqidend != '\t' &&
+              *seqidend != '\r')
+          seqidend++;
+        if(seqidend > seqid)
+        {
+          GFF3ChunkSeqid *entry = gff3_chunk_stream_seqid(seqids, NULL, seqid,
+                                                          seqidend - seqid);
+          entry->declared = true;
+        }
+        gt_str_append_cstr_nt(stream->declared, line, eol - line);
+        gt_str_append_char(stream->declared, '\n');
+        stream->numdeclared++;
+      }
+    }
+    else if(line < eol && *line != '#' && *line != '\r')
+    {
+      if(!body)
+      {
+        body = true;
+        stream->bodystart = chunk.start = line - data;
+        chunk.line = lineno;
+      }
+
+      // Consecutive features usually share a sequence
+      const char *tab = memchr(line, '\t', eol - line);
+      GtRange range;
+      if(tab != NULL && gff3_chunk_stream_coords(line, eol, &range))
+      {
+        GtUword length = tab - line;
+        if(current == NULL || length != currentlength ||
+           strncmp(line, currentid, length) != 0)
+        {
+          current = gff3_chunk_stream_seqid(seqids, order, line, length);
+          currentid = line;
+          currentlength = length;
+        }
+        if(!current->declared)
+        {
+          if(!current->ranged)
+            current->range = range;
+          current->range = gt_range_join(&current->range, &range);
+          current->ranged = true;
+        }
+      }
+    }
+    line = next;
+    lineno++;
+  }
+  if(body)
+  {
+    chunk.end = stream->size;
+    gt_array_add(stream->chunks, chunk);
+  }
+  splittable = splittable && gt_array_size(stream->chunks) > 1;
+
+  GtUword i;
+  for(i = 0; splittable && i < gt_str_array_size(order); i++)
+  {
+    const char *seqid = gt_str_array_get(order, i);
+    GFF3ChunkSeqid *entry = gt_hashmap_get(seqids, seqid);
+    if(entry->declared || !entry->ranged)
+      continue;
+    gt_str_append_cstr(stream->implied, "##sequence-region   ");
+    gt_str_append_cstr(stream->implied, seqid);
+    gt_str_append_char(stream->implied, ' ');
+    gt_str_append_uword(stream->implied, entry->range.start);
+    gt_str_append_char(stream->implied, ' ');
+    gt_str_append_uword(stream->implied, entry->range.end);
+    gt_str_append_char(stream->implied, '\n');
+    stream->numimplied++;
+  }
+  gt_hashmap_delete(seqids);
+  gt_str_array_delete(order);
+  return splittable;
+}
+
+static GFF3ChunkSeqid *gff3_chunk_stream_seqid(GtHashmap *seqids,
+                                               GtStrArray *order,
+                                               const char *seqid,
+                                               GtUword length)
+{
+  char *key = gt_cstr_dup_nt(seqid, length);
+  GFF3ChunkSeqid *entry = gt_hashmap_get(seqids, key);
+  if(entry != NULL)
+  {
+    gt_free(key);
+    return entry;
+  }
+
+  entry = gt_malloc( sizeof(GFF3ChunkSeqid) );
+  entry->range.start = 0;
+  entry->range.end = 0;
+  entry->declared = false;
+  entry->ranged = false;
+  if(order != NULL)
+    gt_str_array_add_cstr(order, key);
+  gt_hashmap_add(seqids, key, entry);
+  return entry;
+}
+
+static bool gff3_chunk_stream_test_compare(GtArray *nodes1, GtArray *nodes2)
+{
+  GtArray *feats[2], *regions[2];
+  GtArray *nodes[2] = { nodes1, nodes2 };
+  GtUword i, j;
+  for(i = 0; i < 2; i++)
+  {
+    feats[i] = gt_array_new( sizeof(GtFeatureNode *) );
+    regions[i] = gt_array_new( sizeof(GtGenomeNode *) );
+    for(j = 0; j < gt_array_size(nodes[i]); j++)
+    {
+      GtGenomeNode **gn = gt_array_get(nodes[i], j);
+      GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+      if(fn != NULL)
+        gt_array_add(feats[i], fn);
+      else if(gt_region_node_try_cast(*gn) != NULL)
+        gt_array_add(regions[i], *gn);
+    }
+  }
+
+  bool match = gt_array_size(feats[0]) == gt_array_size(feats[1]) &&
+               gt_array_size(regions[0]) == gt_array_size(regions[1]);
+  for(i = 0; match && i < gt_array_size(feats[0]); i++)
+  {
+    GtFeatureNode *fn1 = *(GtFeatureNode **)gt_array_get(feats[0], i);
+    GtFeatureNode *fn2 = *(GtFeatureNode **)gt_array_get(feats[1], i);
+    GtRange r1 = gt_genome_node_get_range((GtGenomeNode *)fn1);
+    GtRange r2 = gt_genome_node_get_range((GtGenomeNode *)fn2);
+    const char *id1 = gt_feature_node_get_attribute(fn1, "ID");
+    const char *id2 = gt_feature_node_get_attribute(fn2, "ID");
+    match = gt_range_compare(&r1, &r2) == 0 &&
+            strcmp(gt_feature_node_get_type(fn1),
+                   gt_feature_node_get_type(fn2)) == 0 &&
+            ((id1 == NULL && id2 == NULL) ||
+             (id1 != NULL && id2 != NULL && strcmp(id1, id2) == 0));
+
+    // Subfeatures must also come from the same file and line
+    GtUword count1 = 0, count2 = 0;
+    GtFeatureNodeIterator *iter1 = gt_feature_node_iterator_new(fn1);
+    GtFeatureNodeIterator *iter2 = gt_feature_node_iterator_new(fn2);
+    GtGenomeNode *gn1 = (GtGenomeNode *)fn1, *gn2 = (GtGenomeNode *)fn2;
+    while(match && gn1 != NULL && gn2 != NULL)
+    {
+      match = strcmp(gt_genome_node_get_filename(gn1),
+                     gt_genome_node_get_filename(gn2)) == 0 &&
+              gt_genome_node_get_line_number(gn1) ==
+              gt_genome_node_get_line_number(gn2);
+      gn1 = (GtGenomeNode *)gt_feature_node_iterator_next(iter1);
+      gn2 = (GtGenomeNode *)gt_feature_node_iterator_next(iter2);
+      count1 += gn1 != NULL;
+      count2 += gn2 != NULL;
+    }
+    gt_feature_node_iterator_delete(iter1);
+    gt_feature_node_iterator_delete(iter2);
+    match = match && count1 == count2;
+  }
+
+  for(i = 0; match && i < gt_array_size(regions[0]); i++)
+  {
+    GtGenomeNode **rn1 = gt_array_get(regions[0], i);
+    GtStr *seqid = gt_genome_node_get_seqid(*rn1);
+    GtRange r1 = gt_genome_node_get_range(*rn1);
+    bool found = false;
+    for(j = 0; !found && j < gt_array_size(regions[1]); j++)
+    {
+      GtGenomeNode **rn2 = gt_array_get(regions[1], j);
+      GtRange r2 = gt_genome_node_get_range(*rn2);
+      found = gt_str_cmp(seqid, gt_genome_node_get_seqid(*rn2)) == 0 &&
+              gt_range_compare(&r1, &r2) == 0;
+    }
+    match = found;
+  }
+
+  for(i = 0; i < 2; i++)
+  {
+    gt_array_delete(feats[i]);
+    gt_array_delete(regions[i]);
+  }
+  return match;
+}
+
+static int gff3_chunk_stream_test_error(const char *filename,
+                                        GtUword numthreads, GtError *error)
+{
+  GtNodeStream *stream;
+  if(numthreads == 0)
+    stream = gff3_chunk_stream_parser(filename, false);
+  else
+  {
+    stream = agn_gff3_chunk_stream_new(1, &filename, false, numthreads);
+    AgnGFF3ChunkStream *chunkstream = gff3_chunk_stream_cast(stream);
+    chunkstream->chunksize = 1;
+  }
+
+  GtGenomeNode *gn;
+  int had_err;
+  while(!(had_err = gt_node_stream_next(stream, &gn, error)) && gn != NULL)
+    gt_genome_node_delete(gn);
+  gt_node_stream_delete(stream);
+  return had_err;
+}
+
+static GtStr *gff3_chunk_stream_test_file(const char *data)
+{
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *tempfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(tempfile, "/aegean-chunk-XXXXXX");
+  int fd = mkstemp(gt_str_get(tempfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "w");
+  bool written = outstream != NULL && fputs(data, outstream) != EOF;
+  if(outstream != NULL)
+    written = fclose(outstream) == 0 && written;
+  else if(fd >= 0)
+    close(fd);
+  if(!written)
+  {
+    if(fd >= 0)
+      unlink(gt_str_get(tempfile));
+    gt_str_delete(tempfile);
+    return NULL;
+  }
+  return tempfile;
+}
+
+static GtArray *gff3_chunk_stream_test_load(const char *filename,
+                                            GtUword numthreads,
+                                            GtUword chunksize)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *stream;
+  if(numthreads == 0)
+    stream = gff3_chunk_stream_parser(filename, false);
+  else
+  {
+    stream = agn_gff3_chunk_stream_new(1, &filename, false, numthreads);
+    AgnGFF3ChunkStream *chunkstream = gff3_chunk_stream_cast(stream);
+    chunkstream->chunksize = chunksize;
+  }
+
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn;
+  int had_err;
+  while(!(had_err = gt_node_stream_next(stream, &gn, error)) && gn != NULL)
+    gt_array_add(nodes, gn);
+  if(had_err)
+  {
+    fprintf(stderr, "[AgnGFF3ChunkStream::gff3_chunk_stream_test_load] error "
+            "processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(stream);
+  gt_error_delete(error);
+  return nodes;
+}
+
+static void gff3_chunk_stream_test_unload(GtArray *nodes)
+{
+  while(gt_array_size(nodes) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(nodes);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(nodes);
+}
+
+static void *gff3_chunk_stream_worker(void *data)
+{
+  GFF3ChunkWorker *worker = data;
+  AgnGFF3ChunkStream *stream = worker->stream;
+  GFF3Chunk *chunk = gt_array_get(stream->chunks, worker->chunk);
+
+  // The first chunk keeps the file header; the others get a minimal one
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *tempfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(tempfile, "/aegean-chunk-XXXXXX");
+  int fd = mkstemp(gt_str_get(tempfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "w");
+  if(outstream == NULL)
+  {
+    gt_error_set(worker->error, "could not create temporary file '%s'",
+                 gt_str_get(tempfile));
+    worker->had_err = -1;
+    if(fd >= 0)
+    {
+      close(fd);
+      unlink(gt_str_get(tempfile));
+    }
+    gt_str_delete(tempfile);
+    return NULL;
+  }
+  if(worker->chunk == 0)
+    fwrite(stream->data, sizeof(char), stream->bodystart, outstream);
+  else
+  {
+    fputs("##gff-version   3\n", outstream);
+    fputs(gt_str_get(stream->declared), outstream);
+  }
+  fputs(gt_str_get(stream->implied), outstream);
+  fwrite(stream->data + chunk->start, sizeof(char), chunk->end - chunk->start,
+         outstream);
+  if(fclose(outstream) != 0)
+  {
+    gt_error_set(worker->error, "could not write temporary file '%s'",
+                 gt_str_get(tempfile));
+    worker->had_err = -1;
+    unlink(gt_str_get(tempfile));
+    gt_str_delete(tempfile);
+    return NULL;
+  }
+
+  // Every chunk declares all regions, but only the first delivers them
+  GtNodeStream *parser = gff3_chunk_stream_parser(gt_str_get(tempfile),
+                                                  stream->sorted);
+  GtGenomeNode *gn;
+  while(1)
+  {
+    worker->had_err = gt_node_stream_next(parser, &gn, worker->error);
+    if(worker->had_err || gn == NULL)
+      break;
+    if(worker->chunk > 0 && gt_region_node_try_cast(gn) != NULL)
+      gt_genome_node_delete(gn);
+    else
+      gt_array_add(worker->output, gn);
+  }
+  if(worker->had_err)
+    gff3_chunk_stream_error(stream, chunk, gt_str_get(tempfile), worker->error);
+  gt_node_stream_delete(parser);
+  unlink(gt_str_get(tempfile));
+  gt_str_delete(tempfile);
+  return NULL;
+}
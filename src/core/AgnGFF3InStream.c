@@ -0,0 +1,680 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "core/file_api.h"
+#include "core/str_api.h"
+#include "core/str_array_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "extended/merge_stream_api.h"
+#include "AgnBinaryInStream.h"
+#include "AgnGFF3ChunkStream.h"
+#include "AgnGFF3InStream.h"
+#include "AgnSortCheckStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * The ``in_stream`` is created when the first node is requested, after the
+ * input files have been trimmed. For each temporary file in ``tempfiles``,
+ * ``origins`` holds the name of the original file, which is restored to the
+ * parsed nodes by a ``GFF3OriginStream``. For sorted input, it is fed by a chain of
+ * streams for each file; all of the streams are kept in ``streams``. The
+ * ``binary`` array flags the input files in the binary annotation format, and
+ * ``numbinary`` counts them. With more than one thread, GFF3 files are parsed
+ * by an ``AgnGFF3ChunkStream``.
+ */
+struct AgnGFF3InStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtArray *streams;
+  GtStrArray *infiles;
+  GtStrArray *tempfiles;
+  GtArray *origins;
+  GtHashmap *keepattrs;
+  bool *binary;
+  GtUword numbinary;
+  bool sorted;
+  GtUword numthreads;
+};
+
+/**
+ * Stream restoring the original file names of the nodes parsed from trimmed
+ * temporary files; the ``tempfiles`` and ``origins`` arrays belong to the
+ * enclosing ``AgnGFF3InStream``.
+ */
+typedef struct
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtStrArray *tempfiles;
+  GtArray *origins;
+} GFF3OriginStream;
+
+#define GFF3_IN_STREAM_SORTED_PRAGMA "##aegean-sorted"
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define gff3_in_stream_cast(GS)\
+        gt_node_stream_cast(gff3_in_stream_class(), GS)
+
+#define gff3_origin_stream_cast(GS)\
+        gt_node_stream_cast(gff3_origin_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* gff3_in_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void gff3_in_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Determine whether attributes with the given key should be kept.
+ */
+static bool gff3_in_stream_keep(AgnGFF3InStream *stream, const char *key);
+
+/**
+ * @function Determine whether the header of the given file includes the
+ * ``##aegean-sorted`` pragma.
+ */
+static bool gff3_in_stream_marked_sorted(const char *filename);
+
+/**
+ * @function Pulls nodes from the GenomeTools GFF3 parser, creating the parser
+ * (and trimming the input files if requested) on the first call.
+ */
+static int gff3_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error);
+
+/**
+ * @function Load the features of the given file for unit testing, keeping only
+ * the attributes in ``keepattrs`` if it is not NULL.
+ */
+static void gff3_in_stream_test_data(const char *filename,
+                                     GtHashmap *keepattrs, GtArray *feats);
+
+/**
+ * @function Copy the input file to a new temporary file, discarding unwanted
+ * attributes, and add the name of the temporary file to ``tempfiles``.
+ */
+static int gff3_in_stream_trim_file(AgnGFF3InStream *stream,
+                                    const char *filename, GtError *error);
+
+/**
+ * @function Write a single line of GFF3 to ``outstream``, discarding unwanted
+ * attributes if it is a feature line. The line is modified in place while
+ * attribute keys are checked, but restored afterwards.
+ */
+static void gff3_in_stream_trim_line(AgnGFF3InStream *stream, GtStr *line,
+                                     FILE *outstream);
+
+/**
+ * @function Implements the GtNodeStream interface for origin streams.
+ */
+static const GtNodeStreamClass *gff3_origin_stream_class(void);
+
+/**
+ * @function Destructor for origin streams.
+ */
+static void gff3_origin_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Constructor for a stream restoring the original file names of the
+ * nodes in ``in``, which parses the trimmed files of ``stream``.
+ */
+static GtNodeStream *gff3_origin_stream_new(AgnGFF3InStream *stream,
+                                            GtNodeStream *in);
+
+/**
+ * @function Pulls a node from the parser and restores the original file name
+ * of the node and all of its subfeatures.
+ */
+static int gff3_origin_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error);
+
+/**
+ * @function If the node was parsed from one of the temporary files, give it
+ * the name of the original file, keeping its line number.
+ */
+static void gff3_origin_stream_restore(GFF3OriginStream *stream,
+                                       GtGenomeNode *gn);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_gff3_in_stream_new(int numfiles, const char **filenames,
+                                     GtHashmap *keepattrs)
+{
+  GtNodeStream *ns = gt_node_stream_create(gff3_in_stream_class(), false);
+  AgnGFF3InStream *stream = gff3_in_stream_cast(ns);
+  stream->in_stream = NULL;
+  stream->streams = gt_array_new( sizeof(GtNodeStream *) );
+  stream->infiles = gt_str_array_new();
+  stream->tempfiles = gt_str_array_new();
+  stream->origins = gt_array_new( sizeof(GtStr *) );
+  stream->keepattrs = NULL;
+  if(keepattrs != NULL)
+    stream->keepattrs = gt_hashmap_ref(keepattrs);
+
+  int i;
+  stream->binary = gt_calloc(numfiles + 1, sizeof (bool));
+  stream->numbinary = 0;
+  stream->sorted = numfiles > 0;
+  stream->numthreads = 1;
+  for(i = 0; i < numfiles; i++)
+  {
+    bool filesorted = false;
+    gt_str_array_add_cstr(stream->infiles, filenames[i]);
+    stream->binary[i] = agn_binary_in_stream_probe(filenames[i], &filesorted);
+    if(stream->binary[i])
+      stream->numbinary++;
+    else
+      filesorted = gff3_in_stream_marked_sorted(filenames[i]);
+    if(!filesorted)
+      stream->sorted = false;
+  }
+  return ns;
+}
+
+bool agn_gff3_in_stream_is_sorted(AgnGFF3InStream *stream)
+{
+  agn_assert(stream);
+  return stream->sorted;
+}
+
+void agn_gff3_in_stream_set_threads(AgnGFF3InStream *stream,
+                                    GtUword numthreads)
+{
+  agn_assert(stream && numthreads > 0 && stream->in_stream == NULL);
+  stream->numthreads = numthreads;
+}
+
+bool agn_gff3_in_stream_unit_test(AgnUnitTest *test)
+{
+  const char *filename = "data/gff3/amel-ncbi-g716.gff3";
+  GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
+  gff3_in_stream_test_data(filename, NULL, feats);
+  GtHashmap *keepattrs = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  gt_hashmap_add(keepattrs, "gbkey", "gbkey");
+  GtArray *trimmed = gt_array_new( sizeof(GtFeatureNode *) );
+  gff3_in_stream_test_data(filename, keepattrs, trimmed);
+
+  GtUword i, numnodes = 0, numtrimmed = 0;
+  bool test1 = gt_array_size(feats) > 0 &&
+               gt_array_size(feats) == gt_array_size(trimmed);
+  bool test2 = test1;
+  for(i = 0; i < gt_array_size(feats) && test1; i++)
+  {
+    GtFeatureNode **fn = gt_array_get(feats, i);
+    GtFeatureNode **tfn = gt_array_get(trimmed, i);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(*fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      numnodes++;
+    }
+    gt_feature_node_iterator_delete(iter);
+
+    iter = gt_feature_node_iterator_new(*tfn);
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      numtrimmed++;
+      if(gt_feature_node_get_attribute(feature, "Dbxref") != NULL ||
+         gt_feature_node_get_attribute(feature, "product") != NULL)
+        test2 = false;
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+  test1 = test1 && numnodes == numtrimmed;
+  agn_unit_test_result(test, "NCBI: structure", test1);
+  agn_unit_test_result(test, "NCBI: attributes dropped", test2);
+
+  bool test3 = test1;
+  if(test3)
+  {
+    GtFeatureNode **fn = gt_array_get(feats, 0);
+    GtFeatureNode **tfn = gt_array_get(trimmed, 0);
+    const char *dbxref = gt_feature_node_get_attribute(*fn, "Dbxref");
+    const char *name = gt_feature_node_get_attribute(*tfn, "Name");
+    const char *gbkey = gt_feature_node_get_attribute(*tfn, "gbkey");
+    test3 = dbxref != NULL && name != NULL && gbkey != NULL &&
+            strcmp(name, "LOC726786") == 0 && strcmp(gbkey, "Gene") == 0 &&
+            gt_feature_node_get_attribute(*tfn, "partial") == NULL;
+  }
+  agn_unit_test_result(test, "NCBI: attributes kept", test3);
+
+  bool test4 = test1;
+  for(i = 0; i < gt_array_size(feats) && test4; i++)
+  {
+    GtGenomeNode **gn = gt_array_get(feats, i);
+    GtGenomeNode **tgn = gt_array_get(trimmed, i);
+    test4 = strcmp(gt_genome_node_get_filename(*tgn), filename) == 0 &&
+            gt_genome_node_get_line_number(*tgn) ==
+            gt_genome_node_get_line_number(*gn);
+  }
+  agn_unit_test_result(test, "NCBI: origin", test4);
+
+  while(gt_array_size(feats) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(feats);
+    gt_genome_node_delete(*gn);
+  }
+  while(gt_array_size(trimmed) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(trimmed);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(feats);
+  gt_array_delete(trimmed);
+  gt_hashmap_delete(keepattrs);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *gff3_in_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnGFF3InStream),
+                                   gff3_in_stream_free,
+                                   gff3_in_stream_next);
+  }
+  return nsc;
+}
+
+static void gff3_in_stream_free(GtNodeStream *ns)
+{
+  AgnGFF3InStream *stream = gff3_in_stream_cast(ns);
+  while(gt_array_size(stream->streams) > 0)
+  {
+    GtNodeStream **component = gt_array_pop(stream->streams);
+    gt_node_stream_delete(*component);
+  }
+  gt_array_delete(stream->streams);
+
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(stream->tempfiles); i++)
+    unlink(gt_str_array_get(stream->tempfiles, i));
+  gt_str_array_delete(stream->infiles);
+  gt_str_array_delete(stream->tempfiles);
+  for(i = 0; i < gt_array_size(stream->origins); i++)
+    gt_str_delete(*(GtStr **)gt_array_get(stream->origins, i));
+  gt_array_delete(stream->origins);
+  gt_free(stream->binary);
+  if(stream->keepattrs != NULL)
+    gt_hashmap_delete(stream->keepattrs);
+}
+
+static bool gff3_in_stream_keep(AgnGFF3InStream *stream, const char *key)
+{
+  return strcmp(key, "ID") == 0 || strcmp(key, "Parent") == 0 ||
+         strcmp(key, "Name") == 0 || strcmp(key, "accession") == 0 ||
+         gt_hashmap_get(stream->keepattrs, key) != NULL;
+}
+
+static bool gff3_in_stream_marked_sorted(const char *filename)
+{
+  if(strcmp(filename, "-") == 0)
+    return false;
+  GtFile *instream = gt_file_new(filename, "r", NULL);
+  if(instream == NULL)
+    return false;
+
+  // Pragmas must precede the first feature
+  bool marked = false;
+  GtStr *line = gt_str_new();
+  while(!marked && gt_str_read_next_line_generic(line, instream) != EOF)
+  {
+    const char *linestr = gt_str_get(line);
+    if(linestr[0] != '#')
+      break;
+    size_t length = strlen(GFF3_IN_STREAM_SORTED_PRAGMA);
+    marked = strncmp(linestr, GFF3_IN_STREAM_SORTED_PRAGMA, length) == 0 &&
+             (linestr[length] == '\0' || linestr[length] == ' ' ||
+              linestr[length] == '\t' || linestr[length] == '\r');
+    gt_str_reset(line);
+  }
+  gt_str_delete(line);
+  gt_file_delete(instream);
+  return marked;
+}
+
+static int gff3_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error)
+{
+  gt_error_check(error);
+  AgnGFF3InStream *stream = gff3_in_stream_cast(ns);
+  if(stream->in_stream == NULL)
+  {
+    GtUword i, numfiles = gt_str_array_size(stream->infiles);
+    if(stream->numbinary > 0 && stream->numbinary < numfiles &&
+       !stream->sorted)
+    {
+      gt_error_set(error, "binary annotation files can only be combined with "
+                   "GFF3 files marked as sorted");
+      return -1;
+    }
+
+    // Binary files are read directly; GFF3 files may first be trimmed
+    if(stream->keepattrs != NULL && numfiles == 0)
+    {
+      gt_str_array_add_cstr(stream->infiles, "-");
+      numfiles = 1;
+    }
+    const char **filenames = gt_malloc( sizeof(char *) * (numfiles + 1) );
+    for(i = 0; i < numfiles; i++)
+    {
+      filenames[i] = gt_str_array_get(stream->infiles, i);
+      if(stream->keepattrs != NULL && !stream->binary[i])
+      {
+        if(gff3_in_stream_trim_file(stream, filenames[i], error))
+        {
+          gt_free(filenames);
+          return -1;
+        }
+        GtUword numtemp = gt_str_array_size(stream->tempfiles);
+        filenames[i] = gt_str_array_get(stream->tempfiles, numtemp - 1);
+      }
+    }
+    if(stream->sorted)
+    {
+      GtArray *checked = gt_array_new( sizeof(GtNodeStream *) );
+      for(i = 0; i < numfiles; i++)
+      {
+        GtNodeStream *in;
+        if(stream->binary[i])
+          in = agn_binary_in_stream_new(1, filenames + i, stream->keepattrs);
+        else if(stream->numthreads > 1)
+        {
+          in = agn_gff3_chunk_stream_new(1, filenames + i, true,
+                                         stream->numthreads);
+        }
+        else
+        {
+          in = gt_gff3_in_stream_new_sorted(filenames[i]);
+          gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)in);
+          gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)in);
+        }
+        gt_array_add(stream->streams, in);
+        if(stream->keepattrs != NULL && !stream->binary[i])
+        {
+          in = gff3_origin_stream_new(stream, in);
+          gt_array_add(stream->streams, in);
+        }
+        stream->in_stream = agn_sort_check_stream_new(in);
+        gt_array_add(stream->streams, stream->in_stream);
+        gt_array_add(checked, stream->in_stream);
+      }
+      if(numfiles > 1)
+      {
+        stream->in_stream = gt_merge_stream_new(checked);
+        gt_array_add(stream->streams, stream->in_stream);
+      }
+      gt_array_delete(checked);
+    }
+    else if(stream->numbinary > 0)
+    {
+      stream->in_stream = agn_binary_in_stream_new(numfiles, filenames,
+                                                   stream->keepattrs);
+      gt_array_add(stream->streams, stream->in_stream);
+    }
+    else if(stream->numthreads > 1)
+    {
+      stream->in_stream = agn_gff3_chunk_stream_new(numfiles, filenames, false,
+                                                    stream->numthreads);
+      gt_array_add(stream->streams, stream->in_stream);
+    }
+    else
+    {
+      stream->in_stream = gt_gff3_in_stream_new_unsorted(numfiles, filenames);
+      gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)
+                                            stream->in_stream);
+      gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream->in_stream);
+      gt_array_add(stream->streams, stream->in_stream);
+    }
+    if(!stream->sorted && stream->numbinary == 0 && stream->keepattrs != NULL)
+    {
+      stream->in_stream = gff3_origin_stream_new(stream, stream->in_stream);
+      gt_array_add(stream->streams, stream->in_stream);
+    }
+    gt_free(filenames);
+  }
+
+  return gt_node_stream_next(stream->in_stream, gn, error);
+}
+
+static void gff3_in_stream_test_data(const char *filename,
+                                     GtHashmap *keepattrs, GtArray *feats)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *gff3in = agn_gff3_in_stream_new(1, &filename, keepattrs);
+  GtNodeStream *arraystream = gt_array_out_stream_new(gff3in, feats, error);
+  int pullresult = gt_node_stream_pull(arraystream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnGFF3InStream::gff3_in_stream_test_data] error "
+            "processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(gff3in);
+  gt_node_stream_delete(arraystream);
+  gt_error_delete(error);
+}
+
+static int gff3_in_stream_trim_file(AgnGFF3InStream *stream,
+                                    const char *filename, GtError *error)
+{
+  GtFile *instream;
+  if(strcmp(filename, "-") == 0)
+    instream = gt_file_new_from_fileptr(stdin);
+  else
+  {
+    instream = gt_file_new(filename, "r", error);
+    if(instream == NULL)
+      return -1;
+  }
+
+  const char *tmpdir = getenv("TMPDIR");
+  GtStr *tempfile = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  gt_str_append_cstr(tempfile, "/aegean-gff3-XXXXXX");
+  int fd = mkstemp(gt_str_get(tempfile));
+  FILE *outstream = fd < 0 ? NULL : fdopen(fd, "w");
+  if(outstream == NULL)
+  {
+    gt_error_set(error, "could not create temporary file '%s'",
+                 gt_str_get(tempfile));
+    if(fd >= 0)
+    {
+      close(fd);
+      unlink(gt_str_get(tempfile));
+    }
+    gt_str_delete(tempfile);
+    if(strcmp(filename, "-") == 0)
+      gt_file_delete_without_handle(instream);
+    else
+      gt_file_delete(instream);
+    return -1;
+  }
+  gt_str_array_add(stream->tempfiles, tempfile);
+  GtStr *origin = gt_str_new_cstr(strcmp(filename, "-") == 0 ? "stdin"
+                                                             : filename);
+  gt_array_add(stream->origins, origin);
+
+  GtStr *line = gt_str_new();
+  while(gt_str_read_next_line_generic(line, instream) != EOF)
+  {
+    gff3_in_stream_trim_line(stream, line, outstream);
+    gt_str_reset(line);
+  }
+  gt_str_delete(line);
+
+  int had_err = 0;
+  if(fclose(outstream) != 0)
+  {
+    gt_error_set(error, "could not write temporary file '%s'",
+                 gt_str_get(tempfile));
+    had_err = -1;
+  }
+  gt_str_delete(tempfile);
+  if(strcmp(filename, "-") == 0)
+    gt_file_delete_without_handle(instream);
+  else
+    gt_file_delete(instream);
+  return had_err;
+}
+
+static void gff3_in_stream_trim_line(AgnGFF3InStream *stream, GtStr *line,
+                                     FILE *outstream)
+{
+  // Pragmas, comments, and Fasta data are copied unchanged
+  char *linestr = gt_str_get(line);
+  char *attrs = linestr;
+  int numtabs = 0;
+  if(linestr[0] != '#')
+  {
+    while(numtabs < 8 && (attrs = strchr(attrs, '\t')) != NULL)
+    {
+      attrs++;
+      numtabs++;
+    }
+  }
+  if(numtabs < 8)
+  {
+    fputs(linestr, outstream);
+    fputc('\n', outstream);
+    return;
+  }
+
+  fwrite(linestr, sizeof(char), attrs - linestr, outstream);
+  bool empty = true;
+  char *pair = attrs;
+  while(*pair != '\0')
+  {
+    char *end = strchr(pair, ';');
+    if(end == NULL)
+      end = pair + strlen(pair);
+    char *key = pair;
+    while(key < end && *key == ' ')
+      key++;
+    char *equals = memchr(key, '=', end - key);
+    if(equals != NULL)
+    {
+      *equals = '\0';
+      bool keep = gff3_in_stream_keep(stream, key);
+      *equals = '=';
+      if(keep)
+      {
+        if(!empty)
+          fputc(';', outstream);
+        fwrite(pair, sizeof(char), end - pair, outstream);
+        empty = false;
+      }
+    }
+    if(*end == '\0')
+      break;
+    pair = end + 1;
+  }
+  if(empty)
+    fputc('.', outstream);
+  fputc('\n', outstream);
+}
+
+static const GtNodeStreamClass *gff3_origin_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (GFF3OriginStream),
+                                   gff3_origin_stream_free,
+                                   gff3_origin_stream_next);
+  }
+  return nsc;
+}
+
+static void gff3_origin_stream_free(GtNodeStream *ns)
+{
+  GFF3OriginStream *stream = gff3_origin_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static GtNodeStream *gff3_origin_stream_new(AgnGFF3InStream *stream,
+                                            GtNodeStream *in)
+{
+  GtNodeStream *ns = gt_node_stream_create(gff3_origin_stream_class(),
+                                           gt_node_stream_is_sorted(in));
+  GFF3OriginStream *origin_stream = gff3_origin_stream_cast(ns);
+  origin_stream->in_stream = gt_node_stream_ref(in);
+  origin_stream->tempfiles = stream->tempfiles;
+  origin_stream->origins = stream->origins;
+  return ns;
+}
+
+static int gff3_origin_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error)
+{
+  gt_error_check(error);
+  GFF3OriginStream *stream = gff3_origin_stream_cast(ns);
+  int had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  if(had_err || *gn == NULL)
+    return had_err;
+
+  gff3_origin_stream_restore(stream, *gn);
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn != NULL)
+  {
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      gff3_origin_stream_restore(stream, (GtGenomeNode *)feature);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+  return 0;
+}
+
+static void gff3_origin_stream_restore(GFF3OriginStream *stream,
+                                       GtGenomeNode *gn)
+{
+  const char *filename = gt_genome_node_get_filename(gn);
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(stream->tempfiles); i++)
+  {
+    if(strcmp(filename, gt_str_array_get(stream->tempfiles, i)) == 0)
+    {
+      GtStr *origin = *(GtStr **)gt_array_get(stream->origins, i);
+      gt_genome_node_set_origin(gn, origin,
+                                gt_genome_node_get_line_number(gn));
+      return;
+    }
+  }
+}
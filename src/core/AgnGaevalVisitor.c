@@ -12,7 +12,8 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include <string.h>
 #include "core/array_api.h"
 #include "core/queue_api.h"
-#include "extended/feature_index_memory_api.h"
+#include "core/thread_api.h"
+#include "AgnAlignmentIndex.h"
 #include "AgnFilterStream.h"
 #include "AgnGaevalVisitor.h"
 #include "AgnInferCDSVisitor.h"
@@ -23,6 +24,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define gaeval_visitor_cast(GV)\
         gt_node_visitor_cast(gaeval_visitor_class(), GV)
 
+#define gaeval_batch_stream_cast(GS)\
+        gt_node_stream_cast(gaeval_batch_stream_class(), GS)
+
+#define GAEVAL_BATCH_SIZE 1024
+
 //----------------------------------------------------------------------------//
 // Data structure definition
 //----------------------------------------------------------------------------//
@@ -30,37 +36,115 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 struct AgnGaevalVisitor
 {
   const GtNodeVisitor parent_instance;
-  GtFeatureIndex *alignments;
+  AgnAlignmentIndex *alignments;
+  GtArray *overlapping;
   FILE *tsvout;
   AgnGaevalParams params;
+  GtNodeStream *astream;
+  GtGenomeNode *nextaln;
+  GtStr *seqid;
+  GtUword laststart;
+  GtStr *alnseqid;
+  GtUword alnstart;
 };
 
+/**
+ * @type Coverage and integrity scores computed for a single mRNA, kept so that
+ * scores computed in parallel can be reported in input order.
+ */
+typedef struct
+{
+  GtFeatureNode *mrna;
+  double coverage;
+  double integrity;
+  double components[5];
+} GaevalScore;
+
+/**
+ * @type Each worker thread scores every ``stride``th mRNA in the ``scores``
+ * array, beginning with ``offset``.
+ */
+typedef struct
+{
+  AgnGaevalVisitor *v;
+  GtArray *scores;
+  GtUword offset;
+  GtUword stride;
+} GaevalWorker;
+
+/**
+ * @type Node stream that buffers a batch of features from its input so that the
+ * mRNAs can be scored in parallel, and then delivers the features downstream in
+ * their original order.
+ */
+typedef struct
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in;
+  GtNodeVisitor *nv;
+  GtUword numthreads;
+  GtQueue *batch;
+} GaevalBatchStream;
+
 
 //----------------------------------------------------------------------------//
 // Prototypes of private functions
 //----------------------------------------------------------------------------//
 
 /**
- * @function Calculate coverage for the given gene model.
+ * @function Class definition for the batch stream.
+ */
+static const GtNodeStreamClass *gaeval_batch_stream_class(void);
+
+/**
+ * @function Destructor for the batch stream.
  */
-static double gaeval_visitor_calculate_coverage(AgnGaevalVisitor *v,
-                                                GtFeatureNode *genemodel,
-                                                GtError *error);
+static void gaeval_batch_stream_free(GtNodeStream *ns);
 
 /**
- * @function Calculate integrity for the given gene model.
+ * @function Pull the next node from the batch stream, filling and scoring a new
+ * batch whenever the previous one is exhausted.
+ */
+static int gaeval_batch_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error);
+
+/**
+ * @function When alignments are streamed, pull alignments from the alignment
+ * stream until reaching one that begins after the given top-level feature, and
+ * (if ``prune`` is set) discard those that can no longer overlap with this or
+ * any subsequent feature. Returns -1 if either the features or the alignments
+ * are not sorted.
+ */
+static int gaeval_visitor_advance(AgnGaevalVisitor *v, GtFeatureNode *fn,
+                                  bool prune, GtError *error);
+
+/**
+ * @function Calculate coverage for the given gene model from the overlapping
+ * alignments.
+ */
+static double gaeval_visitor_calculate_coverage(GtFeatureNode *genemodel,
+                                                GtArray *alignments);
+
+/**
+ * @function Calculate integrity for the given gene model from its coverage and
+ * the alignment gaps that confirm its introns.
  */
 static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
                                                  GtFeatureNode *genemodel,
                                                  double coverage,
-                                                 double *components,
-                                                 GtError *error);
+                                                 double *components);
 
 /**
  * @function Cast a node visitor object as a AgnGaevalVisitor.
  */
 static const GtNodeVisitorClass* gaeval_visitor_class();
 
+/**
+ * @function Add the coverage and integrity scores as attributes of the mRNA and
+ * print them as a row of TSV output, if requested.
+ */
+static void gaeval_visitor_annotate(AgnGaevalVisitor *v, GaevalScore *score);
+
 /**
  * @function Add up exon and match lengths to calculate coverage.
  */
@@ -77,13 +161,29 @@ static void gaeval_visitor_free(GtNodeVisitor *nv);
  * the alignment. Returns NULL if there is no overlap.
  */
 static GtArray*
-gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment);
+gaeval_visitor_intersect(GtGenomeNode *genemodel, AgnAlignment *alignment);
 
 /**
- * @function Calculate the proportion of introns confirmed by gaps in
+ * @function Calculate the proportion of introns confirmed by an alignment gap
+ * with identical coordinates.
+ */
+static double gaeval_visitor_introns_confirmed(AgnAlignmentIndex *alignments,
+                                               GtArray *introns);
+
+/**
+ * @function Find all alignments overlapping with the given gene model. The
+ * results are stored in the visitor's ``overlapping`` array, which is shared
+ * by the coverage and integrity calculations.
+ */
+static GtArray *gaeval_visitor_query(AgnGaevalVisitor *v,
+                                     GtFeatureNode *genemodel);
+
+/**
+ * @function Compute coverage and integrity for the mRNA from the given set of
  * overlapping alignments.
  */
-static double gaeval_visitor_introns_confirmed(GtArray *introns, GtArray *gaps);
+static void gaeval_visitor_score(AgnGaevalVisitor *v, GaevalScore *score,
+                                 GtArray *overlapping);
 
 /**
  * @function Determine the overlap, if any, between the two ranges. Returns the
@@ -92,15 +192,21 @@ static double gaeval_visitor_introns_confirmed(GtArray *introns, GtArray *gaps);
 static GtRange gaeval_visitor_range_intersect(GtRange *r1, GtRange *r2);
 
 /**
- * @function Typecheck select function for grabbing `match_gap` features.
+ * @function Used to combine the coverage from individual alignments into a
+ * single aggregate coverage. The ranges are sorted and merged in place.
+ */
+static void gaeval_visitor_union(GtArray *coverage);
+
+/**
+ * @function Allocate the visitor and initialize everything but the alignments.
  */
-static bool gaeval_visitor_typecheck_gap(GtFeatureNode *fn);
+static GtNodeVisitor *gaeval_visitor_setup(AgnGaevalParams gparams);
 
 /**
- * @function Used to bombine the coverage from individual alignments into a
- * single aggregate coverage.
+ * @function Wrap the given stream with a filter that keeps only alignment
+ * features.
  */
-static GtArray *gaeval_visitor_union(GtArray *cov1, GtArray *cov2);
+static GtNodeStream *gaeval_visitor_alignment_filter(GtNodeStream *astream);
 
 /**
  * @function Procedure for processing feature nodes (the only node of interest
@@ -110,6 +216,11 @@ static int
 gaeval_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
                                   GtError *error);
 
+/**
+ * @function Thread function for scoring a share of the mRNAs in a batch.
+ */
+static void *gaeval_visitor_worker(void *data);
+
 /**
  * @function Unit test for coverage calculations.
  */
@@ -130,6 +241,13 @@ static void gv_test_calc_integrity_simple(AgnUnitTest *test);
  */
 static void gv_test_intersect(AgnUnitTest *test);
 
+/**
+ * @function Store the given alignment in an index and intersect it with the
+ * given gene model.
+ */
+static GtArray *gv_test_intersect_alignment(GtGenomeNode *genemodel,
+                                            GtGenomeNode *alignment);
+
 /**
  * @function Unit test for `gaeval_visitor_introns_confirmed` function.
  */
@@ -162,75 +280,52 @@ GtNodeVisitor*
 agn_gaeval_visitor_new(GtNodeStream *astream, AgnGaevalParams gparams)
 {
   agn_assert(astream);
-
-  // Create the node visitor
-  GtNodeVisitor *nv = gt_node_visitor_create(gaeval_visitor_class());
+  GtNodeVisitor *nv = gaeval_visitor_setup(gparams);
   AgnGaevalVisitor *v = gaeval_visitor_cast(nv);
-  v->alignments = gt_feature_index_memory_new();
-  v->tsvout = NULL;
-  v->params = gparams;
-
-  // Check that sum of weights is 1.0
-  double weights_total = gparams.alpha + gparams.beta +
-                         gparams.gamma + gparams.epsilon;
-  if(fabs(weights_total - 1.0) > 0.0001)
-  {
-    fprintf(stderr, "[AgnGaevalVisitor::agn_gaeval_visitor_new] warning: "
-            "sum of weights is not 1.0 %.3lf; integrity calculations will be "
-            "incorrect\n", weights_total);
-  }
-
-
-  // Set up node stream to load alignment features into memory
-  GtQueue *streams = gt_queue_new();
-  GtNodeStream *stream, *last_stream;
-  GtHashmap *typestokeep = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
-  gt_hashmap_add(typestokeep, "cDNA_match", "cDNA_match");
-  gt_hashmap_add(typestokeep, "EST_match", "EST_match");
-  gt_hashmap_add(typestokeep, "nucleotide_match", "nucleotide_match");
-  stream = agn_filter_stream_new(astream, typestokeep);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-
-  stream = gt_feature_out_stream_new(last_stream, v->alignments);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
 
-  stream = gt_inter_feature_stream_new(last_stream, "cDNA_match", "match_gap");
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-
-  stream = gt_inter_feature_stream_new(last_stream, "EST_match", "match_gap");
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-
-  stream = gt_inter_feature_stream_new(last_stream, "nucleotide_match",
-                                       "match_gap");
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-
-  // Process the node stream
+  // Load alignment features into memory; gaps between aligned segments are
+  // computed by the alignment index as each alignment is stored
+  GtNodeStream *stream = gaeval_visitor_alignment_filter(astream);
   GtError *error = gt_error_new();
-  int result = gt_node_stream_pull(last_stream, error);
+  int result = agn_alignment_index_load(v->alignments, stream, error);
+  gt_node_stream_delete(stream);
   if(result == -1)
   {
     fprintf(stderr, "[AEGeAn::AgnGaevalStream] error parsing alignments: %s\n",
             gt_error_get(error));
+    gt_error_delete(error);
     gt_node_visitor_delete(nv);
     return NULL;
   }
   gt_error_delete(error);
-  gt_hashmap_delete(typestokeep);
-  while(gt_queue_size(streams) > 0)
-  {
-    stream = gt_queue_get(streams);
-    gt_node_stream_delete(stream);
-  }
-  gt_queue_delete(streams);
 
   return nv;
 }
 
+GtNodeVisitor*
+agn_gaeval_visitor_new_streaming(GtNodeStream *astream, AgnGaevalParams gparams)
+{
+  agn_assert(astream);
+  GtNodeVisitor *nv = gaeval_visitor_setup(gparams);
+  AgnGaevalVisitor *v = gaeval_visitor_cast(nv);
+  v->astream = gaeval_visitor_alignment_filter(astream);
+  return nv;
+}
+
+GtNodeStream *agn_gaeval_threaded_stream_new(GtNodeStream *in,
+                                             GtNodeVisitor *nv,
+                                             GtUword numthreads)
+{
+  agn_assert(in && nv && numthreads > 0);
+  GtNodeStream *ns = gt_node_stream_create(gaeval_batch_stream_class(), false);
+  GaevalBatchStream *stream = gaeval_batch_stream_cast(ns);
+  stream->in = gt_node_stream_ref(in);
+  stream->nv = nv;
+  stream->numthreads = numthreads;
+  stream->batch = gt_queue_new();
+  return ns;
+}
+
 void agn_gaeval_visitor_tsv_out(AgnGaevalVisitor *v, GtStr *tsvfilename)
 {
   v->tsvout = fopen(gt_str_get(tsvfilename), "w");
@@ -240,7 +335,96 @@ void agn_gaeval_visitor_tsv_out(AgnGaevalVisitor *v, GtStr *tsvfilename)
             gt_str_get(tsvfilename));
     exit(1);
   }
-  fprintf(v->tsvout, "ID\tLabel\tIntegrity\tCoverage\tNumIntrons\tA\tB\tΓ\tE\n");
+  fprintf(v->tsvout, "ID\tLabel\tIntegrity\tCoverage\tNumIntrons\tA\tB\tΓ\tE\t"
+          "IntronSupport\n");
+}
+
+int agn_gaeval_visitor_visit_batch(AgnGaevalVisitor *v, GtArray *features,
+                                   GtUword numthreads, GtError *error)
+{
+  agn_assert(v && features && numthreads > 0);
+  GtUword i, numfeatures = gt_array_size(features);
+  if(numfeatures == 0)
+    return 0;
+
+  if(v->astream != NULL)
+  {
+    for(i = 0; i < numfeatures; i++)
+    {
+      GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(features, i);
+      if(gaeval_visitor_advance(v, fn, i == 0, error) != 0)
+        return -1;
+    }
+  }
+  agn_alignment_index_prepare(v->alignments);
+
+  GtArray *scores = gt_array_new( sizeof(GaevalScore) );
+  for(i = 0; i < numfeatures; i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(features, i);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feat;
+    for(feat  = gt_feature_node_iterator_next(iter);
+        feat != NULL;
+        feat  = gt_feature_node_iterator_next(iter))
+    {
+      if(agn_typecheck_mrna(feat))
+      {
+        GaevalScore score = { feat, 0.0, 0.0, { 0.0 } };
+        gt_array_add(scores, score);
+      }
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+
+  GtUword numworkers = numthreads;
+  if(numworkers > gt_array_size(scores))
+    numworkers = gt_array_size(scores);
+  GaevalWorker *workers = gt_malloc( sizeof(GaevalWorker) * numworkers );
+  GtThread **threads = gt_malloc( sizeof(GtThread *) * numworkers );
+  for(i = 0; i < numworkers; i++)
+  {
+    workers[i].v = v;
+    workers[i].scores = scores;
+    workers[i].offset = i;
+    workers[i].stride = numworkers;
+    threads[i] = NULL;
+  }
+
+  // The calling thread handles the first share; if GenomeTools was compiled
+  // without thread support, gt_thread_new fails and shares are run serially.
+  GtError *threaderror = gt_error_new();
+  for(i = 1; i < numworkers; i++)
+  {
+    threads[i] = gt_thread_new(gaeval_visitor_worker, workers + i, threaderror);
+    if(threads[i] == NULL)
+    {
+      gt_error_unset(threaderror);
+      gaeval_visitor_worker(workers + i);
+    }
+  }
+  if(numworkers > 0)
+    gaeval_visitor_worker(workers);
+  for(i = 1; i < numworkers; i++)
+  {
+    if(threads[i] != NULL)
+    {
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
+    }
+  }
+  gt_error_delete(threaderror);
+  gt_free(threads);
+  gt_free(workers);
+
+  for(i = 0; i < gt_array_size(scores); i++)
+  {
+    GaevalScore *score = gt_array_get(scores, i);
+    gaeval_visitor_annotate(v, score);
+  }
+  gt_array_delete(scores);
+
+  return 0;
 }
 
 bool agn_gaeval_visitor_unit_test(AgnUnitTest *test)
@@ -268,42 +452,222 @@ static const GtNodeVisitorClass* gaeval_visitor_class()
   return nvc;
 }
 
-static double gaeval_visitor_calculate_coverage(AgnGaevalVisitor *v,
-                                                GtFeatureNode *genemodel,
-                                                GtError *error)
+static const GtNodeStreamClass *gaeval_batch_stream_class(void)
 {
-  agn_assert(v && genemodel);
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (GaevalBatchStream),
+                                   gaeval_batch_stream_free,
+                                   gaeval_batch_stream_next);
+  }
+  return nsc;
+}
 
-  GtStr *seqid = gt_genome_node_get_seqid((GtGenomeNode *)genemodel);
-  GtRange mrna_range = gt_genome_node_get_range((GtGenomeNode *)genemodel);
-  GtArray *overlapping = gt_array_new( sizeof(GtFeatureNode *) );
-  bool hasseqid;
-  gt_feature_index_has_seqid(v->alignments, &hasseqid, gt_str_get(seqid),error);
-  if(hasseqid)
+static void gaeval_batch_stream_free(GtNodeStream *ns)
+{
+  GaevalBatchStream *stream = gaeval_batch_stream_cast(ns);
+  while(gt_queue_size(stream->batch) > 0)
   {
-    gt_feature_index_get_features_for_range(v->alignments, overlapping,
-                                            gt_str_get(seqid), &mrna_range,
-                                            error);
+    GtGenomeNode *gn = gt_queue_get(stream->batch);
+    gt_genome_node_delete(gn);
+  }
+  gt_queue_delete(stream->batch);
+  gt_node_visitor_delete(stream->nv);
+  gt_node_stream_delete(stream->in);
+}
+
+static int gaeval_batch_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error)
+{
+  gt_error_check(error);
+  GaevalBatchStream *stream = gaeval_batch_stream_cast(ns);
+  if(gt_queue_size(stream->batch) > 0)
+  {
+    *gn = gt_queue_get(stream->batch);
+    return 0;
   }
 
+  GtArray *features = gt_array_new( sizeof(GtFeatureNode *) );
+  int had_err = 0;
+  while(gt_array_size(features) < GAEVAL_BATCH_SIZE)
+  {
+    GtGenomeNode *node;
+    had_err = gt_node_stream_next(stream->in, &node, error);
+    if(had_err || node == NULL)
+      break;
+
+    gt_queue_add(stream->batch, node);
+    GtFeatureNode *fn = gt_feature_node_try_cast(node);
+    if(fn != NULL)
+      gt_array_add(features, fn);
+  }
+
+  if(!had_err)
+  {
+    AgnGaevalVisitor *v = gaeval_visitor_cast(stream->nv);
+    had_err = agn_gaeval_visitor_visit_batch(v, features, stream->numthreads,
+                                             error);
+  }
+  gt_array_delete(features);
+
+  if(had_err)
+  {
+    while(gt_queue_size(stream->batch) > 0)
+    {
+      GtGenomeNode *node = gt_queue_get(stream->batch);
+      gt_genome_node_delete(node);
+    }
+    *gn = NULL;
+    return had_err;
+  }
+
+  *gn = NULL;
+  if(gt_queue_size(stream->batch) > 0)
+    *gn = gt_queue_get(stream->batch);
+  return 0;
+}
+
+static int gaeval_visitor_advance(AgnGaevalVisitor *v, GtFeatureNode *fn,
+                                  bool prune, GtError *error)
+{
+  agn_assert(v && v->astream && fn);
+  GtGenomeNode *gn = (GtGenomeNode *)fn;
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+  GtRange range = gt_genome_node_get_range(gn);
+
+  int seqcmp = strcmp(seqid, gt_str_get(v->seqid));
+  if(seqcmp < 0 || (seqcmp == 0 && range.start < v->laststart))
+  {
+    gt_error_set(error, "gene models are not sorted: feature at %s:%lu "
+                 "follows %s:%lu", seqid, range.start, gt_str_get(v->seqid),
+                 v->laststart);
+    return -1;
+  }
+  gt_str_set(v->seqid, seqid);
+  v->laststart = range.start;
+  if(prune)
+    agn_alignment_index_prune(v->alignments, seqid, range.start);
+
+  int had_err = 0;
+  while(!had_err)
+  {
+    if(v->nextaln == NULL)
+    {
+      had_err = gt_node_stream_next(v->astream, &v->nextaln, error);
+      if(had_err || v->nextaln == NULL)
+        break;
+    }
+
+    GtFeatureNode *alignment = gt_feature_node_try_cast(v->nextaln);
+    if(alignment == NULL)
+    {
+      gt_genome_node_delete(v->nextaln);
+      v->nextaln = NULL;
+      continue;
+    }
+
+    const char *alnseqid = gt_str_get(gt_genome_node_get_seqid(v->nextaln));
+    GtRange alnrange = gt_genome_node_get_range(v->nextaln);
+    int alncmp = strcmp(alnseqid, gt_str_get(v->alnseqid));
+    if(alncmp < 0 || (alncmp == 0 && alnrange.start < v->alnstart))
+    {
+      gt_error_set(error, "alignments are not sorted: alignment at %s:%lu "
+                   "follows %s:%lu", alnseqid, alnrange.start,
+                   gt_str_get(v->alnseqid), v->alnstart);
+      had_err = -1;
+      break;
+    }
+    gt_str_set(v->alnseqid, alnseqid);
+    v->alnstart = alnrange.start;
+
+    // Hold on to the first alignment past the current feature for later
+    seqcmp = strcmp(alnseqid, seqid);
+    if(seqcmp > 0 || (seqcmp == 0 && alnrange.start > range.end))
+      break;
+
+    if(seqcmp == 0)
+      agn_alignment_index_add(v->alignments, alignment);
+    gt_genome_node_delete(v->nextaln);
+    v->nextaln = NULL;
+  }
+
+  return had_err;
+}
+
+static GtNodeStream *gaeval_visitor_alignment_filter(GtNodeStream *astream)
+{
+  GtHashmap *typestokeep = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  gt_hashmap_add(typestokeep, "cDNA_match", "cDNA_match");
+  gt_hashmap_add(typestokeep, "EST_match", "EST_match");
+  gt_hashmap_add(typestokeep, "nucleotide_match", "nucleotide_match");
+  GtNodeStream *stream = agn_filter_stream_new(astream, typestokeep);
+  gt_hashmap_delete(typestokeep);
+  return stream;
+}
+
+static void gaeval_visitor_annotate(AgnGaevalVisitor *v, GaevalScore *score)
+{
+  char covstr[16];
+  sprintf(covstr, "%.3lf", score->coverage);
+  gt_feature_node_add_attribute(score->mrna, "gaeval_coverage", covstr);
+
+  char intstr[16];
+  sprintf(intstr, "%.3lf", score->integrity);
+  gt_feature_node_add_attribute(score->mrna, "gaeval_integrity", intstr);
+
+  if(v->tsvout)
+  {
+    const char *mrnaid = gt_feature_node_get_attribute(score->mrna, "ID");
+    const char *mrnalabel = agn_feature_node_get_label(score->mrna);
+    GtArray *introns = agn_typecheck_select(score->mrna, agn_typecheck_intron);
+    GtStr *support = gt_str_new();
+    GtUword i;
+    for(i = 0; i < gt_array_size(introns); i++)
+    {
+      GtGenomeNode *intron = *(GtGenomeNode **)gt_array_get(introns, i);
+      GtStr *seqid = gt_genome_node_get_seqid(intron);
+      GtRange range = gt_genome_node_get_range(intron);
+      GtUword depth = agn_alignment_index_gap_support(v->alignments,
+                                                      gt_str_get(seqid),
+                                                      &range);
+      if(i > 0)
+        gt_str_append_char(support, ',');
+      gt_str_append_ulong(support, depth);
+    }
+    if(gt_array_size(introns) == 0)
+      gt_str_append_char(support, '.');
+
+    fprintf(v->tsvout, "%s\t%s\t%s\t%s\t%lu\t%.3lf\t%.3lf\t%.3lf\t%.3lf\t"
+            "%s\n", mrnaid, mrnalabel, intstr, covstr, gt_array_size(introns),
+            score->components[0], score->components[1],
+            score->components[2], score->components[3], gt_str_get(support));
+    gt_str_delete(support);
+    gt_array_delete(introns);
+  }
+}
+
+static double gaeval_visitor_calculate_coverage(GtFeatureNode *genemodel,
+                                                GtArray *alignments)
+{
+  agn_assert(genemodel && alignments);
+
   GtArray *exon_coverage = gt_array_new( sizeof(GtRange) );
   GtUword i;
-  for(i = 0; i < gt_array_size(overlapping); i++)
+  for(i = 0; i < gt_array_size(alignments); i++)
   {
-    GtFeatureNode *alignment = *(GtFeatureNode **)gt_array_get(overlapping, i);
+    AgnAlignment *alignment = gt_array_get(alignments, i);
     GtArray *covered_parts = gaeval_visitor_intersect((GtGenomeNode*)genemodel,
-                                                      (GtGenomeNode*)alignment);
+                                                      alignment);
     if(covered_parts != NULL)
     {
-      GtArray *temp = gaeval_visitor_union(exon_coverage, covered_parts);
+      gt_array_add_array(exon_coverage, covered_parts);
       gt_array_delete(covered_parts);
-      gt_array_delete(exon_coverage);
-      exon_coverage = temp;
     }
   }
+  gaeval_visitor_union(exon_coverage);
   double coverage = gaeval_visitor_coverage_resolve(genemodel, exon_coverage);
   gt_array_delete(exon_coverage);
-  gt_array_delete(overlapping);
 
   return coverage;
 }
@@ -311,34 +675,10 @@ static double gaeval_visitor_calculate_coverage(AgnGaevalVisitor *v,
 static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
                                                  GtFeatureNode *genemodel,
                                                  double coverage,
-                                                 double *components,
-                                                 GtError *error)
+                                                 double *components)
 {
   agn_assert(v && genemodel);
 
-  GtStr *seqid = gt_genome_node_get_seqid((GtGenomeNode *)genemodel);
-  GtRange mrna_range = gt_genome_node_get_range((GtGenomeNode *)genemodel);
-  GtArray *overlapping = gt_array_new( sizeof(GtFeatureNode *) );
-  bool hasseqid;
-  gt_feature_index_has_seqid(v->alignments, &hasseqid, gt_str_get(seqid),error);
-  if(hasseqid)
-  {
-    gt_feature_index_get_features_for_range(v->alignments, overlapping,
-                                            gt_str_get(seqid), &mrna_range,
-                                            error);
-  }
-
-  GtArray *gaps = gt_array_new( sizeof(GtFeatureNode *) );
-  while(gt_array_size(overlapping) > 0)
-  {
-    GtFeatureNode *alignment = *(GtFeatureNode **)gt_array_pop(overlapping);
-    GtArray *agaps = agn_typecheck_select(alignment,
-                                          gaeval_visitor_typecheck_gap);
-    gt_array_add_array(gaps, agaps);
-    gt_array_delete(agaps);
-  }
-  gt_array_delete(overlapping);
-
   GtUword utr5p_len = agn_mrna_5putr_length(genemodel);
   double utr5p_score = 0.0;
   if(utr5p_len >= v->params.exp_5putr_len)
@@ -367,9 +707,8 @@ static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
   }
   else
   {
-    structure_score = gaeval_visitor_introns_confirmed(introns, gaps);
+    structure_score = gaeval_visitor_introns_confirmed(v->alignments, introns);
   }
-  gt_array_delete(gaps);
   gt_array_delete(introns);
 
   double integrity = (v->params.alpha   * structure_score) +
@@ -409,20 +748,24 @@ static double gaeval_visitor_coverage_resolve(GtFeatureNode *genemodel,
 static void gaeval_visitor_free(GtNodeVisitor *nv)
 {
   AgnGaevalVisitor *v = gaeval_visitor_cast(nv);
-  gt_feature_index_delete(v->alignments);
+  agn_alignment_index_delete(v->alignments);
+  gt_array_delete(v->overlapping);
+  gt_genome_node_delete(v->nextaln);
+  if(v->astream != NULL)
+    gt_node_stream_delete(v->astream);
+  gt_str_delete(v->seqid);
+  gt_str_delete(v->alnseqid);
 }
 
 static GtArray*
-gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment)
+gaeval_visitor_intersect(GtGenomeNode *genemodel, AgnAlignment *alignment)
 {
   agn_assert(genemodel && alignment);
 
   GtFeatureNode *genefn = gt_feature_node_cast(genemodel);
-  GtFeatureNode *algnfn = gt_feature_node_cast(alignment);
   agn_assert(gt_feature_node_has_type(genefn, "mRNA"));
   GtStrand genestrand = gt_feature_node_get_strand(genefn);
-  GtStrand algnstrand = gt_feature_node_get_strand(algnfn);
-  if(genestrand != algnstrand)
+  if(genestrand != alignment->strand)
     return NULL;
 
   GtArray *covered_parts = gt_array_new( sizeof(GtRange) );
@@ -433,22 +776,15 @@ gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment)
     GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(exons, i);
     GtRange exonrange = gt_genome_node_get_range(exon);
 
-    GtFeatureNodeIterator *aniter = gt_feature_node_iterator_new(algnfn);
-    GtFeatureNode *tempaln;
+    GtUword j;
     GtRange nullrange = {0, 0};
-    for(tempaln  = gt_feature_node_iterator_next(aniter);
-        tempaln != NULL;
-        tempaln  = gt_feature_node_iterator_next(aniter))
+    for(j = 0; j < alignment->num_segments; j++)
     {
-      if(gt_feature_node_has_type(tempaln, "match_gap"))
-        continue;
-
-      GtRange alnrange = gt_genome_node_get_range((GtGenomeNode *) tempaln);
+      GtRange alnrange = alignment->segments[j];
       GtRange intr = gaeval_visitor_range_intersect(&exonrange, &alnrange);
       if(gt_range_compare(&intr, &nullrange) != 0)
         gt_array_add(covered_parts, intr);
     }
-    gt_feature_node_iterator_delete(aniter);
   }
   gt_array_delete(exons);
 
@@ -466,36 +802,77 @@ gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment)
   return covered_parts;
 }
 
-static double gaeval_visitor_introns_confirmed(GtArray *introns, GtArray *gaps)
+static double gaeval_visitor_introns_confirmed(AgnAlignmentIndex *alignments,
+                                               GtArray *introns)
 {
-  agn_assert(introns && gaps);
+  agn_assert(alignments && introns);
   GtUword intron_count = gt_array_size(introns);
-  GtUword gap_count = gt_array_size(gaps);
   agn_assert(intron_count > 0);
 
-  if(gap_count == 0)
-    return 0.0;
-
-  GtUword i, j, num_confirmed = 0;
+  GtUword i, num_confirmed = 0;
   for(i = 0; i < intron_count; i++)
   {
     GtGenomeNode *intron = *(GtGenomeNode **)gt_array_get(introns, i);
+    GtStr *seqid = gt_genome_node_get_seqid(intron);
     GtRange intron_range = gt_genome_node_get_range(intron);
-    for(j = 0; j < gap_count; j++)
-    {
-      GtGenomeNode *gap = *(GtGenomeNode **)gt_array_get(gaps, j);
-      GtRange gap_range = gt_genome_node_get_range(gap);
-      if(gt_range_compare(&intron_range, &gap_range) == 0)
-      {
-        num_confirmed++;
-        break;
-      }
-    }
+    if(agn_alignment_index_gap_support(alignments, gt_str_get(seqid),
+                                       &intron_range) > 0)
+      num_confirmed++;
   }
 
   return (double)num_confirmed / (double)intron_count;
 }
 
+static GtArray *gaeval_visitor_query(AgnGaevalVisitor *v,
+                                     GtFeatureNode *genemodel)
+{
+  agn_assert(v && genemodel);
+  GtStr *seqid = gt_genome_node_get_seqid((GtGenomeNode *)genemodel);
+  GtRange mrna_range = gt_genome_node_get_range((GtGenomeNode *)genemodel);
+  gt_array_reset(v->overlapping);
+  agn_alignment_index_query(v->alignments, gt_str_get(seqid), &mrna_range,
+                            v->overlapping);
+  return v->overlapping;
+}
+
+static void gaeval_visitor_score(AgnGaevalVisitor *v, GaevalScore *score,
+                                 GtArray *overlapping)
+{
+  score->coverage = gaeval_visitor_calculate_coverage(score->mrna,
+                                                      overlapping);
+  score->integrity = gaeval_visitor_calculate_integrity(v, score->mrna,
+                                                        score->coverage,
+                                                        score->components);
+}
+
+static GtNodeVisitor *gaeval_visitor_setup(AgnGaevalParams gparams)
+{
+  GtNodeVisitor *nv = gt_node_visitor_create(gaeval_visitor_class());
+  AgnGaevalVisitor *v = gaeval_visitor_cast(nv);
+  v->alignments = agn_alignment_index_new();
+  v->overlapping = gt_array_new( sizeof(AgnAlignment) );
+  v->tsvout = NULL;
+  v->params = gparams;
+  v->astream = NULL;
+  v->nextaln = NULL;
+  v->seqid = gt_str_new();
+  v->laststart = 0;
+  v->alnseqid = gt_str_new();
+  v->alnstart = 0;
+
+  // Check that sum of weights is 1.0
+  double weights_total = gparams.alpha + gparams.beta +
+                         gparams.gamma + gparams.epsilon;
+  if(fabs(weights_total - 1.0) > 0.0001)
+  {
+    fprintf(stderr, "[AgnGaevalVisitor::agn_gaeval_visitor_new] warning: "
+            "sum of weights is not 1.0 %.3lf; integrity calculations will be "
+            "incorrect\n", weights_total);
+  }
+
+  return nv;
+}
+
 static GtRange gaeval_visitor_range_intersect(GtRange *r1, GtRange *r2)
 {
   agn_assert(r1 && r2);
@@ -510,41 +887,25 @@ static GtRange gaeval_visitor_range_intersect(GtRange *r1, GtRange *r2)
   return nullrange;
 }
 
-static bool gaeval_visitor_typecheck_gap(GtFeatureNode *fn)
-{
-  return gt_feature_node_has_type(fn, "match_gap");
-}
-
-static GtArray *gaeval_visitor_union(GtArray *cov1, GtArray *cov2)
+static void gaeval_visitor_union(GtArray *coverage)
 {
-  agn_assert(cov1 && cov2);
-  gt_array_add_array(cov1, cov2);
-  if(gt_array_size(cov1) > 1)
-    gt_array_sort(cov1, (GtCompare)gt_range_compare);
-
-  GtArray *runion = gt_array_new(sizeof(GtRange));
-  if(gt_array_size(cov1) == 0)
-    return runion;
-  GtRange *rng = gt_array_get(cov1, 0);
-  gt_array_add(runion, *rng);
-  GtRange *prev = gt_array_get(runion, 0);
-  if(gt_array_size(cov1) == 1)
-    return runion;
+  agn_assert(coverage);
+  GtUword numranges = gt_array_size(coverage);
+  if(numranges < 2)
+    return;
 
-  GtUword i;
-  for(i = 1; i < gt_array_size(cov1); i++)
+  gt_array_sort(coverage, (GtCompare)gt_range_compare);
+  GtRange *ranges = gt_array_get_space(coverage);
+  GtUword i, last = 0;
+  for(i = 1; i < numranges; i++)
   {
-    rng = gt_array_get(cov1, i);
-    if(gt_range_overlap(rng, prev))
-      *prev = gt_range_join(rng, prev);
+    if(gt_range_overlap(ranges + i, ranges + last))
+      ranges[last] = gt_range_join(ranges + i, ranges + last);
     else
-    {
-      gt_array_add(runion, *rng);
-      prev = gt_array_get(runion, gt_array_size(runion) - 1);
-    }
+      ranges[++last] = ranges[i];
   }
-
-  return runion;
+  if(last + 1 < numranges)
+    gt_array_rem_span(coverage, last + 1, numranges - 1);
 }
 
 static int
@@ -554,6 +915,9 @@ gaeval_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
   AgnGaevalVisitor *v = gaeval_visitor_cast(nv);
   gt_error_check(error);
 
+  if(v->astream != NULL && gaeval_visitor_advance(v, fn, true, error) != 0)
+    return -1;
+
   GtFeatureNodeIterator *feats = gt_feature_node_iterator_new(fn);
   GtFeatureNode *tempfeat;
   for(tempfeat  = gt_feature_node_iterator_next(feats);
@@ -563,35 +927,39 @@ gaeval_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
     if(agn_typecheck_mrna(tempfeat) == false)
       continue;
 
-    double coverage = gaeval_visitor_calculate_coverage(v, tempfeat, error);
-    char covstr[16];
-    sprintf(covstr, "%.3lf", coverage);
-    gt_feature_node_add_attribute(tempfeat, "gaeval_coverage", covstr);
-
-    double integrity_components[5];
-    double integrity = gaeval_visitor_calculate_integrity(
-        v, tempfeat, coverage, integrity_components, error
-    );
-    char intstr[16];
-    sprintf(intstr, "%.3lf", integrity);
-    gt_feature_node_add_attribute(tempfeat, "gaeval_integrity", intstr);
-
-    if(v->tsvout)
-    {
-      const char *mrnaid = gt_feature_node_get_attribute(tempfeat, "ID");
-      const char *mrnalabel = agn_feature_node_get_label(tempfeat);
-      GtUword num_introns = agn_typecheck_count(tempfeat, agn_typecheck_intron);
-      fprintf(v->tsvout, "%s\t%s\t%s\t%s\t%lu\t%.3lf\t%.3lf\t%.3lf\t%.3lf\n",
-              mrnaid, mrnalabel, intstr, covstr, num_introns,
-              integrity_components[0], integrity_components[1],
-              integrity_components[2], integrity_components[3]);
-    }
+    GaevalScore score;
+    score.mrna = tempfeat;
+    GtArray *overlapping = gaeval_visitor_query(v, tempfeat);
+    gaeval_visitor_score(v, &score, overlapping);
+    gaeval_visitor_annotate(v, &score);
   }
   gt_feature_node_iterator_delete(feats);
 
   return 0;
 }
 
+static void *gaeval_visitor_worker(void *data)
+{
+  GaevalWorker *worker = data;
+  GtArray *overlapping = gt_array_new( sizeof(AgnAlignment) );
+  GtUword i;
+  for(i = worker->offset;
+      i < gt_array_size(worker->scores);
+      i += worker->stride)
+  {
+    GaevalScore *score = gt_array_get(worker->scores, i);
+    GtGenomeNode *gn = (GtGenomeNode *)score->mrna;
+    GtStr *seqid = gt_genome_node_get_seqid(gn);
+    GtRange range = gt_genome_node_get_range(gn);
+    gt_array_reset(overlapping);
+    agn_alignment_index_lookup(worker->v->alignments, gt_str_get(seqid), &range,
+                               overlapping);
+    gaeval_visitor_score(worker->v, score, overlapping);
+  }
+  gt_array_delete(overlapping);
+  return NULL;
+}
+
 static void gv_test_calc_coverage(AgnUnitTest *test)
 {
   const char *filename = "data/gff3/gaeval-stream-unit-test-1.gff3";
@@ -626,9 +994,12 @@ static void gv_test_calc_coverage(AgnUnitTest *test)
   GtFeatureNode *g2 = *(GtFeatureNode **)gt_array_get(feats, 1);
   GtFeatureNode *g3 = *(GtFeatureNode **)gt_array_get(feats, 2);
 
-  double cov1 = gaeval_visitor_calculate_coverage(gv, g1, error);
-  double cov2 = gaeval_visitor_calculate_coverage(gv, g2, error);
-  double cov3 = gaeval_visitor_calculate_coverage(gv, g3, error);
+  double cov1 = gaeval_visitor_calculate_coverage(g1,
+                                                  gaeval_visitor_query(gv, g1));
+  double cov2 = gaeval_visitor_calculate_coverage(g2,
+                                                  gaeval_visitor_query(gv, g2));
+  double cov3 = gaeval_visitor_calculate_coverage(g3,
+                                                  gaeval_visitor_query(gv, g3));
   bool test1 = fabs(cov1 - 0.252) < 0.001 &&
                fabs(cov2 - 0.473) < 0.001 &&
                fabs(cov3 - 1.000) < 0.001;
@@ -682,10 +1053,12 @@ static void gv_test_calc_integrity(AgnUnitTest *test)
   GtFeatureNode *g1 = *(GtFeatureNode **)gt_array_get(feats, 0);
   GtFeatureNode *g2 = *(GtFeatureNode **)gt_array_get(feats, 1);
 
-  double cov1 = gaeval_visitor_calculate_coverage(gv,  g1, error);
-  double cov2 = gaeval_visitor_calculate_coverage(gv,  g2, error);
-  double int1 = gaeval_visitor_calculate_integrity(gv, g1, cov1, NULL, error);
-  double int2 = gaeval_visitor_calculate_integrity(gv, g2, cov2, NULL, error);
+  GtArray *aln1 = gaeval_visitor_query(gv, g1);
+  double cov1 = gaeval_visitor_calculate_coverage(g1, aln1);
+  double int1 = gaeval_visitor_calculate_integrity(gv, g1, cov1, NULL);
+  GtArray *aln2 = gaeval_visitor_query(gv, g2);
+  double cov2 = gaeval_visitor_calculate_coverage(g2, aln2);
+  double int2 = gaeval_visitor_calculate_integrity(gv, g2, cov2, NULL);
 
   bool test1 = fabs(cov1 - 1.000) < 0.001 &&
                fabs(cov2 - 0.997) < 0.001 &&
@@ -738,8 +1111,9 @@ static void gv_test_calc_integrity_simple(AgnUnitTest *test)
   agn_assert(gt_array_size(feats) == 1);
   GtFeatureNode *g1 = *(GtFeatureNode **)gt_array_get(feats, 0);
 
-  double cov1 = gaeval_visitor_calculate_coverage(gv,  g1, error);
-  double int1 = gaeval_visitor_calculate_integrity(gv, g1, cov1, NULL, error);
+  GtArray *aln1 = gaeval_visitor_query(gv, g1);
+  double cov1 = gaeval_visitor_calculate_coverage(g1, aln1);
+  double int1 = gaeval_visitor_calculate_integrity(gv, g1, cov1, NULL);
 
   bool test1 = fabs(cov1 - 0.882) < 0.001 &&
                fabs(int1 - 0.680) < 0.001;
@@ -781,9 +1155,9 @@ static void gv_test_intersect(AgnUnitTest *test)
   GtGenomeNode *est5 = *(GtGenomeNode **)gt_array_get(feats, 6);
   GtGenomeNode *est6 = *(GtGenomeNode **)gt_array_get(feats, 8);
 
-  GtArray *cov = gaeval_visitor_intersect(g1, est1);
+  GtArray *cov = gv_test_intersect_alignment(g1, est1);
   bool test1 = cov == NULL;
-  cov = gaeval_visitor_intersect(g1, est2);
+  cov = gv_test_intersect_alignment(g1, est2);
   test1 = gt_array_size(cov) == 1;
   if(test1)
   {
@@ -794,7 +1168,7 @@ static void gv_test_intersect(AgnUnitTest *test)
   agn_unit_test_result(test, "intersect (1)", test1);
   gt_array_delete(cov);
 
-  cov = gaeval_visitor_intersect(g2, est3);
+  cov = gv_test_intersect_alignment(g2, est3);
   bool test2 = gt_array_size(cov) == 2;
   if(test2)
   {
@@ -808,7 +1182,7 @@ static void gv_test_intersect(AgnUnitTest *test)
   agn_unit_test_result(test, "intersect (2)", test2);
   gt_array_delete(cov);
 
-  cov = gaeval_visitor_intersect(g2, est4);
+  cov = gv_test_intersect_alignment(g2, est4);
   bool test3 = gt_array_size(cov) == 2;
   if(test3)
   {
@@ -822,7 +1196,7 @@ static void gv_test_intersect(AgnUnitTest *test)
   agn_unit_test_result(test, "intersect (3)", test3);
   gt_array_delete(cov);
 
-  cov = gaeval_visitor_intersect(g3, est5);
+  cov = gv_test_intersect_alignment(g3, est5);
   bool test4 = gt_array_size(cov) == 2;
   if(test4)
   {
@@ -836,7 +1210,7 @@ static void gv_test_intersect(AgnUnitTest *test)
   agn_unit_test_result(test, "intersect (4)", test4);
   gt_array_delete(cov);
 
-  cov = gaeval_visitor_intersect(g3, est6);
+  cov = gv_test_intersect_alignment(g3, est6);
   bool test5 = gt_array_size(cov) == 2;
   if(test5)
   {
@@ -862,9 +1236,25 @@ static void gv_test_intersect(AgnUnitTest *test)
   gt_genome_node_delete(est6);
 }
 
+static GtArray *gv_test_intersect_alignment(GtGenomeNode *genemodel,
+                                            GtGenomeNode *alignment)
+{
+  AgnAlignmentIndex *idx = agn_alignment_index_new();
+  agn_alignment_index_add(idx, gt_feature_node_cast(alignment));
+  GtArray *hits = gt_array_new( sizeof(AgnAlignment) );
+  GtStr *seqid = gt_genome_node_get_seqid(alignment);
+  GtRange range = gt_genome_node_get_range(alignment);
+  agn_alignment_index_query(idx, gt_str_get(seqid), &range, hits);
+  agn_assert(gt_array_size(hits) == 1);
+  GtArray *cov = gaeval_visitor_intersect(genemodel, gt_array_get(hits, 0));
+  gt_array_delete(hits);
+  agn_alignment_index_delete(idx);
+  return cov;
+}
+
 static void gv_test_introns_confirmed(AgnUnitTest *test)
 {
-  GtGenomeNode *intron, *gap;
+  GtGenomeNode *intron;
   GtStr *seqid = gt_str_new_cstr("chr");
   GtArray *introns = gt_array_new( sizeof(GtGenomeNode *) );
   intron = gt_feature_node_new(seqid, "intron", 1000, 1170, GT_STRAND_REVERSE);
@@ -878,24 +1268,33 @@ static void gv_test_introns_confirmed(AgnUnitTest *test)
   intron = gt_feature_node_new(seqid, "intron", 2800, 2950, GT_STRAND_REVERSE);
   gt_array_add(introns, intron);
 
-  GtArray *gaps = gt_array_new( sizeof(GtGenomeNode *) );
+  AgnAlignmentIndex *alignments = agn_alignment_index_new();
+  GtGenomeNode *aln = gt_feature_node_new(seqid, "EST_match", 900, 999,
+                                          GT_STRAND_REVERSE);
+  agn_alignment_index_add(alignments, (GtFeatureNode *)aln);
+  gt_genome_node_delete(aln);
 
-  double intcon = gaeval_visitor_introns_confirmed(introns, gaps);
+  double intcon = gaeval_visitor_introns_confirmed(alignments, introns);
   bool test1 = fabs(intcon - 0.0) < 0.0001;
   agn_unit_test_result(test, "introns confirmed (no gaps)", test1);
 
-  gap = gt_feature_node_new(seqid, "match_gap", 1000, 1170, GT_STRAND_REVERSE);
-  gt_array_add(gaps, gap);
-  gap = gt_feature_node_new(seqid, "match_gap", 1225, 1302, GT_STRAND_REVERSE);
-  gt_array_add(gaps, gap);
-  gap = gt_feature_node_new(seqid, "match_gap", 1950, 2110, GT_STRAND_REVERSE);
-  gt_array_add(gaps, gap);
-  gap = gt_feature_node_new(seqid, "match_gap", 2575, 2655, GT_STRAND_REVERSE);
-  gt_array_add(gaps, gap);
-  gap = gt_feature_node_new(seqid, "match_gap", 2800, 2950, GT_STRAND_REVERSE);
-  gt_array_add(gaps, gap);
-
-  intcon = gaeval_visitor_introns_confirmed(introns, gaps);
+  // Segments chosen to leave gaps of 1000-1170, 1225-1302, 1950-2110,
+  // 2575-2655, and 2800-2950
+  GtRange segments[] = { { 900, 999 }, { 1171, 1224 }, { 1303, 1949 },
+                         { 2111, 2574 }, { 2656, 2799 }, { 2951, 3000 } };
+  aln = gt_feature_node_new_pseudo(seqid, 900, 3000, GT_STRAND_REVERSE);
+  GtUword i;
+  for(i = 0; i < 6; i++)
+  {
+    GtGenomeNode *seg = gt_feature_node_new(seqid, "EST_match",
+                                            segments[i].start, segments[i].end,
+                                            GT_STRAND_REVERSE);
+    gt_feature_node_add_child((GtFeatureNode *)aln, (GtFeatureNode *)seg);
+  }
+  agn_alignment_index_add(alignments, (GtFeatureNode *)aln);
+  gt_genome_node_delete(aln);
+
+  intcon = gaeval_visitor_introns_confirmed(alignments, introns);
   bool test2 = fabs(intcon - 0.6) < 0.0001;
   agn_unit_test_result(test, "introns confirmed (gaps)", test2);
 
@@ -905,13 +1304,7 @@ static void gv_test_introns_confirmed(AgnUnitTest *test)
     gt_genome_node_delete(intron);
   }
   gt_array_delete(introns);
-
-  while(gt_array_size(gaps) > 0)
-  {
-    gap = *(GtGenomeNode **)gt_array_pop(gaps);
-    gt_genome_node_delete(gap);
-  }
-  gt_array_delete(gaps);
+  agn_alignment_index_delete(alignments);
   gt_str_delete(seqid);
 }
 
@@ -948,7 +1341,9 @@ static void gv_test_union(AgnUnitTest *test)
   GtRange rng02 = {11525, 14070};
   gt_array_add(r2, rng01);
   gt_array_add(r2, rng02);
-  GtArray *ru = gaeval_visitor_union(r1, r2);
+  gt_array_add_array(r1, r2);
+  gaeval_visitor_union(r1);
+  GtArray *ru = r1;
   bool test1 = gt_array_size(ru) == 2;
   if(test1)
   {
@@ -960,7 +1355,6 @@ static void gv_test_union(AgnUnitTest *test)
   agn_unit_test_result(test, "union (1)", test1);
   gt_array_delete(r1);
   gt_array_delete(r2);
-  gt_array_delete(ru);
 
   r1 = gt_array_new( sizeof(GtRange) );
   r2 = gt_array_new( sizeof(GtRange) );
@@ -972,7 +1366,9 @@ static void gv_test_union(AgnUnitTest *test)
   gt_array_add(r1, rng04);
   gt_array_add(r2, rng05);
   gt_array_add(r2, rng06);
-  ru = gaeval_visitor_union(r1, r2);
+  gt_array_add_array(r1, r2);
+  gaeval_visitor_union(r1);
+  ru = r1;
   bool test2 = gt_array_size(ru) == 2;
   if(test2)
   {
@@ -986,7 +1382,6 @@ static void gv_test_union(AgnUnitTest *test)
   agn_unit_test_result(test, "union (2)", test2);
   gt_array_delete(r1);
   gt_array_delete(r2);
-  gt_array_delete(ru);
 
   r1 = gt_array_new( sizeof(GtRange) );
   r2 = gt_array_new( sizeof(GtRange) );
@@ -1000,7 +1395,9 @@ static void gv_test_union(AgnUnitTest *test)
   gt_array_add(r2, rng09);
   gt_array_add(r2, rng10);
   gt_array_add(r2, rng11);
-  ru = gaeval_visitor_union(r1, r2);
+  gt_array_add_array(r1, r2);
+  gaeval_visitor_union(r1);
+  ru = r1;
   bool test3 = gt_array_size(ru) == 3;
 
   if(test3)
@@ -1018,5 +1415,4 @@ static void gv_test_union(AgnUnitTest *test)
   agn_unit_test_result(test, "union (3)", test3);
   gt_array_delete(r1);
   gt_array_delete(r2);
-  gt_array_delete(ru);
 }
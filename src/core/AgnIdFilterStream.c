@@ -10,6 +10,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 #include <string.h>
 #include "core/queue_api.h"
+#include "core/str_array_api.h"
 #include "extended/array_in_stream_api.h"
 #include "extended/array_out_stream_api.h"
 #include "extended/feature_node_iterator_api.h"
@@ -25,7 +26,7 @@ struct AgnIdFilterStream
 {
   const GtNodeStream parent_instance;
   GtNodeStream *in_stream;
-  GtHashmap *ids2keep;
+  AgnIdSet *ids2keep;
 };
 
 
@@ -46,6 +47,13 @@ static const GtNodeStreamClass* id_filter_stream_class(void);
  */
 static void id_filter_stream_free(GtNodeStream *ns);
 
+/**
+ * @function Determine whether the feature or any of its subfeatures has an ID
+ * in the list of IDs to keep. If the feature is kept but its own ID is not in
+ * the list, the subfeatures that do not lead to a listed ID are removed.
+ */
+static bool id_filter_stream_keep(AgnIdFilterStream *stream, GtFeatureNode *fn);
+
 /**
  * @function Pulls nodes from the input stream and feeds them to the output
  * stream if they are in the list of IDs to keep.
@@ -53,10 +61,19 @@ static void id_filter_stream_free(GtNodeStream *ns);
 static int id_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
                                 GtError *error);
 
+/**
+ * @function Filter the features of the given file with the given IDs, and
+ * store the IDs of the features that are kept (or of their first subfeature,
+ * for pseudo-features) in ``keptids``, and the IDs of the mRNAs they contain
+ * in ``keptmrnas``.
+ */
+static void id_filter_stream_test(const char *filename, const char *ids,
+                                  GtStrArray *keptids, GtStrArray *keptmrnas);
+
 /**
  * @function Generate data for unit testing.
  */
-static void id_filter_stream_test_data(GtQueue *queue);
+static void id_filter_stream_test_data(GtQueue *queue, const char *filename);
 
 
 //------------------------------------------------------------------------------
@@ -64,7 +81,7 @@ static void id_filter_stream_test_data(GtQueue *queue);
 //------------------------------------------------------------------------------
 
 GtNodeStream* agn_id_filter_stream_new(GtNodeStream *in_stream,
-                                       GtHashmap *ids2keep)
+                                       AgnIdSet *ids2keep)
 {
   GtNodeStream *ns;
   AgnIdFilterStream *stream;
@@ -72,7 +89,7 @@ GtNodeStream* agn_id_filter_stream_new(GtNodeStream *in_stream,
   ns = gt_node_stream_create(id_filter_stream_class(), false);
   stream = id_filter_stream_cast(ns);
   stream->in_stream = gt_node_stream_ref(in_stream);
-  stream->ids2keep = gt_hashmap_ref(ids2keep);
+  stream->ids2keep = ids2keep;
   return ns;
 }
 
@@ -92,7 +109,39 @@ static void id_filter_stream_free(GtNodeStream *ns)
 {
   AgnIdFilterStream *stream = id_filter_stream_cast(ns);
   gt_node_stream_delete(stream->in_stream);
-  gt_hashmap_delete(stream->ids2keep);
+}
+
+static bool id_filter_stream_keep(AgnIdFilterStream *stream, GtFeatureNode *fn)
+{
+  const char *featureid = gt_feature_node_get_attribute(fn, "ID");
+  if(agn_id_set_contains(stream->ids2keep, featureid))
+    return true;
+
+  // Children are removed after the traversal, since removing them would
+  // invalidate the iterator
+  GtArray *discard = gt_array_new( sizeof(GtFeatureNode *) );
+  bool keep = false;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    if(id_filter_stream_keep(stream, child))
+      keep = true;
+    else
+      gt_array_add(discard, child);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  GtUword i;
+  for(i = 0; keep && i < gt_array_size(discard); i++)
+  {
+    GtFeatureNode *fn_discard = *(GtFeatureNode **)gt_array_get(discard, i);
+    agn_feature_node_remove_tree(fn, fn_discard);
+  }
+  gt_array_delete(discard);
+  return keep;
 }
 
 static int id_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
@@ -116,8 +165,7 @@ static int id_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
     if(!fn)
       return 0;
 
-    const char *featureid = gt_feature_node_get_attribute(fn, "ID");
-    if(gt_hashmap_get(stream->ids2keep, featureid) != NULL)
+    if(id_filter_stream_keep(stream, fn))
     {
       return 0;
     }
@@ -134,50 +182,100 @@ static int id_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
 
 bool agn_id_filter_stream_unit_test(AgnUnitTest *test)
 {
-    GtArray *source, *sink;
-    GtHashmap *ids;
-    GtNodeStream *aos, *ais, *ifs;
-    GtUword progress;
-
-    GtError *error = gt_error_new();
-    GtQueue *queue = gt_queue_new();
-    id_filter_stream_test_data(queue);
-    agn_assert(gt_queue_size(queue) == 1);
-
-    source = gt_queue_get(queue);
-    sink = gt_array_new( sizeof(GtFeatureNode *) );
-    ids = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
-    gt_hashmap_add(ids, "gene2", "gene2");
-    ais = gt_array_in_stream_new(source, &progress, error);
-    ifs = agn_id_filter_stream_new(ais, ids);
-    aos = gt_array_out_stream_new(ifs, sink, error);
-    gt_node_stream_pull(aos, error);
-    bool test1 = gt_array_size(sink) == 1;
-    if(test1)
+  GtStrArray *keptids = gt_str_array_new();
+  id_filter_stream_test("data/gff3/bogus-three-genes.gff3", "gene2\n", keptids,
+                        NULL);
+  bool test1 = gt_str_array_size(keptids) == 1 &&
+               strcmp(gt_str_array_get(keptids, 0), "gene2") == 0;
+  agn_unit_test_result(test, "gene2", test1);
+  gt_str_array_delete(keptids);
+
+  keptids = gt_str_array_new();
+  id_filter_stream_test("data/gff3/bogus-three-genes.gff3", "gene3\ngene*\n",
+                        keptids, NULL);
+  bool test2 = gt_str_array_size(keptids) == 3 &&
+               strcmp(gt_str_array_get(keptids, 0), "gene1") == 0 &&
+               strcmp(gt_str_array_get(keptids, 2), "gene3") == 0;
+  agn_unit_test_result(test, "prefix", test2);
+  gt_str_array_delete(keptids);
+
+  keptids = gt_str_array_new();
+  GtStrArray *keptmrnas = gt_str_array_new();
+  id_filter_stream_test("data/gff3/tair-altsplice.gff3", "AT1G01020.2\n",
+                        keptids, keptmrnas);
+  bool test3 = gt_str_array_size(keptids) == 1 &&
+               strcmp(gt_str_array_get(keptids, 0), "AT1G01020") == 0 &&
+               gt_str_array_size(keptmrnas) == 1 &&
+               strcmp(gt_str_array_get(keptmrnas, 0), "AT1G01020.2") == 0;
+  agn_unit_test_result(test, "mRNA ID", test3);
+  gt_str_array_delete(keptids);
+  gt_str_array_delete(keptmrnas);
+
+  keptids = gt_str_array_new();
+  id_filter_stream_test("data/gff3/tair-altsplice.gff3", "AT1G01020.3\n",
+                        keptids, NULL);
+  bool test4 = gt_str_array_size(keptids) == 0;
+  agn_unit_test_result(test, "no match", test4);
+  gt_str_array_delete(keptids);
+
+  return agn_unit_test_success(test);
+}
+
+static void id_filter_stream_test(const char *filename, const char *ids,
+                                  GtStrArray *keptids, GtStrArray *keptmrnas)
+{
+  GtArray *source, *sink;
+  GtNodeStream *aos, *ais, *ifs;
+  GtUword progress;
+
+  GtError *error = gt_error_new();
+  GtQueue *queue = gt_queue_new();
+  id_filter_stream_test_data(queue, filename);
+  agn_assert(gt_queue_size(queue) == 1);
+
+  source = gt_queue_get(queue);
+  sink = gt_array_new( sizeof(GtFeatureNode *) );
+  AgnIdSet *idset = agn_id_set_new(ids, strlen(ids));
+  ais = gt_array_in_stream_new(source, &progress, error);
+  ifs = agn_id_filter_stream_new(ais, idset);
+  aos = gt_array_out_stream_new(ifs, sink, error);
+  gt_node_stream_pull(aos, error);
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(sink); i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(sink, i);
+    const char *featureid = gt_feature_node_get_attribute(fn, "ID");
+    gt_str_array_add_cstr(keptids, featureid ? featureid : "");
+    if(keptmrnas != NULL)
     {
-      GtFeatureNode *fn = *(GtFeatureNode **)gt_array_pop(sink);
-      const char *featureid = gt_feature_node_get_attribute(fn, "ID");
-      test1 = featureid != NULL && strcmp(featureid, "gene2") == 0;
-      gt_genome_node_delete((GtGenomeNode *)fn);
+      GtArray *mrnas = agn_typecheck_select(fn, agn_typecheck_mrna);
+      GtUword j;
+      for(j = 0; j < gt_array_size(mrnas); j++)
+      {
+        GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, j);
+        const char *mrnaid = gt_feature_node_get_attribute(mrna, "ID");
+        gt_str_array_add_cstr(keptmrnas, mrnaid ? mrnaid : "");
+      }
+      gt_array_delete(mrnas);
     }
-    agn_unit_test_result(test, "gene2", test1);
-    gt_array_delete(source);
-    gt_array_delete(sink);
-    gt_hashmap_delete(ids);
-    gt_node_stream_delete(ais);
-    gt_node_stream_delete(ifs);
-    gt_node_stream_delete(aos);
-    gt_error_delete(error);
-    gt_queue_delete(queue);
-
-    return agn_unit_test_success(test);
+    gt_genome_node_delete((GtGenomeNode *)fn);
+  }
+
+  gt_array_delete(source);
+  gt_array_delete(sink);
+  gt_node_stream_delete(ais);
+  gt_node_stream_delete(ifs);
+  gt_node_stream_delete(aos);
+  agn_id_set_delete(idset);
+  gt_error_delete(error);
+  gt_queue_delete(queue);
 }
 
-static void id_filter_stream_test_data(GtQueue *queue)
+static void id_filter_stream_test_data(GtQueue *queue, const char *filename)
 {
   GtError *error = gt_error_new();
-  const char *refrfile = "data/gff3/bogus-three-genes.gff3";
-  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &refrfile);
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &filename);
   gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
   gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
   GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
@@ -0,0 +1,253 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include "core/ma_api.h"
+#include "AgnIdSet.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * The ``ids`` and ``prefixes`` tables point into ``buffer``, in which each ID
+ * (minus the trailing ``*`` for prefixes) has been terminated in place.
+ */
+struct AgnIdSet
+{
+  char *buffer;
+  char **ids;
+  GtUword numids;
+  char **prefixes;
+  GtUword numprefixes;
+};
+
+#define ID_SET_READ_SIZE 65536
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Build the set from ``buffer``, which holds ``length`` characters
+ * plus a terminating null character. The set takes ownership of the buffer.
+ */
+static AgnIdSet *id_set_build(char *buffer, GtUword length);
+
+/**
+ * @function Compare two IDs (given as pointers to ``char *``) for sorting.
+ */
+static int id_set_compare(const void *p1, const void *p2);
+
+/**
+ * @function Sort the given table of IDs and remove duplicates. If ``prefixes``
+ * is true, also remove any ID that begins with another ID of the table. Returns
+ * the number of IDs remaining.
+ */
+static GtUword id_set_sort(char **table, GtUword count, bool prefixes);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+bool agn_id_set_contains(AgnIdSet *set, const char *id)
+{
+  agn_assert(set);
+  if(id == NULL)
+    return false;
+
+  if(bsearch(&id, set->ids, set->numids, sizeof(char *), id_set_compare))
+    return true;
+
+  // Find the last prefix that sorts before the ID; no other prefix can match
+  GtUword lower = 0, upper = set->numprefixes;
+  while(lower < upper)
+  {
+    GtUword mid = lower + (upper - lower) / 2;
+    if(strcmp(set->prefixes[mid], id) <= 0)
+      lower = mid + 1;
+    else
+      upper = mid;
+  }
+  if(lower == 0)
+    return false;
+  const char *prefix = set->prefixes[lower - 1];
+  return strncmp(prefix, id, strlen(prefix)) == 0;
+}
+
+void agn_id_set_delete(AgnIdSet *set)
+{
+  gt_free(set->buffer);
+  gt_free(set->ids);
+  gt_free(set->prefixes);
+  gt_free(set);
+}
+
+AgnIdSet *agn_id_set_new(const char *data, GtUword length)
+{
+  agn_assert(data);
+  char *buffer = gt_malloc(sizeof(char) * (length + 1));
+  memcpy(buffer, data, length);
+  buffer[length] = '\0';
+  return id_set_build(buffer, length);
+}
+
+AgnIdSet *agn_id_set_read(FILE *instream, GtError *error)
+{
+  agn_assert(instream);
+  gt_error_check(error);
+
+  GtUword length = 0, capacity = ID_SET_READ_SIZE;
+  char *buffer = gt_malloc(sizeof(char) * (capacity + 1));
+  size_t numread;
+  while((numread = fread(buffer + length, sizeof(char), capacity - length,
+                         instream)) > 0)
+  {
+    length += numread;
+    if(length == capacity)
+    {
+      capacity *= 2;
+      buffer = gt_realloc(buffer, sizeof(char) * (capacity + 1));
+    }
+  }
+  if(ferror(instream))
+  {
+    gt_error_set(error, "could not read IDs");
+    gt_free(buffer);
+    return NULL;
+  }
+
+  buffer[length] = '\0';
+  return id_set_build(buffer, length);
+}
+
+GtUword agn_id_set_size(AgnIdSet *set)
+{
+  return set->numids + set->numprefixes;
+}
+
+bool agn_id_set_unit_test(AgnUnitTest *test)
+{
+  const char *data = "gene2\nmRNA7  extra\n\n  AT1G01*\r\nAT1G0102*\n"
+                     "gene2\nAT2*\n";
+  AgnIdSet *set = agn_id_set_new(data, strlen(data));
+  agn_unit_test_result(test, "size", agn_id_set_size(set) == 4);
+
+  bool test1 = agn_id_set_contains(set, "gene2") &&
+               agn_id_set_contains(set, "mRNA7") &&
+               !agn_id_set_contains(set, "gene") &&
+               !agn_id_set_contains(set, "gene20") &&
+               !agn_id_set_contains(set, "extra") &&
+               !agn_id_set_contains(set, NULL);
+  agn_unit_test_result(test, "exact IDs", test1);
+
+  bool test2 = agn_id_set_contains(set, "AT1G01") &&
+               agn_id_set_contains(set, "AT1G01020.1") &&
+               agn_id_set_contains(set, "AT1G01990") &&
+               agn_id_set_contains(set, "AT2G40000") &&
+               !agn_id_set_contains(set, "AT1G0") &&
+               !agn_id_set_contains(set, "AT1G02010") &&
+               !agn_id_set_contains(set, "AT3G01010");
+  agn_unit_test_result(test, "prefixes", test2);
+  agn_id_set_delete(set);
+
+  set = agn_id_set_new("", 0);
+  bool test3 = agn_id_set_size(set) == 0 &&
+               !agn_id_set_contains(set, "gene2");
+  agn_unit_test_result(test, "empty", test3);
+  agn_id_set_delete(set);
+
+  return agn_unit_test_success(test);
+}
+
+static AgnIdSet *id_set_build(char *buffer, GtUword length)
+{
+  // Count the lines to size the tables
+  GtUword i, numlines = 1;
+  for(i = 0; i < length; i++)
+  {
+    if(buffer[i] == '\n')
+      numlines++;
+  }
+
+  AgnIdSet *set = gt_malloc( sizeof(AgnIdSet) );
+  set->buffer = buffer;
+  set->ids = gt_malloc( sizeof(char *) * numlines );
+  set->numids = 0;
+  set->prefixes = gt_malloc( sizeof(char *) * numlines );
+  set->numprefixes = 0;
+
+  char *c = buffer;
+  char *end = buffer + length;
+  while(c < end)
+  {
+    while(c < end && (*c == ' ' || *c == '\t' || *c == '\r'))
+      c++;
+    char *id = c;
+    while(c < end && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n')
+      c++;
+    char *idend = c;
+    while(c < end && *c != '\n')
+      c++;
+    c++;
+    *idend = '\0';
+
+    if(idend > id + 1 && idend[-1] == '*')
+    {
+      idend[-1] = '\0';
+      set->prefixes[set->numprefixes++] = id;
+    }
+    else if(idend > id)
+      set->ids[set->numids++] = id;
+  }
+
+  set->numids = id_set_sort(set->ids, set->numids, false);
+  set->numprefixes = id_set_sort(set->prefixes, set->numprefixes, true);
+  if(set->numids > 0)
+    set->ids = gt_realloc(set->ids, sizeof(char *) * set->numids);
+  if(set->numprefixes > 0)
+  {
+    set->prefixes = gt_realloc(set->prefixes,
+                               sizeof(char *) * set->numprefixes);
+  }
+  return set;
+}
+
+static int id_set_compare(const void *p1, const void *p2)
+{
+  const char *id1 = *(const char **)p1;
+  const char *id2 = *(const char **)p2;
+  return strcmp(id1, id2);
+}
+
+static GtUword id_set_sort(char **table, GtUword count, bool prefixes)
+{
+  if(count == 0)
+    return 0;
+
+  qsort(table, count, sizeof(char *), id_set_compare);
+
+  // Any ID beginning with the last ID kept sorts immediately after it
+  GtUword i, numkept = 1;
+  for(i = 1; i < count; i++)
+  {
+    const char *last = table[numkept - 1];
+    if(strcmp(table[i], last) == 0)
+      continue;
+    if(prefixes && strncmp(table[i], last, strlen(last)) == 0)
+      continue;
+    table[numkept++] = table[i];
+  }
+  return numkept;
+}
@@ -21,14 +21,30 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 // Data structure definition
 //----------------------------------------------------------------------------//
 
+/**
+ * The arrays, hashmap, and string are scratch space, reset and reused for each
+ * gene so that processing a gene requires no allocations other than for the
+ * inferred features themselves. ``inferredexons`` and ``inferredintrons`` hold
+ * the exons and introns inferred for the current gene, each sorted by range,
+ * so that features shared by several mRNAs can be found with a binary search.
+ * They are kept apart because an exon of one isoform can have the same range
+ * as an intron of another.
+ */
 struct AgnInferExonsVisitor
 {
   const GtNodeVisitor parent_instance;
   GtFeatureNode *gene;
-  GtIntervalTree *exonsbyrange;
-  GtIntervalTree *intronsbyrange;
   GtArray *exons;
   GtArray *introns;
+  GtArray *mrnas;
+  GtArray *inferredexons;
+  GtArray *inferredintrons;
+  GtArray *cds;
+  GtArray *utrs;
+  GtArray *parts;
+  GtArray *ranges;
+  GtHashmap *adjacent;
+  GtStr *parentstr;
   GtLogger *logger;
   GtStr *source;
 };
@@ -43,11 +59,30 @@ struct AgnInferExonsVisitor
  */
 static const GtNodeVisitorClass* infer_exons_visitor_class();
 
+/**
+ * @function Find a feature with the given range in an array of features
+ * sorted by range. Returns NULL if there is no such feature.
+ */
+static GtFeatureNode *infer_exons_visitor_find(GtArray *feats, GtRange *range);
+
 /**
  * @function Destructor.
  */
 static void infer_exons_visitor_free(GtNodeVisitor *nv);
 
+/**
+ * @function Add a feature to an array of features sorted by range.
+ */
+static void infer_exons_visitor_insert(GtArray *feats, GtFeatureNode *fn);
+
+/**
+ * @function Collect the features of the given type under ``fn`` in the
+ * ``feats`` array, replacing its previous contents.
+ */
+static void infer_exons_visitor_select(GtFeatureNode *fn,
+                                       bool (*func)(GtFeatureNode *),
+                                       GtArray *feats);
+
 /**
  * @function Generate data for unit testing.
  */
@@ -62,15 +97,16 @@ infer_exons_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
                                        GtError *error);
 
 /**
- * @function If an exon with the same coordinates already exists and belongs to
- * another mRNA, associate it with this mRNA as well instead of creating a
+ * @function If a feature with the same coordinates was already inferred for
+ * another mRNA of the gene (``inferred`` holds the previously inferred exons or
+ * introns), associate it with this mRNA as well instead of creating a
  * duplicate feature.
  */
 static bool
 infer_exons_visitor_visit_gene_collapse_feature(AgnInferExonsVisitor *v,
                                                 GtFeatureNode *mrna,
-                                                GtRange *range,
-                                                GtIntervalTree *featsbyrange);
+                                                GtArray *inferred,
+                                                GtRange *range);
 
 /**
  * @function Infer exons from CDS and UTR segments if possible.
@@ -79,11 +115,13 @@ static void
 infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v);
 
 /**
- * @function Infer introns from exons if necessary.
+ * @function Infer introns for an mRNA from its exons, which must be sorted.
+ * Returns false if the mRNA has directly adjacent exons.
  */
-static void
-infer_exons_visitor_visit_gene_infer_introns(AgnInferExonsVisitor *v);
-
+static bool
+infer_exons_visitor_visit_gene_infer_introns(AgnInferExonsVisitor *v,
+                                             GtFeatureNode *mrna,
+                                             GtArray *exons);
 
 //----------------------------------------------------------------------------//
 // Method implementations
@@ -104,6 +142,18 @@ GtNodeVisitor* agn_infer_exons_visitor_new(GtLogger *logger)
   GtNodeVisitor *nv;
   nv = gt_node_visitor_create(infer_exons_visitor_class());
   AgnInferExonsVisitor *v = infer_exons_visitor_cast(nv);
+  v->gene = NULL;
+  v->exons = gt_array_new( sizeof(GtFeatureNode *) );
+  v->introns = gt_array_new( sizeof(GtFeatureNode *) );
+  v->mrnas = gt_array_new( sizeof(GtFeatureNode *) );
+  v->inferredexons = gt_array_new( sizeof(GtFeatureNode *) );
+  v->inferredintrons = gt_array_new( sizeof(GtFeatureNode *) );
+  v->cds = gt_array_new( sizeof(GtFeatureNode *) );
+  v->utrs = gt_array_new( sizeof(GtFeatureNode *) );
+  v->parts = gt_array_new( sizeof(GtFeatureNode *) );
+  v->ranges = gt_array_new( sizeof(GtRange) );
+  v->adjacent = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  v->parentstr = gt_str_new();
   v->logger = logger;
   v->source = NULL;
   return nv;
@@ -183,6 +233,148 @@ bool agn_infer_exons_visitor_unit_test(AgnUnitTest *test)
     gt_genome_node_delete(cds_n);
   }
   gt_queue_delete(queue);
+
+  // Exons shared by two mRNAs with very long IDs
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", 1000, 2000,
+                                           GT_STRAND_FORWARD);
+  GtStr *mrnaids[2];
+  GtUword i;
+  for(i = 0; i < 2; i++)
+  {
+    GtUword j;
+    mrnaids[i] = gt_str_new_cstr(i == 0 ? "mRNA" : "isoform");
+    for(j = 0; j < 800; j++)
+      gt_str_append_char(mrnaids[i], 'A' + (j % 26));
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", 1000, 2000,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_attribute((GtFeatureNode *)mrna, "ID",
+                                  gt_str_get(mrnaids[i]));
+    gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+    GtGenomeNode *cds1 = gt_feature_node_new(seqid, "CDS", 1000, 1200,
+                                             GT_STRAND_FORWARD);
+    GtGenomeNode *cds2 = gt_feature_node_new(seqid, "CDS", 1500, 2000,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cds1);
+    gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cds2);
+  }
+  GtError *error = gt_error_new();
+  GtLogger *logger = gt_logger_new(false, "", stderr);
+  GtNodeVisitor *nv = agn_infer_exons_visitor_new(logger);
+  bool longids = gt_genome_node_accept(gene, nv, error) == 0;
+  GtArray *mrnas = agn_typecheck_select((GtFeatureNode *)gene,
+                                        agn_typecheck_mrna);
+  GtArray *parts[2][2];
+  for(i = 0; i < 2; i++)
+  {
+    GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, i);
+    parts[i][0] = agn_typecheck_select(mrna, agn_typecheck_exon);
+    parts[i][1] = agn_typecheck_select(mrna, agn_typecheck_intron);
+  }
+  longids = longids && gt_array_size(mrnas) == 2 &&
+            gt_array_size(parts[0][0]) == 2 &&
+            gt_array_size(parts[1][0]) == 2 &&
+            gt_array_size(parts[0][1]) == 1 &&
+            gt_array_size(parts[1][1]) == 1;
+  if(longids)
+  {
+    // Either mRNA may be processed first
+    GtFeatureNode *first = *(GtFeatureNode **)gt_array_get(mrnas, 0);
+    const char *firstid = gt_feature_node_get_attribute(first, "ID");
+    GtUword k = strcmp(firstid, gt_str_get(mrnaids[0])) == 0 ? 0 : 1;
+    GtStr *expected = gt_str_clone(mrnaids[k]);
+    gt_str_append_char(expected, ',');
+    gt_str_append_str(expected, mrnaids[1 - k]);
+    GtUword j;
+    for(j = 0; j < 3; j++)
+    {
+      GtArray *feats0 = parts[0][j / 2], *feats1 = parts[1][j / 2];
+      GtFeatureNode **fn0 = gt_array_get(feats0, j % 2);
+      GtFeatureNode **fn1 = gt_array_get(feats1, j % 2);
+      const char *parent = gt_feature_node_get_attribute(*fn0, "Parent");
+      longids = longids && *fn0 == *fn1 && parent != NULL &&
+                strcmp(parent, gt_str_get(expected)) == 0;
+    }
+    gt_str_delete(expected);
+  }
+  agn_unit_test_result(test, "shared exons, long mRNA IDs", longids);
+  for(i = 0; i < 2; i++)
+  {
+    gt_array_delete(parts[i][0]);
+    gt_array_delete(parts[i][1]);
+  }
+  gt_array_delete(mrnas);
+
+  // An intron of one isoform with the same range as an exon of another
+  GtGenomeNode *altgene = gt_feature_node_new(seqid, "gene", 10, 600,
+                                              GT_STRAND_FORWARD);
+  GtUword cdscoords[2][6] = { { 100, 199, 300, 400, 0, 0 },
+                              { 10, 50, 200, 299, 500, 600 } };
+  for(i = 0; i < 2; i++)
+  {
+    GtUword numcds = i == 0 ? 2 : 3, j;
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", cdscoords[i][0],
+                                             cdscoords[i][2*numcds - 1],
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_attribute((GtFeatureNode *)mrna, "ID",
+                                  i == 0 ? "altA" : "altB");
+    gt_feature_node_add_child((GtFeatureNode *)altgene, (GtFeatureNode *)mrna);
+    for(j = 0; j < numcds; j++)
+    {
+      GtGenomeNode *cds = gt_feature_node_new(seqid, "CDS", cdscoords[i][2*j],
+                                              cdscoords[i][2*j + 1],
+                                              GT_STRAND_FORWARD);
+      gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cds);
+    }
+  }
+  bool altsplice = gt_genome_node_accept(altgene, nv, error) == 0;
+  mrnas = agn_typecheck_select((GtFeatureNode *)altgene, agn_typecheck_mrna);
+  for(i = 0; i < 2; i++)
+  {
+    GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, i);
+    GtUword k = strcmp(gt_feature_node_get_attribute(mrna, "ID"), "altA") == 0
+                ? 0 : 1;
+    parts[k][0] = agn_typecheck_select(mrna, agn_typecheck_exon);
+    parts[k][1] = agn_typecheck_select(mrna, agn_typecheck_intron);
+  }
+  altsplice = altsplice && gt_array_size(mrnas) == 2 &&
+              gt_array_size(parts[0][0]) == 2 &&
+              gt_array_size(parts[0][1]) == 1 &&
+              gt_array_size(parts[1][0]) == 3 &&
+              gt_array_size(parts[1][1]) == 2;
+  if(altsplice)
+  {
+    GtFeatureNode *intron = *(GtFeatureNode **)gt_array_get(parts[0][1], 0);
+    GtRange irange = gt_genome_node_get_range((GtGenomeNode *)intron);
+    GtFeatureNode *exon = NULL;
+    for(i = 0; i < 3; i++)
+    {
+      GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(parts[1][0], i);
+      GtRange erange = gt_genome_node_get_range((GtGenomeNode *)fn);
+      if(erange.start == 200 && erange.end == 299)
+        exon = fn;
+    }
+    altsplice = exon != NULL && intron != exon &&
+                agn_typecheck_intron(intron) && agn_typecheck_exon(exon) &&
+                irange.start == 200 && irange.end == 299;
+  }
+  agn_unit_test_result(test, "alternative splicing, intron matches exon",
+                       altsplice);
+  for(i = 0; i < 2; i++)
+  {
+    gt_array_delete(parts[i][0]);
+    gt_array_delete(parts[i][1]);
+  }
+  gt_array_delete(mrnas);
+  gt_genome_node_delete(altgene);
+  gt_node_visitor_delete(nv);
+  gt_logger_delete(logger);
+  gt_error_delete(error);
+  gt_genome_node_delete(gene);
+  gt_str_delete(mrnaids[0]);
+  gt_str_delete(mrnaids[1]);
+  gt_str_delete(seqid);
+
   return agn_unit_test_success(test);
 }
 
@@ -199,13 +391,79 @@ static const GtNodeVisitorClass* infer_exons_visitor_class()
   return nvc;
 }
 
+static GtFeatureNode *infer_exons_visitor_find(GtArray *feats, GtRange *range)
+{
+  GtUword low = 0, high = gt_array_size(feats);
+  while(low < high)
+  {
+    GtUword mid = low + (high - low) / 2;
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(feats, mid);
+    GtRange midrange = gt_genome_node_get_range(gn);
+    int result = gt_range_compare(&midrange, range);
+    if(result == 0)
+      return (GtFeatureNode *)gn;
+    else if(result < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return NULL;
+}
+
 static void infer_exons_visitor_free(GtNodeVisitor *nv)
 {
   AgnInferExonsVisitor *v = infer_exons_visitor_cast(nv);
+  gt_array_delete(v->exons);
+  gt_array_delete(v->introns);
+  gt_array_delete(v->mrnas);
+  gt_array_delete(v->inferredexons);
+  gt_array_delete(v->inferredintrons);
+  gt_array_delete(v->cds);
+  gt_array_delete(v->utrs);
+  gt_array_delete(v->parts);
+  gt_array_delete(v->ranges);
+  gt_hashmap_delete(v->adjacent);
+  gt_str_delete(v->parentstr);
   if(v->source != NULL)
     gt_str_delete(v->source);
 }
 
+static void infer_exons_visitor_insert(GtArray *feats, GtFeatureNode *fn)
+{
+  // Features are usually inferred in order, so this rarely moves anything
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+  gt_array_add(feats, fn);
+  GtUword i = gt_array_size(feats) - 1;
+  while(i > 0)
+  {
+    GtFeatureNode **prev = gt_array_get(feats, i - 1);
+    GtRange prevrange = gt_genome_node_get_range((GtGenomeNode *)*prev);
+    if(gt_range_compare(&prevrange, &range) <= 0)
+      break;
+    GtFeatureNode **current = gt_array_get(feats, i);
+    *current = *prev;
+    *prev = fn;
+    i--;
+  }
+}
+
+static void infer_exons_visitor_select(GtFeatureNode *fn,
+                                       bool (*func)(GtFeatureNode *),
+                                       GtArray *feats)
+{
+  gt_array_reset(feats);
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    if(func(current))
+      gt_array_add(feats, current);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
 static void infer_exons_visitor_test_data(GtQueue *queue)
 {
   GtError *error = gt_error_new();
@@ -245,10 +503,11 @@ infer_exons_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
   AgnInferExonsVisitor *v = infer_exons_visitor_cast(nv);
   gt_error_check(error);
 
+  int had_err = 0;
   GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
   GtFeatureNode *current;
   for(current = gt_feature_node_iterator_next(iter);
-      current != NULL;
+      current != NULL && !had_err;
       current = gt_feature_node_iterator_next(iter))
   {
     if(!agn_typecheck_gene(current) && !agn_typecheck_transcript(current))
@@ -256,107 +515,92 @@ infer_exons_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
 
     GtUword i;
     v->gene = current;
-
-    v->exonsbyrange = gt_interval_tree_new(NULL);
-    v->exons = agn_typecheck_select(current, agn_typecheck_exon);
-    for(i = 0; i < gt_array_size(v->exons); i++)
-    {
-      GtGenomeNode **exon = gt_array_get(v->exons, i);
-      GtRange range = gt_genome_node_get_range(*exon);
-      GtIntervalTreeNode *itn = gt_interval_tree_node_new(*exon, range.start,
-                                                          range.end);
-      gt_interval_tree_insert(v->exonsbyrange, itn);
-    }
+    infer_exons_visitor_select(current, agn_typecheck_exon, v->exons);
+    infer_exons_visitor_select(current, agn_typecheck_intron, v->introns);
+    infer_exons_visitor_select(current, agn_typecheck_mrna, v->mrnas);
+    gt_array_reset(v->inferredexons);
+    gt_array_reset(v->inferredintrons);
     if(gt_array_size(v->exons) == 0)
       infer_exons_visitor_visit_gene_infer_exons(v);
 
-    GtArray *mrnas = agn_typecheck_select(current, agn_typecheck_mrna);
-    while(gt_array_size(mrnas) > 0)
+    // Each mRNA's exons are sorted once, both to check them for overlap and to
+    // infer introns between them
+    bool inferintrons = gt_array_size(v->introns) == 0 &&
+                        gt_array_size(v->exons) > 1;
+    for(i = 0; i < gt_array_size(v->mrnas); i++)
     {
-      GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_pop(mrnas);
-      GtArray *exons = agn_typecheck_select(mrna, agn_typecheck_exon);
-      if(agn_feature_overlap_check(exons))
+      GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(v->mrnas, i);
+      infer_exons_visitor_select(mrna, agn_typecheck_exon, v->parts);
+      gt_array_sort(v->parts, (GtCompare)agn_genome_node_compare);
+      GtUword j, maxend = 0;
+      for(j = 0; j < gt_array_size(v->parts); j++)
       {
-        const char *rnaid = gt_feature_node_get_attribute(mrna, "ID");
-        gt_error_set(error, "mRNA '%s' contains overlapping exons", rnaid);
-        return -1;
+        GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(v->parts, j);
+        GtRange range = gt_genome_node_get_range(exon);
+        if(j > 0 && range.start <= maxend)
+        {
+          const char *rnaid = gt_feature_node_get_attribute(mrna, "ID");
+          gt_error_set(error, "mRNA '%s' contains overlapping exons", rnaid);
+          had_err = -1;
+          break;
+        }
+        if(range.end > maxend)
+          maxend = range.end;
       }
-      gt_array_delete(exons);
-    }
-    gt_array_delete(mrnas);
 
-    v->intronsbyrange = gt_interval_tree_new(NULL);
-    v->introns = agn_typecheck_select(current, agn_typecheck_intron);
-    if(gt_array_size(v->introns) == 0 && gt_array_size(v->exons) > 1)
-      infer_exons_visitor_visit_gene_infer_introns(v);
-
-    gt_array_delete(v->exons);
-    gt_array_delete(v->introns);
-    gt_interval_tree_delete(v->exonsbyrange);
-    gt_interval_tree_delete(v->intronsbyrange);
+      if(!had_err && inferintrons && gt_array_size(v->parts) > 1)
+        inferintrons = infer_exons_visitor_visit_gene_infer_introns(v, mrna,
+                                                                    v->parts);
+      if(had_err)
+        break;
+    }
   }
   gt_feature_node_iterator_delete(iter);
 
-  return 0;
+  return had_err;
 }
 
 static bool
 infer_exons_visitor_visit_gene_collapse_feature(AgnInferExonsVisitor *v,
                                                 GtFeatureNode *mrna,
-                                                GtRange *range,
-                                                GtIntervalTree *featsbyrange)
+                                                GtArray *inferred,
+                                                GtRange *range)
 {
-  GtArray *overlapping = gt_array_new( sizeof(GtFeatureNode *) );
-  gt_interval_tree_find_all_overlapping(featsbyrange, range->start,
-                                        range->end, overlapping);
-  bool collapsed = false;
-  while(gt_array_size(overlapping) > 0)
+  GtFeatureNode *fn = infer_exons_visitor_find(inferred, range);
+  if(fn == NULL)
+    return false;
+
+  gt_feature_node_add_child(mrna, fn);
+  gt_genome_node_ref((GtGenomeNode *)fn);
+  const char *parentattr = gt_feature_node_get_attribute(fn, "Parent");
+  const char *tid = gt_feature_node_get_attribute(mrna, "ID");
+  if(tid != NULL)
   {
-    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_pop(overlapping);
-    GtRange fnrange = gt_genome_node_get_range((GtGenomeNode *)fn);
-    if(gt_range_compare(range, &fnrange) == 0)
+    gt_str_reset(v->parentstr);
+    if(parentattr != NULL)
     {
-      gt_feature_node_add_child(mrna, fn);
-      gt_genome_node_ref((GtGenomeNode *)fn);
-      const char *parentattr = gt_feature_node_get_attribute(fn, "Parent");
-      const char *tid = gt_feature_node_get_attribute(mrna, "ID");
-      if(strlen(tid) > 1023)
-      {
-        gt_logger_log(v->logger, "[AgnInferExonsVisitor::infer_exons_visitor"
-                      "_visit_gene_collapse_feature] mRNA ID is too long (%lu "
-                      "characters), will be truncated\n", strlen(tid));
-      }
-      char parentstr[1024];
-      strncpy(parentstr, parentattr, 1023);
-      sprintf(parentstr + strlen(parentstr), ",%s", tid);
-      gt_feature_node_set_attribute(fn, "Parent", parentstr);
-
-      collapsed = true;
-      break;
+      gt_str_append_cstr(v->parentstr, parentattr);
+      gt_str_append_char(v->parentstr, ',');
     }
+    gt_str_append_cstr(v->parentstr, tid);
+    gt_feature_node_set_attribute(fn, "Parent", gt_str_get(v->parentstr));
   }
-  gt_array_delete(overlapping);
-  return collapsed;
+  return true;
 }
 
 static void
 infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v)
 {
-  GtFeatureNode *fn;
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(v->gene);
-  for(fn  = gt_feature_node_iterator_next(iter);
-      fn != NULL;
-      fn  = gt_feature_node_iterator_next(iter))
+  GtUword m;
+  for(m = 0; m < gt_array_size(v->mrnas); m++)
   {
-    if(!agn_typecheck_mrna(fn))
-     continue;
-
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(v->mrnas, m);
     const char *mrnaid = gt_feature_node_get_attribute(fn, "ID");
     unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)fn);
-    GtArray *cds  = agn_typecheck_select(fn, agn_typecheck_cds);
-    GtArray *utrs = agn_typecheck_select(fn, agn_typecheck_utr);
+    infer_exons_visitor_select(fn, agn_typecheck_cds, v->cds);
+    infer_exons_visitor_select(fn, agn_typecheck_utr, v->utrs);
 
-    bool cds_explicit = gt_array_size(cds) > 0;
+    bool cds_explicit = gt_array_size(v->cds) > 0;
     if(!cds_explicit)
     {
       gt_logger_log(v->logger, "cannot infer missing exons for mRNA '%s' "
@@ -365,49 +609,48 @@ infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v)
     }
 
     GtUword i,j;
-    GtHashmap *adjacent_utrs = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
-    GtArray *exons_to_add = gt_array_new( sizeof(GtRange) );
-    for(i = 0; i < gt_array_size(cds); i++)
+    gt_hashmap_reset(v->adjacent);
+    gt_array_reset(v->ranges);
+    for(i = 0; i < gt_array_size(v->cds); i++)
     {
-      GtGenomeNode **cdssegment = gt_array_get(cds, i);
+      GtGenomeNode **cdssegment = gt_array_get(v->cds, i);
       GtRange crange = gt_genome_node_get_range(*cdssegment);
       GtRange erange = crange;
-      for(j = 0; j < gt_array_size(utrs); j++)
+      for(j = 0; j < gt_array_size(v->utrs); j++)
       {
-        GtGenomeNode **utrsegment = gt_array_get(utrs, j);
+        GtGenomeNode **utrsegment = gt_array_get(v->utrs, j);
         GtRange urange = gt_genome_node_get_range(*utrsegment);
 
         // If the UTR segment is adjacent to the CDS, merge the ranges
         if(urange.end+1 == crange.start || crange.end+1 == urange.start)
         {
           erange = gt_range_join(&erange, &urange);
-          gt_hashmap_add(adjacent_utrs, utrsegment, utrsegment);
+          gt_hashmap_add(v->adjacent, *utrsegment, *utrsegment);
         }
       }
-      gt_array_add(exons_to_add, erange);
+      gt_array_add(v->ranges, erange);
     }
 
     // Now create UTR-only exons
-    for(i = 0; i < gt_array_size(utrs); i++)
+    for(i = 0; i < gt_array_size(v->utrs); i++)
     {
-      GtGenomeNode **utrsegment = gt_array_get(utrs, i);
+      GtGenomeNode **utrsegment = gt_array_get(v->utrs, i);
       GtRange urange = gt_genome_node_get_range(*utrsegment);
-      if(gt_hashmap_get(adjacent_utrs, utrsegment) == NULL)
+      if(gt_hashmap_get(v->adjacent, *utrsegment) == NULL)
       {
-        gt_array_add(exons_to_add, urange);
+        gt_array_add(v->ranges, urange);
       }
     }
 
-    for(i = 0; i < gt_array_size(exons_to_add); i++)
+    for(i = 0; i < gt_array_size(v->ranges); i++)
     {
-      GtRange *erange = gt_array_get(exons_to_add, i);
-      if(infer_exons_visitor_visit_gene_collapse_feature(v, fn, erange,
-                                                         v->exonsbyrange))
-      {
+      GtRange *erange = gt_array_get(v->ranges, i);
+      if(infer_exons_visitor_visit_gene_collapse_feature(v, fn,
+                                                         v->inferredexons,
+                                                         erange))
         continue;
-      }
 
-      GtGenomeNode **firstcds = gt_array_get(cds, 0);
+      GtGenomeNode **firstcds = gt_array_get(v->cds, 0);
       GtGenomeNode *exon = gt_feature_node_new
       (
         gt_genome_node_get_seqid(*firstcds), "exon", erange->start, erange->end,
@@ -420,95 +663,68 @@ infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v)
       if(mrnaid)
         gt_feature_node_add_attribute(fn_exon, "Parent", mrnaid);
       gt_array_add(v->exons, exon);
-      GtIntervalTreeNode *node = gt_interval_tree_node_new(exon, erange->start,
-                                                           erange->end);
-      gt_interval_tree_insert(v->exonsbyrange, node);
+      infer_exons_visitor_insert(v->inferredexons, fn_exon);
     }
-    gt_array_delete(exons_to_add);
 
     if(gt_array_size(v->exons) == 0)
     {
       gt_logger_log(v->logger, "unable to infer exons for mRNA '%s' (line %u)",
                     mrnaid, ln);
     }
-    gt_array_delete(cds);
-    gt_array_delete(utrs);
-    gt_hashmap_delete(adjacent_utrs);
   }
-  gt_feature_node_iterator_delete(iter);
 }
 
-static void
-infer_exons_visitor_visit_gene_infer_introns(AgnInferExonsVisitor *v)
+static bool
+infer_exons_visitor_visit_gene_infer_introns(AgnInferExonsVisitor *v,
+                                             GtFeatureNode *mrna,
+                                             GtArray *exons)
 {
-  GtFeatureNode *fn;
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(v->gene);
-  for(fn  = gt_feature_node_iterator_next(iter);
-      fn != NULL;
-      fn  = gt_feature_node_iterator_next(iter))
+  const char *mrnaid = gt_feature_node_get_attribute(mrna, "ID");
+  unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)mrna);
+  GtUword i;
+  gt_array_reset(v->ranges);
+  for(i = 1; i < gt_array_size(exons); i++)
   {
-    if(!agn_typecheck_mrna(fn))
-     continue;
+    GtGenomeNode **exon1 = gt_array_get(exons, i-1);
+    GtGenomeNode **exon2 = gt_array_get(exons, i);
+    GtRange first_range  = gt_genome_node_get_range(*exon1);
+    GtRange second_range = gt_genome_node_get_range(*exon2);
 
-    const char *mrnaid = gt_feature_node_get_attribute(fn, "ID");
-    unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)fn);
-    GtArray *exons = agn_typecheck_select(fn, agn_typecheck_exon);
-    if(gt_array_size(exons) < 2)
+    if(first_range.end == second_range.start - 1)
     {
-      gt_array_delete(exons);
-      continue;
+      gt_logger_log(v->logger, "mRNA '%s' (line %u) has directly adjacent "
+                    "exons", mrnaid, ln);
+      return false;
     }
-
-    GtUword i;
-    GtArray *introns_to_add = gt_array_new( sizeof(GtRange) );
-    for(i = 1; i < gt_array_size(exons); i++)
+    else
     {
-      GtGenomeNode **exon1 = gt_array_get(exons, i-1);
-      GtGenomeNode **exon2 = gt_array_get(exons, i);
-      GtRange first_range  = gt_genome_node_get_range(*exon1);
-      GtRange second_range = gt_genome_node_get_range(*exon2);
-
-      if(first_range.end == second_range.start - 1)
-      {
-        gt_logger_log(v->logger, "mRNA '%s' (line %u) has directly adjacent "
-                      "exons", mrnaid, ln);
-        return;
-      }
-      else
-      {
-        GtRange irange = { first_range.end + 1, second_range.start - 1 };
-        gt_array_add(introns_to_add, irange);
-      }
+      GtRange irange = { first_range.end + 1, second_range.start - 1 };
+      gt_array_add(v->ranges, irange);
     }
+  }
 
-    for(i = 0; i < gt_array_size(introns_to_add); i++)
-    {
-      GtRange *irange = gt_array_get(introns_to_add, i);
-      if(infer_exons_visitor_visit_gene_collapse_feature(v, fn, irange,
-                                                         v->intronsbyrange))
-      {
-        continue;
-      }
+  for(i = 0; i < gt_array_size(v->ranges); i++)
+  {
+    GtRange *irange = gt_array_get(v->ranges, i);
+    if(infer_exons_visitor_visit_gene_collapse_feature(v, mrna,
+                                                       v->inferredintrons,
+                                                       irange))
+      continue;
 
-      GtGenomeNode **firstexon = gt_array_get(exons, 0);
-      GtGenomeNode *intron = gt_feature_node_new
-      (
-        gt_genome_node_get_seqid(*firstexon), "intron", irange->start,
-        irange->end, gt_feature_node_get_strand(*(GtFeatureNode **)firstexon)
-      );
-      GtFeatureNode *fn_intron = (GtFeatureNode *)intron;
-      if(v->source)
-        gt_feature_node_set_source(fn_intron, v->source);
-      gt_feature_node_add_child(fn, fn_intron);
-      if(mrnaid)
-        gt_feature_node_add_attribute(fn_intron, "Parent", mrnaid);
-      gt_array_add(v->introns, fn_intron);
-      GtIntervalTreeNode *node = gt_interval_tree_node_new(intron,irange->start,
-                                                           irange->end);
-      gt_interval_tree_insert(v->intronsbyrange, node);
-    }
-    gt_array_delete(introns_to_add);
-    gt_array_delete(exons);
+    GtGenomeNode **firstexon = gt_array_get(exons, 0);
+    GtGenomeNode *intron = gt_feature_node_new
+    (
+      gt_genome_node_get_seqid(*firstexon), "intron", irange->start,
+      irange->end, gt_feature_node_get_strand(*(GtFeatureNode **)firstexon)
+    );
+    GtFeatureNode *fn_intron = (GtFeatureNode *)intron;
+    if(v->source)
+      gt_feature_node_set_source(fn_intron, v->source);
+    gt_feature_node_add_child(mrna, fn_intron);
+    if(mrnaid)
+      gt_feature_node_add_attribute(fn_intron, "Parent", mrnaid);
+    gt_array_add(v->introns, fn_intron);
+    infer_exons_visitor_insert(v->inferredintrons, fn_intron);
   }
-  gt_feature_node_iterator_delete(iter);
+  return true;
 }
@@ -15,6 +15,57 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * Per-gene values that can be collected for filtering in a single traversal of
+ * a locus. ``LOCUS_METRIC_NONE`` marks a filter whose function is called
+ * directly.
+ */
+enum LocusFilterMetric
+{
+  LOCUS_METRIC_GENES,
+  LOCUS_METRIC_MRNAS,
+  LOCUS_METRIC_EXONS,
+  LOCUS_METRIC_CDS_LENGTH,
+  LOCUS_METRIC_NONE
+};
+typedef enum LocusFilterMetric LocusFilterMetric;
+
+struct LocusCompiledFilter
+{
+  AgnLocusFilter filter;
+  LocusFilterMetric metric;
+};
+typedef struct LocusCompiledFilter LocusCompiledFilter;
+
+struct AgnLocusFilterSet
+{
+  GtArray *filters;
+  bool metrics[LOCUS_METRIC_NONE];
+  bool bysource;
+};
+
+#ifndef WITHOUT_CAIRO
+/**
+ * The feature index, diagram, and layout of a graphic are built (and deleted)
+ * by the thread that owns the locus, since they take references to its
+ * features; only the canvas is created when the graphic is rendered.
+ */
+struct AgnLocusPng
+{
+  GtFeatureIndex *index;
+  GtStyle *style;
+  GtDiagram *diagram;
+  GtLayout *layout;
+  GtUword width;
+  GtUword height;
+  char filename[512];
+};
+#endif
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -45,6 +96,37 @@ static void locus_clique_array_delete(GtArray *array);
  */
 static void locus_clique_pair_array_delete(GtArray *array);
 
+/**
+ * @function Parse a comma-separated list of mRNA positions at ``*pos`` and
+ * build a clique from the corresponding mRNAs. ``*pos`` is advanced past the
+ * list. Returns NULL if the list is empty or invalid.
+ */
+static AgnTranscriptClique *locus_decode_clique(const char **pos,
+                                                GtArray *mrnas,
+                                                AgnSequenceRegion *region);
+
+/**
+ * @function Parse a semicolon-separated list of cliques at ``*pos``, up to the
+ * next ``|`` or the end of the string, adding them to ``cliques``. Returns false
+ * if any clique is invalid.
+ */
+static bool locus_decode_cliques(const char **pos, GtArray *mrnas,
+                                 AgnSequenceRegion *region, GtArray *cliques);
+
+/**
+ * @function Append the positions (in ``mrnas``) of the clique's transcripts to
+ * ``selection``, separated by commas.
+ */
+static void locus_encode_clique(AgnTranscriptClique *clique, GtArray *mrnas,
+                                GtStr *selection);
+
+/**
+ * @function Append each clique in the array to ``selection``, separated by
+ * semicolons.
+ */
+static void locus_encode_cliques(GtArray *cliques, GtArray *mrnas,
+                                 GtStr *selection);
+
 /**
  * @function If reference transcripts belonging to the same locus overlap, they
  * must be separated before comparison with prediction transcript models (and
@@ -61,6 +143,30 @@ static GtArray *locus_enumerate_cliques(AgnLocus *locus, GtArray *trans);
 static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
                                       GtArray *predcliques);
 
+/**
+ * @function Update an FNV-1a hash with the given bytes.
+ */
+static void locus_hash_bytes(GtUint64 *hash, const void *data, size_t size);
+
+/**
+ * @function Walk the genes of ``locus`` once, storing the value of each metric
+ * needed by ``set`` in ``values``, indexed by source and then by metric.
+ */
+static void locus_filter_collect(AgnLocusFilterSet *set, AgnLocus *locus,
+                                 GtUword values[][LOCUS_METRIC_NONE]);
+
+/**
+ * @function Determine which single-traversal metric, if any, corresponds to the
+ * given filter's function.
+ */
+static LocusFilterMetric locus_filter_metric(AgnLocusFilter *filter);
+
+/**
+ * @function Update a hash with the type, coordinates, and strand of the given
+ * feature and all of its subfeatures.
+ */
+static void locus_hash_feature(GtUint64 *hash, GtFeatureNode *feature);
+
 /**
  * @function Wrapper for gt_genome_node_get_length, for use in locus filtering.
  */
@@ -232,45 +338,139 @@ void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger)
   if(pairs2report != NULL)
     return;
 
-  GtArray *refr_trans = agn_locus_refr_mrnas(locus);
-  GtArray *refrcliques = locus_enumerate_cliques(locus, refr_trans);
-  gt_array_delete(refr_trans);
+  GtArray *refrcliques = agn_locus_refr_cliques(locus);
+  agn_locus_comparative_analysis_shared(locus, refrcliques, logger);
+  if(refrcliques != NULL)
+    locus_clique_array_delete(refrcliques);
+}
+
+void agn_locus_comparative_analysis_shared(AgnLocus *locus,
+                                           GtArray *refrcliques,
+                                           GtLogger *logger)
+{
+  GtArray *pairs2report = gt_genome_node_get_user_data(locus, "pairs2report");
+  if(pairs2report != NULL)
+    return;
+
   GtArray *pred_trans = agn_locus_pred_mrnas(locus);
   GtArray *predcliques = locus_enumerate_cliques(locus, pred_trans);
   gt_array_delete(pred_trans);
 
   if(refrcliques == NULL || predcliques == NULL)
   {
-    if(refrcliques)
-    {
-      while(gt_array_size(refrcliques) > 0)
-      {
-        AgnTranscriptClique **clique = gt_array_pop(refrcliques);
-        agn_transcript_clique_delete(*clique);
-      }
-      gt_array_delete(refrcliques);
-    }
     if(predcliques)
-    {
-      while(gt_array_size(predcliques) > 0)
-      {
-        AgnTranscriptClique **clique = gt_array_pop(predcliques);
-        agn_transcript_clique_delete(*clique);
-      }
-      gt_array_delete(predcliques);
-    }
+      locus_clique_array_delete(predcliques);
     return;
   }
 
-  GtArray *clique_pairs = locus_enumerate_pairs(locus,refrcliques,predcliques);
+  // The selection step releases one reference to each clique
+  GtArray *refrcopy = gt_array_new( sizeof(AgnTranscriptClique *) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(refrcliques); i++)
+  {
+    AgnTranscriptClique *clique;
+    clique = *(AgnTranscriptClique **)gt_array_get(refrcliques, i);
+    gt_genome_node_ref(clique);
+    gt_array_add(refrcopy, clique);
+  }
+
+  GtArray *clique_pairs = locus_enumerate_pairs(locus, refrcopy, predcliques);
   gt_array_sort(clique_pairs, (GtCompare)agn_clique_pair_compare_reverse);
-  locus_select_pairs(locus, refrcliques, predcliques, clique_pairs);
+  locus_select_pairs(locus, refrcopy, predcliques, clique_pairs);
 
-  gt_array_delete(refrcliques);
+  gt_array_delete(refrcopy);
   gt_array_delete(predcliques);
   gt_array_delete(clique_pairs);
 }
 
+bool agn_locus_comparative_analysis_restore(AgnLocus *locus,
+                                            const char *selection)
+{
+  agn_assert(locus && selection);
+  if(agn_locus_pairs_to_report(locus) != NULL)
+    return true;
+
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  GtRange range = gt_genome_node_get_range(locus);
+  AgnSequenceRegion region = { seqid, range };
+  GtArray *refr_trans = agn_locus_refr_mrnas(locus);
+  GtArray *pred_trans = agn_locus_pred_mrnas(locus);
+  GtArray *pairs2report = gt_array_new( sizeof(AgnCliquePair *) );
+  GtArray *uniqrefr = gt_array_new( sizeof(AgnTranscriptClique *) );
+  GtArray *uniqpred = gt_array_new( sizeof(AgnTranscriptClique *) );
+
+  // Encoding: refr/pred;refr/pred;...|uniqrefr;...|uniqpred;...
+  bool success = true;
+  const char *pos = selection;
+  while(*pos != '|' && *pos != '\0')
+  {
+    AgnTranscriptClique *rclique, *pclique = NULL;
+    rclique = locus_decode_clique(&pos, refr_trans, &region);
+    if(rclique != NULL && *pos == '/')
+    {
+      pos++;
+      pclique = locus_decode_clique(&pos, pred_trans, &region);
+    }
+    if(rclique == NULL || pclique == NULL)
+    {
+      if(rclique != NULL)
+        agn_transcript_clique_delete(rclique);
+      success = false;
+      break;
+    }
+    AgnCliquePair *pair = agn_clique_pair_new(rclique, pclique);
+    gt_array_add(pairs2report, pair);
+    agn_transcript_clique_delete(rclique);
+    agn_transcript_clique_delete(pclique);
+    if(*pos == ';')
+      pos++;
+  }
+  success = success && *pos++ == '|' &&
+            locus_decode_cliques(&pos, refr_trans, &region, uniqrefr) &&
+            *pos++ == '|' &&
+            locus_decode_cliques(&pos, pred_trans, &region, uniqpred) &&
+            *pos == '\0';
+  gt_array_delete(refr_trans);
+  gt_array_delete(pred_trans);
+
+  if(!success)
+  {
+    locus_clique_pair_array_delete(pairs2report);
+    locus_clique_array_delete(uniqrefr);
+    locus_clique_array_delete(uniqpred);
+    return false;
+  }
+
+  AgnComparison *stats = gt_genome_node_get_user_data(locus, "compstats");
+  agn_assert(stats != NULL);
+  GtUword i;
+  for(i = 0; i < gt_array_size(pairs2report); i++)
+  {
+    AgnCliquePair *pair = *(AgnCliquePair **)gt_array_get(pairs2report, i);
+    agn_clique_pair_comparison_aggregate(pair, stats);
+  }
+  agn_comparison_resolve(stats);
+  gt_genome_node_add_user_data(locus, "pairs2report", pairs2report,
+                               (GtFree)locus_clique_pair_array_delete);
+
+  if(gt_array_size(uniqrefr) > 0)
+  {
+    gt_genome_node_add_user_data(locus, "uniqrefr", uniqrefr,
+                                 (GtFree)locus_clique_array_delete);
+  }
+  else
+    gt_array_delete(uniqrefr);
+  if(gt_array_size(uniqpred) > 0)
+  {
+    gt_genome_node_add_user_data(locus, "uniqpred", uniqpred,
+                                 (GtFree)locus_clique_array_delete);
+  }
+  else
+    gt_array_delete(uniqpred);
+
+  return true;
+}
+
 int agn_locus_array_compare(const void *p1, const void *p2)
 {
   AgnLocus *l1 = *(AgnLocus **)p1;
@@ -293,6 +493,33 @@ void agn_locus_comparison_aggregate(AgnLocus *locus, AgnComparison *comp)
   agn_comparison_aggregate(comp, stats);
 }
 
+GtUint64 agn_locus_content_hash(AgnLocus *locus)
+{
+  GtUint64 hash = 14695981039346656037ULL;
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  GtRange range = gt_genome_node_get_range(locus);
+  locus_hash_bytes(&hash, gt_str_get(seqid), gt_str_length(seqid) + 1);
+  locus_hash_bytes(&hash, &range.start, sizeof(range.start));
+  locus_hash_bytes(&hash, &range.end, sizeof(range.end));
+
+  AgnComparisonSource sources[] = { REFERENCESOURCE, PREDICTIONSOURCE };
+  GtUword i, j;
+  for(i = 0; i < 2; i++)
+  {
+    GtArray *mrnas = agn_locus_mrnas(locus, sources[i]);
+    GtUword nummrnas = gt_array_size(mrnas);
+    locus_hash_bytes(&hash, &nummrnas, sizeof(nummrnas));
+    for(j = 0; j < nummrnas; j++)
+    {
+      GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, j);
+      locus_hash_feature(&hash, mrna);
+    }
+    gt_array_delete(mrnas);
+  }
+
+  return hash;
+}
+
 void agn_locus_data_aggregate(AgnLocus *locus, AgnComparisonData *data)
 {
   GtUword numrefrgenes, numpredgenes;
@@ -438,19 +665,7 @@ void agn_locus_filter_parse(FILE *filterfile, GtArray *filters)
       exit(1);
     }
 
-    if(strcmp(opstr, ">") == 0)
-      filter.operator = AGN_LOCUS_FILTER_GT;
-    else if(strcmp(opstr, ">=") == 0)
-      filter.operator = AGN_LOCUS_FILTER_GE;
-    else if(strcmp(opstr, "<") == 0)
-      filter.operator = AGN_LOCUS_FILTER_LT;
-    else if(strcmp(opstr, "<=") == 0)
-      filter.operator = AGN_LOCUS_FILTER_LE;
-    else if(strcmp(opstr, "=") == 0)
-      filter.operator = AGN_LOCUS_FILTER_EQ;
-    else if(strcmp(opstr, "<>") == 0)
-      filter.operator = AGN_LOCUS_FILTER_NO;
-    else
+    if(!agn_locus_filter_op_parse(opstr, &filter.operator))
     {
       fprintf(stderr, "[AgnLocus::agn_locus_filter_parse] invalid operator "
               "'%s'", opstr);
@@ -486,41 +701,136 @@ bool agn_locus_filter_test(AgnLocus *locus, AgnLocusFilter *filter)
     return true;
 
   value = filter->function(locus, filter->src);
-  if(filter->operator == AGN_LOCUS_FILTER_EQ)
-  {
-    if(value == filter->testvalue)
-      return true;
-  }
-  else if(filter->operator == AGN_LOCUS_FILTER_NE)
-  {
-    if(value != filter->testvalue)
-      return true;
-  }
-  else if(filter->operator == AGN_LOCUS_FILTER_GT)
-  {
-    if(value > filter->testvalue)
-      return true;
-  }
-  else if(filter->operator == AGN_LOCUS_FILTER_GE)
-  {
-    if(value >= filter->testvalue)
-      return true;
-  }
-  else if(filter->operator == AGN_LOCUS_FILTER_LT)
+  return agn_locus_filter_op_test(filter->operator, value, filter->testvalue);
+}
+
+bool agn_locus_filter_op_parse(const char *opstr, AgnLocusFilterOp *op)
+{
+  agn_assert(opstr && op);
+  if(strcmp(opstr, ">") == 0)
+    *op = AGN_LOCUS_FILTER_GT;
+  else if(strcmp(opstr, ">=") == 0)
+    *op = AGN_LOCUS_FILTER_GE;
+  else if(strcmp(opstr, "<") == 0)
+    *op = AGN_LOCUS_FILTER_LT;
+  else if(strcmp(opstr, "<=") == 0)
+    *op = AGN_LOCUS_FILTER_LE;
+  else if(strcmp(opstr, "=") == 0)
+    *op = AGN_LOCUS_FILTER_EQ;
+  else if(strcmp(opstr, "!=") == 0)
+    *op = AGN_LOCUS_FILTER_NE;
+  else if(strcmp(opstr, "<>") == 0)
+    *op = AGN_LOCUS_FILTER_NO;
+  else
+    return false;
+  return true;
+}
+
+bool agn_locus_filter_op_test(AgnLocusFilterOp op, double value,
+                              double testvalue)
+{
+  switch(op)
   {
-    if(value < filter->testvalue)
-      return true;
+    case AGN_LOCUS_FILTER_EQ: return value == testvalue;
+    case AGN_LOCUS_FILTER_NE: return value != testvalue;
+    case AGN_LOCUS_FILTER_GT: return value >  testvalue;
+    case AGN_LOCUS_FILTER_GE: return value >= testvalue;
+    case AGN_LOCUS_FILTER_LT: return value <  testvalue;
+    case AGN_LOCUS_FILTER_LE: return value <= testvalue;
+    case AGN_LOCUS_FILTER_NO: return true;
   }
-  else if(filter->operator == AGN_LOCUS_FILTER_LE)
+  return false;
+}
+
+void agn_locus_filter_set_delete(AgnLocusFilterSet *set)
+{
+  if(set == NULL)
+    return;
+  gt_array_delete(set->filters);
+  gt_free(set);
+}
+
+AgnLocusFilterSet *agn_locus_filter_set_new(GtArray *filters, bool countsonly)
+{
+  AgnLocusFilterSet *set;
+  GtUword i, pass;
+  agn_assert(filters);
+
+  set = gt_malloc( sizeof(AgnLocusFilterSet) );
+  set->filters = gt_array_new( sizeof(LocusCompiledFilter) );
+  for(i = 0; i < LOCUS_METRIC_NONE; i++)
+    set->metrics[i] = false;
+  set->bysource = false;
+
+  // Order filters by cost: locus length needs no traversal, the metrics share
+  // a single traversal, and any other function does its own.
+  for(pass = 0; pass < 3; pass++)
   {
-    if(value <= filter->testvalue)
-      return true;
+    for(i = 0; i < gt_array_size(filters); i++)
+    {
+      LocusCompiledFilter compiled;
+      compiled.filter = *(AgnLocusFilter *)gt_array_get(filters, i);
+      compiled.metric = locus_filter_metric(&compiled.filter);
+      if(compiled.filter.operator == AGN_LOCUS_FILTER_NO)
+        continue;
+      if(countsonly && compiled.metric != LOCUS_METRIC_GENES &&
+         compiled.metric != LOCUS_METRIC_MRNAS)
+        continue;
+
+      bool islength = compiled.filter.function == locus_length;
+      if((pass == 0 && !islength) ||
+         (pass == 1 && compiled.metric == LOCUS_METRIC_NONE) ||
+         (pass == 2 && (islength || compiled.metric != LOCUS_METRIC_NONE)))
+        continue;
+
+      if(compiled.metric != LOCUS_METRIC_NONE)
+      {
+        set->metrics[compiled.metric] = true;
+        if(compiled.filter.src != DEFAULTSOURCE)
+          set->bysource = true;
+      }
+      gt_array_add(set->filters, compiled);
+    }
   }
-  else if(filter->operator == AGN_LOCUS_FILTER_NO)
+
+  return set;
+}
+
+GtUword agn_locus_filter_set_size(AgnLocusFilterSet *set)
+{
+  agn_assert(set);
+  return gt_array_size(set->filters);
+}
+
+bool agn_locus_filter_set_test(AgnLocusFilterSet *set, AgnLocus *locus)
+{
+  GtUword values[DEFAULTSOURCE + 1][LOCUS_METRIC_NONE];
+  bool collected = false;
+  GtUword i;
+  agn_assert(set && locus);
+
+  for(i = 0; i < gt_array_size(set->filters); i++)
   {
-    return true;
+    LocusCompiledFilter *compiled = gt_array_get(set->filters, i);
+    AgnLocusFilter *filter = &compiled->filter;
+    GtUword value;
+    if(compiled->metric == LOCUS_METRIC_NONE)
+      value = filter->function(locus, filter->src);
+    else
+    {
+      if(!collected)
+      {
+        locus_filter_collect(set, locus, values);
+        collected = true;
+      }
+      value = values[filter->src][compiled->metric];
+    }
+
+    if(!agn_locus_filter_op_test(filter->operator, value, filter->testvalue))
+      return false;
   }
-  return false;
+
+  return true;
 }
 
 GtArray *agn_locus_get(AgnLocus *locus)
@@ -801,17 +1111,28 @@ void agn_locus_png_track_selector(GtBlock *block, GtStr *track, void *data)
 #endif
 
 #ifndef WITHOUT_CAIRO
-void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
+void agn_locus_png_delete(AgnLocusPng *png)
+{
+  agn_assert(png);
+  gt_layout_delete(png->layout);
+  gt_diagram_delete(png->diagram);
+  gt_feature_index_delete(png->index);
+  gt_style_delete(png->style);
+  gt_free(png);
+}
+
+AgnLocusPng *agn_locus_png_new(AgnLocus *locus, AgnLocusPngMetadata *metadata)
 {
   GtError *error = gt_error_new();
-  GtFeatureIndex *index = gt_feature_index_memory_new();
-  GtUword i, graphic_width;
+  AgnLocusPng *png = gt_malloc( sizeof(AgnLocusPng) );
+  png->index = gt_feature_index_memory_new();
+  GtUword i;
 
   GtArray *refr_trans = agn_locus_refr_mrnas(locus);
   for(i = 0; i < gt_array_size(refr_trans); i++)
   {
     GtFeatureNode *trans = *(GtFeatureNode **)gt_array_get(refr_trans, i);
-    gt_feature_index_add_feature_node(index, trans, error);
+    gt_feature_index_add_feature_node(png->index, trans, error);
     if(gt_error_is_set(error))
     {
       fprintf(stderr, "error: %s\n", gt_error_get(error));
@@ -824,7 +1145,7 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
   for(i = 0; i < gt_array_size(pred_trans); i++)
   {
     GtFeatureNode *trans = *(GtFeatureNode **)gt_array_get(pred_trans, i);
-    gt_feature_index_add_feature_node(index, trans, error);
+    gt_feature_index_add_feature_node(png->index, trans, error);
     if(gt_error_is_set(error))
     {
       fprintf(stderr, "error: %s\n", gt_error_get(error));
@@ -835,76 +1156,84 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
 
   // Determine graphic width
   double scaling_factor = 0.05;
-  graphic_width = gt_genome_node_get_length(locus) * scaling_factor;
-  if(graphic_width < 650)
-    graphic_width = 650;
-  if(graphic_width > 10000)
-    graphic_width = 10000;
+  png->width = gt_genome_node_get_length(locus) * scaling_factor;
+  if(png->width < 650)
+    png->width = 650;
+  if(png->width > 10000)
+    png->width = 10000;
 
   // Generate the graphic...this is going to get a bit hairy
-  GtStyle *style;
-  if(!(style = gt_style_new(error)))
+  if(!(png->style = gt_style_new(error)))
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-  if(gt_style_load_file(style, metadata->stylefile, error))
+  if(gt_style_load_file(png->style, metadata->stylefile, error))
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
   GtStr *seqid = gt_genome_node_get_seqid(locus);
   GtRange locusrange = gt_genome_node_get_range(locus);
-  GtDiagram *diagram = gt_diagram_new(index, gt_str_get(seqid), &locusrange,
-                                      style, error);
-  gt_diagram_set_track_selector_func(diagram,
+  png->diagram = gt_diagram_new(png->index, gt_str_get(seqid), &locusrange,
+                                png->style, error);
+  gt_diagram_set_track_selector_func(png->diagram,
       (GtTrackSelectorFunc)agn_locus_png_track_selector, metadata
   );
-  GtLayout *layout = gt_layout_new(diagram, graphic_width, style, error);
-  if(!layout)
+  png->layout = gt_layout_new(png->diagram, png->width, png->style, error);
+  if(!png->layout)
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-  gt_layout_set_track_ordering_func(layout,
+  gt_layout_set_track_ordering_func(png->layout,
       (GtTrackOrderingFunc)locus_track_order, NULL
   );
-  GtUword image_height;
-  if(gt_layout_get_height(layout, &image_height, error))
+  if(gt_layout_get_height(png->layout, &png->height, error))
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-  GtCanvas *canvas = gt_canvas_cairo_file_new(style, GT_GRAPHICS_PNG,
-                                              graphic_width, image_height, NULL,
+
+  sprintf(png->filename, metadata->filename_template, gt_str_get(seqid),
+          gt_str_get(seqid), locusrange.start, locusrange.end);
+  gt_error_delete(error);
+  return png;
+}
+
+void agn_locus_png_render(AgnLocusPng *png)
+{
+  agn_assert(png);
+  GtError *error = gt_error_new();
+  GtCanvas *canvas = gt_canvas_cairo_file_new(png->style, GT_GRAPHICS_PNG,
+                                              png->width, png->height, NULL,
                                               error);
   if(!canvas)
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-  if(gt_layout_sketch(layout, canvas, error))
+  if(gt_layout_sketch(png->layout, canvas, error))
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-
-  char pngfile[512];
-  sprintf(pngfile, metadata->filename_template, gt_str_get(seqid),
-          gt_str_get(seqid), locusrange.start, locusrange.end);
-  if(gt_canvas_cairo_file_to_file((GtCanvasCairoFile*) canvas, pngfile, error))
+  if(gt_canvas_cairo_file_to_file((GtCanvasCairoFile*) canvas, png->filename,
+                                  error))
   {
     fprintf(stderr, "error: %s\n", gt_error_get(error));
     exit(EXIT_FAILURE);
   }
-
-  gt_feature_index_delete(index);
   gt_canvas_delete(canvas);
-  gt_layout_delete(layout);
-  gt_diagram_delete(diagram);
-  gt_style_delete(style);
   gt_error_delete(error);
 }
+
+void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
+{
+  AgnLocusPng *png = agn_locus_png_new(locus, metadata);
+  agn_locus_png_render(png);
+  agn_locus_png_delete(png);
+}
 #endif
 
 void agn_locus_print_transcript_mapping(AgnLocus *locus, FILE *outstream)
@@ -921,6 +1250,84 @@ void agn_locus_print_transcript_mapping(AgnLocus *locus, FILE *outstream)
   gt_array_delete(transids);
 }
 
+bool agn_locus_selection_encode(AgnLocus *locus, GtStr *selection)
+{
+  agn_assert(locus && selection);
+  GtArray *pairs2report = agn_locus_pairs_to_report(locus);
+  if(pairs2report == NULL)
+    return false;
+
+  GtArray *refr_trans = agn_locus_refr_mrnas(locus);
+  GtArray *pred_trans = agn_locus_pred_mrnas(locus);
+  GtUword i;
+  gt_str_reset(selection);
+  for(i = 0; i < gt_array_size(pairs2report); i++)
+  {
+    AgnCliquePair *pair = *(AgnCliquePair **)gt_array_get(pairs2report, i);
+    if(i > 0)
+      gt_str_append_char(selection, ';');
+    locus_encode_clique(agn_clique_pair_get_refr_clique(pair), refr_trans,
+                        selection);
+    gt_str_append_char(selection, '/');
+    locus_encode_clique(agn_clique_pair_get_pred_clique(pair), pred_trans,
+                        selection);
+  }
+  gt_str_append_char(selection, '|');
+  locus_encode_cliques(agn_locus_get_unique_refr_cliques(locus), refr_trans,
+                       selection);
+  gt_str_append_char(selection, '|');
+  locus_encode_cliques(agn_locus_get_unique_pred_cliques(locus), pred_trans,
+                       selection);
+  gt_array_delete(refr_trans);
+  gt_array_delete(pred_trans);
+
+  return true;
+}
+
+GtArray *agn_locus_refr_cliques(AgnLocus *locus)
+{
+  agn_assert(locus);
+  GtArray *refr_trans = agn_locus_refr_mrnas(locus);
+  GtArray *refrcliques = locus_enumerate_cliques(locus, refr_trans);
+  gt_array_delete(refr_trans);
+  return refrcliques;
+}
+
+AgnLocus *agn_locus_select_prediction(AgnLocus *locus, const char *predfile)
+{
+  agn_assert(locus && predfile);
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  AgnLocus *newlocus = agn_locus_new(seqid);
+  GtHashmap *refr_feats = gt_genome_node_get_user_data(locus, "refrfeats");
+  GtHashmap *pred_feats = gt_genome_node_get_user_data(locus, "predfeats");
+
+  GtFeatureNode *locusfn = gt_feature_node_cast(locus);
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(locusfn);
+  GtFeatureNode *fn;
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    const char *filename = gt_genome_node_get_filename((GtGenomeNode *)fn);
+    if(refr_feats != NULL && gt_hashmap_get(refr_feats, fn) != NULL)
+    {
+      gt_genome_node_ref((GtGenomeNode *)fn);
+      agn_locus_add_refr_feature(newlocus, fn);
+    }
+    else if(pred_feats != NULL && gt_hashmap_get(pred_feats, fn) != NULL &&
+            strcmp(filename, predfile) == 0)
+    {
+      gt_genome_node_ref((GtGenomeNode *)fn);
+      agn_locus_add_pred_feature(newlocus, fn);
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  GtRange range = gt_genome_node_get_range(locus);
+  agn_locus_set_range(newlocus, range.start, range.end);
+  return newlocus;
+}
+
 void agn_locus_set_range(AgnLocus *locus, GtUword start, GtUword end)
 {
   if(start > end)
@@ -1056,7 +1463,33 @@ bool agn_locus_unit_test(AgnUnitTest *test)
   agn_comparison_resolve(&stats);
   bool grapetest2 = agn_comparison_test(&stats, &c);
   agn_unit_test_result(test, "grape test 2", grapetest2);
+
+  GtStr *selection = gt_str_new();
+  bool restoretest = agn_locus_selection_encode(locus, selection);
+  GtUint64 hash = agn_locus_content_hash(locus);
+  agn_locus_delete(locus);
+  GtQueue *restorequeue = gt_queue_new();
+  locus_test_data(restorequeue);
+  locus = gt_queue_get(restorequeue);
+  restoretest = restoretest && hash != agn_locus_content_hash(locus);
+  agn_locus_delete(locus);
+  locus = gt_queue_get(restorequeue);
+  restoretest = restoretest && hash == agn_locus_content_hash(locus) &&
+                agn_locus_comparative_analysis_restore(locus,
+                                                       gt_str_get(selection));
+  agn_comparison_init(&stats);
+  agn_locus_comparison_aggregate(locus, &stats);
+  agn_comparison_resolve(&stats);
+  restoretest = restoretest && agn_comparison_test(&stats, &c);
+  agn_unit_test_result(test, "restore selection", restoretest);
   agn_locus_delete(locus);
+  while(gt_queue_size(restorequeue) > 0)
+  {
+    locus = gt_queue_get(restorequeue);
+    agn_locus_delete(locus);
+  }
+  gt_queue_delete(restorequeue);
+  gt_str_delete(selection);
 
   AgnLocus *locus1 = gt_queue_get(queue);
   AgnLocus *locus2 = gt_queue_get(queue);
@@ -1085,6 +1518,32 @@ bool agn_locus_unit_test(AgnUnitTest *test)
                 agn_locus_filter_test(locus1, &filter) &&
                 !agn_locus_filter_test(locus2, &filter);
   agn_unit_test_result(test, "filter by exon number", exonnumtest);
+
+  GtArray *filters = gt_array_new( sizeof(AgnLocusFilter) );
+  filter.function = agn_locus_cds_length;
+  filter.testvalue = 813;
+  filter.operator = AGN_LOCUS_FILTER_LE;
+  gt_array_add(filters, filter);
+  filter.function = agn_locus_exon_num;
+  filter.testvalue = 7;
+  filter.operator = AGN_LOCUS_FILTER_NE;
+  gt_array_add(filters, filter);
+  AgnLocusFilterSet *set = agn_locus_filter_set_new(filters, false);
+  bool filtersettest = agn_locus_filter_set_size(set) == 2 &&
+                       agn_locus_filter_set_test(set, locus1) &&
+                       !agn_locus_filter_set_test(set, locus2);
+  agn_locus_filter_set_delete(set);
+  filter.function = agn_locus_gene_num;
+  filter.testvalue = 1;
+  filter.operator = AGN_LOCUS_FILTER_GE;
+  gt_array_add(filters, filter);
+  set = agn_locus_filter_set_new(filters, true);
+  filtersettest = filtersettest && agn_locus_filter_set_size(set) == 1 &&
+                  agn_locus_filter_set_test(set, locus1) &&
+                  agn_locus_filter_set_test(set, locus2);
+  agn_locus_filter_set_delete(set);
+  gt_array_delete(filters);
+  agn_unit_test_result(test, "compiled filter set", filtersettest);
   agn_locus_delete(locus1);
   agn_locus_delete(locus2);
 
@@ -1165,6 +1624,86 @@ static void locus_clique_pair_array_delete(GtArray *array)
   gt_array_delete(array);
 }
 
+static AgnTranscriptClique *locus_decode_clique(const char **pos,
+                                                GtArray *mrnas,
+                                                AgnSequenceRegion *region)
+{
+  AgnTranscriptClique *clique = NULL;
+  while(**pos >= '0' && **pos <= '9')
+  {
+    char *end;
+    GtUword index = strtoul(*pos, &end, 10);
+    *pos = end;
+    if(index >= gt_array_size(mrnas))
+    {
+      if(clique != NULL)
+        agn_transcript_clique_delete(clique);
+      return NULL;
+    }
+
+    if(clique == NULL)
+      clique = agn_transcript_clique_new(region);
+    GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, index);
+    agn_transcript_clique_add(clique, mrna);
+    if(**pos == ',')
+      (*pos)++;
+  }
+  return clique;
+}
+
+static bool locus_decode_cliques(const char **pos, GtArray *mrnas,
+                                 AgnSequenceRegion *region, GtArray *cliques)
+{
+  while(**pos != '|' && **pos != '\0')
+  {
+    AgnTranscriptClique *clique = locus_decode_clique(pos, mrnas, region);
+    if(clique == NULL)
+      return false;
+    gt_array_add(cliques, clique);
+    if(**pos == ';')
+      (*pos)++;
+  }
+  return true;
+}
+
+static void locus_encode_clique(AgnTranscriptClique *clique, GtArray *mrnas,
+                                GtStr *selection)
+{
+  GtArray *trans = agn_transcript_clique_to_array(clique);
+  GtUword i, j;
+  for(i = 0; i < gt_array_size(trans); i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(trans, i);
+    for(j = 0; j < gt_array_size(mrnas); j++)
+    {
+      if(*(GtFeatureNode **)gt_array_get(mrnas, j) == fn)
+        break;
+    }
+    agn_assert(j < gt_array_size(mrnas));
+    if(i > 0)
+      gt_str_append_char(selection, ',');
+    gt_str_append_ulong(selection, j);
+  }
+  gt_array_delete(trans);
+}
+
+static void locus_encode_cliques(GtArray *cliques, GtArray *mrnas,
+                                 GtStr *selection)
+{
+  GtUword i;
+  if(cliques == NULL)
+    return;
+
+  for(i = 0; i < gt_array_size(cliques); i++)
+  {
+    AgnTranscriptClique *clique;
+    clique = *(AgnTranscriptClique **)gt_array_get(cliques, i);
+    if(i > 0)
+      gt_str_append_char(selection, ';');
+    locus_encode_clique(clique, mrnas, selection);
+  }
+}
+
 static GtArray *locus_enumerate_cliques(AgnLocus *locus, GtArray *trans)
 {
   if(gt_array_size(trans) == 0)
@@ -1234,6 +1773,116 @@ static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
   return clique_pairs;
 }
 
+static void locus_filter_collect(AgnLocusFilterSet *set, AgnLocus *locus,
+                                 GtUword values[][LOCUS_METRIC_NONE])
+{
+  GtHashmap *refr_feats = NULL, *pred_feats = NULL;
+  GtUword src, i;
+  for(src = 0; src <= DEFAULTSOURCE; src++)
+  {
+    for(i = 0; i < LOCUS_METRIC_NONE; i++)
+      values[src][i] = 0;
+  }
+  if(set->bysource)
+  {
+    refr_feats = gt_genome_node_get_user_data(locus, "refrfeats");
+    pred_feats = gt_genome_node_get_user_data(locus, "predfeats");
+  }
+  bool subfeatures = set->metrics[LOCUS_METRIC_MRNAS] ||
+                     set->metrics[LOCUS_METRIC_EXONS] ||
+                     set->metrics[LOCUS_METRIC_CDS_LENGTH];
+
+  GtFeatureNode *fn = gt_feature_node_cast(locus);
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    if(!agn_typecheck_gene(feature))
+      continue;
+
+    GtUword genevalues[LOCUS_METRIC_NONE] = { 1, 0, 0, 0 };
+    if(subfeatures)
+    {
+      GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(feature);
+      GtFeatureNode *subfeature;
+      for(subfeature  = gt_feature_node_iterator_next(subiter);
+          subfeature != NULL;
+          subfeature  = gt_feature_node_iterator_next(subiter))
+      {
+        if(agn_typecheck_mrna(subfeature))
+        {
+          genevalues[LOCUS_METRIC_MRNAS]++;
+          if(set->metrics[LOCUS_METRIC_CDS_LENGTH])
+          {
+            GtUword cdslength = agn_mrna_cds_length(subfeature);
+            genevalues[LOCUS_METRIC_CDS_LENGTH] += cdslength;
+          }
+        }
+        else if(agn_typecheck_exon(subfeature))
+          genevalues[LOCUS_METRIC_EXONS]++;
+      }
+      gt_feature_node_iterator_delete(subiter);
+    }
+
+    bool inrefr = refr_feats && gt_hashmap_get(refr_feats, feature) != NULL;
+    bool inpred = pred_feats && gt_hashmap_get(pred_feats, feature) != NULL;
+    for(i = 0; i < LOCUS_METRIC_NONE; i++)
+    {
+      values[DEFAULTSOURCE][i] += genevalues[i];
+      if(inrefr)
+        values[REFERENCESOURCE][i] += genevalues[i];
+      if(inpred)
+        values[PREDICTIONSOURCE][i] += genevalues[i];
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+static LocusFilterMetric locus_filter_metric(AgnLocusFilter *filter)
+{
+  if(filter->function == agn_locus_gene_num)
+    return LOCUS_METRIC_GENES;
+  else if(filter->function == agn_locus_mrna_num)
+    return LOCUS_METRIC_MRNAS;
+  else if(filter->function == agn_locus_exon_num)
+    return LOCUS_METRIC_EXONS;
+  else if(filter->function == agn_locus_cds_length)
+    return LOCUS_METRIC_CDS_LENGTH;
+  return LOCUS_METRIC_NONE;
+}
+
+static void locus_hash_bytes(GtUint64 *hash, const void *data, size_t size)
+{
+  const unsigned char *bytes = data;
+  size_t i;
+  for(i = 0; i < size; i++)
+  {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ULL;
+  }
+}
+
+static void locus_hash_feature(GtUint64 *hash, GtFeatureNode *feature)
+{
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(feature);
+  GtFeatureNode *fn;
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    const char *type = gt_feature_node_get_type(fn);
+    GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+    GtStrand strand = gt_feature_node_get_strand(fn);
+    locus_hash_bytes(hash, type, strlen(type) + 1);
+    locus_hash_bytes(hash, &range.start, sizeof(range.start));
+    locus_hash_bytes(hash, &range.end, sizeof(range.end));
+    locus_hash_bytes(hash, &strand, sizeof(strand));
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
 static GtUword locus_length(AgnLocus *locus,
                             GT_UNUSED AgnComparisonSource source)
 {
@@ -18,7 +18,7 @@ struct AgnLocusFilterStream
 {
   const GtNodeStream parent_instance;
   GtNodeStream *in_stream;
-  GtArray *filters;
+  AgnLocusFilterSet *filters;
 };
 
 
@@ -62,9 +62,13 @@ GtNodeStream* agn_locus_filter_stream_new(GtNodeStream *in_stream,
   stream->in_stream = gt_node_stream_ref(in_stream);
 
   if(filters == NULL)
-    stream->filters = gt_array_new( sizeof(AgnLocusFilter) );
+  {
+    filters = gt_array_new( sizeof(AgnLocusFilter) );
+    stream->filters = agn_locus_filter_set_new(filters, false);
+    gt_array_delete(filters);
+  }
   else
-    stream->filters = gt_array_ref(filters);
+    stream->filters = agn_locus_filter_set_new(filters, false);
 
   return ns;
 }
@@ -85,7 +89,7 @@ static void locus_filter_stream_free(GtNodeStream *ns)
 {
   AgnLocusFilterStream *stream = locus_filter_stream_cast(ns);
   gt_node_stream_delete(stream->in_stream);
-  gt_array_delete(stream->filters);
+  agn_locus_filter_set_delete(stream->filters);
 }
 
 static int locus_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
@@ -93,13 +97,11 @@ static int locus_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
 {
   AgnLocusFilterStream *stream;
   GtFeatureNode *fn;
-  GtUword i;
   gt_error_check(error);
   stream = locus_filter_stream_cast(ns);
 
   while(1)
   {
-    bool keeplocus = true;
     int had_err = gt_node_stream_next(stream->in_stream, gn, error);
     if(had_err)
       return had_err;
@@ -111,17 +113,7 @@ static int locus_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
       return 0;
 
     agn_assert(gt_feature_node_has_type(fn, "locus"));
-    for(i = 0; i < gt_array_size(stream->filters); i++)
-    {
-      AgnLocusFilter *filter = gt_array_get(stream->filters, i);
-      if(agn_locus_filter_test(*gn, filter) == false)
-      {
-        keeplocus = false;
-        break;
-      }
-    }
-
-    if(keeplocus)
+    if(agn_locus_filter_set_test(stream->filters, *gn))
       return 0;
     else
     {
@@ -12,7 +12,8 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include <math.h>
 #include "core/queue_api.h"
 #include "extended/sort_stream_api.h"
-#include "AgnGeneStream.h"
+#include "AgnCanonStream.h"
+#include "AgnGFF3InStream.h"
 #include "AgnLocus.h"
 #include "AgnLocusStream.h"
 #include "AgnLocusRefineStream.h"
@@ -881,18 +882,21 @@ static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
   GtNodeStream *current_stream, *last_stream;
   GtQueue *streams = gt_queue_new();
 
-  current_stream = gt_gff3_in_stream_new_unsorted(1, &filename);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  current_stream = agn_gff3_in_stream_new(1, &filename, NULL);
+  bool sorted = agn_gff3_in_stream_is_sorted((AgnGFF3InStream *)
+                                             current_stream);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = gt_sort_stream_new(last_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(!sorted)
+  {
+    current_stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
 
   GtLogger *logger = gt_logger_new(true, "", stderr);
-  current_stream = agn_gene_stream_new(last_stream, logger);
+  current_stream = agn_canon_stream_new(last_stream, logger);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
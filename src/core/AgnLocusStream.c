@@ -10,9 +10,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 #include <string.h>
 #include "core/queue_api.h"
+#include "core/str_array_api.h"
 #include "extended/feature_index_memory_api.h"
 #include "extended/sort_stream_api.h"
-#include "AgnGeneStream.h"
+#include "AgnCanonStream.h"
+#include "AgnGFF3InStream.h"
 #include "AgnInferParentStream.h"
 #include "AgnLocusStream.h"
 #include "AgnLocus.h"
@@ -40,8 +42,9 @@ struct AgnLocusStream
   GtStr *source;
   GtStr *nameformat;
   char *refrfile;
-  char *predfile;
+  GtStrArray *predfiles;
   FILE *ilenfile;
+  AgnLocusFilterSet *filters;
 };
 
 //------------------------------------------------------------------------------
@@ -88,6 +91,14 @@ static void locus_stream_mint(AgnLocusStream *stream, AgnLocus *locus);
 static int locus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
                              GtError *error);
 
+/**
+ * @function Produce the next node for the output stream. If the locus just
+ * collected was rejected by the stream's filters, ``gn`` is set to NULL while
+ * input remains buffered.
+ */
+static int locus_stream_next_node(AgnLocusStream *stream, GtGenomeNode **gn,
+                                  GtError *error);
+
 /**
  * @function Callback function: store region nodes in a feature index to enable
  * computing end locus coordinates correctly.
@@ -122,16 +133,25 @@ static void locus_stream_unit_test_loci(AgnUnitTest *test);
 // Method definitions
 //------------------------------------------------------------------------------
 
-void agn_locus_stream_label_pairwise(AgnLocusStream *stream,
-                                     const char *refrfile, const char *predfile)
+void agn_locus_stream_label_multiway(AgnLocusStream *stream,
+                                     const char *refrfile, int numpreds,
+                                     const char **predfiles)
 {
-  agn_assert(stream);
+  int i;
+  agn_assert(stream && refrfile && numpreds > 0 && predfiles);
   if(stream->refrfile != NULL)
     gt_free(stream->refrfile);
   stream->refrfile = gt_cstr_dup(refrfile);
-  if(stream->predfile != NULL)
-    gt_free(stream->predfile);
-  stream->predfile = gt_cstr_dup(predfile);
+  gt_str_array_delete(stream->predfiles);
+  stream->predfiles = gt_str_array_new();
+  for(i = 0; i < numpreds; i++)
+    gt_str_array_add_cstr(stream->predfiles, predfiles[i]);
+}
+
+void agn_locus_stream_label_pairwise(AgnLocusStream *stream,
+                                     const char *refrfile, const char *predfile)
+{
+  agn_locus_stream_label_multiway(stream, refrfile, 1, &predfile);
 }
 
 GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
@@ -150,8 +170,9 @@ GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
   stream->source = gt_str_new_cstr("AEGeAn::AgnLocusStream");
   stream->nameformat = NULL;
   stream->refrfile = NULL;
-  stream->predfile = NULL;
+  stream->predfiles = NULL;
   stream->ilenfile = NULL;
+  stream->filters = NULL;
   return ns;
 }
 
@@ -161,6 +182,18 @@ void agn_locus_stream_set_endmode(AgnLocusStream *stream, int endmode)
   stream->endmode = endmode;
 }
 
+void agn_locus_stream_set_filters(AgnLocusStream *stream, GtArray *filters)
+{
+  agn_assert(stream && filters);
+  agn_locus_filter_set_delete(stream->filters);
+  stream->filters = agn_locus_filter_set_new(filters, true);
+  if(agn_locus_filter_set_size(stream->filters) == 0)
+  {
+    agn_locus_filter_set_delete(stream->filters);
+    stream->filters = NULL;
+  }
+}
+
 void agn_locus_stream_set_name_format(AgnLocusStream *stream, const char *fmt)
 {
   agn_assert(stream && fmt);
@@ -201,33 +234,38 @@ static int locus_stream_add_feature(AgnLocusStream *stream, AgnLocus *locus,
   if(stream->refrfile == NULL)
   {
     agn_locus_add_feature(locus, feature);
+    return 0;
   }
-  else
+
+  const char * filename = gt_genome_node_get_filename((GtGenomeNode*)feature);
+  if(strcmp(filename, stream->refrfile) == 0)
   {
-    const char * filename = gt_genome_node_get_filename((GtGenomeNode*)feature);
-    if(strcmp(filename, stream->refrfile) == 0)
-      agn_locus_add_refr_feature(locus, feature);
-    else if(strcmp(filename, stream->predfile) == 0)
-      agn_locus_add_pred_feature(locus, feature);
-    else
+    agn_locus_add_refr_feature(locus, feature);
+    return 0;
+  }
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(stream->predfiles); i++)
+  {
+    if(strcmp(filename, gt_str_array_get(stream->predfiles, i)) == 0)
     {
-      if(strcmp(filename, "generated") == 0)
-      {
-        gt_error_set(error, "cannot infer parent features while doing "
-                     "comparative analysis; please preprocess annotations with "
-                     "`canon-gff3` to create explicit `gene` features and then "
-                     "try again");
-      }
-      else
-      {
-        gt_error_set(error, "filename '%s' does not match reference or "
-                     "prediction", filename);
-      }
-      return -1;
+      agn_locus_add_pred_feature(locus, feature);
+      return 0;
     }
   }
 
-  return 0;
+  if(strcmp(filename, "generated") == 0)
+  {
+    gt_error_set(error, "cannot infer parent features while doing "
+                 "comparative analysis; please preprocess annotations with "
+                 "`canon-gff3` to create explicit `gene` features and then "
+                 "try again");
+  }
+  else
+  {
+    gt_error_set(error, "filename '%s' does not match reference or "
+                 "prediction", filename);
+  }
+  return -1;
 }
 
 static const GtNodeStreamClass *locus_stream_class(void)
@@ -500,6 +538,15 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
       }
     }
 
+    if(!haderror && stream->delta == 0 && stream->filters != NULL &&
+       !agn_locus_filter_set_test(stream->filters, locus))
+    {
+      agn_locus_delete(locus);
+      gt_array_delete(current_locus);
+      *gn = NULL;
+      return 0;
+    }
+
     if(stream->delta > 0)
       locus_stream_extend(stream, locus);
 
@@ -527,7 +574,8 @@ static void locus_stream_free(GtNodeStream *ns)
   if(stream->nameformat)
     gt_str_delete(stream->nameformat);
   gt_free(stream->refrfile);
-  gt_free(stream->predfile);
+  gt_str_array_delete(stream->predfiles);
+  agn_locus_filter_set_delete(stream->filters);
 }
 
 static void locus_stream_mint(AgnLocusStream *stream, AgnLocus *locus)
@@ -610,6 +658,18 @@ static int locus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
   agn_assert(ns && gn && error);
 
   AgnLocusStream *stream = locus_stream_cast(ns);
+  int result;
+  do
+  {
+    result = locus_stream_next_node(stream, gn, error);
+  } while(!result && *gn == NULL && stream->buffer != NULL);
+
+  return result;
+}
+
+static int locus_stream_next_node(AgnLocusStream *stream, GtGenomeNode **gn,
+                                  GtError *error)
+{
   if(gt_queue_size(stream->locusqueue) > 0)
   {
     *gn = gt_queue_get(stream->locusqueue);
@@ -663,15 +723,18 @@ static void locus_stream_test_data(GtQueue *queue, int numfiles,
   GtNodeStream *current_stream, *last_stream;
   GtQueue *streams = gt_queue_new();
 
-  current_stream = gt_gff3_in_stream_new_unsorted(numfiles, filenames);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  current_stream = agn_gff3_in_stream_new(numfiles, filenames, NULL);
+  bool sorted = agn_gff3_in_stream_is_sorted((AgnGFF3InStream *)
+                                             current_stream);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = gt_sort_stream_new(last_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(!sorted)
+  {
+    current_stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
 
   GtHashmap *type_parents = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
                                            gt_free_func);
@@ -681,7 +744,7 @@ static void locus_stream_test_data(GtQueue *queue, int numfiles,
   last_stream = current_stream;
 
   GtLogger *logger = gt_logger_new(true, "", stderr);
-  current_stream = agn_gene_stream_new(last_stream, logger);
+  current_stream = agn_canon_stream_new(last_stream, logger);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
@@ -0,0 +1,707 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/array_api.h"
+#include "core/hashmap_api.h"
+#include "core/queue_api.h"
+#include "core/thread_api.h"
+#include "extended/array_out_stream_api.h"
+#include "AgnCanonStream.h"
+#include "AgnCdsIdVisitor.h"
+#include "AgnMapStream.h"
+#include "AgnUtils.h"
+
+#define map_stream_cast(GS)\
+        gt_node_stream_cast(map_stream_class(), GS)
+
+#define map_feed_stream_cast(GS)\
+        gt_node_stream_cast(map_feed_stream_class(), GS)
+
+#define MAP_STREAM_BATCH_SIZE 1024
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * @type A node read from the input, along with the nodes that processing it
+ * produced. Features are set to NULL once they have been handed to a worker;
+ * other nodes are placed directly in the output array. For features,
+ * ``worker`` is the worker that processed it, and ``logstart`` and ``logend``
+ * delimit the messages it logged while doing so.
+ */
+typedef struct
+{
+  GtGenomeNode *node;
+  GtArray *output;
+  GtUword worker;
+  long logstart;
+  long logend;
+} MapSlot;
+
+/**
+ * @type Node stream delivering the features of one worker's share to the
+ * worker's copy of the processing chain, one at a time.
+ */
+typedef struct
+{
+  const GtNodeStream parent_instance;
+  GtQueue *nodes;
+} MapFeedStream;
+
+/**
+ * @type Each worker processes the batch slots whose indices are listed in its
+ * ``share`` with its own copy of the processing chain. The ``strings`` table
+ * maps sequence IDs, sources, and file names shared between features to the
+ * worker's private copies. The chain logs to ``logger``, which writes to the
+ * temporary file ``logfile``.
+ */
+typedef struct
+{
+  MapSlot *slots;
+  GtArray *share;
+  GtNodeStream *feed;
+  GtNodeStream *chain;
+  GtQueue *streams;
+  GtHashmap *strings;
+  FILE *logfile;
+  GtLogger *logger;
+  GtError *error;
+  int had_err;
+} MapWorker;
+
+struct AgnMapStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtLogger *logger;
+  GtStr *logline;
+  MapWorker *workers;
+  GtUword numworkers;
+  MapSlot *slots;
+  GtUword numslots;
+  GtUword nextslot;
+  GtUword nextnode;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Class definition for the feed stream.
+ */
+static const GtNodeStreamClass *map_feed_stream_class(void);
+
+/**
+ * @function Destructor for the feed stream.
+ */
+static void map_feed_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pull the next node from the feed stream, or NULL if the current
+ * feature has already been delivered.
+ */
+static int map_feed_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                GtError *error);
+
+/**
+ * @function Read the next batch of nodes from the input and process the
+ * features with the workers.
+ */
+static int map_stream_batch(AgnMapStream *stream, GtError *error);
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *map_stream_class(void);
+
+/**
+ * @function Delete all nodes of the current batch that have not yet been
+ * delivered.
+ */
+static void map_stream_clear(AgnMapStream *stream);
+
+/**
+ * @function Forward the messages logged by the workers while processing the
+ * current batch to the stream's logger, in input order.
+ */
+static void map_stream_forward_logs(AgnMapStream *stream);
+
+/**
+ * @function Class destructor.
+ */
+static void map_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Deliver the next node of the current batch, processing a new batch
+ * whenever the previous one is exhausted.
+ */
+static int map_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error);
+
+/**
+ * @function Look up (or create) the worker's private copy of a shared string.
+ */
+static GtStr *map_stream_private_str(MapWorker *worker, const void *key,
+                                     const char *value);
+
+/**
+ * @function Replace the sequence ID, source, and file name strings of the
+ * feature and all of its subfeatures with copies that belong to the given
+ * worker, so that the workers never update the reference counts of the same
+ * string.
+ */
+static void map_stream_privatize(MapWorker *worker, GtFeatureNode *fn);
+
+/**
+ * @function Replace the sequence ID and file name strings of a single node
+ * with the worker's copies.
+ */
+static void map_stream_privatize_node(MapWorker *worker, GtGenomeNode *gn);
+
+/**
+ * @function Processing chain used for unit testing.
+ */
+static GtNodeStream *map_stream_test_chain(GtNodeStream *in, GtUword worker,
+                                           GtUword numworkers, GtLogger *logger,
+                                           GtQueue *streams, void *data);
+
+/**
+ * @function Compare the features produced by two runs, position by position.
+ */
+static bool map_stream_test_compare(GtArray *feats1, GtArray *feats2);
+
+/**
+ * @function Load the features of a GFF3 file, processed either with the unit
+ * test chain directly or with a map stream running the chain on the given
+ * number of threads.
+ */
+static GtArray *map_stream_test_load(const char *filename, GtUword numthreads,
+                                     GtLogger *logger);
+
+/**
+ * @function Thread function for processing a worker's share of a batch.
+ */
+static void *map_stream_worker(void *data);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_map_stream_new(GtNodeStream *in,
+                                 AgnMapStreamChainFunc chainfunc, void *data,
+                                 GtUword numthreads, GtLogger *logger)
+{
+  agn_assert(in && chainfunc && numthreads > 0);
+  GtNodeStream *ns = gt_node_stream_create(map_stream_class(), false);
+  AgnMapStream *stream = map_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in);
+  stream->logger = logger;
+  stream->logline = gt_str_new();
+
+  GtUword i;
+  stream->slots = gt_malloc( sizeof(MapSlot) * MAP_STREAM_BATCH_SIZE );
+  for(i = 0; i < MAP_STREAM_BATCH_SIZE; i++)
+  {
+    stream->slots[i].node = NULL;
+    stream->slots[i].output = gt_array_new( sizeof(GtGenomeNode *) );
+  }
+  stream->numslots = 0;
+  stream->nextslot = 0;
+  stream->nextnode = 0;
+
+  stream->numworkers = numthreads;
+  stream->workers = gt_malloc( sizeof(MapWorker) * numthreads );
+  for(i = 0; i < numthreads; i++)
+  {
+    MapWorker *worker = stream->workers + i;
+    worker->slots = stream->slots;
+    worker->share = gt_array_new( sizeof(GtUword) );
+    worker->feed = gt_node_stream_create(map_feed_stream_class(), false);
+    MapFeedStream *feed = map_feed_stream_cast(worker->feed);
+    feed->nodes = gt_queue_new();
+    worker->streams = gt_queue_new();
+    worker->logfile = NULL;
+    worker->logger = NULL;
+    if(logger != NULL)
+    {
+      worker->logfile = tmpfile();
+      if(worker->logfile == NULL)
+      {
+        fprintf(stderr, "error: unable to open temporary log file\n");
+        exit(1);
+      }
+      worker->logger = gt_logger_new(gt_logger_enabled(logger), "",
+                                     worker->logfile);
+    }
+    worker->chain = chainfunc(worker->feed, i, numthreads, worker->logger,
+                              worker->streams, data);
+    worker->strings = gt_hashmap_new(GT_HASH_DIRECT, NULL,
+                                     (GtFree)gt_str_delete);
+    worker->error = gt_error_new();
+    worker->had_err = 0;
+  }
+  return ns;
+}
+
+bool agn_map_stream_unit_test(AgnUnitTest *test)
+{
+  FILE *log = fopen("/dev/null", "w");
+  if(log == NULL)
+  {
+    fprintf(stderr, "[AgnMapStream::agn_map_stream_unit_test] error "
+            "opening /dev/null");
+  }
+  GtLogger *logger = gt_logger_new(true, "", log);
+
+  const char *filename = "data/gff3/grape-refr.gff3";
+  GtArray *serial = map_stream_test_load(filename, 0, logger);
+  GtArray *single = map_stream_test_load(filename, 1, logger);
+  GtArray *parallel = map_stream_test_load(filename, 3, logger);
+  bool test1 = gt_array_size(serial) > 0 &&
+               map_stream_test_compare(serial, single);
+  agn_unit_test_result(test, "single worker", test1);
+
+  bool test2 = map_stream_test_compare(serial, parallel);
+  agn_unit_test_result(test, "three workers, input order", test2);
+
+  GtArray *arrays[] = { serial, single, parallel };
+  GtUword i;
+  for(i = 0; i < 3; i++)
+  {
+    while(gt_array_size(arrays[i]) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(arrays[i]);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(arrays[i]);
+  }
+  gt_logger_delete(logger);
+  if(log != NULL)
+    fclose(log);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *map_feed_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (MapFeedStream),
+                                   map_feed_stream_free,
+                                   map_feed_stream_next);
+  }
+  return nsc;
+}
+
+static void map_feed_stream_free(GtNodeStream *ns)
+{
+  MapFeedStream *stream = map_feed_stream_cast(ns);
+  while(gt_queue_size(stream->nodes) > 0)
+  {
+    GtGenomeNode *gn = gt_queue_get(stream->nodes);
+    gt_genome_node_delete(gn);
+  }
+  gt_queue_delete(stream->nodes);
+}
+
+static int map_feed_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                GtError *error)
+{
+  gt_error_check(error);
+  MapFeedStream *stream = map_feed_stream_cast(ns);
+  *gn = NULL;
+  if(gt_queue_size(stream->nodes) > 0)
+    *gn = gt_queue_get(stream->nodes);
+  return 0;
+}
+
+static int map_stream_batch(AgnMapStream *stream, GtError *error)
+{
+  GtUword i, numfeatures = 0;
+  int had_err = 0;
+  for(i = 0; i < stream->numworkers; i++)
+  {
+    gt_array_reset(stream->workers[i].share);
+    gt_hashmap_reset(stream->workers[i].strings);
+    if(stream->workers[i].logfile != NULL)
+      rewind(stream->workers[i].logfile);
+  }
+
+  stream->numslots = 0;
+  stream->nextslot = 0;
+  stream->nextnode = 0;
+  while(stream->numslots < MAP_STREAM_BATCH_SIZE)
+  {
+    GtGenomeNode *gn;
+    had_err = gt_node_stream_next(stream->in_stream, &gn, error);
+    if(had_err || gn == NULL)
+      break;
+
+    GtUword index = stream->numslots++;
+    MapSlot *slot = stream->slots + index;
+    gt_array_reset(slot->output);
+    slot->logstart = slot->logend = 0;
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+    {
+      slot->node = NULL;
+      gt_array_add(slot->output, gn);
+      continue;
+    }
+
+    // Features are dealt out to the workers in turn
+    slot->worker = numfeatures++ % stream->numworkers;
+    MapWorker *worker = stream->workers + slot->worker;
+    slot->node = gn;
+    gt_array_add(worker->share, index);
+    map_stream_privatize(worker, fn);
+  }
+  if(had_err)
+    return had_err;
+
+  GtUword numworkers = stream->numworkers;
+  if(numworkers > numfeatures)
+    numworkers = numfeatures;
+  GtThread **threads = gt_malloc( sizeof(GtThread *) * stream->numworkers );
+  for(i = 0; i < numworkers; i++)
+    threads[i] = NULL;
+
+  // The calling thread handles the first share; if GenomeTools was compiled
+  // without thread support, gt_thread_new fails and shares are run serially.
+  GtError *threaderror = gt_error_new();
+  for(i = 1; i < numworkers; i++)
+  {
+    threads[i] = gt_thread_new(map_stream_worker, stream->workers + i,
+                               threaderror);
+    if(threads[i] == NULL)
+    {
+      gt_error_unset(threaderror);
+      map_stream_worker(stream->workers + i);
+    }
+  }
+  if(numworkers > 0)
+    map_stream_worker(stream->workers);
+  for(i = 1; i < numworkers; i++)
+  {
+    if(threads[i] != NULL)
+    {
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
+    }
+  }
+  gt_error_delete(threaderror);
+  gt_free(threads);
+  map_stream_forward_logs(stream);
+
+  for(i = 0; !had_err && i < numworkers; i++)
+  {
+    MapWorker *worker = stream->workers + i;
+    if(worker->had_err)
+    {
+      gt_error_set(error, "%s", gt_error_get(worker->error));
+      had_err = worker->had_err;
+    }
+    worker->had_err = 0;
+    gt_error_unset(worker->error);
+  }
+  return had_err;
+}
+
+static const GtNodeStreamClass *map_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnMapStream),
+                                   map_stream_free,
+                                   map_stream_next);
+  }
+  return nsc;
+}
+
+static void map_stream_clear(AgnMapStream *stream)
+{
+  GtUword i, j;
+  for(i = stream->nextslot; i < stream->numslots; i++)
+  {
+    MapSlot *slot = stream->slots + i;
+    if(slot->node != NULL)
+    {
+      gt_genome_node_delete(slot->node);
+      slot->node = NULL;
+    }
+    j = i == stream->nextslot ? stream->nextnode : 0;
+    for(; j < gt_array_size(slot->output); j++)
+    {
+      GtGenomeNode **gn = gt_array_get(slot->output, j);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_reset(slot->output);
+  }
+  stream->numslots = 0;
+  stream->nextslot = 0;
+  stream->nextnode = 0;
+}
+
+static void map_stream_forward_logs(AgnMapStream *stream)
+{
+  GtUword i;
+  if(stream->logger == NULL || !gt_logger_enabled(stream->logger))
+    return;
+
+  for(i = 0; i < stream->numslots; i++)
+  {
+    MapSlot *slot = stream->slots + i;
+    if(slot->logend <= slot->logstart)
+      continue;
+
+    FILE *logfile = stream->workers[slot->worker].logfile;
+    fseek(logfile, slot->logstart, SEEK_SET);
+    while(ftell(logfile) < slot->logend &&
+          gt_str_read_next_line(stream->logline, logfile) != EOF)
+    {
+      gt_logger_log(stream->logger, "%s", gt_str_get(stream->logline));
+      gt_str_reset(stream->logline);
+    }
+  }
+}
+
+static void map_stream_free(GtNodeStream *ns)
+{
+  AgnMapStream *stream = map_stream_cast(ns);
+  GtUword i;
+  map_stream_clear(stream);
+  for(i = 0; i < stream->numworkers; i++)
+  {
+    MapWorker *worker = stream->workers + i;
+    while(gt_queue_size(worker->streams) > 0)
+    {
+      GtNodeStream *chainstream = gt_queue_get(worker->streams);
+      gt_node_stream_delete(chainstream);
+    }
+    gt_queue_delete(worker->streams);
+    gt_node_stream_delete(worker->feed);
+    gt_array_delete(worker->share);
+    gt_hashmap_delete(worker->strings);
+    if(worker->logger != NULL)
+    {
+      gt_logger_delete(worker->logger);
+      fclose(worker->logfile);
+    }
+    gt_error_delete(worker->error);
+  }
+  gt_free(stream->workers);
+  gt_str_delete(stream->logline);
+  for(i = 0; i < MAP_STREAM_BATCH_SIZE; i++)
+    gt_array_delete(stream->slots[i].output);
+  gt_free(stream->slots);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static int map_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
+{
+  gt_error_check(error);
+  AgnMapStream *stream = map_stream_cast(ns);
+  while(1)
+  {
+    while(stream->nextslot < stream->numslots)
+    {
+      MapSlot *slot = stream->slots + stream->nextslot;
+      if(stream->nextnode < gt_array_size(slot->output))
+      {
+        GtGenomeNode **outnode = gt_array_get(slot->output, stream->nextnode++);
+        *gn = *outnode;
+        return 0;
+      }
+      stream->nextslot++;
+      stream->nextnode = 0;
+    }
+
+    int had_err = map_stream_batch(stream, error);
+    if(had_err)
+    {
+      map_stream_clear(stream);
+      *gn = NULL;
+      return had_err;
+    }
+    if(stream->numslots == 0)
+    {
+      *gn = NULL;
+      return 0;
+    }
+  }
+}
+
+static GtStr *map_stream_private_str(MapWorker *worker, const void *key,
+                                     const char *value)
+{
+  GtStr *str = gt_hashmap_get(worker->strings, key);
+  if(str == NULL)
+  {
+    str = gt_str_new_cstr(value);
+    gt_hashmap_add(worker->strings, (void *)key, str);
+  }
+  return str;
+}
+
+static void map_stream_privatize(MapWorker *worker, GtFeatureNode *fn)
+{
+  if(gt_feature_node_is_pseudo(fn))
+    map_stream_privatize_node(worker, (GtGenomeNode *)fn);
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feat;
+  for(feat  = gt_feature_node_iterator_next(iter);
+      feat != NULL;
+      feat  = gt_feature_node_iterator_next(iter))
+  {
+    map_stream_privatize_node(worker, (GtGenomeNode *)feat);
+    const char *source = gt_feature_node_get_source(feat);
+    gt_feature_node_set_source(feat, map_stream_private_str(worker, source,
+                                                            source));
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+static void map_stream_privatize_node(MapWorker *worker, GtGenomeNode *gn)
+{
+  GtStr *seqid = gt_genome_node_get_seqid(gn);
+  gt_genome_node_change_seqid(gn, map_stream_private_str(worker, seqid,
+                                                         gt_str_get(seqid)));
+
+  // Nodes not read from a file have no file name string to share
+  const char *filename = gt_genome_node_get_filename(gn);
+  if(strcmp(filename, "generated") != 0)
+  {
+    GtStr *privatename = map_stream_private_str(worker, filename, filename);
+    gt_genome_node_set_origin(gn, privatename,
+                              gt_genome_node_get_line_number(gn));
+  }
+}
+
+static GtNodeStream *map_stream_test_chain(GtNodeStream *in, GtUword worker,
+                                           GtUword numworkers, GtLogger *logger,
+                                           GtQueue *streams, void *data)
+{
+  GtNodeStream *stream = agn_canon_stream_new(in, logger);
+  agn_canon_stream_defer_cds_ids((AgnCanonStream *)stream);
+  gt_queue_add(streams, stream);
+  return stream;
+}
+
+static bool map_stream_test_compare(GtArray *feats1, GtArray *feats2)
+{
+  if(gt_array_size(feats1) != gt_array_size(feats2))
+    return false;
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(feats1); i++)
+  {
+    GtFeatureNode *fn1 = *(GtFeatureNode **)gt_array_get(feats1, i);
+    GtFeatureNode *fn2 = *(GtFeatureNode **)gt_array_get(feats2, i);
+    const char *id1 = gt_feature_node_get_attribute(fn1, "ID");
+    const char *id2 = gt_feature_node_get_attribute(fn2, "ID");
+    if(agn_genome_node_compare((GtGenomeNode **)&fn1,
+                               (GtGenomeNode **)&fn2) != 0 ||
+       strcmp(gt_feature_node_get_type(fn1), gt_feature_node_get_type(fn2)) ||
+       strcmp(gt_feature_node_get_source(fn1),
+              gt_feature_node_get_source(fn2)) ||
+       id1 == NULL || id2 == NULL || strcmp(id1, id2) != 0)
+      return false;
+
+    GtUword count1 = 0, count2 = 0;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn1);
+    while(gt_feature_node_iterator_next(iter) != NULL)
+      count1++;
+    gt_feature_node_iterator_delete(iter);
+    iter = gt_feature_node_iterator_new(fn2);
+    while(gt_feature_node_iterator_next(iter) != NULL)
+      count2++;
+    gt_feature_node_iterator_delete(iter);
+    if(count1 != count2)
+      return false;
+  }
+  return true;
+}
+
+static GtArray *map_stream_test_load(const char *filename, GtUword numthreads,
+                                     GtLogger *logger)
+{
+  GtError *error = gt_error_new();
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *stream = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  gt_queue_add(streams, stream);
+
+  if(numthreads == 0)
+    stream = map_stream_test_chain(stream, 0, 1, logger, streams, NULL);
+  else
+  {
+    stream = agn_map_stream_new(stream, map_stream_test_chain, NULL,
+                                numthreads, logger);
+    gt_queue_add(streams, stream);
+  }
+  stream = agn_cds_id_stream_new(stream);
+  gt_queue_add(streams, stream);
+
+  GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
+  stream = gt_array_out_stream_new(stream, feats, error);
+  gt_queue_add(streams, stream);
+  if(gt_node_stream_pull(stream, error) == -1)
+  {
+    fprintf(stderr, "[AgnMapStream::map_stream_test_load] error processing "
+            "features: %s\n", gt_error_get(error));
+  }
+
+  while(gt_queue_size(streams) > 0)
+  {
+    stream = gt_queue_get(streams);
+    gt_node_stream_delete(stream);
+  }
+  gt_queue_delete(streams);
+  gt_error_delete(error);
+  return feats;
+}
+
+static void *map_stream_worker(void *data)
+{
+  MapWorker *worker = data;
+  MapFeedStream *feed = map_feed_stream_cast(worker->feed);
+  GtUword i;
+  for(i = 0; i < gt_array_size(worker->share); i++)
+  {
+    GtUword *index = gt_array_get(worker->share, i);
+    MapSlot *slot = worker->slots + *index;
+    gt_queue_add(feed->nodes, slot->node);
+    slot->node = NULL;
+    if(worker->logfile != NULL)
+      slot->logstart = ftell(worker->logfile);
+
+    GtGenomeNode *gn;
+    while(1)
+    {
+      worker->had_err = gt_node_stream_next(worker->chain, &gn, worker->error);
+      if(worker->had_err || gn == NULL)
+        break;
+      gt_array_add(slot->output, gn);
+    }
+    if(worker->logfile != NULL)
+    {
+      fflush(worker->logfile);
+      slot->logend = ftell(worker->logfile);
+    }
+    if(worker->had_err)
+      break;
+  }
+  return NULL;
+}
@@ -7,6 +7,8 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <float.h>
+#include <stdlib.h>
 #include <string.h>
 #include "core/array_api.h"
 #include "AgnFilterStream.h"
@@ -19,14 +21,45 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 
 //------------------------------------------------------------------------------
-// Data structure definition
+// Data structure definitions
 //------------------------------------------------------------------------------
 
+/**
+ * @type Statistics for an mRNA, tallied while traversing the feature.
+ * ``parent`` is the index of the enclosing feature of the parent type.
+ */
+typedef struct
+{
+  GtFeatureNode *mrna;
+  GtUword parent;
+  GtUword cdslength;
+  GtUword exonlength;
+  GtUword numexons;
+} MrnaRepCandidate;
+
+/**
+ * @type A feature of the parent type and the index of the best candidate so
+ * far; ``hasbest`` is false until the first enclosed mRNA has been seen.
+ */
+typedef struct
+{
+  GtFeatureNode *fn;
+  bool hasbest;
+  GtUword best;
+} MrnaRepParent;
+
+/**
+ * The ``parents`` and ``candidates`` arrays are reused for each feature.
+ */
 struct AgnMrnaRepVisitor
 {
   const GtNodeVisitor parent_instance;
   char *parenttype;
   FILE *mapstream;
+  AgnMrnaRepPolicy policy;
+  char *attribute;
+  GtArray *parents;
+  GtArray *candidates;
 };
 
 
@@ -34,21 +67,65 @@ struct AgnMrnaRepVisitor
 // Prototypes for private functions
 //------------------------------------------------------------------------------
 
+/**
+ * @function Determine whether the candidate should replace the current best
+ * candidate: it must have a higher score, or the same score and a label that
+ * sorts first.
+ */
+static bool mrna_rep_visitor_better(AgnMrnaRepVisitor *v,
+                                    MrnaRepCandidate *candidate,
+                                    MrnaRepCandidate *best);
+
 /**
  * @function Implement the interface to the GtNodeVisitor class.
  */
 static const GtNodeVisitorClass *mrna_rep_visitor_class();
 
+/**
+ * @function Traverse the feature graph below ``fn``, recording each feature of
+ * the parent type and each mRNA it encloses and tallying the CDS and exon
+ * segments of each mRNA. ``parent`` and ``mrna`` are the indices of the
+ * enclosing parent feature and mRNA, or -1 if there is none.
+ */
+static void mrna_rep_visitor_collect(AgnMrnaRepVisitor *v, GtFeatureNode *fn,
+                                     long parent, long mrna);
+
 /**
  * @function Release memory.
  */
 static void mrna_rep_visitor_free(GtNodeVisitor *nv);
 
+/**
+ * @function Compare function for ``MrnaRepParent`` objects, ordering them by
+ * the position of the parent feature.
+ */
+static int mrna_rep_visitor_parent_compare(const void *p1, const void *p2);
+
+/**
+ * @function Score an mRNA according to the selection policy.
+ */
+static double mrna_rep_visitor_score(AgnMrnaRepVisitor *v,
+                                     MrnaRepCandidate *candidate);
+
 /**
  * @function Generate data for unit testing.
  */
 static void mrna_rep_visitor_test_data(GtQueue *queue);
 
+/**
+ * @function Create a gene with three mRNAs for unit testing: mRNA1 has the
+ * longest transcript and the highest score, mRNA2 the longest CDS, and mRNA3
+ * the most exons.
+ */
+static GtFeatureNode *mrna_rep_visitor_test_gene(GtStr *seqid);
+
+/**
+ * @function Apply the given selection policy to the unit test gene, and check
+ * that the expected mRNA is the only one remaining.
+ */
+static bool mrna_rep_visitor_test_policy(AgnMrnaRepPolicy policy,
+                                         const char *expected);
+
 /**
  * @function Identify any mRNA subfeatures associated with this top-level
  * feature and apply the CDS inference procedure.
@@ -74,6 +151,10 @@ GtNodeVisitor *agn_mrna_rep_visitor_new(FILE *mapstream)
   AgnMrnaRepVisitor *v = mrna_rep_visitor_cast(nv);
   v->parenttype = gt_cstr_dup("gene");
   v->mapstream = mapstream;
+  v->policy = AGN_MRNA_REP_CDS_LENGTH;
+  v->attribute = NULL;
+  v->parents = gt_array_new( sizeof(MrnaRepParent) );
+  v->candidates = gt_array_new( sizeof(MrnaRepCandidate) );
   return nv;
 }
 
@@ -84,6 +165,18 @@ void agn_mrna_rep_visitor_set_parent_type(AgnMrnaRepVisitor *v,
   v->parenttype = gt_cstr_dup(type);
 }
 
+void agn_mrna_rep_visitor_set_policy(AgnMrnaRepVisitor *v,
+                                     AgnMrnaRepPolicy policy,
+                                     const char *attribute)
+{
+  agn_assert(v && (policy != AGN_MRNA_REP_ATTRIBUTE || attribute != NULL));
+  v->policy = policy;
+  gt_free(v->attribute);
+  v->attribute = NULL;
+  if(policy == AGN_MRNA_REP_ATTRIBUTE)
+    v->attribute = gt_cstr_dup(attribute);
+}
+
 bool agn_mrna_rep_visitor_unit_test(AgnUnitTest *test)
 {
   GtQueue *queue = gt_queue_new();
@@ -105,11 +198,38 @@ bool agn_mrna_rep_visitor_unit_test(AgnUnitTest *test)
   agn_unit_test_result(test, "TAIR10: test 1", test1);
   gt_genome_node_delete(gene);
   gt_array_delete(mrnas);
-
   gt_queue_delete(queue);
+
+  bool test2 = mrna_rep_visitor_test_policy(AGN_MRNA_REP_CDS_LENGTH, "mRNA2");
+  agn_unit_test_result(test, "longest CDS", test2);
+
+  bool test3 = mrna_rep_visitor_test_policy(AGN_MRNA_REP_TRANSCRIPT_LENGTH,
+                                            "mRNA1");
+  agn_unit_test_result(test, "longest transcript", test3);
+
+  bool test4 = mrna_rep_visitor_test_policy(AGN_MRNA_REP_EXON_COUNT, "mRNA3");
+  agn_unit_test_result(test, "most exons", test4);
+
+  bool test5 = mrna_rep_visitor_test_policy(AGN_MRNA_REP_ATTRIBUTE, "mRNA1");
+  agn_unit_test_result(test, "attribute score", test5);
+
   return agn_unit_test_success(test);
 }
 
+static bool mrna_rep_visitor_better(AgnMrnaRepVisitor *v,
+                                    MrnaRepCandidate *candidate,
+                                    MrnaRepCandidate *best)
+{
+  double score = mrna_rep_visitor_score(v, candidate);
+  double bestscore = mrna_rep_visitor_score(v, best);
+  if(score != bestscore)
+    return score > bestscore;
+
+  const char *label = agn_feature_node_get_label(candidate->mrna);
+  const char *bestlabel = agn_feature_node_get_label(best->mrna);
+  return strcmp(label, bestlabel) < 0;
+}
+
 static const GtNodeVisitorClass *mrna_rep_visitor_class()
 {
   static const GtNodeVisitorClass *nvc = NULL;
@@ -123,10 +243,85 @@ static const GtNodeVisitorClass *mrna_rep_visitor_class()
   return nvc;
 }
 
+static void mrna_rep_visitor_collect(AgnMrnaRepVisitor *v, GtFeatureNode *fn,
+                                     long parent, long mrna)
+{
+  if(gt_feature_node_has_type(fn, v->parenttype))
+  {
+    MrnaRepParent newparent = { fn, false, 0 };
+    gt_array_add(v->parents, newparent);
+    parent = gt_array_size(v->parents) - 1;
+  }
+
+  if(mrna >= 0)
+  {
+    MrnaRepCandidate *candidate = gt_array_get(v->candidates, mrna);
+    if(agn_typecheck_cds(fn))
+      candidate->cdslength += gt_genome_node_get_length((GtGenomeNode *)fn);
+    else if(agn_typecheck_exon(fn))
+    {
+      candidate->exonlength += gt_genome_node_get_length((GtGenomeNode *)fn);
+      candidate->numexons++;
+    }
+  }
+  else if(parent >= 0 && agn_typecheck_mrna(fn))
+  {
+    MrnaRepCandidate candidate = { fn, parent, 0, 0, 0 };
+    gt_array_add(v->candidates, candidate);
+    mrna = gt_array_size(v->candidates) - 1;
+  }
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    mrna_rep_visitor_collect(v, child, parent, mrna);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
 static void mrna_rep_visitor_free(GtNodeVisitor *nv)
 {
   AgnMrnaRepVisitor *v = mrna_rep_visitor_cast(nv);
   gt_free(v->parenttype);
+  gt_free(v->attribute);
+  gt_array_delete(v->parents);
+  gt_array_delete(v->candidates);
+}
+
+static int mrna_rep_visitor_parent_compare(const void *p1, const void *p2)
+{
+  const MrnaRepParent *parent1 = p1;
+  const MrnaRepParent *parent2 = p2;
+  GtGenomeNode *gn1 = (GtGenomeNode *)parent1->fn;
+  GtGenomeNode *gn2 = (GtGenomeNode *)parent2->fn;
+  return agn_genome_node_compare(&gn1, &gn2);
+}
+
+static double mrna_rep_visitor_score(AgnMrnaRepVisitor *v,
+                                     MrnaRepCandidate *candidate)
+{
+  if(v->policy == AGN_MRNA_REP_TRANSCRIPT_LENGTH)
+  {
+    if(candidate->numexons == 0)
+      return gt_genome_node_get_length((GtGenomeNode *)candidate->mrna);
+    return candidate->exonlength;
+  }
+  else if(v->policy == AGN_MRNA_REP_EXON_COUNT)
+    return candidate->numexons;
+  else if(v->policy == AGN_MRNA_REP_ATTRIBUTE)
+  {
+    const char *value = gt_feature_node_get_attribute(candidate->mrna,
+                                                      v->attribute);
+    char *end;
+    double score = value == NULL ? 0.0 : strtod(value, &end);
+    if(value == NULL || end == value)
+      return -DBL_MAX;
+    return score;
+  }
+  return candidate->cdslength;
 }
 
 static void mrna_rep_visitor_test_data(GtQueue *queue)
@@ -159,64 +354,124 @@ static void mrna_rep_visitor_test_data(GtQueue *queue)
   gt_error_delete(error);
 }
 
-static int
-mrna_rep_visit_feature_node(GtNodeVisitor *nv,GtFeatureNode *fn,GtError *error)
+static GtFeatureNode *mrna_rep_visitor_test_gene(GtStr *seqid)
 {
-  gt_error_check(error);
-  AgnMrnaRepVisitor *v = mrna_rep_visitor_cast(nv);
+  // Exon and CDS coordinates for each mRNA, terminated by zeros
+  GtUword coords[3][2][12] = {
+    { { 1000, 1999, 0 },
+      { 1200, 1499, 0 } },
+    { { 1000, 1199, 1300, 1499, 1600, 1799, 0 },
+      { 1050, 1199, 1300, 1499, 1600, 1749, 0 } },
+    { { 1000, 1179, 1250, 1429, 1500, 1679, 1700, 1879, 1900, 2079, 0 },
+      { 1100, 1179, 1250, 1429, 1500, 1639, 0 } },
+  };
+  const char *scores[] = { "7", "2.5", "none" };
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", 1000, 2079,
+                                           GT_STRAND_FORWARD);
+  gt_feature_node_add_attribute((GtFeatureNode *)gene, "ID", "gene1");
 
-  GtUword i,j;
-  GtArray *parents = agn_typecheck_select_str(fn, v->parenttype);
-  for(i = 0; i < gt_array_size(parents); i++)
+  GtUword i, j, k;
+  for(i = 0; i < 3; i++)
   {
-    GtGenomeNode **parent = gt_array_get(parents, i);
-    GtFeatureNode *parentfn = gt_feature_node_cast(*parent);
-    const char *parentlabel = agn_feature_node_get_label(parentfn);
-    GtArray *mrnas = agn_typecheck_select(parentfn, agn_typecheck_mrna);
-    if(gt_array_size(mrnas) <= 1)
+    char mrnaid[16];
+    sprintf(mrnaid, "mRNA%lu", i + 1);
+    GtUword *exons = coords[i][0];
+    for(j = 0; exons[j] != 0; j += 2);
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", exons[0],
+                                             exons[j - 1], GT_STRAND_FORWARD);
+    gt_feature_node_add_attribute((GtFeatureNode *)mrna, "ID", mrnaid);
+    gt_feature_node_add_attribute((GtFeatureNode *)mrna, "score", scores[i]);
+    gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+    for(k = 0; k < 2; k++)
     {
-      if(v->mapstream != NULL && gt_array_size(mrnas) == 1)
+      for(j = 0; coords[i][k][j] != 0; j += 2)
       {
-        GtFeatureNode **mrna = gt_array_pop(mrnas);
-        const char *mrnalabel = agn_feature_node_get_label(*mrna);
-        fprintf(v->mapstream, "%s\t%s\n", parentlabel, mrnalabel);
+        GtGenomeNode *part = gt_feature_node_new(seqid, k == 0 ? "exon" : "CDS",
+                                                 coords[i][k][j],
+                                                 coords[i][k][j + 1],
+                                                 GT_STRAND_FORWARD);
+        gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode*)part);
       }
-      gt_array_delete(mrnas);
-      continue;
     }
+  }
+  return (GtFeatureNode *)gene;
+}
 
-    // Find the longest mRNA
-    const char *longest_label = NULL;
-    GtFeatureNode *longest_mrna = NULL;
-    GtUword longest_length = 0;
-    for(j = 0; j < gt_array_size(mrnas); j++)
+static bool mrna_rep_visitor_test_policy(AgnMrnaRepPolicy policy,
+                                         const char *expected)
+{
+  GtError *error = gt_error_new();
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtFeatureNode *gene = mrna_rep_visitor_test_gene(seqid);
+  GtNodeVisitor *nv = agn_mrna_rep_visitor_new(NULL);
+  agn_mrna_rep_visitor_set_policy((AgnMrnaRepVisitor *)nv, policy, "score");
+  bool success = gt_genome_node_accept((GtGenomeNode *)gene, nv, error) == 0;
+  GtArray *mrnas = agn_typecheck_select(gene, agn_typecheck_mrna);
+  if(success && gt_array_size(mrnas) == 1)
+  {
+    GtFeatureNode **mrna = gt_array_get(mrnas, 0);
+    const char *mrnaid = gt_feature_node_get_attribute(*mrna, "ID");
+    success = strcmp(mrnaid, expected) == 0;
+  }
+  else
+    success = false;
+
+  gt_array_delete(mrnas);
+  gt_node_visitor_delete(nv);
+  gt_genome_node_delete((GtGenomeNode *)gene);
+  gt_str_delete(seqid);
+  gt_error_delete(error);
+  return success;
+}
+
+static int
+mrna_rep_visit_feature_node(GtNodeVisitor *nv,GtFeatureNode *fn,GtError *error)
+{
+  gt_error_check(error);
+  AgnMrnaRepVisitor *v = mrna_rep_visitor_cast(nv);
+
+  GtUword i;
+  gt_array_reset(v->parents);
+  gt_array_reset(v->candidates);
+  mrna_rep_visitor_collect(v, fn, -1, -1);
+
+  // Find the best mRNA for each parent
+  for(i = 0; i < gt_array_size(v->candidates); i++)
+  {
+    MrnaRepCandidate *candidate = gt_array_get(v->candidates, i);
+    MrnaRepParent *parent = gt_array_get(v->parents, candidate->parent);
+    if(!parent->hasbest ||
+       mrna_rep_visitor_better(v, candidate,
+                               gt_array_get(v->candidates, parent->best)))
     {
-      GtGenomeNode **mrna = gt_array_get(mrnas, j);
-      GtFeatureNode *mrnafn = gt_feature_node_cast(*mrna);
-      GtUword length = agn_mrna_cds_length(mrnafn);
-      const char *mrnalabel = agn_feature_node_get_label(mrnafn);
-      bool lexosorted = longest_label && strcmp(mrnalabel, longest_label) < 0;
-      bool preempt = length == longest_length && lexosorted;
-      if(longest_length == 0 || length > longest_length || preempt)
-      {
-        longest_mrna = mrnafn;
-        longest_label = mrnalabel;
-        longest_length = length;
-      }
+      parent->best = i;
+      parent->hasbest = true;
     }
-    if(v->mapstream != NULL)
-      fprintf(v->mapstream, "%s\t%s\n", parentlabel, longest_label);
+  }
+
+  // Remove all other mRNAs
+  for(i = 0; i < gt_array_size(v->candidates); i++)
+  {
+    MrnaRepCandidate *candidate = gt_array_get(v->candidates, i);
+    MrnaRepParent *parent = gt_array_get(v->parents, candidate->parent);
+    if(parent->best != i)
+      agn_feature_node_remove_tree(fn, candidate->mrna);
+  }
 
-    // Now, remove all other mRNAs
-    for(j = 0; j < gt_array_size(mrnas); j++)
+  if(v->mapstream != NULL)
+  {
+    // Report in sorted order as before, rather than in traversal order
+    gt_array_sort(v->parents, mrna_rep_visitor_parent_compare);
+    for(i = 0; i < gt_array_size(v->parents); i++)
     {
-      GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, j);
-      if(mrna != longest_mrna)
-        agn_feature_node_remove_tree(fn, mrna);
+      MrnaRepParent *parent = gt_array_get(v->parents, i);
+      if(!parent->hasbest)
+        continue;
+      MrnaRepCandidate *best = gt_array_get(v->candidates, parent->best);
+      fprintf(v->mapstream, "%s\t%s\n", agn_feature_node_get_label(parent->fn),
+              agn_feature_node_get_label(best->mrna));
     }
-    gt_array_delete(mrnas);
   }
-  gt_array_delete(parents);
 
   return 0;
 }
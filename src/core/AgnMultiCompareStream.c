@@ -0,0 +1,256 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include "core/str_array_api.h"
+#include "AgnComparison.h"
+#include "AgnLocus.h"
+#include "AgnMultiCompareStream.h"
+#include "AgnTranscriptClique.h"
+
+#define multi_compare_stream_cast(GS)\
+        gt_node_stream_cast(multi_compare_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnMultiCompareStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtStrArray *predfiles;
+  GtArray *reports;
+  GtArray *data;
+  AgnLocusFilterSet *filters;
+  GtLogger *logger;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* multi_compare_stream_class(void);
+
+/**
+ * @function Compare the given locus against the ``i``th prediction and pass it
+ * to that prediction's report. The reference cliques are enumerated the first
+ * time they are needed.
+ */
+static int multi_compare_stream_compare(AgnMultiCompareStream *stream,
+                                        AgnLocus *locus, GtUword i,
+                                        GtArray **refrcliques, bool *enumerated,
+                                        GtError *error);
+
+/**
+ * @function Class destructor.
+ */
+static void multi_compare_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls loci from the input stream and compares them against each
+ * prediction.
+ */
+static int multi_compare_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_multi_compare_stream_add_prediction(AgnMultiCompareStream *stream,
+                                             const char *predfile,
+                                             GtNodeVisitor *report)
+{
+  AgnComparisonData data;
+  agn_assert(stream && predfile);
+  gt_str_array_add_cstr(stream->predfiles, predfile);
+  gt_array_add(stream->reports, report);
+  agn_comparison_data_init(&data);
+  gt_array_add(stream->data, data);
+}
+
+GtNodeStream *agn_multi_compare_stream_new(GtNodeStream *in_stream,
+                                           GtArray *filters, GtLogger *logger)
+{
+  GtNodeStream *ns;
+  AgnMultiCompareStream *stream;
+  agn_assert(in_stream);
+  ns = gt_node_stream_create(multi_compare_stream_class(), false);
+  stream = multi_compare_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->predfiles = gt_str_array_new();
+  stream->reports = gt_array_new( sizeof(GtNodeVisitor *) );
+  stream->data = gt_array_new( sizeof(AgnComparisonData) );
+  stream->filters = NULL;
+  if(filters != NULL)
+    stream->filters = agn_locus_filter_set_new(filters, false);
+  stream->logger = logger;
+  return ns;
+}
+
+void agn_multi_compare_stream_print_matrix(AgnMultiCompareStream *stream,
+                                           FILE *outstream)
+{
+  GtUword i;
+  agn_assert(stream && outstream);
+
+  fputs("Prediction\tLoci\tComparisons\tPerfectMatches\tMislabeled\t"
+        "CDSMatches\tExonMatches\tUTRMatches\tNonMatches\tCDSNucSn\t"
+        "CDSNucSp\tCDSNucF1\tUTRNucSn\tUTRNucSp\tUTRNucF1\tCDSStrucSn\t"
+        "CDSStrucSp\tCDSStrucF1\tExonStrucSn\tExonStrucSp\tExonStrucF1\t"
+        "UTRStrucSn\tUTRStrucSp\tUTRStrucF1\tIdentity\n", outstream);
+  for(i = 0; i < gt_str_array_size(stream->predfiles); i++)
+  {
+    AgnComparisonData *data = gt_array_get(stream->data, i);
+    AgnCompClassSummary *summ = &data->summary;
+    AgnComparison *stats = &data->stats;
+    fprintf(outstream, "%s\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu",
+            gt_str_array_get(stream->predfiles, i), data->info.num_loci,
+            data->info.num_comparisons, summ->perfect_matches.comparison_count,
+            summ->perfect_mislabeled.comparison_count,
+            summ->cds_matches.comparison_count,
+            summ->exon_matches.comparison_count,
+            summ->utr_matches.comparison_count,
+            summ->non_matches.comparison_count);
+
+    AgnCompStatsScaled *nucs[] = { &stats->cds_nuc_stats,
+                                   &stats->utr_nuc_stats };
+    AgnCompStatsBinary *strucs[] = { &stats->cds_struc_stats,
+                                     &stats->exon_struc_stats,
+                                     &stats->utr_struc_stats };
+    GtUword j;
+    for(j = 0; j < 2; j++)
+    {
+      fprintf(outstream, "\t%s\t%s\t%s", nucs[j]->sns, nucs[j]->sps,
+              nucs[j]->f1s);
+    }
+    for(j = 0; j < 3; j++)
+    {
+      fprintf(outstream, "\t%s\t%s\t%s", strucs[j]->sns, strucs[j]->sps,
+              strucs[j]->f1s);
+    }
+    if(stats->overall_length > 0)
+    {
+      fprintf(outstream, "\t%.3lf\n",
+              (double)stats->overall_matches / (double)stats->overall_length);
+    }
+    else
+      fputs("\t--\n", outstream);
+  }
+}
+
+static const GtNodeStreamClass *multi_compare_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnMultiCompareStream),
+                                   multi_compare_stream_free,
+                                   multi_compare_stream_next);
+  }
+  return nsc;
+}
+
+static int multi_compare_stream_compare(AgnMultiCompareStream *stream,
+                                        AgnLocus *locus, GtUword i,
+                                        GtArray **refrcliques, bool *enumerated,
+                                        GtError *error)
+{
+  const char *predfile = gt_str_array_get(stream->predfiles, i);
+  AgnLocus *view = agn_locus_select_prediction(locus, predfile);
+  if(agn_locus_num_refr_genes(view) == 0 && agn_locus_num_pred_genes(view) == 0)
+  {
+    agn_locus_delete(view);
+    return 0;
+  }
+
+  if(stream->filters != NULL && !agn_locus_filter_set_test(stream->filters,view))
+  {
+    agn_locus_delete(view);
+    return 0;
+  }
+
+  if(!*enumerated)
+  {
+    *refrcliques = agn_locus_refr_cliques(locus);
+    *enumerated = true;
+  }
+  agn_locus_comparative_analysis_shared(view, *refrcliques, stream->logger);
+  agn_locus_data_aggregate(view, gt_array_get(stream->data, i));
+
+  int had_err = 0;
+  GtNodeVisitor *report = *(GtNodeVisitor **)gt_array_get(stream->reports, i);
+  if(report != NULL)
+    had_err = gt_genome_node_accept(view, report, error);
+  agn_locus_delete(view);
+  return had_err;
+}
+
+static void multi_compare_stream_free(GtNodeStream *ns)
+{
+  AgnMultiCompareStream *stream = multi_compare_stream_cast(ns);
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->reports); i++)
+  {
+    GtNodeVisitor *report = *(GtNodeVisitor **)gt_array_get(stream->reports,i);
+    if(report != NULL)
+      gt_node_visitor_delete(report);
+  }
+  gt_node_stream_delete(stream->in_stream);
+  gt_str_array_delete(stream->predfiles);
+  gt_array_delete(stream->reports);
+  gt_array_delete(stream->data);
+  agn_locus_filter_set_delete(stream->filters);
+}
+
+static int multi_compare_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error)
+{
+  AgnMultiCompareStream *stream;
+  GtFeatureNode *fn;
+  int had_err;
+  gt_error_check(error);
+  stream = multi_compare_stream_cast(ns);
+
+  had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  if(had_err || !*gn)
+    return had_err;
+
+  fn = gt_feature_node_try_cast(*gn);
+  if(!fn)
+    return 0;
+
+  agn_assert(gt_feature_node_has_type(fn, "locus"));
+  GtArray *refrcliques = NULL;
+  bool enumerated = false;
+  GtUword i;
+  for(i = 0; !had_err && i < gt_str_array_size(stream->predfiles); i++)
+  {
+    had_err = multi_compare_stream_compare(stream, *gn, i, &refrcliques,
+                                           &enumerated, error);
+  }
+
+  if(refrcliques != NULL)
+  {
+    while(gt_array_size(refrcliques) > 0)
+    {
+      AgnTranscriptClique **clique = gt_array_pop(refrcliques);
+      agn_transcript_clique_delete(*clique);
+    }
+    gt_array_delete(refrcliques);
+  }
+
+  return had_err;
+}
@@ -0,0 +1,269 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include "core/array_api.h"
+#include "core/cstr_api.h"
+#include "core/ma_api.h"
+#include "AgnProfileStream.h"
+#include "AgnUtils.h"
+
+#define profile_stream_cast(GS)\
+        gt_node_stream_cast(profile_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * Statistics for a single stage. The ``child`` values are those recorded while
+ * the stage was waiting on the stage upstream of it, and are subtracted from
+ * the totals when the statistics are printed.
+ */
+typedef struct
+{
+  char *label;
+  GtUword nodes;
+  GtUword depth;
+  GtUword maxdepth;
+  double wall;
+  double childwall;
+  double cpu;
+  double childcpu;
+  long rss;
+  long childrss;
+} ProfileStage;
+
+struct AgnProfile
+{
+  GtArray *stages;
+  long active;
+};
+
+struct AgnProfileStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  AgnProfile *profile;
+  GtUword stage;
+};
+
+/**
+ * Snapshot of the process' resource usage.
+ */
+typedef struct
+{
+  double wall;
+  double cpu;
+  long rss;
+} ProfileSample;
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* profile_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void profile_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls a node from the wrapped stream, charging the time and memory
+ * used to the wrapped stage.
+ */
+static int profile_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error);
+
+/**
+ * @function Record the current wall time, CPU time, and peak resident set size.
+ */
+static void profile_sample(ProfileSample *sample);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_profile_delete(AgnProfile *profile)
+{
+  GtUword i;
+  if(profile == NULL)
+    return;
+
+  for(i = 0; i < gt_array_size(profile->stages); i++)
+  {
+    ProfileStage *stage = gt_array_get(profile->stages, i);
+    gt_free(stage->label);
+  }
+  gt_array_delete(profile->stages);
+  gt_free(profile);
+}
+
+AgnProfile *agn_profile_new()
+{
+  AgnProfile *profile = gt_malloc( sizeof(AgnProfile) );
+  profile->stages = gt_array_new( sizeof(ProfileStage) );
+  profile->active = -1;
+  return profile;
+}
+
+void agn_profile_print(AgnProfile *profile, FILE *outstream, bool json)
+{
+  GtUword i;
+  agn_assert(profile && outstream);
+
+  if(json)
+    fputs("[\n", outstream);
+  else
+  {
+    fprintf(outstream, "%-24s %12s %10s %10s %12s %10s %12s\n", "Stage",
+            "Nodes", "Wall(s)", "CPU(s)", "Nodes/s", "Depth", "RSS(KB)");
+  }
+
+  for(i = 0; i < gt_array_size(profile->stages); i++)
+  {
+    ProfileStage *stage = gt_array_get(profile->stages, i);
+    double wall = stage->wall - stage->childwall;
+    double cpu = stage->cpu - stage->childcpu;
+    long rss = stage->rss - stage->childrss;
+    double rate = wall > 0.0 ? stage->nodes / wall : 0.0;
+    if(json)
+    {
+      fprintf(outstream, "  { \"stage\": \"%s\", \"nodes\": %lu, "
+              "\"wall\": %.6lf, \"cpu\": %.6lf, \"nodes_per_sec\": %.1lf, "
+              "\"depth\": %lu, \"rss_kb\": %ld }%s\n", stage->label,
+              stage->nodes, wall, cpu, rate, stage->maxdepth, rss,
+              i + 1 < gt_array_size(profile->stages) ? "," : "");
+    }
+    else
+    {
+      fprintf(outstream, "%-24s %12lu %10.3lf %10.3lf %12.1lf %10lu %12ld\n",
+              stage->label, stage->nodes, wall, cpu, rate, stage->maxdepth,
+              rss);
+    }
+  }
+
+  if(json)
+    fputs("]\n", outstream);
+}
+
+GtNodeStream *agn_profile_stream_new(GtNodeStream *in_stream,
+                                     AgnProfile *profile, const char *label)
+{
+  GtNodeStream *ns;
+  AgnProfileStream *stream;
+  ProfileStage stage = { NULL, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0, 0 };
+  agn_assert(in_stream && profile && label);
+
+  ns = gt_node_stream_create(profile_stream_class(), false);
+  stream = profile_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->profile = profile;
+  stream->stage = gt_array_size(profile->stages);
+  stage.label = gt_cstr_dup(label);
+  gt_array_add(profile->stages, stage);
+  return ns;
+}
+
+GtNodeStream *agn_profile_stream_wrap(AgnProfile *profile,
+                                      GtNodeStream *stream, const char *label,
+                                      GtQueue *streams)
+{
+  GtNodeStream *wrapper;
+  agn_assert(stream && label && streams);
+  if(profile == NULL)
+    return stream;
+
+  wrapper = agn_profile_stream_new(stream, profile, label);
+  gt_queue_add(streams, wrapper);
+  return wrapper;
+}
+
+static void profile_sample(ProfileSample *sample)
+{
+  struct timeval now;
+  struct rusage usage;
+  gettimeofday(&now, NULL);
+  getrusage(RUSAGE_SELF, &usage);
+  sample->wall = now.tv_sec + now.tv_usec / 1000000.0;
+  sample->cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+                usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+  sample->rss = usage.ru_maxrss;
+}
+
+static const GtNodeStreamClass *profile_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnProfileStream),
+                                   profile_stream_free,
+                                   profile_stream_next);
+  }
+  return nsc;
+}
+
+static void profile_stream_free(GtNodeStream *ns)
+{
+  AgnProfileStream *stream = profile_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static int profile_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error)
+{
+  AgnProfileStream *stream;
+  AgnProfile *profile;
+  ProfileStage *stage;
+  ProfileSample before, after;
+  long caller;
+  int had_err;
+  gt_error_check(error);
+  stream = profile_stream_cast(ns);
+  profile = stream->profile;
+
+  caller = profile->active;
+  profile->active = stream->stage;
+  stage = gt_array_get(profile->stages, stream->stage);
+  stage->depth = 0;
+
+  profile_sample(&before);
+  had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  profile_sample(&after);
+
+  // The stages array does not change size while the pipeline runs
+  stage->wall += after.wall - before.wall;
+  stage->cpu  += after.cpu - before.cpu;
+  stage->rss  += after.rss - before.rss;
+  if(stage->depth > stage->maxdepth)
+    stage->maxdepth = stage->depth;
+  if(!had_err && *gn != NULL)
+    stage->nodes++;
+
+  profile->active = caller;
+  if(caller >= 0)
+  {
+    ProfileStage *downstream = gt_array_get(profile->stages, caller);
+    downstream->childwall += after.wall - before.wall;
+    downstream->childcpu  += after.cpu - before.cpu;
+    downstream->childrss  += after.rss - before.rss;
+    if(!had_err && *gn != NULL)
+      downstream->depth++;
+  }
+
+  return had_err;
+}
@@ -0,0 +1,260 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "core/str_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/feature_node_api.h"
+#include "extended/meta_node_api.h"
+#include "AgnSortCheckStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * The sequence ID, start coordinate, and line number of the previous feature
+ * are copied rather than keeping a reference to the feature itself, which may
+ * be modified or deleted further down the stream.
+ */
+struct AgnSortCheckStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtStr *seqid;
+  GtUword start;
+  GtUword line;
+  GtUword numfeatures;
+  bool mark;
+};
+
+#define SORT_CHECK_STREAM_PRAGMA "aegean-sorted"
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define sort_check_stream_cast(GS)\
+        gt_node_stream_cast(sort_check_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* sort_check_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void sort_check_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls nodes from the input stream, checks the order of features,
+ * and delivers the nodes to the output stream.
+ */
+static int sort_check_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error);
+
+/**
+ * @function Pass the given nodes through a sort check stream, and check that
+ * the expected number of features is delivered and that an error is reported
+ * only when expected.
+ */
+static bool sort_check_stream_test(GtArray *nodes, bool mark,
+                                   GtUword numexpected, bool experror);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_sort_check_stream_mark_output(AgnSortCheckStream *stream)
+{
+  agn_assert(stream);
+  stream->mark = true;
+}
+
+GtNodeStream *agn_sort_check_stream_new(GtNodeStream *in_stream)
+{
+  agn_assert(in_stream);
+  GtNodeStream *ns = gt_node_stream_create(sort_check_stream_class(), false);
+  AgnSortCheckStream *stream = sort_check_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->seqid = gt_str_new();
+  stream->start = 0;
+  stream->line = 0;
+  stream->numfeatures = 0;
+  stream->mark = false;
+  return ns;
+}
+
+bool agn_sort_check_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_meta_node_new(SORT_CHECK_STREAM_PRAGMA, NULL);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 100, 900, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 100, 400, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 500, 800, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 50, 300, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  bool test1 = sort_check_stream_test(nodes, false, 4, false);
+  agn_unit_test_result(test, "sorted", test1);
+  gt_array_delete(nodes);
+
+  nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  gn = gt_feature_node_new(chr1, "gene", 100, 900, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 500, 800, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  bool test2 = sort_check_stream_test(nodes, true, 2, false);
+  agn_unit_test_result(test, "marked", test2);
+  gt_array_delete(nodes);
+
+  nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  gn = gt_feature_node_new(chr1, "gene", 500, 800, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 100, 900, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  bool test3 = sort_check_stream_test(nodes, false, 1, true);
+  agn_unit_test_result(test, "coordinates out of order", test3);
+  gt_array_delete(nodes);
+
+  nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  gn = gt_feature_node_new(chr2, "gene", 50, 300, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 100, 900, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  bool test4 = sort_check_stream_test(nodes, false, 1, true);
+  agn_unit_test_result(test, "sequences out of order", test4);
+  gt_array_delete(nodes);
+
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *sort_check_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnSortCheckStream),
+                                   sort_check_stream_free,
+                                   sort_check_stream_next);
+  }
+  return nsc;
+}
+
+static void sort_check_stream_free(GtNodeStream *ns)
+{
+  AgnSortCheckStream *stream = sort_check_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_str_delete(stream->seqid);
+}
+
+static int sort_check_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error)
+{
+  AgnSortCheckStream *stream;
+  int had_err;
+  gt_error_check(error);
+  stream = sort_check_stream_cast(ns);
+
+  if(stream->mark)
+  {
+    stream->mark = false;
+    *gn = gt_meta_node_new(SORT_CHECK_STREAM_PRAGMA, NULL);
+    return 0;
+  }
+
+  while(1)
+  {
+    had_err = gt_node_stream_next(stream->in_stream, gn, error);
+    if(had_err || !*gn)
+      return had_err;
+
+    GtMetaNode *mn = gt_meta_node_try_cast(*gn);
+    if(mn != NULL &&
+       strcmp(gt_meta_node_get_directive(mn), SORT_CHECK_STREAM_PRAGMA) == 0)
+    {
+      gt_genome_node_delete(*gn);
+      continue;
+    }
+
+    GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+    if(fn == NULL)
+      return 0;
+
+    const char *seqid = gt_str_get(gt_genome_node_get_seqid(*gn));
+    GtUword start = gt_genome_node_get_start(*gn);
+    GtUword line = gt_genome_node_get_line_number(*gn);
+    if(stream->numfeatures > 0)
+    {
+      int seqcmp = strcmp(seqid, gt_str_get(stream->seqid));
+      if(seqcmp < 0 || (seqcmp == 0 && start < stream->start))
+      {
+        const char *filename = gt_genome_node_get_filename(*gn);
+        gt_error_set(error, "input is not sorted: feature at %s:%lu (file "
+                     "'%s', line %lu) follows feature at %s:%lu (line %lu)",
+                     seqid, start, filename ? filename : "", line,
+                     gt_str_get(stream->seqid), stream->start, stream->line);
+        gt_genome_node_delete(*gn);
+        *gn = NULL;
+        return -1;
+      }
+    }
+    gt_str_set(stream->seqid, seqid);
+    stream->start = start;
+    stream->line = line;
+    stream->numfeatures++;
+    return 0;
+  }
+}
+
+static bool sort_check_stream_test(GtArray *nodes, bool mark,
+                                   GtUword numexpected, bool experror)
+{
+  GtError *error = gt_error_new();
+  GtUword progress;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *scs = agn_sort_check_stream_new(ais);
+  if(mark)
+    agn_sort_check_stream_mark_output((AgnSortCheckStream *)scs);
+
+  GtUword numfeatures = 0, nummeta = 0;
+  GtGenomeNode *gn;
+  int had_err;
+  while((had_err = gt_node_stream_next(scs, &gn, error)) == 0 && gn != NULL)
+  {
+    if(gt_feature_node_try_cast(gn) != NULL)
+      numfeatures++;
+    else if(gt_meta_node_try_cast(gn) != NULL)
+      nummeta++;
+    gt_genome_node_delete(gn);
+  }
+  bool success = numfeatures == numexpected && (had_err != 0) == experror &&
+                 nummeta == (mark ? 1 : 0);
+
+  // Release any nodes not pulled after an error
+  while(gt_node_stream_next(ais, &gn, error) == 0 && gn != NULL)
+    gt_genome_node_delete(gn);
+
+  gt_node_stream_delete(scs);
+  gt_node_stream_delete(ais);
+  gt_error_delete(error);
+  return success;
+}
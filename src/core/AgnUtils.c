@@ -7,6 +7,9 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include "core/hashmap_api.h"
 #include "extended/feature_node_iterator_api.h"
@@ -304,6 +307,21 @@ bool agn_overlap_ilocus(GtGenomeNode *f1, GtGenomeNode *f2,
   return gt_range_overlap_delta(&r1, &r2, minoverlap);
 }
 
+bool agn_parse_uword(const char *str, GtUword *value)
+{
+  agn_assert(str && value);
+  if(!isdigit((unsigned char)str[0]))
+    return false;
+
+  char *end;
+  errno = 0;
+  GtUword result = strtoul(str, &end, 10);
+  if(*end != '\0' || errno != 0)
+    return false;
+  *value = result;
+  return true;
+}
+
 void agn_print_version(const char *progname, FILE *outstream)
 {
   fprintf(outstream, "[%s] AEGeAn Toolkit %s (%s %s)\n", progname,
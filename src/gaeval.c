@@ -9,11 +9,15 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 
 #include <getopt.h>
+#include <limits.h>
 #include <math.h>
+#include <string.h>
 #include "genometools.h"
+#include "AgnGFF3InStream.h"
 #include "AgnGaevalVisitor.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
+#include "AgnProfileStream.h"
 #include "AgnUtils.h"
 
 typedef struct
@@ -21,7 +25,11 @@ typedef struct
   const char *alignfile;
   const char **genefiles;
   int numgenefiles;
+  bool sorted;
+  int numthreads;
   GtStr *tsvout;
+  bool profile;
+  bool profilejson;
   AgnGaevalParams params;
 } GaevalOptions;
 
@@ -45,8 +53,20 @@ static void print_usage(FILE *outstream)
 "  Basic options:\n"
 "    -h|--help               print this help message and exit\n"
 "    -v|--version            print version number and exit\n"
+"    -s|--sorted             indicate that genes and alignments are both\n"
+"                            sorted by sequence ID and start coordinate;\n"
+"                            alignments are then streamed rather than loaded\n"
+"                            into memory all at once; the alignment file must\n"
+"                            separate features with '###' lines, without\n"
+"                            which the parser holds every alignment until\n"
+"                            the end of the file\n"
 "    -t|--tsv FILE           print coverage and integrity scores to the\n"
-"                            specified file in tab-separated text\n\n"
+"                            specified file in tab-separated text\n"
+"    -j|--threads INT        number of threads to use for parsing input and\n"
+"                            scoring gene models; default is 1\n"
+"    -P|--profile[=json]     report the number of nodes processed and the\n"
+"                            time and memory used by each processing stage\n"
+"                            to the terminal (stderr) as a table or as JSON\n\n"
 "  Weights for calculating integrity score (must add up to 1.0):\n"
 "    -a|--alpha: DOUBLE      introns confirmed, or %% expected CDS length for\n"
 "                            single-exon genes; default is 0.6\n"
@@ -61,16 +81,23 @@ static void print_usage(FILE *outstream)
 
 static void parse_options(int argc, char **argv, GaevalOptions *options)
 {
+  options->sorted = false;
+  options->numthreads = 1;
   options->tsvout = NULL;
+  options->profile = false;
+  options->profilejson = false;
   default_params(&options->params);
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hvt:a:b:g:e:c:5:3:";
+  const char *optstr = "hvst:j:P::a:b:g:e:c:5:3:";
   const struct option gaeval_options[] =
   {
     { "help",      no_argument,       NULL, 'h' },
     { "version",   no_argument,       NULL, 'v' },
+    { "sorted",    no_argument,       NULL, 's' },
     { "tsv",       required_argument, NULL, 't' },
+    { "threads",   required_argument, NULL, 'j' },
+    { "profile",   optional_argument, NULL, 'P' },
     { "alpha",     required_argument, NULL, 'a' },
     { "beta",      required_argument, NULL, 'b' },
     { "gamma",     required_argument, NULL, 'g' },
@@ -103,6 +130,26 @@ static void parse_options(int argc, char **argv, GaevalOptions *options)
     }
     else if(opt == 'g')
       options->params.gamma = atof(optarg);
+    else if(opt == 'j')
+    {
+      GtUword numthreads;
+      options->numthreads = 0;
+      if(agn_parse_uword(optarg, &numthreads) && numthreads <= INT_MAX)
+        options->numthreads = numthreads;
+    }
+    else if(opt == 'P')
+    {
+      options->profile = true;
+      if(optarg != NULL && strcmp(optarg, "json") == 0)
+        options->profilejson = true;
+      else if(optarg != NULL && strcmp(optarg, "table") != 0)
+      {
+        fprintf(stderr, "error: unknown profile format '%s'\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 's')
+      options->sorted = true;
     else if(opt == 't')
     {
       if(options->tsvout != NULL)
@@ -126,6 +173,13 @@ static void parse_options(int argc, char **argv, GaevalOptions *options)
     exit(1);
   }
 
+  if(options->numthreads < 1)
+  {
+    print_usage(stderr);
+    fprintf(stderr, "error: number of threads must be a positive integer\n");
+    exit(1);
+  }
+
   double weight_total = options->params.alpha + options->params.beta +
                         options->params.gamma + options->params.epsilon;
   if(fabs(weight_total - 1.0) > 0.00001)
@@ -146,6 +200,7 @@ int main(int argc, char **argv)
   GtError *error;
   GtNodeStream *stream, *last_stream, *align_stream;
   GtQueue *streams;
+  AgnProfile *profile = NULL;
   GaevalOptions options;
 
   //----------
@@ -154,44 +209,55 @@ int main(int argc, char **argv)
   gt_lib_init();
   parse_options(argc, argv, &options);
   streams = gt_queue_new();
+  if(options.profile)
+    profile = agn_profile_new();
 
-  stream = gt_gff3_in_stream_new_unsorted(1, &options.alignfile);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  stream = agn_gff3_in_stream_new(1, &options.alignfile, NULL);
+  agn_gff3_in_stream_set_threads((AgnGFF3InStream *)stream,
+                                 options.numthreads);
   gt_queue_add(streams, stream);
   align_stream = stream;
 
-  stream = gt_gff3_in_stream_new_unsorted(options.numgenefiles,
-                                          options.genefiles);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  stream = agn_gff3_in_stream_new(options.numgenefiles, options.genefiles,
+                                  NULL);
+  agn_gff3_in_stream_set_threads((AgnGFF3InStream *)stream,
+                                 options.numthreads);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "gff3-in", streams);
 
   GtStr *source = gt_str_new_cstr("AEGeAn::GAEVAL");
   GtLogger *logger = gt_logger_new(true, "", stderr);
   stream = agn_infer_cds_stream_new(last_stream, source, logger);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "infer-cds", streams);
 
   stream = agn_infer_exons_stream_new(last_stream, source, logger);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "infer-exons",
+                                        streams);
   gt_str_delete(source);
 
-  GtNodeVisitor *nv = agn_gaeval_visitor_new(align_stream, options.params);
+  GtNodeVisitor *nv;
+  if(options.sorted)
+    nv = agn_gaeval_visitor_new_streaming(align_stream, options.params);
+  else
+    nv = agn_gaeval_visitor_new(align_stream, options.params);
   if(options.tsvout)
   {
     agn_gaeval_visitor_tsv_out((AgnGaevalVisitor *)nv, options.tsvout);
   }
-  stream = gt_visitor_stream_new(last_stream, nv);
+  if(options.numthreads > 1)
+    stream = agn_gaeval_threaded_stream_new(last_stream, nv,
+                                            options.numthreads);
+  else
+    stream = gt_visitor_stream_new(last_stream, nv);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "gaeval", streams);
 
   stream = gt_gff3_out_stream_new(last_stream, NULL);
   gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
   gt_queue_add(streams, stream);
-  last_stream = stream;
+  last_stream = agn_profile_stream_wrap(profile, stream, "gff3-out", streams);
 
   //----------
   // Execute the processing stream
@@ -201,6 +267,11 @@ int main(int argc, char **argv)
   if(had_err)
     fprintf(stderr, "Error processing node stream: %s\n", gt_error_get(error));
   gt_error_delete(error);
+  if(profile != NULL)
+  {
+    agn_profile_print(profile, stderr, options.profilejson);
+    agn_profile_delete(profile);
+  }
 
   //----------
   // Free memory
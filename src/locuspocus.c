@@ -34,6 +34,11 @@ typedef struct
   GtUword minoverlap;
   FILE *ilenfile;
   bool retain;
+  bool profile;
+  bool profilejson;
+  GtHashmap *keepattrs;
+  GtUword sortmem;
+  GtUword numthreads;
 } LocusPocusOptions;
 
 // Set default values for program
@@ -59,6 +64,11 @@ static void set_option_defaults(LocusPocusOptions *options)
   options->minoverlap = 1;
   options->ilenfile = NULL;
   options->retain = false;
+  options->profile = false;
+  options->profilejson = false;
+  options->keepattrs = NULL;
+  options->sortmem = 0;
+  options->numthreads = 1;
 }
 
 static void free_option_memory(LocusPocusOptions *options)
@@ -74,6 +84,8 @@ static void free_option_memory(LocusPocusOptions *options)
     gt_free(options->nameformat);
   if(options->ilenfile != NULL)
     fclose(options->ilenfile);
+  if(options->keepattrs != NULL)
+    gt_hashmap_delete(options->keepattrs);
 }
 
 // Usage statement
@@ -86,6 +98,9 @@ static void print_usage(FILE *outstream)
 "    -d|--debug             print detailed debugging messages to terminal\n"
 "                           (standard error)\n"
 "    -h|--help              print this help message and exit\n"
+"    -P|--profile[=json]    report the number of nodes processed and the time\n"
+"                           and memory used by each processing stage to the\n"
+"                           terminal (standard error) as a table or as JSON\n"
 "    -v|--version           print version number and exit\n\n"
 "  iLocus parsing:\n"
 "    -l|--delta: INT        when parsing interval loci, use the following\n"
@@ -132,6 +147,20 @@ static void print_usage(FILE *outstream)
 "  Input options:\n"
 "    -f|--filter: TYPE      comma-separated list of feature types to use in\n"
 "                           constructing loci/iLoci; default is 'gene'\n"
+"    -j|--threads: INT      number of threads to use for parsing the input;\n"
+"                           default is 1\n"
+"    -k|--keep: KEYS        comma-separated list of attribute keys; all other\n"
+"                           attributes except ID, Parent, Name, and\n"
+"                           accession are discarded before the input is\n"
+"                           parsed; the trimmed input is written to a\n"
+"                           temporary file in $TMPDIR (default /tmp) and\n"
+"                           read back, which costs an extra pass over the\n"
+"                           data and disk space for trimmed copies of the\n"
+"                           input files\n"
+"    -M|--sortmem: INT      when sorting the input, hold at most INT MB of\n"
+"                           features in memory, writing sorted runs to\n"
+"                           temporary files as needed; by default, the\n"
+"                           entire input is sorted in memory\n"
 "    -p|--parent: CT:PT     if a feature of type $CT exists without a parent,\n"
 "                           create a parent for this feature with type $PT;\n"
 "                           for example, mRNA:gene will create a gene feature\n"
@@ -146,7 +175,7 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "cdef:g:hi:l:m:n:o:p:rsTt:uVvy";
+  const char *optstr = "cdef:g:hi:j:k:l:M:m:n:o:P::p:rsTt:uVvy";
   const char *key, *value, *oldvalue;
   const struct option locuspocus_options[] =
   {
@@ -157,11 +186,15 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
     { "genemap",    required_argument, NULL, 'g' },
     { "help",       no_argument,       NULL, 'h' },
     { "ilens",      required_argument, NULL, 'i' },
+    { "threads",    required_argument, NULL, 'j' },
+    { "keep",       required_argument, NULL, 'k' },
     { "delta",      required_argument, NULL, 'l' },
+    { "sortmem",    required_argument, NULL, 'M' },
     { "minoverlap", required_argument, NULL, 'm' },
     { "namefmt",    required_argument, NULL, 'n' },
     { "outfile",    required_argument, NULL, 'o' },
     { "parent",     required_argument, NULL, 'p' },
+    { "profile",    optional_argument, NULL, 'P' },
     { "refine",     no_argument,       NULL, 'r' },
     { "skipends",   no_argument,       NULL, 's' },
     { "retainids",  no_argument,       NULL, 'T' },
@@ -227,6 +260,31 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       if(options->ilenfile == NULL)
         gt_error_set(error, "could not open ilenfile file '%s'", optarg);
     }
+    else if(opt == 'j')
+    {
+      if(!agn_parse_uword(optarg, &options->numthreads) ||
+         options->numthreads == 0)
+      {
+        gt_error_set(error, "could not convert number of threads '%s' to a "
+                     "positive integer", optarg);
+      }
+    }
+    else if(opt == 'k')
+    {
+      if(options->keepattrs == NULL)
+      {
+        options->keepattrs = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                            NULL);
+      }
+      for(value = strtok(optarg, ","); value != NULL; value = strtok(NULL, ","))
+      {
+        if(gt_hashmap_get(options->keepattrs, value) == NULL)
+        {
+          char *keycopy = gt_cstr_dup(value);
+          gt_hashmap_add(options->keepattrs, keycopy, keycopy);
+        }
+      }
+    }
     else if(opt == 'l')
     {
       if(sscanf(optarg, "%lu", &options->delta) == EOF)
@@ -235,6 +293,15 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
                      optarg);
       }
     }
+    else if(opt == 'M')
+    {
+      if(!agn_parse_uword(optarg, &options->sortmem) ||
+         options->sortmem == 0 || options->sortmem > GT_UWORD_MAX / 1048576)
+      {
+        gt_error_set(error, "could not convert sort memory '%s' to a "
+                     "positive integer", optarg);
+      }
+    }
     else if(opt == 'm')
     {
       if(sscanf(optarg, "%lu", &options->minoverlap) == EOF)
@@ -255,6 +322,14 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       options->outstream = gt_file_new(optarg, "w", error);
       options->filefreefunc = gt_file_delete;
     }
+    else if(opt == 'P')
+    {
+      options->profile = true;
+      if(optarg != NULL && strcmp(optarg, "json") == 0)
+        options->profilejson = true;
+      else if(optarg != NULL && strcmp(optarg, "table") != 0)
+        gt_error_set(error, "unknown profile format '%s'", optarg);
+    }
     else if(opt == 'p')
     {
       key = strtok(optarg, ":");
@@ -311,6 +386,7 @@ int main(int argc, char **argv)
   GtLogger *logger;
   GtQueue *streams;
   GtNodeStream *current_stream, *last_stream;
+  AgnProfile *profile = NULL;
   gt_lib_init();
 
   // Parse command-line options
@@ -335,37 +411,62 @@ int main(int argc, char **argv)
 
   logger = gt_logger_new(true, "", stderr);
   streams = gt_queue_new();
+  if(options.profile)
+    profile = agn_profile_new();
 
 
   //----- Set up the node processing stream -----//
   //---------------------------------------------//
 
-  current_stream = gt_gff3_in_stream_new_unsorted(numfiles,
-                                                  (const char **)argv + optind);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  if(options.keepattrs != NULL && options.pseudofix &&
+     gt_hashmap_get(options.keepattrs, "pseudo") == NULL)
+  {
+    char *key = gt_cstr_dup("pseudo");
+    gt_hashmap_add(options.keepattrs, key, key);
+  }
+  current_stream = agn_gff3_in_stream_new(numfiles, (const char **)argv + optind,
+                                          options.keepattrs);
+  agn_gff3_in_stream_set_threads((AgnGFF3InStream *)current_stream,
+                                 options.numthreads);
+  bool sorted = agn_gff3_in_stream_is_sorted((AgnGFF3InStream *)
+                                             current_stream);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "gff3-in",
+                                        streams);
 
   if(options.pseudofix)
   {
     current_stream = agn_pseudogene_fix_stream_new(last_stream);
     gt_queue_add(streams, current_stream);
-    last_stream = current_stream;
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "pseudogene-fix", streams);
   }
 
   current_stream = agn_infer_parent_stream_new(last_stream,
                                                options.type_parents);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                        "infer-parent", streams);
 
   current_stream = agn_filter_stream_new(last_stream, options.filter);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "filter",
+                                        streams);
 
-  current_stream = gt_sort_stream_new(last_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  // Input marked as sorted is merged and checked as it is read
+  if(!sorted)
+  {
+    if(options.sortmem > 0)
+    {
+      current_stream = agn_external_sort_stream_new(last_stream,
+                                                    options.sortmem * 1048576);
+    }
+    else
+      current_stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, current_stream);
+    last_stream = agn_profile_stream_wrap(profile, current_stream, "sort",
+                                          streams);
+  }
 
   current_stream = agn_locus_stream_new(last_stream, options.delta);
   AgnLocusStream *ls = (AgnLocusStream*)current_stream;
@@ -377,7 +478,8 @@ int main(int argc, char **argv)
   if(options.skipiiLoci)
     agn_locus_stream_skip_iiLoci(ls);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "locus",
+                                        streams);
 
   if(options.refine)
   {
@@ -390,7 +492,8 @@ int main(int argc, char **argv)
     if(options.nameformat != NULL)
       agn_locus_refine_stream_set_name_format(lrs, options.nameformat);
     gt_queue_add(streams, current_stream);
-    last_stream = current_stream;
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "locus-refine", streams);
   }
 
   if(options.genestream != NULL || options.transstream != NULL)
@@ -398,21 +501,24 @@ int main(int argc, char **argv)
     current_stream = agn_locus_map_stream_new(last_stream, options.genestream,
                                               options.transstream);
     gt_queue_add(streams, current_stream);
-    last_stream = current_stream;
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "locus-map", streams);
   }
 
   if(options.verbose == 0)
   {
     current_stream = agn_remove_children_stream_new(last_stream);
     gt_queue_add(streams, current_stream);
-    last_stream = current_stream;
+    last_stream = agn_profile_stream_wrap(profile, current_stream,
+                                          "remove-children", streams);
   }
 
   current_stream = gt_gff3_out_stream_new(last_stream, options.outstream);
   if(options.retain)
     gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)current_stream);
   gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  last_stream = agn_profile_stream_wrap(profile, current_stream, "gff3-out",
+                                        streams);
 
 
   //----- Execute the node processing stream -----//
@@ -421,6 +527,11 @@ int main(int argc, char **argv)
   int result = gt_node_stream_pull(last_stream, error);
   if(result == -1)
     fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
+  if(profile != NULL)
+  {
+    agn_profile_print(profile, stderr, options.profilejson);
+    agn_profile_delete(profile);
+  }
 
 
   // Free memory and terminate
@@ -0,0 +1,465 @@
+/**
+
+Copyright (c) 2017, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <getopt.h>
+#include <string.h>
+#include "genometools.h"
+#include "aegean.h"
+
+typedef struct
+{
+  GtUword field;
+  AgnLocusFilterOp operator;
+  double testvalue;
+} QueryFilter;
+
+typedef struct
+{
+  GtArray *filters;
+  bool filter_class;
+  AgnCompClassification classification;
+  char *seqid;
+  GtRange range;
+  bool use_range;
+  bool summary;
+  bool diff;
+} QueryOptions;
+
+// Numeric fields that can be used in filters and that are reported by the
+// summary; the order must match the one used by query_record_values
+static const char *query_fields[] =
+{
+  "Start", "End", "Length",
+  "CDSNucTP", "CDSNucFN", "CDSNucFP", "CDSNucTN",
+  "CDSNucSn", "CDSNucSp", "CDSNucF1", "CDSNucAED",
+  "UTRNucTP", "UTRNucFN", "UTRNucFP", "UTRNucTN",
+  "UTRNucSn", "UTRNucSp", "UTRNucF1", "UTRNucAED",
+  "CDSStrucCorrect", "CDSStrucMissing", "CDSStrucWrong",
+  "CDSStrucSn", "CDSStrucSp", "CDSStrucF1", "CDSStrucAED",
+  "ExonStrucCorrect", "ExonStrucMissing", "ExonStrucWrong",
+  "ExonStrucSn", "ExonStrucSp", "ExonStrucF1", "ExonStrucAED",
+  "UTRStrucCorrect", "UTRStrucMissing", "UTRStrucWrong",
+  "UTRStrucSn", "UTRStrucSp", "UTRStrucF1", "UTRStrucAED",
+  "OverallMatches", "OverallLength", "Identity",
+  NULL
+};
+#define QUERY_NUM_FIELDS 43
+#define QUERY_FIRST_STAT_FIELD 3
+
+static void print_usage(FILE *outstream)
+{
+  fprintf(outstream,
+"\nparseval-query: filter, summarize, and compare ParsEval results stores\n"
+"Usage: parseval-query [options] results.agn\n"
+"       parseval-query [options] --diff old.agn new.agn\n"
+"  Options:\n"
+"    -c|--class: STRING      only report comparisons with the given\n"
+"                            classification: 'perfect_match', 'mislabeled',\n"
+"                            'cds_match', 'exon_match', 'utr_match', or\n"
+"                            'non_match'\n"
+"    -d|--diff               report comparisons that were added (+), removed\n"
+"                            (-), or changed (~) between two stores;\n"
+"                            comparisons are matched by locus coordinates and\n"
+"                            reference transcript IDs\n"
+"    -f|--filter: STRING     only report comparisons satisfying the given\n"
+"                            condition, such as 'CDSNucF1 < 0.9' or\n"
+"                            'Length >= 1000'; may be used multiple times\n"
+"    -h|--help               print this help message and exit\n"
+"    -r|--region: STRING     only report comparisons from the given region,\n"
+"                            formatted as 'seqid' or 'seqid:start-end'\n"
+"    -s|--summary            report counts of each classification and\n"
+"                            aggregate statistics instead of individual\n"
+"                            comparisons\n\n"
+"  Filter fields:\n");
+  GtUword i;
+  for(i = 0; query_fields[i] != NULL; i++)
+    fprintf(outstream, "%s%s", i % 4 == 0 ? "    " : ", ", query_fields[i]);
+  fputs("\n\n", outstream);
+}
+
+static void parse_filter(const char *condition, GtArray *filters)
+{
+  char field[64], opstr[8];
+  QueryFilter filter;
+  int n = sscanf(condition, " %63[A-Za-z0-9] %7[<>=!] %lf", field, opstr,
+                 &filter.testvalue);
+  if(n != 3)
+  {
+    fprintf(stderr, "error: cannot parse filter '%s'\n", condition);
+    exit(1);
+  }
+  if(!agn_locus_filter_op_parse(opstr, &filter.operator))
+  {
+    fprintf(stderr, "error: invalid operator '%s' in filter '%s'\n", opstr,
+            condition);
+    exit(1);
+  }
+  for(filter.field = 0; query_fields[filter.field] != NULL; filter.field++)
+  {
+    if(strcmp(field, query_fields[filter.field]) == 0)
+      break;
+  }
+  if(query_fields[filter.field] == NULL)
+  {
+    fprintf(stderr, "error: unknown field '%s' in filter '%s'\n", field,
+            condition);
+    exit(1);
+  }
+  gt_array_add(filters, filter);
+}
+
+static void parse_region(const char *region, QueryOptions *options)
+{
+  const char *colon = strrchr(region, ':');
+  if(colon != NULL &&
+     sscanf(colon + 1, "%lu-%lu", &options->range.start,
+            &options->range.end) == 2)
+  {
+    if(options->range.start > options->range.end)
+    {
+      fprintf(stderr, "error: invalid region '%s'\n", region);
+      exit(1);
+    }
+    options->seqid = gt_cstr_dup_nt(region, colon - region);
+    options->use_range = true;
+  }
+  else
+    options->seqid = gt_cstr_dup(region);
+}
+
+static void parse_options(int argc, char **argv, QueryOptions *options)
+{
+  int opt = 0;
+  int optindex = 0;
+  const char *optstr = "c:df:hr:s";
+  const struct option query_options[] =
+  {
+    { "class",   required_argument, NULL, 'c' },
+    { "diff",    no_argument,       NULL, 'd' },
+    { "filter",  required_argument, NULL, 'f' },
+    { "help",    no_argument,       NULL, 'h' },
+    { "region",  required_argument, NULL, 'r' },
+    { "summary", no_argument,       NULL, 's' },
+    { NULL,      no_argument,       NULL,  0  },
+  };
+  for(opt  = getopt_long(argc, argv, optstr, query_options, &optindex);
+      opt != -1;
+      opt  = getopt_long(argc, argv, optstr, query_options, &optindex))
+  {
+    if(opt == 'c')
+    {
+      options->filter_class = true;
+      options->classification = agn_comp_classification_parse(optarg);
+      if(options->classification == AGN_COMP_CLASS_UNCLASSIFIED)
+      {
+        fprintf(stderr, "error: unknown classification '%s'\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'd')
+      options->diff = true;
+    else if(opt == 'f')
+      parse_filter(optarg, options->filters);
+    else if(opt == 'h')
+    {
+      print_usage(stdout);
+      exit(0);
+    }
+    else if(opt == 'r')
+      parse_region(optarg, options);
+    else if(opt == 's')
+      options->summary = true;
+    else
+    {
+      print_usage(stderr);
+      exit(1);
+    }
+  }
+
+  int numfiles = argc - optind;
+  if(numfiles != (options->diff ? 2 : 1))
+  {
+    fprintf(stderr, "error: expected %d store file(s), found %d\n",
+            options->diff ? 2 : 1, numfiles);
+    print_usage(stderr);
+    exit(1);
+  }
+  if(options->diff && options->summary)
+  {
+    fputs("error: --diff and --summary cannot be used together\n", stderr);
+    exit(1);
+  }
+}
+
+static double *query_scaled_values(AgnCompStatsScaled *stats, double *values)
+{
+  *values++ = stats->tp;
+  *values++ = stats->fn;
+  *values++ = stats->fp;
+  *values++ = stats->tn;
+  *values++ = stats->sn;
+  *values++ = stats->sp;
+  *values++ = stats->f1;
+  *values++ = stats->ed;
+  return values;
+}
+
+static double *query_binary_values(AgnCompStatsBinary *stats, double *values)
+{
+  *values++ = stats->correct;
+  *values++ = stats->missing;
+  *values++ = stats->wrong;
+  *values++ = stats->sn;
+  *values++ = stats->sp;
+  *values++ = stats->f1;
+  *values++ = stats->ed;
+  return values;
+}
+
+static void query_record_values(AgnCompareRecord *record, double *values)
+{
+  AgnComparison *stats = &record->stats;
+  double *v = values;
+  *v++ = record->range.start;
+  *v++ = record->range.end;
+  *v++ = gt_range_length(&record->range);
+  v = query_scaled_values(&stats->cds_nuc_stats, v);
+  v = query_scaled_values(&stats->utr_nuc_stats, v);
+  v = query_binary_values(&stats->cds_struc_stats, v);
+  v = query_binary_values(&stats->exon_struc_stats, v);
+  v = query_binary_values(&stats->utr_struc_stats, v);
+  *v++ = stats->overall_matches;
+  *v++ = stats->overall_length;
+  *v++ = (double)stats->overall_matches / (double)stats->overall_length;
+  agn_assert(v - values == QUERY_NUM_FIELDS);
+}
+
+static bool query_record_passes(AgnCompareRecord *record,
+                                QueryOptions *options)
+{
+  double values[QUERY_NUM_FIELDS];
+  GtUword i;
+
+  if(options->filter_class && record->classification != options->classification)
+    return false;
+  if(gt_array_size(options->filters) == 0)
+    return true;
+
+  query_record_values(record, values);
+  for(i = 0; i < gt_array_size(options->filters); i++)
+  {
+    QueryFilter *filter = gt_array_get(options->filters, i);
+    if(!agn_locus_filter_op_test(filter->operator, values[filter->field],
+                                 filter->testvalue))
+      return false;
+  }
+  return true;
+}
+
+static void query_print_header(FILE *outstream, bool diff)
+{
+  if(diff)
+    fputs("Change\t", outstream);
+  fputs("Seqid\tStart\tEnd\tRefrTranscripts\tPredTranscripts\tClassification\t"
+        "CDSNucTP\tCDSNucFN\tCDSNucFP\tCDSNucTN\tUTRNucTP\tUTRNucFN\tUTRNucFP\t"
+        "UTRNucTN\tCDSStrucCorrect\tCDSStrucMissing\tCDSStrucWrong\t"
+        "ExonStrucCorrect\tExonStrucMissing\tExonStrucWrong\tUTRStrucCorrect\t"
+        "UTRStrucMissing\tUTRStrucWrong\tOverallMatches\tOverallLength\n",
+        outstream);
+}
+
+static void query_print_record(AgnCompareRecord *record, FILE *outstream)
+{
+  AgnComparison *stats = &record->stats;
+  AgnCompStatsScaled *nucs[] = { &stats->cds_nuc_stats, &stats->utr_nuc_stats };
+  AgnCompStatsBinary *strucs[] = { &stats->cds_struc_stats,
+                                   &stats->exon_struc_stats,
+                                   &stats->utr_struc_stats };
+  GtUword i;
+
+  fprintf(outstream, "%s\t%lu\t%lu\t%s\t%s\t%s", record->seqid,
+          record->range.start, record->range.end, record->refrids,
+          record->predids,
+          agn_comp_classification_label(record->classification));
+  for(i = 0; i < 2; i++)
+  {
+    fprintf(outstream, "\t%lu\t%lu\t%lu\t%lu", nucs[i]->tp, nucs[i]->fn,
+            nucs[i]->fp, nucs[i]->tn);
+  }
+  for(i = 0; i < 3; i++)
+  {
+    fprintf(outstream, "\t%lu\t%lu\t%lu", strucs[i]->correct,
+            strucs[i]->missing, strucs[i]->wrong);
+  }
+  fprintf(outstream, "\t%lu\t%lu\n", stats->overall_matches,
+          stats->overall_length);
+}
+
+static char *query_record_key(AgnCompareRecord *record)
+{
+  GtStr *key = gt_str_new_cstr(record->seqid);
+  gt_str_append_char(key, '\t');
+  gt_str_append_ulong(key, record->range.start);
+  gt_str_append_char(key, '\t');
+  gt_str_append_ulong(key, record->range.end);
+  gt_str_append_char(key, '\t');
+  gt_str_append_cstr(key, record->refrids);
+  char *keystr = gt_cstr_dup(gt_str_get(key));
+  gt_str_delete(key);
+  return keystr;
+}
+
+static void query_diff(AgnCompareStore *oldstore, AgnCompareStore *newstore,
+                       QueryOptions *options, FILE *outstream)
+{
+  AgnCompareRecord record, oldrecord;
+  GtHashmap *oldrows = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                      gt_free_func);
+  GtUword i;
+
+  for(i = 0; i < agn_compare_store_size(oldstore); i++)
+  {
+    agn_compare_store_get(oldstore, i, &record);
+    if(!query_record_passes(&record, options))
+      continue;
+    GtUword *row = gt_malloc(sizeof (GtUword));
+    *row = i;
+    gt_hashmap_add(oldrows, query_record_key(&record), row);
+  }
+
+  query_print_header(outstream, true);
+  for(i = 0; i < agn_compare_store_size(newstore); i++)
+  {
+    agn_compare_store_get(newstore, i, &record);
+    if(!query_record_passes(&record, options))
+      continue;
+
+    char *key = query_record_key(&record);
+    GtUword *row = gt_hashmap_get(oldrows, key);
+    if(row == NULL)
+    {
+      fputs("+\t", outstream);
+      query_print_record(&record, outstream);
+    }
+    else
+    {
+      agn_compare_store_get(oldstore, *row, &oldrecord);
+      if(record.classification != oldrecord.classification ||
+         strcmp(record.predids, oldrecord.predids) != 0 ||
+         !agn_comparison_test(&record.stats, &oldrecord.stats))
+      {
+        fputs("~\t", outstream);
+        query_print_record(&record, outstream);
+      }
+      gt_hashmap_remove(oldrows, key);
+    }
+    gt_free(key);
+  }
+
+  // Anything left in the table has no counterpart in the new store
+  for(i = 0; i < agn_compare_store_size(oldstore); i++)
+  {
+    agn_compare_store_get(oldstore, i, &record);
+    if(!query_record_passes(&record, options))
+      continue;
+    char *key = query_record_key(&record);
+    if(gt_hashmap_get(oldrows, key) != NULL)
+    {
+      fputs("-\t", outstream);
+      query_print_record(&record, outstream);
+    }
+    gt_free(key);
+  }
+  gt_hashmap_delete(oldrows);
+}
+
+static void query_summary(AgnCompareStore *store, QueryOptions *options,
+                          FILE *outstream)
+{
+  GtUword counts[AGN_COMP_CLASS_NON_MATCH + 1] = { 0 };
+  GtUword total = 0, i;
+  AgnCompareRecord record, aggregate;
+  double values[QUERY_NUM_FIELDS];
+
+  agn_comparison_init(&aggregate.stats);
+  aggregate.range.start = aggregate.range.end = 0;
+  for(i = 0; i < agn_compare_store_size(store); i++)
+  {
+    agn_compare_store_get(store, i, &record);
+    if(!query_record_passes(&record, options))
+      continue;
+    total++;
+    if(record.classification <= AGN_COMP_CLASS_NON_MATCH)
+      counts[record.classification]++;
+    agn_comparison_aggregate(&aggregate.stats, &record.stats);
+  }
+  agn_comparison_resolve(&aggregate.stats);
+
+  fprintf(outstream, "Comparisons\t%lu\n", total);
+  AgnCompClassification cls;
+  for(cls = AGN_COMP_CLASS_PERFECT_MATCH; cls <= AGN_COMP_CLASS_NON_MATCH; cls++)
+  {
+    fprintf(outstream, "%s\t%lu\n", agn_comp_classification_label(cls),
+            counts[cls]);
+  }
+  query_record_values(&aggregate, values);
+  for(i = QUERY_FIRST_STAT_FIELD; i < QUERY_NUM_FIELDS; i++)
+    fprintf(outstream, "%s\t%.3lf\n", query_fields[i], values[i]);
+}
+
+int main(int argc, char **argv)
+{
+  GtError *error;
+  AgnCompareStore *store, *newstore = NULL;
+  QueryOptions options = { NULL, false, AGN_COMP_CLASS_UNCLASSIFIED, NULL,
+                           { 0, 0 }, false, false, false };
+  int had_err = 0;
+
+  gt_lib_init();
+  options.filters = gt_array_new(sizeof (QueryFilter));
+  parse_options(argc, argv, &options);
+  error = gt_error_new();
+
+  GtRange *range = options.use_range ? &options.range : NULL;
+  store = agn_compare_store_open(argv[optind], options.seqid, range, error);
+  if(store != NULL && options.diff)
+  {
+    newstore = agn_compare_store_open(argv[optind + 1], options.seqid, range,
+                                      error);
+  }
+  if(store == NULL || (options.diff && newstore == NULL))
+  {
+    fprintf(stderr, "[parseval-query] error: %s\n", gt_error_get(error));
+    had_err = 1;
+  }
+  else if(options.diff)
+    query_diff(store, newstore, &options, stdout);
+  else if(options.summary)
+    query_summary(store, &options, stdout);
+  else
+  {
+    AgnCompareRecord record;
+    GtUword i;
+    query_print_header(stdout, false);
+    for(i = 0; i < agn_compare_store_size(store); i++)
+    {
+      agn_compare_store_get(store, i, &record);
+      if(query_record_passes(&record, &options))
+        query_print_record(&record, stdout);
+    }
+  }
+
+  agn_compare_store_delete(store);
+  agn_compare_store_delete(newstore);
+  gt_array_delete(options.filters);
+  gt_free(options.seqid);
+  gt_error_delete(error);
+  gt_lib_clean();
+  return had_err;
+}
@@ -8,7 +8,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 #include <getopt.h>
+#include <string.h>
 #include "genometools.h"
+#include "AgnGFF3InStream.h"
 #include "AgnMrnaRepVisitor.h"
 #include "AgnPseudogeneFixVisitor.h"
 
@@ -19,6 +21,8 @@ typedef struct
   bool fix_pseudogenes;
   bool locus_parent;
   FILE *mapstream;
+  AgnMrnaRepPolicy policy;
+  const char *attribute;
 } PmrnaOptions;
 
 static void print_usage(FILE *outstream)
@@ -26,6 +30,7 @@ static void print_usage(FILE *outstream)
   fprintf(outstream,
 "\npmrna: filter out all but the primary isoform from each gene of the input\n"
 "Usage: pmrna [options] < annot.gff3 > new.gff3\n"
+"       pmrna [options] annot.gff3|annot.agb [...] > new.gff3\n"
 "  Options:\n"
 "    -h|--help           print this help message and exit\n"
 "    -i|--introns        flag indicating that introns are declared explicitly\n"
@@ -34,14 +39,19 @@ static void print_usage(FILE *outstream)
 "    -l|--locus          report a single representative mRNA for each locus\n"
 "                        instead of each gene\n"
 "    -m|--map: FILE      write each gene/mRNA mapping to the specified file\n"
-"    -p|--pseudogenes    disable pseudogene detection and correction\n\n");
+"    -p|--pseudogenes    disable pseudogene detection and correction\n"
+"    -s|--select: STR    criterion by which the representative mRNA is\n"
+"                        selected: 'cds' for the longest CDS, 'transcript'\n"
+"                        for the longest spliced transcript, 'exons' for the\n"
+"                        most exons, or 'attr:KEY' for the highest numeric\n"
+"                        value of the KEY attribute; default is 'cds'\n\n");
 }
 
 static void parse_options(int argc, char **argv, PmrnaOptions *options)
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hilm:p";
+  const char *optstr = "hilm:ps:";
   const struct option pmrna_options[] =
   {
     { "help",        no_argument,       NULL, 'h' },
@@ -49,6 +59,7 @@ static void parse_options(int argc, char **argv, PmrnaOptions *options)
     { "locus",       no_argument,       NULL, 'l' },
     { "map",         required_argument, NULL, 'm' },
     { "pseudogenes", no_argument,       NULL, 'o' },
+    { "select",      required_argument, NULL, 's' },
     { NULL,          no_argument,       NULL,  0  },
   };
   for(opt  = getopt_long(argc, argv + 0, optstr, pmrna_options, &optindex);
@@ -75,6 +86,25 @@ static void parse_options(int argc, char **argv, PmrnaOptions *options)
     }
     else if(opt == 'p')
       options->fix_pseudogenes = false;
+    else if(opt == 's')
+    {
+      if(strcmp(optarg, "cds") == 0)
+        options->policy = AGN_MRNA_REP_CDS_LENGTH;
+      else if(strcmp(optarg, "transcript") == 0)
+        options->policy = AGN_MRNA_REP_TRANSCRIPT_LENGTH;
+      else if(strcmp(optarg, "exons") == 0)
+        options->policy = AGN_MRNA_REP_EXON_COUNT;
+      else if(strncmp(optarg, "attr:", 5) == 0 && optarg[5] != '\0')
+      {
+        options->policy = AGN_MRNA_REP_ATTRIBUTE;
+        options->attribute = optarg + 5;
+      }
+      else
+      {
+        fprintf(stderr, "error: unknown selection criterion '%s'\n", optarg);
+        exit(1);
+      }
+    }
   }
 }
 
@@ -83,7 +113,8 @@ int main(int argc, char **argv)
   GtError *error;
   GtNodeStream *stream, *last_stream;
   GtQueue *streams;
-  PmrnaOptions options = { true, NULL, true, false, NULL };
+  PmrnaOptions options = { true, NULL, true, false, NULL,
+                           AGN_MRNA_REP_CDS_LENGTH, NULL };
   parse_options(argc, argv, &options);
 
   //----------
@@ -92,9 +123,8 @@ int main(int argc, char **argv)
   gt_lib_init();
   streams = gt_queue_new();
 
-  stream = gt_gff3_in_stream_new_unsorted(0, NULL);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  stream = agn_gff3_in_stream_new(argc - optind, (const char **)argv + optind,
+                                  NULL);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
@@ -105,14 +135,9 @@ int main(int argc, char **argv)
     last_stream = stream;
   }
 
-  if(options.infer_introns)
-  {
-    stream = gt_add_introns_stream_new(last_stream);
-    gt_queue_add(streams, stream);
-    last_stream = stream;
-  }
-
   GtNodeVisitor *nv = agn_mrna_rep_visitor_new(options.mapstream);
+  agn_mrna_rep_visitor_set_policy((AgnMrnaRepVisitor *)nv, options.policy,
+                                  options.attribute);
   if(options.locus_parent)
   {
     agn_mrna_rep_visitor_set_parent_type((AgnMrnaRepVisitor *)nv, "locus");
@@ -132,6 +157,14 @@ int main(int argc, char **argv)
   gt_queue_add(streams, stream);
   last_stream = stream;
 
+  // Introns are inferred only for the representative mRNAs
+  if(options.infer_introns)
+  {
+    stream = gt_add_introns_stream_new(last_stream);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+
   stream = gt_gff3_out_stream_new(last_stream, NULL);
   gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
   gt_queue_add(streams, stream);
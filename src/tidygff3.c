@@ -9,25 +9,68 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 
 #include <getopt.h>
+#include <limits.h>
 #include "genometools.h"
 #include "aegean.h"
 
-int main(int argc, char **argv)
+static void print_usage(FILE *outstream)
 {
-  GtError *error;
-  GtNodeStream *stream, *last_stream;
-  GtQueue *streams;
+  fputs("\nUsage: tidygff3 [options] < in.gff3 > out.gff3\n"
+"  Options:\n"
+"     -h|--help               print this help message and exit\n"
+"     -j|--threads: INT       number of threads to use for processing genes;\n"
+"                             default is 1\n\n",
+        outstream);
+}
 
-  // Set up the processing stream
-  //----------
-  gt_lib_init();
-  streams = gt_queue_new();
+static int tidygff3_parse_options(int argc, char **argv)
+{
+  int opt = 0;
+  int optindex = 0;
+  GtUword numthreads = 1;
+  const char *optstr = "hj:";
+  const struct option init_options[] =
+  {
+    { "help",    no_argument,       NULL, 'h' },
+    { "threads", required_argument, NULL, 'j' },
+    { NULL,      no_argument,       NULL, 0 },
+  };
 
-  stream = gt_gff3_in_stream_new_unsorted(0, NULL);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
+  for(opt = getopt_long(argc, argv, optstr, init_options, &optindex);
+      opt != -1;
+      opt = getopt_long(argc, argv, optstr, init_options, &optindex))
+  {
+    if(opt == 'h')
+    {
+      print_usage(stdout);
+      exit(0);
+    }
+    else if(opt == 'j')
+    {
+      if(!agn_parse_uword(optarg, &numthreads))
+        numthreads = 0;
+    }
+    else
+    {
+      print_usage(stderr);
+      exit(1);
+    }
+  }
+  if(numthreads < 1 || numthreads > INT_MAX)
+  {
+    fprintf(stderr, "error: number of threads must be a positive integer\n");
+    exit(1);
+  }
+  return numthreads;
+}
+
+// Per-feature cleanup stages; with multiple threads, each worker of the map
+// stream gets its own copy
+static GtNodeStream *tidygff3_chain(GtNodeStream *in, GtUword worker,
+                                    GtUword numworkers, GtLogger *logger,
+                                    GtQueue *streams, void *data)
+{
+  GtNodeStream *stream, *last_stream = in;
 
   stream = agn_pseudogene_fix_stream_new(last_stream);
   gt_queue_add(streams, stream);
@@ -59,6 +102,37 @@ int main(int argc, char **argv)
   gt_hashmap_delete(types);
   gt_str_delete(source);
 
+  return last_stream;
+}
+
+int main(int argc, char **argv)
+{
+  GtError *error;
+  GtNodeStream *stream, *last_stream;
+  GtQueue *streams;
+  int numthreads = tidygff3_parse_options(argc, argv);
+
+  // Set up the processing stream
+  //----------
+  gt_lib_init();
+  streams = gt_queue_new();
+
+  stream = gt_gff3_in_stream_new_unsorted(0, NULL);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+  gt_queue_add(streams, stream);
+  last_stream = stream;
+
+  if(numthreads > 1)
+  {
+    stream = agn_map_stream_new(last_stream, tidygff3_chain, NULL, numthreads,
+                                NULL);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+  else
+    last_stream = tidygff3_chain(last_stream, 0, 1, NULL, streams, NULL);
+
   stream = gt_gff3_out_stream_new(last_stream, NULL);
   gt_queue_add(streams, stream);
   last_stream = stream;
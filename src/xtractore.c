@@ -21,7 +21,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 typedef struct
 {
   FILE *idfile;
-  GtHashmap *ids2keep;
+  AgnIdSet *ids2keep;
   FILE *outfile;
   bool typeoverride;
   GtHashmap *typestoextract;
@@ -112,7 +112,7 @@ static void xtract_options_free_memory(XtractoreOptions *options)
   if(options->idfile != NULL)
     fclose(options->idfile);
   if(options->ids2keep != NULL)
-    gt_hashmap_delete(options->ids2keep);
+    agn_id_set_delete(options->ids2keep);
   fclose(options->outfile);
   gt_hashmap_delete(options->typestoextract);
 }
@@ -193,17 +193,7 @@ static void xtract_options_parse(int argc, char **argv,
     }
   }
   if(options->idfile != NULL)
-  {
-    char buffer[512];
-    char *id, *idcopy;
-    options->ids2keep = gt_hashmap_new(GT_HASH_STRING, (GtFree)free, NULL);
-    while(fgets(buffer, 511, options->idfile))
-    {
-      id = strtok(buffer, " \t\n");
-      idcopy = gt_cstr_dup(id);
-      gt_hashmap_add(options->ids2keep, idcopy, idcopy);
-    }
-  }
+    options->ids2keep = agn_id_set_read(options->idfile, error);
 }
 
 static void xtract_options_set_defaults(XtractoreOptions *options)
@@ -402,7 +392,11 @@ static void xt_print_usage(FILE *outstream)
 "    -h|--help             print this help message and exit\n"
 "    -i|--idfile: FILE     file containing a list of feature IDs (1 per line\n"
 "                          with no spaces); if provided, only features with\n"
-"                          IDs in this file will be extracted\n"
+"                          IDs in this file (or with subfeatures with IDs in\n"
+"                          this file) will be extracted, and only the listed\n"
+"                          subfeatures of the latter are retained; an ID\n"
+"                          ending in '*' matches any ID beginning with the\n"
+"                          preceding characters\n"
 "    -o|--outfile: FILE    file to which output sequences will be written;\n"
 "                          default is terminal (stdout)\n"
 "    -t|--type: STRING     feature type to extract; can be used multiple\n"
@@ -452,9 +446,7 @@ int main(int argc, char **argv)
 
   streams = gt_queue_new();
 
-  current_stream = gt_gff3_in_stream_new_unsorted(1, &featfile);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  current_stream = agn_gff3_in_stream_new(1, &featfile, NULL);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
@@ -18,3 +18,123 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "A. mellifera gene multitrans" $result
 rm $tempfile
+
+$memcheckcmd \
+bin/canon-gff3 --profile --outfile $tempfile \
+    data/gff3/amel-gene-multitrans.gff3 2> $tempfile.profile
+
+diff $tempfile data/gff3/amel-gene-multitrans-canon.gff3 > /dev/null
+status=$?
+stages=$(cut -f 1 -d ' ' $tempfile.profile | tr '\n' ' ')
+result="FAIL"
+if [[ $status == 0 && $stages == "Stage gff3-in canon gff3-out " ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "A. mellifera multitrans (profile)" $result
+rm $tempfile $tempfile.profile
+
+bin/canon-gff3 --outfile $tempfile.serial data/gff3/grape-refr.gff3
+$memcheckcmd \
+bin/canon-gff3 --threads 3 --outfile $tempfile data/gff3/grape-refr.gff3
+
+diff $tempfile $tempfile.serial > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape refr (threads)" $result
+rm $tempfile $tempfile.serial
+
+# CDS IDs are generated for the prediction's unnamed CDS features
+bin/canon-gff3 --outfile $tempfile.serial data/gff3/grape-pred.gff3 \
+    2> $tempfile.serial.log
+$memcheckcmd \
+bin/canon-gff3 --threads 3 --outfile $tempfile data/gff3/grape-pred.gff3 \
+    2> $tempfile.log
+
+diff $tempfile $tempfile.serial > /dev/null && \
+diff $tempfile.log $tempfile.serial.log > /dev/null && \
+grep -Eq 'ID=CDS0(;|$)' $tempfile
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape pred (threads, CDS IDs)" $result
+rm $tempfile $tempfile.serial $tempfile.log $tempfile.serial.log
+
+# Input marked with the ##aegean-sorted pragma is streamed without sorting,
+# merged across files, and rejected if it is not actually sorted
+genes() {
+  awk -F '\t' '$3 == "gene" { print $9 }' $1 | cut -f 1 -d ';' | tr '\n' ' '
+}
+
+$memcheckcmd \
+bin/canon-gff3 --outfile $tempfile data/gff3/bogus-sorted-1.gff3
+
+status=1
+if grep -qx '##aegean-sorted' $tempfile && \
+   [[ $(genes $tempfile) == "ID=geneA1 ID=geneA2 ID=geneA3 " ]]; then
+  status=0
+fi
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "sorted input" $result
+rm $tempfile
+
+$memcheckcmd \
+bin/canon-gff3 --outfile $tempfile data/gff3/bogus-sorted-1.gff3 \
+    data/gff3/bogus-sorted-2.gff3
+
+merged="ID=geneA1 ID=geneB1 ID=geneA2 ID=geneB2 ID=geneA3 ID=geneB3 "
+status=1
+if grep -qx '##aegean-sorted' $tempfile && \
+   [[ $(genes $tempfile) == "$merged" ]]; then
+  status=0
+fi
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "sorted input (merge)" $result
+rm $tempfile
+
+status=0
+if bin/canon-gff3 --outfile $tempfile data/gff3/bogus-sorted-bad.gff3 \
+       2> $tempfile.log; then
+  status=1
+fi
+if bin/canon-gff3 --outfile $tempfile data/gff3/bogus-sorted-1.gff3 \
+       data/gff3/bogus-sorted-bad.gff3 2>> $tempfile.log; then
+  status=1
+fi
+if [[ $(grep -c 'not sorted' $tempfile.log) != 2 ]]; then
+  status=1
+fi
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "unsorted input marked as sorted" $result
+rm -f $tempfile $tempfile.log
+
+grep -v '^##aegean-sorted' data/gff3/bogus-sorted-bad.gff3 > $tempfile.in.gff3
+$memcheckcmd \
+bin/canon-gff3 --sort --outfile $tempfile $tempfile.in.gff3
+bin/canon-gff3 --outfile $tempfile.again $tempfile
+
+status=1
+if grep -qx '##aegean-sorted' $tempfile && \
+   [[ $(genes $tempfile) == "ID=geneC2 ID=geneC1 ID=geneC3 " ]] && \
+   [[ $(genes $tempfile.again) == "ID=geneC2 ID=geneC1 ID=geneC3 " ]]; then
+  status=0
+fi
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "sort unsorted input" $result
+rm $tempfile $tempfile.again $tempfile.in.gff3
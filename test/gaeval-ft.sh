@@ -36,3 +36,78 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "Pdom" $result
 rm $tempfile
+
+
+$memcheckcmd \
+bin/gaeval --sorted data/gff3/gaeval-stream-unit-test-1.gff3 \
+                    data/gff3/gaeval-stream-unit-test-1.gff3 \
+    > $tempfile
+
+diff $tempfile data/gff3/gaeval-stream-unit-test-1-out.gff3 > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "sans CDS (sorted)" $result
+rm $tempfile
+
+
+$memcheckcmd \
+bin/gaeval --sorted data/gff3/gaeval-stream-unit-test-2.gff3 \
+                    data/gff3/gaeval-stream-unit-test-2.gff3 \
+    > $tempfile
+
+diff $tempfile data/gff3/gaeval-stream-unit-test-2-out.gff3 > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Pdom (sorted)" $result
+rm $tempfile
+
+
+$memcheckcmd \
+bin/gaeval --threads 4 data/gff3/gaeval-stream-unit-test-2.gff3 \
+                       data/gff3/gaeval-stream-unit-test-2.gff3 \
+    > $tempfile
+
+diff $tempfile data/gff3/gaeval-stream-unit-test-2-out.gff3 > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Pdom (4 threads)" $result
+rm $tempfile
+
+
+status=0
+if bin/gaeval --sorted data/gff3/gaeval-stream-unit-test-1.gff3 \
+                       data/gff3/gaeval-unsorted-genes.gff3 \
+       > /dev/null 2> $tempfile; then
+  status=1
+fi
+grep -q "gene models are not sorted" $tempfile || status=1
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "unsorted genes (sorted)" $result
+rm $tempfile
+
+
+status=0
+if bin/gaeval --sorted data/gff3/gaeval-unsorted-aligns.gff3 \
+                       data/gff3/gaeval-stream-unit-test-1.gff3 \
+       > /dev/null 2> $tempfile; then
+  status=1
+fi
+grep -q "alignments are not sorted" $tempfile || status=1
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "unsorted alignments (sorted)" $result
+rm $tempfile
@@ -46,6 +46,25 @@ fi
 printf "        | %-36s | %s\n" "A. mellifera pseudo" $result
 rm $tempfile
 
+for criterion in cds:mRNA2:mRNA4 transcript:mRNA1:mRNA5 exons:mRNA3:mRNA4 \
+                 attr:score:mRNA1:mRNA4; do
+  select=${criterion%:*:*}
+  expected=${criterion#$select:}
+  $memcheckcmd \
+  bin/pmrna --select $select --map $tempfile.map \
+      < data/gff3/pmrna-select.gff3 > $tempfile
+
+  printf "GeneID\tMrnaID\ngene1\t%s\ngene2\t%s\n" ${expected%:*} \
+      ${expected#*:} | diff $tempfile.map - > /dev/null
+  status=$?
+  result="FAIL"
+  if [[ $status == 0 ]]; then
+    result="PASS"
+  fi
+  printf "        | %-36s | %s\n" "select $select" $result
+  rm $tempfile $tempfile.map
+done
+
 
 
 echo "    AEGeAn::tidygff3"
@@ -60,3 +79,255 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "A. dorsata exception" $result
 rm $tempfile
+
+$memcheckcmd \
+bin/tidygff3 --threads 2 < data/gff3/ador-except-in.gff3 > $tempfile
+
+diff $tempfile data/gff3/ador-except-out.gff3 > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "A. dorsata exception (threads)" $result
+rm $tempfile
+
+
+
+echo "    AEGeAn::ParsEval"
+bin/parseval data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 \
+    2> /dev/null | grep -c 'Begin comparison' > $tempfile || true
+$memcheckcmd \
+bin/parseval --outformat=tsv data/gff3/grape-refr.gff3 \
+    data/gff3/grape-pred.gff3 2> /dev/null | tail -n +2 | wc -l \
+    | diff -w - $tempfile > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (tsv rows)" $result
+rm $tempfile
+
+bin/parseval --outformat=tsv data/gff3/grape-refr.gff3 \
+    data/gff3/grape-pred.gff3 2> /dev/null > $tempfile
+bin/parseval --outformat=tsv --cache=${tempfile}.cache \
+    data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 2> /dev/null \
+    > /dev/null
+$memcheckcmd \
+bin/parseval --outformat=tsv --cache=${tempfile}.cache \
+    data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 2> /dev/null \
+    | diff - $tempfile > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (cached)" $result
+rm $tempfile ${tempfile}.cache
+
+bin/parseval --outformat=tsv --delta=100 --maxtrans=8 \
+    data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 2> /dev/null \
+    > $tempfile
+bin/parseval --outformat=tsv --cache=${tempfile}.cache \
+    data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 2> /dev/null \
+    > /dev/null
+$memcheckcmd \
+bin/parseval --outformat=tsv --delta=100 --maxtrans=8 \
+    --cache=${tempfile}.cache data/gff3/grape-refr.gff3 \
+    data/gff3/grape-pred.gff3 2> /dev/null | diff - $tempfile > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (cached, new settings)" $result
+rm $tempfile ${tempfile}.cache
+
+bin/parseval --outformat=tsv --store=${tempfile}.agn \
+    data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 2> /dev/null \
+    > $tempfile
+$memcheckcmd \
+bin/parseval-query ${tempfile}.agn | diff - $tempfile > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (store query)" $result
+
+bin/parseval-query --diff ${tempfile}.agn ${tempfile}.agn \
+    | diff - <(head -n 1 $tempfile | sed 's/^/Change\t/') > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (store diff)" $result
+
+# Point the first row's reference IDs past the end of the block's ID heap
+numrows=$(od -An -t u8 -j 16 -N 8 ${tempfile}.agn | tr -d ' ')
+printf '\377\377\377\377\377\377\377\177' \
+    | dd of=${tempfile}.agn bs=1 seek=$((24 + 3 * numrows * 8)) conv=notrunc \
+    2> /dev/null
+errmsg=$($memcheckcmd bin/parseval-query ${tempfile}.agn 2>&1 > /dev/null \
+         || true)
+status=1
+[[ $errmsg == *"is corrupt"* ]] && status=0
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (corrupt store)" $result
+rm $tempfile ${tempfile}.agn
+
+bin/parseval --outformat=tsv data/gff3/grape-refr.gff3 \
+    data/gff3/grape-pred.gff3 2> /dev/null > $tempfile
+cp data/gff3/grape-pred.gff3 ${tempfile}.pred1.gff3
+cp data/gff3/grape-pred.gff3 ${tempfile}.pred2.gff3
+$memcheckcmd \
+bin/parseval --outformat=tsv --outfile=${tempfile}.dir \
+    data/gff3/grape-refr.gff3 ${tempfile}.pred1.gff3 ${tempfile}.pred2.gff3 \
+    2> /dev/null
+diff ${tempfile}.dir/prediction-1.tsv $tempfile > /dev/null && \
+diff ${tempfile}.dir/prediction-2.tsv $tempfile > /dev/null && \
+test $(wc -l < ${tempfile}.dir/summary.tsv) -eq 3
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (multiple predictions)" $result
+rm -r $tempfile ${tempfile}.pred1.gff3 ${tempfile}.pred2.gff3 ${tempfile}.dir
+
+status=0
+for shards in "" abc 10MB 1.5 " 1" -1 0 99999999999999999999; do
+  if bin/parseval --outformat=html --nopng --shards="$shards" \
+         --outfile=$tempfile --overwrite data/gff3/grape-refr.gff3 \
+         data/gff3/grape-pred.gff3 > /dev/null 2>&1; then
+    status=1
+  fi
+done
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "invalid shard sizes" $result
+rm -rf $tempfile
+
+status=0
+for threads in "" abc 4x 0 -1 " 2" 99999999999999999999; do
+  if bin/parseval --outformat=tsv --threads="$threads" --outfile=$tempfile \
+         --overwrite data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 \
+         > /dev/null 2>&1; then
+    status=1
+  fi
+done
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "invalid thread counts" $result
+rm -f $tempfile
+
+status=0
+for sortmem in "" abc 4x 0 -1 " 2" 17592186044416 99999999999999999999; do
+  if bin/parseval --outformat=tsv --sortmem="$sortmem" --outfile=$tempfile \
+         --overwrite data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 \
+         > /dev/null 2>&1; then
+    status=1
+  fi
+  if bin/locuspocus --sortmem="$sortmem" --outfile=$tempfile \
+         data/gff3/grape-refr.gff3 > /dev/null 2>&1; then
+    status=1
+  fi
+  if bin/canon-gff3 --sortmem="$sortmem" --outfile=$tempfile \
+         data/gff3/grape-refr.gff3 > /dev/null 2>&1; then
+    status=1
+  fi
+done
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "invalid sort memory" $result
+rm -f $tempfile
+
+cp -r data/share ${tempfile}.share
+for class in perfectmatches mislabeled cdsmatches exonmatches utrmatches \
+             nonmatches; do
+  echo "STALE SPILL ROW" > ${tempfile}.share/${class}.tmp
+done
+$memcheckcmd \
+bin/parseval --outformat=html --nopng --datashare=${tempfile}.share \
+    --outfile=$tempfile data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3 \
+    > /dev/null 2>&1
+status=0
+grep -rq "STALE SPILL ROW" $tempfile && status=1
+test -z "$(find $tempfile -name '*.tmp')" || status=1
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (stale spill files)" $result
+rm -r $tempfile ${tempfile}.share
+
+# Enough features to write several sorted runs with a 1 MB budget; features
+# read back from the runs must still be matched to the input files
+cp data/gff3/amel-ogs-g7.gff3 ${tempfile}.pred.gff3
+bin/parseval --outformat=tsv data/gff3/amel-ogs-g7.gff3 \
+    ${tempfile}.pred.gff3 2> /dev/null > $tempfile
+$memcheckcmd \
+bin/parseval --outformat=tsv --sortmem=1 data/gff3/amel-ogs-g7.gff3 \
+    ${tempfile}.pred.gff3 2> /dev/null | diff - $tempfile > /dev/null && \
+test $(wc -l < $tempfile) -gt 1
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Amel Group7 (external sort)" $result
+rm $tempfile ${tempfile}.pred.gff3
+
+# Features read from binary files must still be matched to the input files
+for label in refr pred; do
+  bin/canon-gff3 --binary-out=${tempfile}.${label}.agb \
+      data/gff3/grape-${label}.gff3 2> /dev/null
+  bin/canon-gff3 --outfile=${tempfile}.${label}.gff3 \
+      data/gff3/grape-${label}.gff3 2> /dev/null
+done
+bin/parseval --outformat=tsv ${tempfile}.refr.gff3 ${tempfile}.pred.gff3 \
+    2> /dev/null > $tempfile
+$memcheckcmd \
+bin/parseval --outformat=tsv ${tempfile}.refr.agb ${tempfile}.pred.agb \
+    2> /dev/null | diff - $tempfile > /dev/null && \
+test $(wc -l < $tempfile) -gt 1
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape (binary input)" $result
+rm $tempfile ${tempfile}.refr.agb ${tempfile}.pred.agb ${tempfile}.refr.gff3 \
+   ${tempfile}.pred.gff3
+
+# The Amel data and a renamed copy are large enough to be parsed in chunks;
+# features parsed from chunks must still be matched to the input files
+cp data/gff3/amel-ogs-g7.gff3 ${tempfile}.refr.gff3
+grep -v '^##[^#]' data/gff3/amel-ogs-g7.gff3 | \
+    sed -e 's/^Group7/Copy7/' -e 's/ID=/ID=copy/' -e 's/Parent=/Parent=copy/' \
+    >> ${tempfile}.refr.gff3
+cp ${tempfile}.refr.gff3 ${tempfile}.pred.gff3
+bin/parseval --outformat=tsv ${tempfile}.refr.gff3 ${tempfile}.pred.gff3 \
+    2> /dev/null > $tempfile
+$memcheckcmd \
+bin/parseval --outformat=tsv --threads=4 ${tempfile}.refr.gff3 \
+    ${tempfile}.pred.gff3 2> /dev/null | diff - $tempfile > /dev/null && \
+test $(wc -l < $tempfile) -gt 1
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Amel Group7 (parsing threads)" $result
+rm $tempfile ${tempfile}.refr.gff3 ${tempfile}.pred.gff3
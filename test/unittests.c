@@ -8,21 +8,31 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 #include <string.h>
+#include "AgnAlignmentIndex.h"
 #include "AgnAttributeFilterStream.h"
+#include "AgnBinaryInStream.h"
+#include "AgnCanonStream.h"
+#include "AgnCdsIdVisitor.h"
 #include "AgnCliquePair.h"
+#include "AgnExternalSortStream.h"
 #include "AgnFilterStream.h"
 #include "AgnGaevalVisitor.h"
 #include "AgnGeneStream.h"
+#include "AgnGFF3ChunkStream.h"
+#include "AgnGFF3InStream.h"
 #include "AgnIdFilterStream.h"
+#include "AgnIdSet.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
 #include "AgnLocus.h"
 #include "AgnLocusRefineStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMapStream.h"
 #include "AgnMrnaRepVisitor.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSortCheckStream.h"
 #include "AgnTranscriptClique.h"
 
 int main(int argc, char **argv)
@@ -49,18 +59,38 @@ int main(int argc, char **argv)
                                         agn_locus_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnFilterStream",
                                         agn_filter_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGFF3InStream",
+                                        agn_gff3_in_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnBinaryInStream",
+                                        agn_binary_in_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGFF3ChunkStream",
+                                        agn_gff3_chunk_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnSortCheckStream",
+                                        agn_sort_check_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnExternalSortStream",
+                                        agn_external_sort_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnInferCDSVisitor",
                                         agn_infer_cds_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnInferExonsVisitor",
                                         agn_infer_exons_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGeneStream",
                                         agn_gene_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnCanonStream",
+                                        agn_canon_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnCdsIdVisitor",
+                                        agn_cds_id_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnMapStream",
+                                        agn_map_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusStream",
                                         agn_locus_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusRefineStream",
                                         agn_locus_refine_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnAlignmentIndex",
+                                        agn_alignment_index_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGaevalVisitor",
                                         agn_gaeval_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIdSet",
+                                        agn_id_set_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIdFilterStream",
                                         agn_id_filter_stream_unit_test));
 
@@ -21,3 +21,20 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "major royal jelly" $result
 rm $tempfile
+
+printf "mRNA1\n" > $tempfile.ids
+$memcheckcmd \
+bin/xtractore --type CDS \
+              --idfile $tempfile.ids \
+              --outfile $tempfile \
+              --width 80 \
+              data/gff3/mrj-isoforms.gff3 data/fasta/mrj.gdna.fa
+
+diff $tempfile data/fasta/mrj.cds.fa > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "major royal jelly (mRNA ID)" $result
+rm $tempfile $tempfile.ids